@@ -0,0 +1,383 @@
+/**
+ * @file AsyncBlockReader.cpp
+ * @brief Implements the io_uring and thread-pool back ends of AsyncBlockReader.
+ */
+
+#include "AsyncBlockReader.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+using namespace std;
+
+/**
+ * @brief Creates a reader.
+ * @param queueDepth Maximum reads in flight.
+ * @param preferred Back end to try first.
+ * @param fallbackThreads Worker count for the thread pool; 0 picks one per queue slot up to 64.
+ */
+AsyncBlockReader::AsyncBlockReader(unsigned queueDepth, AsyncBackend preferred, int fallbackThreads)
+    : activeBackend(preferred), depth(queueDepth > 0 ? queueDepth : 1), inFlight(0),
+      ringFd(-1), sqRing(MAP_FAILED), cqRing(MAP_FAILED), sqeArray(MAP_FAILED),
+      sqRingBytes(0), cqRingBytes(0), sqeBytes(0), sqTail(nullptr), sqHead(nullptr), sqMask(0),
+      sqIndices(nullptr), cqHead(nullptr), cqTail(nullptr), cqMask(0), cqes(nullptr),
+      unsubmitted(0), stopping(false)
+{
+    if (activeBackend == ASYNC_IO_URING && !setupRing())
+    {
+        teardownRing();
+        activeBackend = ASYNC_THREAD_POOL;
+    }
+    if (activeBackend == ASYNC_THREAD_POOL)
+    {
+        startWorkers(fallbackThreads);
+    }
+}
+
+/**
+ * @brief Waits for reads in flight, then releases the back end.
+ */
+AsyncBlockReader::~AsyncBlockReader()
+{
+    // The kernel and the workers write into caller buffers, so every read
+    // must finish before the reader goes away.
+    vector<BlockReadCompletion> drained;
+    while (inFlight > 0)
+    {
+        if (wait(drained, inFlight) == 0 && activeBackend == ASYNC_IO_URING)
+        {
+            break; // io_uring_enter() failed; nothing more will complete
+        }
+        drained.clear();
+    }
+
+    if (activeBackend == ASYNC_IO_URING)
+    {
+        teardownRing();
+    }
+    else
+    {
+        {
+            lock_guard<mutex> guard(queueLock);
+            stopping = true;
+        }
+        requestReady.notify_all();
+        for (thread &worker : workers)
+        {
+            worker.join();
+        }
+    }
+}
+
+/**
+ * @brief Creates and maps the io_uring rings.
+ *
+ * io_uring_setup() succeeds from Linux 5.1, but IORING_OP_READ only
+ * exists from 5.6, the release that also added IORING_REGISTER_PROBE.
+ * The ring is only used if the probe reports the opcode; otherwise every
+ * read would complete with -EINVAL.
+ *
+ * @return false if io_uring, or its read opcode, is not available.
+ */
+bool AsyncBlockReader::setupRing()
+{
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = syscall(__NR_io_uring_setup, depth, &params);
+    if (ringFd < 0)
+    {
+        ringFd = -1;
+        return false;
+    }
+
+    // Room for every opcode the u8 last_op can name, 8-byte aligned
+    const unsigned PROBE_OPS = 256;
+    vector<uint64_t> probeBuffer((sizeof(io_uring_probe) + PROBE_OPS * sizeof(io_uring_probe_op)) / 8, 0);
+    io_uring_probe *probe = (io_uring_probe *)probeBuffer.data();
+    if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe, PROBE_OPS) < 0 ||
+        probe->last_op < IORING_OP_READ || (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) == 0)
+    {
+        return false;
+    }
+
+    sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap)
+    {
+        sqRingBytes = cqRingBytes = sqRingBytes > cqRingBytes ? sqRingBytes : cqRingBytes;
+    }
+
+    sqRing = mmap(nullptr, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  ringFd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED)
+    {
+        return false;
+    }
+    cqRing = singleMap ? sqRing
+                       : mmap(nullptr, cqRingBytes, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    if (cqRing == MAP_FAILED)
+    {
+        return false;
+    }
+    sqeBytes = params.sq_entries * sizeof(io_uring_sqe);
+    sqeArray = mmap(nullptr, sqeBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ringFd, IORING_OFF_SQES);
+    if (sqeArray == MAP_FAILED)
+    {
+        return false;
+    }
+
+    char *sq = (char *)sqRing;
+    char *cq = (char *)cqRing;
+    sqHead = (unsigned *)(sq + params.sq_off.head);
+    sqTail = (unsigned *)(sq + params.sq_off.tail);
+    sqMask = *(unsigned *)(sq + params.sq_off.ring_mask);
+    sqIndices = (unsigned *)(sq + params.sq_off.array);
+    cqHead = (unsigned *)(cq + params.cq_off.head);
+    cqTail = (unsigned *)(cq + params.cq_off.tail);
+    cqMask = *(unsigned *)(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+
+    // The kernel rounds the ring up to a power of two; never keep more
+    // reads in flight than the caller asked for or the ring can hold.
+    if (depth > params.sq_entries)
+    {
+        depth = params.sq_entries;
+    }
+    return true;
+}
+
+/**
+ * @brief Unmaps and closes the io_uring rings.
+ */
+void AsyncBlockReader::teardownRing()
+{
+    if (sqeArray != MAP_FAILED)
+    {
+        munmap(sqeArray, sqeBytes);
+    }
+    if (cqRing != MAP_FAILED && cqRing != sqRing)
+    {
+        munmap(cqRing, cqRingBytes);
+    }
+    if (sqRing != MAP_FAILED)
+    {
+        munmap(sqRing, sqRingBytes);
+    }
+    if (ringFd >= 0)
+    {
+        close(ringFd);
+    }
+    sqRing = cqRing = sqeArray = MAP_FAILED;
+    ringFd = -1;
+}
+
+/**
+ * @brief Starts the pread() worker threads.
+ * @param threadCount Number of workers; 0 picks one per queue slot up to 64.
+ */
+void AsyncBlockReader::startWorkers(int threadCount)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = depth < 64 ? depth : 64;
+    }
+    for (int i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&AsyncBlockReader::workerLoop, this);
+    }
+}
+
+/**
+ * @brief pread() worker thread body.
+ */
+void AsyncBlockReader::workerLoop()
+{
+    unique_lock<mutex> guard(queueLock);
+    while (true)
+    {
+        requestReady.wait(guard, [this]
+                          { return stopping || !requests.empty(); });
+        if (requests.empty())
+        {
+            return;
+        }
+        BlockReadRequest request = requests.front();
+        requests.pop_front();
+        guard.unlock();
+
+        // Keep reading until the length is filled or the file ends, so a
+        // completion means the same thing as with io_uring.
+        int result = 0;
+        while (result < (int)request.length)
+        {
+            ssize_t count = pread(request.fd, request.buffer + result, request.length - result,
+                                  request.offset + result);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count < 0)
+            {
+                result = -errno;
+                break;
+            }
+            if (count == 0)
+            {
+                break;
+            }
+            result += count;
+        }
+
+        guard.lock();
+        completions.push_back({request.tag, result});
+        completionReady.notify_one();
+    }
+}
+
+/**
+ * @brief Queues a read.
+ * @param request The read.
+ * @return false if queueDepth reads are already in flight.
+ */
+bool AsyncBlockReader::submit(const BlockReadRequest &request)
+{
+    if (inFlight >= depth)
+    {
+        return false;
+    }
+    inFlight++;
+
+    if (activeBackend == ASYNC_IO_URING)
+    {
+        // Only this thread writes the tail, so a plain load is enough; the
+        // release store publishes the filled entry to the kernel.
+        unsigned tail = *sqTail;
+        unsigned index = tail & sqMask;
+        io_uring_sqe *entry = (io_uring_sqe *)sqeArray + index;
+        memset(entry, 0, sizeof(*entry));
+        entry->opcode = IORING_OP_READ;
+        entry->fd = request.fd;
+        entry->off = request.offset;
+        entry->addr = (uint64_t)(uintptr_t)request.buffer;
+        entry->len = request.length;
+        entry->user_data = request.tag;
+        sqIndices[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+        unsubmitted++;
+    }
+    else
+    {
+        {
+            lock_guard<mutex> guard(queueLock);
+            requests.push_back(request);
+        }
+        requestReady.notify_one();
+    }
+    return true;
+}
+
+/**
+ * @brief Starts queued reads and collects finished ones.
+ * @param out Receives the completions, in completion order.
+ * @param minimum Completions to wait for; 0 only polls.
+ * @return Number of completions appended.
+ */
+size_t AsyncBlockReader::wait(vector<BlockReadCompletion> &out, size_t minimum)
+{
+    if (minimum > inFlight)
+    {
+        minimum = inFlight;
+    }
+    size_t collected = 0;
+
+    if (activeBackend == ASYNC_THREAD_POOL)
+    {
+        unique_lock<mutex> guard(queueLock);
+        completionReady.wait(guard, [this, minimum]
+                             { return completions.size() >= minimum; });
+        collected = completions.size();
+        out.insert(out.end(), completions.begin(), completions.end());
+        completions.clear();
+        inFlight -= collected;
+        return collected;
+    }
+
+    while (true)
+    {
+        // Harvest whatever the kernel has posted.
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail)
+        {
+            const io_uring_cqe &entry = ((const io_uring_cqe *)cqes)[head & cqMask];
+            out.push_back({entry.user_data, entry.res});
+            head++;
+            collected++;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+
+        if (collected >= minimum && unsubmitted == 0)
+        {
+            break;
+        }
+
+        // One system call both hands over the queued reads and sleeps
+        // until enough of them have completed.
+        unsigned waitFor = collected < minimum ? minimum - collected : 0;
+        int submitted = syscall(__NR_io_uring_enter, ringFd, unsubmitted, waitFor,
+                                waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (submitted < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+            {
+                continue;
+            }
+            break;
+        }
+        unsubmitted -= (unsigned)submitted < unsubmitted ? submitted : unsubmitted;
+    }
+    inFlight -= collected;
+    return collected;
+}
+
+/**
+ * @brief Gets the number of reads submitted and not yet collected.
+ * @return The in-flight count.
+ */
+unsigned AsyncBlockReader::pending() const
+{
+    return inFlight;
+}
+
+/**
+ * @brief Gets the maximum number of reads in flight.
+ * @return The queue depth.
+ */
+unsigned AsyncBlockReader::capacity() const
+{
+    return depth;
+}
+
+/**
+ * @brief Gets the back end in use.
+ * @return The back end.
+ */
+AsyncBackend AsyncBlockReader::backend() const
+{
+    return activeBackend;
+}
+
+/**
+ * @brief Gets the name of the back end in use.
+ * @return "io_uring" or "thread pool".
+ */
+string AsyncBlockReader::backendName() const
+{
+    return activeBackend == ASYNC_IO_URING ? "io_uring" : "thread pool";
+}
@@ -0,0 +1,203 @@
+#ifndef ASYNC_BLOCK_READER
+#define ASYNC_BLOCK_READER
+
+/**
+ * @file AsyncBlockReader.h
+ * @brief Declares an asynchronous positional reader with many reads in flight.
+ *
+ * A lookup against an on-disk file normally issues one blocking pread()
+ * at a time, so the device never sees more than one outstanding request.
+ * AsyncBlockReader lets a single thread queue up to @c queueDepth reads
+ * and collect them as they finish, in whatever order the device completes
+ * them.
+ *
+ * Two back ends implement the same interface:
+ *  - io_uring (Linux 5.6+), driven through the raw system calls: reads are
+ *    written into the shared submission ring and handed to the kernel with
+ *    one io_uring_enter() per wait(), and completions are read back from
+ *    the completion ring without further system calls.
+ *  - a thread pool issuing blocking pread() calls, used when io_uring is
+ *    unavailable (older kernels, seccomp filters), lacks IORING_OP_READ
+ *    (5.1 to 5.5) or is explicitly requested.
+ */
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include <condition_variable>
+
+using namespace std;
+
+/**
+ * @enum AsyncBackend
+ * @brief Implementation used by an AsyncBlockReader.
+ */
+enum AsyncBackend
+{
+    ASYNC_IO_URING,   ///< Kernel io_uring submission / completion rings.
+    ASYNC_THREAD_POOL ///< Worker threads calling pread().
+};
+
+/**
+ * @struct BlockReadRequest
+ * @brief One positional read.
+ */
+struct BlockReadRequest
+{
+    int fd;          ///< File to read.
+    uint64_t offset; ///< Byte offset in the file.
+    uint32_t length; ///< Bytes to read.
+    char *buffer;    ///< Destination; must stay valid until the read completes.
+    uint64_t tag;    ///< Caller value returned with the completion.
+};
+
+/**
+ * @struct BlockReadCompletion
+ * @brief Result of one finished read.
+ */
+struct BlockReadCompletion
+{
+    uint64_t tag; ///< Tag of the request.
+    int result;   ///< Bytes read (short only at end of file), or -errno.
+};
+
+/**
+ * @class AsyncBlockReader
+ * @brief Queue of positional reads completed out of order by io_uring or a thread pool.
+ *
+ * The reader is meant to be driven by one thread: submit() and wait() are
+ * not safe to call concurrently.
+ */
+class AsyncBlockReader
+{
+private:
+    AsyncBackend activeBackend; ///< Back end in use.
+    unsigned depth;             ///< Maximum reads in flight.
+    unsigned inFlight;          ///< Reads submitted and not yet returned by wait().
+
+    // io_uring state
+    int ringFd;                 ///< io_uring instance, or -1.
+    void *sqRing;               ///< Mapped submission ring.
+    void *cqRing;               ///< Mapped completion ring (may equal sqRing).
+    void *sqeArray;             ///< Mapped submission queue entries.
+    size_t sqRingBytes;         ///< Size of the sqRing mapping.
+    size_t cqRingBytes;         ///< Size of the cqRing mapping.
+    size_t sqeBytes;            ///< Size of the sqeArray mapping.
+    unsigned *sqTail;           ///< Submission ring tail (written by us).
+    unsigned *sqHead;           ///< Submission ring head (written by the kernel).
+    unsigned sqMask;            ///< Submission ring index mask.
+    unsigned *sqIndices;        ///< Submission ring slot → SQE index array.
+    unsigned *cqHead;           ///< Completion ring head (written by us).
+    unsigned *cqTail;           ///< Completion ring tail (written by the kernel).
+    unsigned cqMask;            ///< Completion ring index mask.
+    void *cqes;                 ///< Completion queue entries.
+    unsigned unsubmitted;       ///< SQEs queued but not yet passed to io_uring_enter().
+
+    // thread-pool state
+    vector<thread> workers;                  ///< pread() workers.
+    mutex queueLock;                         ///< Guards the members below.
+    condition_variable requestReady;         ///< Signalled when a request is queued.
+    condition_variable completionReady;      ///< Signalled when a read finishes.
+    deque<BlockReadRequest> requests;        ///< Reads waiting for a worker.
+    vector<BlockReadCompletion> completions; ///< Finished reads not yet returned.
+    bool stopping;                           ///< Set when workers should exit.
+
+    /**
+     * @brief Creates and maps the io_uring rings.
+     * @return false if io_uring, or its read opcode, is not available.
+     */
+    bool setupRing();
+
+    /**
+     * @brief Unmaps and closes the io_uring rings.
+     */
+    void teardownRing();
+
+    /**
+     * @brief Starts the pread() worker threads.
+     * @param threadCount Number of workers; 0 picks one per queue slot up to 64.
+     */
+    void startWorkers(int threadCount);
+
+    /**
+     * @brief pread() worker thread body.
+     */
+    void workerLoop();
+
+public:
+    /**
+     * @brief Creates a reader.
+     *
+     * Falls back to the thread pool when io_uring is requested but cannot
+     * be set up.
+     *
+     * @param queueDepth Maximum reads in flight.
+     * @param preferred Back end to try first.
+     * @param fallbackThreads Worker count for the thread pool; 0 picks one per queue slot up to 64.
+     */
+    explicit AsyncBlockReader(unsigned queueDepth = 256, AsyncBackend preferred = ASYNC_IO_URING,
+                              int fallbackThreads = 0);
+
+    /**
+     * @brief Waits for reads in flight, then releases the back end.
+     */
+    ~AsyncBlockReader();
+
+    /// @brief Readers own kernel resources and are not copyable.
+    AsyncBlockReader(const AsyncBlockReader &) = delete;
+
+    /// @brief Readers are not copy-assignable.
+    AsyncBlockReader &operator=(const AsyncBlockReader &) = delete;
+
+    /**
+     * @brief Queues a read.
+     *
+     * With io_uring the read is only handed to the kernel by the next
+     * wait(), so a batch of submit() calls costs one system call.
+     *
+     * @param request The read.
+     * @return false if queueDepth reads are already in flight.
+     */
+    bool submit(const BlockReadRequest &request);
+
+    /**
+     * @brief Starts queued reads and collects finished ones.
+     *
+     * Blocks until at least @p minimum reads have finished (capped at the
+     * number in flight), then appends every finished read to @p out.
+     *
+     * @param out Receives the completions, in completion order.
+     * @param minimum Completions to wait for; 0 only polls.
+     * @return Number of completions appended.
+     */
+    size_t wait(vector<BlockReadCompletion> &out, size_t minimum = 1);
+
+    /**
+     * @brief Gets the number of reads submitted and not yet collected.
+     * @return The in-flight count.
+     */
+    unsigned pending() const;
+
+    /**
+     * @brief Gets the maximum number of reads in flight.
+     * @return The queue depth.
+     */
+    unsigned capacity() const;
+
+    /**
+     * @brief Gets the back end in use.
+     * @return The back end.
+     */
+    AsyncBackend backend() const;
+
+    /**
+     * @brief Gets the name of the back end in use.
+     * @return "io_uring" or "thread pool".
+     */
+    string backendName() const;
+};
+
+#endif
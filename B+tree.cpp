@@ -1,6 +1,13 @@
+#ifndef B_PLUS_TREE
+#define B_PLUS_TREE
+
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <vector>
+#include <cstddef>
+#include <string>
+#include <sstream>
 #include "PostalRecord.h"
 using namespace std;
 
@@ -11,6 +18,15 @@ using namespace std;
  * range query, and printing capabilities. The tree nodes
  * are represented by LinkedBlock structures.
  *
+ * Updates are copy-on-write: nodes are reference counted, and insert()
+ * and remove() copy every shared node on the path they modify (path
+ * copying) while untouched subtrees stay shared. snapshot() is therefore
+ * O(1): it takes a reference to the current root, and the version it
+ * names never changes however the tree is updated afterwards. Snapshots
+ * can be read and released on other threads while one thread updates
+ * the tree; insert(), remove() and snapshot() itself must not run
+ * concurrently with each other.
+ *
  * @tparam T Type of keys stored in the B+ tree.
  */
 template <typename T>
@@ -20,9 +36,10 @@ public:
     /**
      * @brief Node structure representing a B+ tree block.
      *
-     * Each LinkedBlock can be either an internal node or a leaf.
-     * Leaf nodes are linked together using the @c next pointer to
-     * support efficient range queries.
+     * Each LinkedBlock can be either an internal node or a leaf. Leaves
+     * are not chained: a leaf may be shared by several versions of the
+     * tree, which would each need a different successor, and in-order
+     * walks (rangeScan(), Iterator) go through the parents instead.
      */
     struct LinkedBlock
     {
@@ -41,12 +58,13 @@ public:
         vector<LinkedBlock *> children;
 
         /**
-         * @brief Pointer to the next leaf node.
+         * @brief Number of references to this node.
          *
-         * Used only when this node is a leaf. Supports fast
-         * traversal for range queries.
+         * Each parent, tree root and snapshot pointing at the node holds
+         * one. A node with more than one reference is shared between
+         * versions and is copied before it is modified.
          */
-        LinkedBlock *next;
+        atomic<int> refCount;
 
         /**
          * @brief Constructs a LinkedBlock node.
@@ -54,14 +72,391 @@ public:
          * @param leaf True if the node should be a leaf, false otherwise.
          */
         LinkedBlock(bool leaf = false)
-            : isLeaf(leaf), next(nullptr)
+            : isLeaf(leaf), refCount(1)
+        {
+        }
+    };
+
+    /**
+     * @brief Bytes used by the tree, broken down by node type.
+     *
+     * Byte counts include the node object itself plus the reserved
+     * capacity of its key and child vectors.
+     */
+    struct MemoryUsage
+    {
+        /// @brief Number of leaf nodes in the tree.
+        size_t leafNodes;
+
+        /// @brief Bytes used by leaf nodes.
+        size_t leafBytes;
+
+        /// @brief Number of internal nodes in the tree.
+        size_t internalNodes;
+
+        /// @brief Bytes used by internal nodes.
+        size_t internalBytes;
+
+        /// @brief Number of recycled nodes waiting in the free-list.
+        size_t freeNodes;
+
+        /// @brief Bytes held by the free-list.
+        size_t freeBytes;
+
+        /**
+         * @brief Gets the total bytes held by the tree and its free-list.
+         * @return The sum of leaf, internal and free-list bytes.
+         */
+        size_t totalBytes() const
+        {
+            return leafBytes + internalBytes + freeBytes;
+        }
+    };
+
+    /**
+     * @brief Shape statistics of the tree, as reported by stats().
+     *
+     * Used to tune the degree for the hardware and to spot fragmentation
+     * (low leaf fill, many underfull nodes) after many deletes.
+     */
+    struct TreeStats
+    {
+        /// @brief Minimum degree of the tree.
+        int degree;
+
+        /// @brief Number of levels (0 for an empty tree).
+        int height;
+
+        /// @brief Total number of keys stored.
+        size_t keyCount;
+
+        /// @brief Total number of nodes (leaves and internal).
+        size_t nodeCount;
+
+        /// @brief Number of leaf nodes.
+        size_t leafCount;
+
+        /// @brief Number of non-root nodes holding fewer than t-1 keys.
+        size_t underfullNodes;
+
+        /// @brief Node count per level; index 0 is the root level.
+        vector<size_t> nodesPerLevel;
+
+        /// @brief Average leaf keys divided by the maximum (2t-1), in [0, 1].
+        double leafFillFactor;
+
+        /// @brief Average number of keys per node.
+        double averageKeysPerNode;
+
+        /// @brief Bytes used by the tree (see memoryUsage()).
+        size_t bytesUsed;
+
+        /**
+         * @brief Histogram of search path lengths.
+         *
+         * Entry @c i is the number of keys whose search stops after
+         * visiting @c i nodes (a key held in the root has path length 1).
+         */
+        vector<size_t> searchPathHistogram;
+
+        /**
+         * @brief Exports the statistics as a single-line JSON object.
+         * @return The JSON text.
+         */
+        string toJson() const
         {
+            ostringstream json;
+            json << "{\"degree\":" << degree
+                 << ",\"height\":" << height
+                 << ",\"keys\":" << keyCount
+                 << ",\"nodes\":" << nodeCount
+                 << ",\"leaves\":" << leafCount
+                 << ",\"underfull_nodes\":" << underfullNodes
+                 << ",\"leaf_fill_factor\":" << leafFillFactor
+                 << ",\"avg_keys_per_node\":" << averageKeysPerNode
+                 << ",\"bytes\":" << bytesUsed
+                 << ",\"nodes_per_level\":[";
+            for (size_t i = 0; i < nodesPerLevel.size(); i++)
+            {
+                json << (i ? "," : "") << nodesPerLevel[i];
+            }
+            json << "],\"search_path_histogram\":[";
+            for (size_t i = 0; i < searchPathHistogram.size(); i++)
+            {
+                json << (i ? "," : "") << searchPathHistogram[i];
+            }
+            json << "]}";
+            return json.str();
+        }
+    };
+
+    /**
+     * @brief Forward iterator over the keys of a snapshot, in ascending order.
+     *
+     * Holds the path from the root to the current key. It stays valid as
+     * long as the Snapshot it came from; an iterator past the last key
+     * equals Snapshot::end().
+     */
+    class Iterator
+    {
+    private:
+        /// @brief Nodes from the root down to the current key, each with the index of its next key.
+        vector<pair<const LinkedBlock *, size_t>> path;
+
+        /**
+         * @brief Descends from a node to its smallest key.
+         * @param linkedBlock The subtree root.
+         */
+        void descendLeftmost(const LinkedBlock *linkedBlock)
+        {
+            while (true)
+            {
+                path.emplace_back(linkedBlock, 0);
+                if (linkedBlock->isLeaf)
+                {
+                    return;
+                }
+                linkedBlock = linkedBlock->children[0];
+            }
+        }
+
+        /**
+         * @brief Climbs out of nodes whose keys have all been visited.
+         *
+         * A parent's frame already points at the separator that follows
+         * the child being left, so it becomes the current key.
+         */
+        void skipVisited()
+        {
+            while (!path.empty() && path.back().second == path.back().first->keys.size())
+            {
+                path.pop_back();
+            }
+        }
+
+        friend class BPlusTree;
+
+    public:
+        /**
+         * @brief Constructs an iterator past the last key.
+         */
+        Iterator() {}
+
+        /**
+         * @brief Gets the current key.
+         * @return The key.
+         */
+        const T &operator*() const
+        {
+            return path.back().first->keys[path.back().second];
+        }
+
+        /**
+         * @brief Moves to the next key.
+         * @return This iterator.
+         */
+        Iterator &operator++()
+        {
+            pair<const LinkedBlock *, size_t> &top = path.back();
+            top.second++;
+            if (!top.first->isLeaf)
+            {
+                descendLeftmost(top.first->children[top.second]);
+            }
+            skipVisited();
+            return *this;
+        }
+
+        /**
+         * @brief Compares the positions of two iterators of the same snapshot.
+         * @param other The other iterator.
+         * @return true if both are at the same key, or both past the end.
+         */
+        bool operator==(const Iterator &other) const
+        {
+            return path.empty() ? other.path.empty() : !other.path.empty() && path.back() == other.path.back();
+        }
+
+        /**
+         * @brief Compares the positions of two iterators of the same snapshot.
+         * @param other The other iterator.
+         * @return true unless both are at the same key or both past the end.
+         */
+        bool operator!=(const Iterator &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * @brief A frozen version of the tree.
+     *
+     * Shares its nodes with the tree and with other snapshots; later
+     * updates of the tree copy the nodes they change, so a snapshot keeps
+     * answering from the version it was taken of. Copying a snapshot is
+     * O(1). The nodes only its version uses are freed when the last
+     * snapshot holding them is destroyed.
+     */
+    class Snapshot
+    {
+    private:
+        /// @brief Root of the version, holding one reference (nullptr for an empty tree).
+        LinkedBlock *root;
+
+        /**
+         * @brief Takes a reference to a version.
+         * @param version Root of the version.
+         */
+        explicit Snapshot(LinkedBlock *version) : root(version)
+        {
+            if (root != nullptr)
+            {
+                root->refCount++;
+            }
+        }
+
+        friend class BPlusTree;
+
+    public:
+        /**
+         * @brief Constructs a snapshot of an empty tree.
+         */
+        Snapshot() : root(nullptr) {}
+
+        /**
+         * @brief Shares another snapshot's version.
+         * @param other The snapshot.
+         */
+        Snapshot(const Snapshot &other) : Snapshot(other.root) {}
+
+        /**
+         * @brief Takes over another snapshot's version.
+         * @param other The snapshot, left empty.
+         */
+        Snapshot(Snapshot &&other) : root(other.root)
+        {
+            other.root = nullptr;
+        }
+
+        /**
+         * @brief Replaces this snapshot's version with another one.
+         * @param other The snapshot to share.
+         * @return This snapshot.
+         */
+        Snapshot &operator=(Snapshot other)
+        {
+            swap(root, other.root);
+            return *this;
+        }
+
+        /**
+         * @brief Releases the version.
+         */
+        ~Snapshot()
+        {
+            release(root, nullptr);
+        }
+
+        /**
+         * @brief Searches the version for a key.
+         * @param key Key to search for.
+         * @return true if the key was in the tree when the snapshot was taken.
+         */
+        bool search(T key) const
+        {
+            return BPlusTree::search(root, key);
+        }
+
+        /**
+         * @brief Visits every key of the version in [lower, upper] in ascending order.
+         *
+         * See BPlusTree::rangeScan(T, T, Visitor, size_t).
+         *
+         * @tparam Visitor Callable taking a const T&.
+         * @param lower Lower bound of the range (inclusive).
+         * @param upper Upper bound of the range (inclusive).
+         * @param visit Called once per key in the range.
+         * @param limit Maximum number of keys to visit.
+         * @return size_t Number of keys visited.
+         */
+        template <typename Visitor>
+        size_t rangeScan(T lower, T upper, Visitor visit, size_t limit = (size_t)-1) const
+        {
+            return BPlusTree::rangeScan(root, lower, upper, visit, limit);
+        }
+
+        /**
+         * @brief Reports the memory held only by this snapshot.
+         *
+         * Nodes shared with the tree or with other snapshots are not
+         * counted, so this is what the tree's updates since the snapshot
+         * cost, and what releasing the last copy of the snapshot frees.
+         *
+         * @return Node counts and bytes of the unshared leaves and internal nodes.
+         */
+        MemoryUsage memoryUsage() const
+        {
+            MemoryUsage usage = {0, 0, 0, 0, 0, 0};
+            unsharedMemoryUsage(root, usage);
+            return usage;
+        }
+
+        /**
+         * @brief Gets an iterator at the smallest key of the version.
+         * @return The iterator.
+         */
+        Iterator begin() const
+        {
+            Iterator it;
+            if (root != nullptr)
+            {
+                it.descendLeftmost(root);
+                it.skipVisited();
+            }
+            return it;
+        }
+
+        /**
+         * @brief Gets an iterator at the first key not less than a given key.
+         * @param key The key.
+         * @return The iterator, or end() if every key is smaller.
+         */
+        Iterator lowerBound(T key) const
+        {
+            Iterator it;
+            for (const LinkedBlock *linkedBlock = root; linkedBlock != nullptr;
+                 linkedBlock = linkedBlock->isLeaf ? nullptr : linkedBlock->children[it.path.back().second])
+            {
+                it.path.emplace_back(linkedBlock, lower_bound(linkedBlock->keys.begin(),
+                                                              linkedBlock->keys.end(), key) -
+                                                      linkedBlock->keys.begin());
+            }
+            it.skipVisited();
+            return it;
+        }
+
+        /**
+         * @brief Gets the iterator past the last key.
+         * @return The iterator.
+         */
+        Iterator end() const
+        {
+            return Iterator();
         }
     };
 
     /// @brief Pointer to the root node of the B+ tree.
     LinkedBlock *root;
 
+    /**
+     * @brief Recycled nodes available for reuse.
+     *
+     * Nodes released by merge() or root collapse are kept here with their
+     * key and child vector capacity intact, so the next splitChild() reuses
+     * them instead of going back to the heap.
+     */
+    vector<LinkedBlock *> freeList;
+
     /**
      * @brief Minimum degree of the B+ tree.
      *
@@ -71,6 +466,76 @@ public:
      */
     int t;
 
+    /**
+     * @brief Gets a node from the free-list, or allocates a new one.
+     *
+     * Fresh nodes reserve room for a full node (2t-1 keys, 2t children) so
+     * their vectors never reallocate while the node is in use.
+     *
+     * @param leaf True if the node should be a leaf, false otherwise.
+     * @return Pointer to an empty node.
+     */
+    LinkedBlock *allocateBlock(bool leaf);
+
+    /**
+     * @brief Returns an unlinked node to the free-list.
+     *
+     * @param linkedBlock Pointer to the node to recycle.
+     */
+    void releaseBlock(LinkedBlock *linkedBlock);
+
+    /**
+     * @brief Drops one reference to a node.
+     *
+     * When it was the last one, the node's children are released in turn
+     * and the node is freed.
+     *
+     * @param linkedBlock Pointer to the node, or nullptr.
+     * @param recycle Free-list receiving freed nodes, or nullptr to delete them.
+     */
+    static void release(LinkedBlock *linkedBlock, vector<LinkedBlock *> *recycle);
+
+    /**
+     * @brief Makes the node held by a child pointer private to this tree.
+     *
+     * A node with a single reference is returned as is. A shared node is
+     * copied: the copy references the same children, replaces the node in
+     * @p slot, and the original loses the reference @p slot held. Updates
+     * call this on each node of their path from the root down, so the
+     * nodes they modify are private and every other node stays shared.
+     *
+     * @param slot The root pointer, or a child pointer of a private node.
+     * @return The private node now held by @p slot.
+     */
+    LinkedBlock *writable(LinkedBlock *&slot);
+
+    /**
+     * @brief Gets the bytes used by one node.
+     *
+     * @param linkedBlock Pointer to the node.
+     * @return The node object plus the capacity of its vectors.
+     */
+    static size_t blockBytes(const LinkedBlock *linkedBlock);
+
+    /**
+     * @brief Accumulates memory usage for the subtree rooted at a node.
+     *
+     * @param linkedBlock Pointer to the subtree root.
+     * @param usage Totals to add to.
+     */
+    void memoryUsage(const LinkedBlock *linkedBlock, MemoryUsage &usage) const;
+
+    /**
+     * @brief Accumulates memory usage of the nodes below a node that have a single reference.
+     *
+     * Stops at shared nodes: they and everything below them are reachable
+     * from another version as well.
+     *
+     * @param linkedBlock Pointer to the subtree root.
+     * @param usage Totals to add to.
+     */
+    static void unsharedMemoryUsage(const LinkedBlock *linkedBlock, MemoryUsage &usage);
+
     /**
      * @brief Splits a full child node of an internal node.
      *
@@ -146,6 +611,47 @@ public:
      */
     void printTree(LinkedBlock *linkedBlock, int level);
 
+    /**
+     * @brief Searches for a key below a node.
+     *
+     * @param linkedBlock Pointer to the subtree root, or nullptr.
+     * @param key Key to search for.
+     * @return true If the key is found.
+     */
+    static bool search(const LinkedBlock *linkedBlock, T key);
+
+    /**
+     * @brief Visits every key in [lower, upper] below a node in ascending order.
+     *
+     * Shared by the tree and its snapshots; see the public rangeScan().
+     *
+     * @param linkedBlock Pointer to the subtree root, or nullptr.
+     * @param lower Lower bound of the range (inclusive).
+     * @param upper Upper bound of the range (inclusive).
+     * @param visit Called once per key in the range.
+     * @param limit Maximum number of keys to visit.
+     * @return size_t Number of keys visited.
+     */
+    template <typename Visitor>
+    static size_t rangeScan(const LinkedBlock *linkedBlock, T lower, T upper, Visitor &visit, size_t limit);
+
+    /**
+     * @brief In-order scan of the keys in [lower, upper] below a node.
+     *
+     * Recursive helper for the public rangeScan() function.
+     *
+     * @param linkedBlock Pointer to the current node.
+     * @param lower Lower bound of the range (inclusive).
+     * @param upper Upper bound of the range (inclusive).
+     * @param visit Called once per key in the range.
+     * @param count Incremented once per key visited.
+     * @param limit Maximum number of keys to visit.
+     * @return false once a key past @p upper has been seen or the limit is reached.
+     */
+    template <typename Visitor>
+    static bool rangeScan(const LinkedBlock *linkedBlock, T lower, T upper,
+                          Visitor &visit, size_t &count, size_t limit);
+
 public:
     /**
      * @brief Constructs a B+ tree with a given minimum degree.
@@ -154,6 +660,17 @@ public:
      */
     BPlusTree(int degree) : root(nullptr), t(degree) {}
 
+    /**
+     * @brief Destroys the tree, freeing the free-list and every node no snapshot holds.
+     */
+    ~BPlusTree();
+
+    /// @brief Trees own their nodes and are not copyable.
+    BPlusTree(const BPlusTree &) = delete;
+
+    /// @brief Trees own their nodes and are not copy-assignable.
+    BPlusTree &operator=(const BPlusTree &) = delete;
+
     /**
      * @brief Inserts a key into the B+ tree.
      *
@@ -192,14 +709,288 @@ public:
      */
     vector<T> rangeQuery(T lower, T upper);
 
+    /**
+     * @brief Visits every key in [lower, upper] in ascending order.
+     *
+     * Splits promote separator keys into internal nodes, so a range is not
+     * fully contained in the leaf chain; the scan descends to the first
+     * leaf of the range and walks the tree in order, visiting separator
+     * keys between their children, and stops at the first key past
+     * @p upper.
+     *
+     * @tparam Visitor Callable taking a const T&.
+     * @param lower Lower bound of the range (inclusive).
+     * @param upper Upper bound of the range (inclusive).
+     * @param visit Called once per key in the range.
+     * @param limit Maximum number of keys to visit; the scan stops early
+     *              once reached, so a caller can resume from the last key.
+     * @return size_t Number of keys visited.
+     */
+    template <typename Visitor>
+    size_t rangeScan(T lower, T upper, Visitor visit, size_t limit = (size_t)-1);
+
+    /**
+     * @brief Takes a snapshot of the current version in O(1).
+     *
+     * Scans of the snapshot see exactly the keys the tree holds now,
+     * whatever insert() and remove() do afterwards.
+     *
+     * @return The snapshot.
+     */
+    Snapshot snapshot() const;
+
     /**
      * @brief Prints the entire B+ tree to standard output.
      *
      * Wrapper around the recursive printTree(LinkedBlock*, int) function.
      */
     void printTree();
+
+    /**
+     * @brief Reports the memory used by the tree, by node type.
+     *
+     * @return Node counts and bytes for leaves, internal nodes and the free-list.
+     */
+    MemoryUsage memoryUsage() const;
+
+    /**
+     * @brief Returns every recycled node on the free-list to the heap.
+     */
+    void releaseFreeList();
+
+    /**
+     * @brief Collects shape statistics of the tree.
+     *
+     * Walks the tree level by level once; cost is linear in the node count.
+     *
+     * @return Height, per-level node counts, fill factors, bytes used and
+     *         the search path length histogram.
+     */
+    TreeStats stats() const;
 };
 
+// Implementation of allocateBlock function
+/**
+ * @brief Gets a recycled node or allocates a new one.
+ *
+ * See BPlusTree::allocateBlock for detailed description.
+ */
+template <typename T>
+typename BPlusTree<T>::LinkedBlock *BPlusTree<T>::allocateBlock(bool leaf)
+{
+    LinkedBlock *linkedBlock;
+    if (!freeList.empty())
+    {
+        linkedBlock = freeList.back();
+        freeList.pop_back();
+        linkedBlock->isLeaf = leaf;
+        linkedBlock->refCount = 1;
+    }
+    else
+    {
+        linkedBlock = new LinkedBlock(leaf);
+        linkedBlock->keys.reserve(2 * t - 1);
+        if (!leaf)
+        {
+            linkedBlock->children.reserve(2 * t);
+        }
+    }
+    return linkedBlock;
+}
+
+// Implementation of releaseBlock function
+/**
+ * @brief Clears a node and pushes it onto the free-list.
+ *
+ * See BPlusTree::releaseBlock for detailed description.
+ */
+template <typename T>
+void BPlusTree<T>::releaseBlock(LinkedBlock *linkedBlock)
+{
+    linkedBlock->keys.clear();
+    linkedBlock->children.clear();
+    freeList.push_back(linkedBlock);
+}
+
+// Implementation of release function
+/**
+ * @brief Drops a reference and frees the node when it was the last.
+ *
+ * Snapshots release their nodes with no free-list, so they can be
+ * destroyed on any thread.
+ *
+ * See BPlusTree::release for detailed description.
+ */
+template <typename T>
+void BPlusTree<T>::release(LinkedBlock *linkedBlock, vector<LinkedBlock *> *recycle)
+{
+    if (linkedBlock == nullptr || linkedBlock->refCount.fetch_sub(1) > 1)
+    {
+        return;
+    }
+    for (LinkedBlock *child : linkedBlock->children)
+    {
+        release(child, recycle);
+    }
+    if (recycle != nullptr)
+    {
+        linkedBlock->keys.clear();
+        linkedBlock->children.clear();
+        recycle->push_back(linkedBlock);
+    }
+    else
+    {
+        delete linkedBlock;
+    }
+}
+
+// Implementation of writable function
+/**
+ * @brief Copies a shared node so it can be modified.
+ *
+ * See BPlusTree::writable for detailed description.
+ */
+template <typename T>
+typename BPlusTree<T>::LinkedBlock *BPlusTree<T>::writable(LinkedBlock *&slot)
+{
+    LinkedBlock *shared = slot;
+    if (shared->refCount.load() == 1)
+    {
+        return shared;
+    }
+    LinkedBlock *copy = allocateBlock(shared->isLeaf);
+    copy->keys.assign(shared->keys.begin(), shared->keys.end());
+    copy->children.assign(shared->children.begin(), shared->children.end());
+    for (LinkedBlock *child : copy->children)
+    {
+        child->refCount++;
+    }
+    slot = copy;
+    release(shared, &freeList);
+    return copy;
+}
+
+// Implementation of destructor
+/**
+ * @brief Frees the free-list and every node that no snapshot still holds.
+ */
+template <typename T>
+BPlusTree<T>::~BPlusTree()
+{
+    release(root, nullptr);
+    releaseFreeList();
+}
+
+// Implementation of releaseFreeList function
+/**
+ * @brief Deletes all recycled nodes.
+ *
+ * See BPlusTree::releaseFreeList for detailed description.
+ */
+template <typename T>
+void BPlusTree<T>::releaseFreeList()
+{
+    for (LinkedBlock *linkedBlock : freeList)
+    {
+        delete linkedBlock;
+    }
+    freeList.clear();
+    freeList.shrink_to_fit();
+}
+
+// Implementation of blockBytes function
+/**
+ * @brief Computes the bytes used by one node.
+ *
+ * See BPlusTree::blockBytes for detailed description.
+ */
+template <typename T>
+size_t BPlusTree<T>::blockBytes(const LinkedBlock *linkedBlock)
+{
+    return sizeof(LinkedBlock) +
+           linkedBlock->keys.capacity() * sizeof(T) +
+           linkedBlock->children.capacity() * sizeof(LinkedBlock *);
+}
+
+// Implementation of memoryUsage function (internal helper)
+/**
+ * @brief Recursively accumulates per-type node counts and bytes.
+ *
+ * See BPlusTree::memoryUsage(const LinkedBlock*, MemoryUsage&) for detailed description.
+ */
+template <typename T>
+void BPlusTree<T>::memoryUsage(const LinkedBlock *linkedBlock,
+                               MemoryUsage &usage) const
+{
+    if (linkedBlock == nullptr)
+    {
+        return;
+    }
+    if (linkedBlock->isLeaf)
+    {
+        usage.leafNodes++;
+        usage.leafBytes += blockBytes(linkedBlock);
+    }
+    else
+    {
+        usage.internalNodes++;
+        usage.internalBytes += blockBytes(linkedBlock);
+        for (const LinkedBlock *child : linkedBlock->children)
+        {
+            memoryUsage(child, usage);
+        }
+    }
+}
+
+// Implementation of unsharedMemoryUsage function
+/**
+ * @brief Recursively accumulates node counts and bytes of unshared nodes.
+ *
+ * See BPlusTree::unsharedMemoryUsage for detailed description.
+ */
+template <typename T>
+void BPlusTree<T>::unsharedMemoryUsage(const LinkedBlock *linkedBlock, MemoryUsage &usage)
+{
+    if (linkedBlock == nullptr || linkedBlock->refCount.load() > 1)
+    {
+        return;
+    }
+    if (linkedBlock->isLeaf)
+    {
+        usage.leafNodes++;
+        usage.leafBytes += blockBytes(linkedBlock);
+    }
+    else
+    {
+        usage.internalNodes++;
+        usage.internalBytes += blockBytes(linkedBlock);
+        for (const LinkedBlock *child : linkedBlock->children)
+        {
+            unsharedMemoryUsage(child, usage);
+        }
+    }
+}
+
+// Implementation of memoryUsage function (public)
+/**
+ * @brief Reports tree and free-list memory by node type.
+ *
+ * See BPlusTree::memoryUsage() for detailed description.
+ */
+template <typename T>
+typename BPlusTree<T>::MemoryUsage BPlusTree<T>::memoryUsage() const
+{
+    MemoryUsage usage = {0, 0, 0, 0, 0, 0};
+    memoryUsage(root, usage);
+    usage.freeNodes = freeList.size();
+    for (const LinkedBlock *linkedBlock : freeList)
+    {
+        usage.freeBytes += blockBytes(linkedBlock);
+    }
+    usage.freeBytes += freeList.capacity() * sizeof(LinkedBlock *);
+    return usage;
+}
+
 // Implementation of splitChild function
 /**
  * @brief Splits a full child node of an internal node.
@@ -210,7 +1001,7 @@ template <typename T>
 void BPlusTree<T>::splitChild(LinkedBlock *parent, int index,
                               LinkedBlock *child)
 {
-    LinkedBlock *newChild = new LinkedBlock(child->isLeaf);
+    LinkedBlock *newChild = allocateBlock(child->isLeaf);
     parent->children.insert(
         parent->children.begin() + index + 1, newChild);
     parent->keys.insert(parent->keys.begin() + index,
@@ -226,12 +1017,6 @@ void BPlusTree<T>::splitChild(LinkedBlock *parent, int index,
                                   child->children.end());
         child->children.resize(t);
     }
-
-    if (child->isLeaf)
-    {
-        newChild->next = child->next;
-        child->next = newChild;
-    }
 }
 
 // Implementation of insertNonFull function
@@ -258,9 +1043,10 @@ void BPlusTree<T>::insertNonFull(LinkedBlock *linkedBlock, T key)
             i--;
         }
         i++;
-        if (linkedBlock->children[i]->keys.size() == 2 * t - 1)
+        LinkedBlock *child = writable(linkedBlock->children[i]);
+        if (child->keys.size() == (size_t)(2 * t - 1))
         {
-            splitChild(linkedBlock, i, linkedBlock->children[i]);
+            splitChild(linkedBlock, i, child);
             if (key > linkedBlock->keys[i])
             {
                 i++;
@@ -305,7 +1091,7 @@ void BPlusTree<T>::remove(LinkedBlock *linkedBlock, T key)
                 }
                 T pred = predLinkedBlock->keys.back();
                 linkedBlock->keys[idx] = pred;
-                remove(linkedBlock->children[idx], pred);
+                remove(writable(linkedBlock->children[idx]), pred);
             }
             else if (linkedBlock->children[idx + 1]->keys.size() >= t)
             {
@@ -316,7 +1102,7 @@ void BPlusTree<T>::remove(LinkedBlock *linkedBlock, T key)
                 }
                 T succ = succLinkedBlock->keys.front();
                 linkedBlock->keys[idx] = succ;
-                remove(linkedBlock->children[idx + 1], succ);
+                remove(writable(linkedBlock->children[idx + 1]), succ);
             }
             else
             {
@@ -345,11 +1131,13 @@ void BPlusTree<T>::remove(LinkedBlock *linkedBlock, T key)
                     }
                     else
                     {
+                        // The child was folded into its left sibling
                         merge(linkedBlock, idx - 1);
+                        idx--;
                     }
                 }
             }
-            remove(linkedBlock->children[idx], key);
+            remove(writable(linkedBlock->children[idx]), key);
         }
     }
 }
@@ -363,8 +1151,8 @@ void BPlusTree<T>::remove(LinkedBlock *linkedBlock, T key)
 template <typename T>
 void BPlusTree<T>::borrowFromPrev(LinkedBlock *linkedBlock, int index)
 {
-    LinkedBlock *child = linkedBlock->children[index];
-    LinkedBlock *sibling = linkedBlock->children[index - 1];
+    LinkedBlock *child = writable(linkedBlock->children[index]);
+    LinkedBlock *sibling = writable(linkedBlock->children[index - 1]);
 
     child->keys.insert(child->keys.begin(),
                        linkedBlock->keys[index - 1]);
@@ -388,8 +1176,8 @@ void BPlusTree<T>::borrowFromPrev(LinkedBlock *linkedBlock, int index)
 template <typename T>
 void BPlusTree<T>::borrowFromNext(LinkedBlock *linkedBlock, int index)
 {
-    LinkedBlock *child = linkedBlock->children[index];
-    LinkedBlock *sibling = linkedBlock->children[index + 1];
+    LinkedBlock *child = writable(linkedBlock->children[index]);
+    LinkedBlock *sibling = writable(linkedBlock->children[index + 1]);
 
     child->keys.push_back(linkedBlock->keys[index]);
     linkedBlock->keys[index] = sibling->keys.front();
@@ -407,12 +1195,16 @@ void BPlusTree<T>::borrowFromNext(LinkedBlock *linkedBlock, int index)
 /**
  * @brief Merges a child node with its right sibling.
  *
+ * The sibling is only read, so it is not copied when shared: the child
+ * takes its own references to the sibling's children and the parent's
+ * reference to the sibling is dropped.
+ *
  * See BPlusTree::merge for detailed description.
  */
 template <typename T>
 void BPlusTree<T>::merge(LinkedBlock *linkedBlock, int index)
 {
-    LinkedBlock *child = linkedBlock->children[index];
+    LinkedBlock *child = writable(linkedBlock->children[index]);
     LinkedBlock *sibling = linkedBlock->children[index + 1];
 
     child->keys.push_back(linkedBlock->keys[index]);
@@ -421,6 +1213,10 @@ void BPlusTree<T>::merge(LinkedBlock *linkedBlock, int index)
                        sibling->keys.end());
     if (!child->isLeaf)
     {
+        for (LinkedBlock *grandchild : sibling->children)
+        {
+            grandchild->refCount++;
+        }
         child->children.insert(child->children.end(),
                                sibling->children.begin(),
                                sibling->children.end());
@@ -429,7 +1225,7 @@ void BPlusTree<T>::merge(LinkedBlock *linkedBlock, int index)
     linkedBlock->keys.erase(linkedBlock->keys.begin() + index);
     linkedBlock->children.erase(linkedBlock->children.begin() + index + 1);
 
-    delete sibling;
+    release(sibling, &freeList);
 }
 
 // Implementation of printTree function
@@ -478,7 +1274,19 @@ void BPlusTree<T>::printTree()
 template <typename T>
 bool BPlusTree<T>::search(T key)
 {
-    LinkedBlock *current = root;
+    return search(root, key);
+}
+
+// Implementation of search function (internal helper)
+/**
+ * @brief Searches for a key starting from a given node.
+ *
+ * See BPlusTree::search(const LinkedBlock*, T) for detailed description.
+ */
+template <typename T>
+bool BPlusTree<T>::search(const LinkedBlock *linkedBlock, T key)
+{
+    const LinkedBlock *current = linkedBlock;
     while (current != nullptr)
     {
         int i = 0;
@@ -503,8 +1311,7 @@ bool BPlusTree<T>::search(T key)
 /**
  * @brief Executes a range query on the B+ tree.
  *
- * Starts from the leaf node where the lower bound would
- * be located and traverses forward using leaf links.
+ * Collects the keys visited by rangeScan().
  *
  * See BPlusTree::rangeQuery for detailed description.
  */
@@ -512,32 +1319,90 @@ template <typename T>
 vector<T> BPlusTree<T>::rangeQuery(T lower, T upper)
 {
     vector<T> result;
-    LinkedBlock *current = root;
-    while (!current->isLeaf)
+    rangeScan(lower, upper, [&result](const T &key)
+              { result.push_back(key); });
+    return result;
+}
+
+// Implementation of rangeScan function (internal helper)
+/**
+ * @brief Recursive in-order range scan.
+ *
+ * Children left of the first key >= lower hold only smaller keys and are
+ * skipped; each remaining child is scanned before its separator key.
+ *
+ * See BPlusTree::rangeScan(LinkedBlock*, T, T, Visitor&, size_t&, size_t) for detailed description.
+ */
+template <typename T>
+template <typename Visitor>
+bool BPlusTree<T>::rangeScan(const LinkedBlock *linkedBlock, T lower, T upper,
+                             Visitor &visit, size_t &count, size_t limit)
+{
+    size_t i = lower_bound(linkedBlock->keys.begin(),
+                           linkedBlock->keys.end(), lower) -
+               linkedBlock->keys.begin();
+    for (; i < linkedBlock->keys.size(); i++)
     {
-        int i = 0;
-        while (i < current->keys.size() && lower > current->keys[i])
+        if (!linkedBlock->isLeaf &&
+            !rangeScan(linkedBlock->children[i], lower, upper, visit, count, limit))
         {
-            i++;
+            return false;
         }
-        current = current->children[i];
-    }
-    while (current != nullptr)
-    {
-        for (const T &key : current->keys)
+        if (upper < linkedBlock->keys[i] || count == limit)
         {
-            if (key >= lower && key <= upper)
-            {
-                result.push_back(key);
-            }
-            if (key > upper)
-            {
-                return result;
-            }
+            return false;
         }
-        current = current->next;
+        visit(linkedBlock->keys[i]);
+        count++;
     }
-    return result;
+    if (!linkedBlock->isLeaf)
+    {
+        return rangeScan(linkedBlock->children.back(), lower, upper, visit, count, limit);
+    }
+    return true;
+}
+
+// Implementation of rangeScan function (public)
+/**
+ * @brief Visits every key in a closed range in ascending order.
+ *
+ * See BPlusTree::rangeScan(T, T, Visitor, size_t) for detailed description.
+ */
+template <typename T>
+template <typename Visitor>
+size_t BPlusTree<T>::rangeScan(T lower, T upper, Visitor visit, size_t limit)
+{
+    return rangeScan(root, lower, upper, visit, limit);
+}
+
+// Implementation of rangeScan function (from a node)
+/**
+ * @brief Visits every key in a closed range below a node.
+ *
+ * See BPlusTree::rangeScan(const LinkedBlock*, T, T, Visitor&, size_t) for detailed description.
+ */
+template <typename T>
+template <typename Visitor>
+size_t BPlusTree<T>::rangeScan(const LinkedBlock *linkedBlock, T lower, T upper, Visitor &visit, size_t limit)
+{
+    size_t count = 0;
+    if (linkedBlock != nullptr && !(upper < lower) && limit > 0)
+    {
+        rangeScan(linkedBlock, lower, upper, visit, count, limit);
+    }
+    return count;
+}
+
+// Implementation of snapshot function
+/**
+ * @brief Shares the current root with a new snapshot.
+ *
+ * See BPlusTree::snapshot for detailed description.
+ */
+template <typename T>
+typename BPlusTree<T>::Snapshot BPlusTree<T>::snapshot() const
+{
+    return Snapshot(root);
 }
 
 // Implementation of insert function
@@ -551,16 +1416,17 @@ void BPlusTree<T>::insert(T key)
 {
     if (root == nullptr)
     {
-        root = new LinkedBlock(true);
+        root = allocateBlock(true);
         root->keys.push_back(key);
     }
     else
     {
-        if (root->keys.size() == 2 * t - 1)
+        LinkedBlock *top = writable(root);
+        if (top->keys.size() == (size_t)(2 * t - 1))
         {
-            LinkedBlock *newRoot = new LinkedBlock();
-            newRoot->children.push_back(root);
-            splitChild(newRoot, 0, root);
+            LinkedBlock *newRoot = allocateBlock(false);
+            newRoot->children.push_back(top);
+            splitChild(newRoot, 0, top);
             root = newRoot;
         }
         insertNonFull(root, key);
@@ -580,11 +1446,81 @@ void BPlusTree<T>::remove(T key)
     {
         return;
     }
-    remove(root, key);
+    remove(writable(root), key);
     if (root->keys.empty() && !root->isLeaf)
     {
         LinkedBlock *tmp = root;
         root = root->children[0];
-        delete tmp;
+        releaseBlock(tmp);
+    }
+}
+
+// Implementation of stats function
+/**
+ * @brief Walks the tree level by level and gathers shape statistics.
+ *
+ * Keys are never duplicated between levels, so every key held at depth
+ * @c d (0-based) is found by a search that visits @c d+1 nodes.
+ *
+ * See BPlusTree::stats for detailed description.
+ */
+template <typename T>
+typename BPlusTree<T>::TreeStats BPlusTree<T>::stats() const
+{
+    TreeStats result;
+    result.degree = t;
+    result.height = 0;
+    result.keyCount = 0;
+    result.nodeCount = 0;
+    result.leafCount = 0;
+    result.underfullNodes = 0;
+    result.leafFillFactor = 0;
+    result.averageKeysPerNode = 0;
+    result.bytesUsed = memoryUsage().totalBytes();
+    result.searchPathHistogram.push_back(0);
+
+    size_t leafKeys = 0;
+    vector<const LinkedBlock *> level;
+    if (root != nullptr)
+    {
+        level.push_back(root);
+    }
+    while (!level.empty())
+    {
+        vector<const LinkedBlock *> nextLevel;
+        size_t levelKeys = 0;
+        for (const LinkedBlock *linkedBlock : level)
+        {
+            levelKeys += linkedBlock->keys.size();
+            if (linkedBlock != root && linkedBlock->keys.size() < (size_t)(t - 1))
+            {
+                result.underfullNodes++;
+            }
+            if (linkedBlock->isLeaf)
+            {
+                result.leafCount++;
+                leafKeys += linkedBlock->keys.size();
+            }
+            nextLevel.insert(nextLevel.end(), linkedBlock->children.begin(),
+                             linkedBlock->children.end());
+        }
+        result.height++;
+        result.nodesPerLevel.push_back(level.size());
+        result.nodeCount += level.size();
+        result.keyCount += levelKeys;
+        result.searchPathHistogram.push_back(levelKeys);
+        level.swap(nextLevel);
     }
+
+    if (result.leafCount > 0)
+    {
+        result.leafFillFactor = (double)leafKeys / (result.leafCount * (2 * t - 1));
+    }
+    if (result.nodeCount > 0)
+    {
+        result.averageKeysPerNode = (double)result.keyCount / result.nodeCount;
+    }
+    return result;
 }
+
+#endif
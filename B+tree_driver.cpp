@@ -5,11 +5,36 @@
  * This program:
  *  - Loads Block Sequence Set (BSS) records from a file.
  *  - Inserts ZIP codes into a B+ tree index.
- *  - Dumps the B+ tree to a file.
+ *  - Dumps the B+ tree and its shape statistics to files.
  *  - Allows runtime lookup of postal records using the B+ tree + sequence set.
+ *
+ * Usage:
+ * @code
+ * search [btree|eytzinger|direct] [--batch <file|->] [--format tsv|json] [--snapshot <image>] [--lazy]
+ * @endcode
+ * The optional engine argument selects the ZIP index engine used for
+ * lookups (default: the dynamic B+ tree). With @c --snapshot the records
+ * are taken from a snapshot image (see main_snapshot.cpp) instead of
+ * parsing the text file; the indexes are still built in memory.
+ *
+ * With @c --lazy no record is loaded up front: the ZIP indexes are built
+ * from the byte-offset index of the data file and every found ZIP is read
+ * from the file on demand through a LazyPostalStore (the direct-address
+ * table, which points at resident blocks, is not available).
+ *
+ * With @c --batch the program does not prompt: it reads one query per line
+ * from the file (or stdin for @c -), either a ZIP (@c 501) or an inclusive
+ * ZIP range (@c 501-600), and writes the results to stdout as TSV (default)
+ * or JSON Lines. Point queries are answered in batches through
+ * ZipIndex::searchBatch(), ranges through the B+ tree; throughput is
+ * reported on stderr.
  */
 
 #include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <unistd.h>
 #include "BlockPostalCode.h"
 #include "BlockSequenceSetPostalCode.h"
 #include "PostalRecord.h"
@@ -17,6 +42,15 @@
 #include <fstream>
 
 #include "B+tree.cpp"
+#include "ZipIndex.h"
+#include "EytzingerZipIndex.h"
+#include "DirectAddressZipTable.h"
+#include "WorkStealingPool.h"
+#include "ZipMembershipFilter.h"
+#include "BufferedWriter.h"
+#include "PostalSnapshot.h"
+#include "LazyPostalStore.h"
+#include <memory>
 
 using namespace std;
 
@@ -36,12 +70,11 @@ bool lookupPostalRecord(int zip,
                         PostalRecord &out,
                         BlockSequenceSetPostalCode &bss)
 {
-    // Start with the head block (by value, just like in main)
-    BlockPostalCode current = bss.getHead();
-
-    while (true)
+    // Walk the blocks in place; copying each block would copy its record.
+    for (const BlockPostalCode *current = bss.getHeadBlock(); current != nullptr;
+         current = current->getNext())
     {
-        HeaderRecordPostalCodeItem item = current.getBlockItem();
+        const HeaderRecordPostalCodeItem &item = current->getBlockItem();
 
         if (item.getZip() == zip)
         {
@@ -51,18 +84,361 @@ bool lookupPostalRecord(int zip,
             out.county = item.getCounty();
             return true;
         }
+    }
+
+    return false; // not found in the sequence set
+}
+
+/**
+ * @brief Retrieves a postal record through the direct-address ZIP table.
+ *
+ * The table maps the ZIP straight to the block holding the record, so no
+ * sequence set traversal is needed.
+ *
+ * @param zip ZIP code to search for.
+ * @param out Reference to PostalRecord where the result will be stored.
+ * @param table Direct-address table built over the sequence set.
+ * @return true If the ZIP was found.
+ * @return false If the ZIP does not exist in the table.
+ */
+bool lookupPostalRecord(int zip,
+                        PostalRecord &out,
+                        const DirectAddressZipTable &table)
+{
+    const BlockPostalCode *block = table.find(zip);
+    if (block == nullptr)
+    {
+        return false;
+    }
+
+    const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+    out.zip = item.getZip();
+    out.place = item.getPlace();
+    out.state = item.getState();
+    out.county = item.getCounty();
+    return true;
+}
 
-        // If there's no "next" block, we're done
-        if (current.getNext() == nullptr)
+/**
+ * @brief Retrieves a postal record from the data file through a lazy store.
+ *
+ * Only the record's location is resident; the record itself is read and
+ * decoded on demand unless the store still has it cached.
+ *
+ * @param zip ZIP code to search for.
+ * @param out Reference to PostalRecord where the result will be stored.
+ * @param store Store open on the data file.
+ * @return true If the ZIP was found.
+ * @return false If the ZIP does not exist in the data file.
+ */
+bool lookupPostalRecord(int zip,
+                        PostalRecord &out,
+                        LazyPostalStore &store)
+{
+    HeaderRecordPostalCodeItem item;
+    if (!store.fetch(zip, item))
+    {
+        return false;
+    }
+
+    out.zip = item.getZip();
+    out.place = item.getPlace();
+    out.state = item.getState();
+    out.county = item.getCounty();
+    return true;
+}
+
+/**
+ * @brief Writes a string as a JSON string literal.
+ * @param out Destination writer.
+ * @param text Text to quote and escape.
+ */
+void writeJsonString(BufferedWriter &out, const string &text)
+{
+    out.put('"');
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
         {
-            break;
+            out.put('\\');
+            out.put(c);
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out.write(escaped, 6);
         }
+        else
+        {
+            out.put(c);
+        }
+    }
+    out.put('"');
+}
 
-        // Move to the next block (getNext() returns BlockPostalCode*)
-        current = *current.getNext();
+/**
+ * @brief Writes the result of one ZIP lookup in the batch output format.
+ *
+ * TSV rows are @c zip, @c found (1 or 0), place, state, county, latitude
+ * and longitude, with the record fields left empty for a missing ZIP.
+ *
+ * @param out Destination writer.
+ * @param json true for JSON Lines, false for TSV.
+ * @param zip The ZIP that was looked up.
+ * @param item The record, or nullptr if the ZIP is absent.
+ */
+void writeBatchResult(BufferedWriter &out, bool json, int zip, const HeaderRecordPostalCodeItem *item)
+{
+    if (item == nullptr)
+    {
+        if (json)
+        {
+            out.write("{\"zip\":");
+            out.writeInt(zip);
+            out.write(",\"found\":false}\n");
+        }
+        else
+        {
+            out.writeInt(zip);
+            out.write("\t0\t\t\t\t\t\n");
+        }
+        return;
     }
 
-    return false; // not found in the sequence set
+    if (json)
+    {
+        out.write("{\"zip\":");
+        out.writeInt(item->getZip());
+        out.write(",\"found\":true,\"place\":");
+        writeJsonString(out, item->getPlace());
+        out.write(",\"state\":");
+        writeJsonString(out, item->getState());
+        out.write(",\"county\":");
+        writeJsonString(out, item->getCounty());
+        out.write(",\"latitude\":");
+        out.writeDouble(item->getLatitude(), 4);
+        out.write(",\"longitude\":");
+        out.writeDouble(item->getLongitude(), 4);
+        out.write("}\n");
+    }
+    else
+    {
+        out.writeInt(item->getZip());
+        out.write("\t1\t");
+        out.write(item->getPlace());
+        out.put('\t');
+        out.write(item->getState());
+        out.put('\t');
+        out.write(item->getCounty());
+        out.put('\t');
+        out.writeDouble(item->getLatitude(), 4);
+        out.put('\t');
+        out.writeDouble(item->getLongitude(), 4);
+        out.put('\n');
+    }
+}
+
+/**
+ * @brief Answers a file of ZIP and ZIP-range queries without prompting.
+ *
+ * Point queries are collected into batches of POINT_BATCH ZIPs; slices of
+ * a batch are screened by the membership filter, the ZIPs it may contain
+ * are checked with ZipIndex::searchBatch(), and hits are resolved to records
+ * in parallel on the pool (lookups only read the indexes), then the rows
+ * are emitted in input order by the calling thread; a
+ * range query first drains the pending batch so output order matches
+ * input order. Records are fetched through the direct-address table,
+ * since walking the sequence set per query would be linear in the data,
+ * or read from the data file when a lazy store is given: the records of
+ * a batch are then read together through an AsyncBlockReader, and the
+ * ZIPs of a range are batched the same way.
+ * Blank lines and lines starting with '#' are skipped; malformed lines
+ * are counted and reported.
+ *
+ * @param path Query file, or "-" for stdin.
+ * @param json true for JSON Lines output, false for TSV.
+ * @param index Engine answering point queries.
+ * @param tree B+ tree answering range queries.
+ * @param filter Membership filter rejecting absent ZIPs before the index is touched.
+ * @param table Direct-address table used to fetch records, or nullptr with @p store.
+ * @param store Lazy store used to fetch records when @p table is nullptr.
+ * @param pool Pool running the point lookups.
+ * @return int Program exit code.
+ */
+int runBatch(const string &path, bool json, ZipIndex &index, BPlusTree<int> &tree,
+             const ZipMembershipFilter &filter, const DirectAddressZipTable *table, LazyPostalStore *store,
+             WorkStealingPool &pool)
+{
+    const size_t POINT_BATCH = 4096;
+    const size_t LOOKUP_SLICE = 512; ///< ZIPs looked up by one pool task
+
+    ifstream file;
+    if (path != "-")
+    {
+        file.open(path);
+        if (!file)
+        {
+            cerr << "Cannot open query file " << path << endl;
+            return 1;
+        }
+    }
+    istream &input = path == "-" ? cin : file;
+    ios::sync_with_stdio(false);
+
+    BufferedWriter out(STDOUT_FILENO);
+    if (!json)
+    {
+        out.write("zip\tfound\tplace\tstate\tcounty\tlatitude\tlongitude\n");
+    }
+
+    vector<int> points;
+    points.reserve(POINT_BATCH);
+    bool found[POINT_BATCH];
+    bool readOk[POINT_BATCH]; ///< Whether the store fetched each record
+    vector<int> hitZips;      ///< ZIPs of the batch the index found, in lazy mode
+    vector<size_t> hitRows;   ///< Batch position of each of hitZips
+    vector<const HeaderRecordPostalCodeItem *> records(POINT_BATCH);
+    vector<HeaderRecordPostalCodeItem> fetched(table == nullptr ? POINT_BATCH : 0); ///< Records read by the store
+    unique_ptr<AsyncBlockReader> reader(table == nullptr ? new AsyncBlockReader() : nullptr);
+    size_t pointCount = 0, rangeCount = 0, invalidCount = 0, rowCount = 0;
+
+    /// Resolves a ZIP to its resident record through the direct-address table.
+    auto resolve = [&](int zip) -> const HeaderRecordPostalCodeItem *
+    {
+        const BlockPostalCode *block = table->find(zip);
+        return block == nullptr ? nullptr : &block->getBlockItem();
+    };
+
+    auto drainPoints = [&]()
+    {
+        pool.parallelFor(0, points.size(), LOOKUP_SLICE, [&](size_t first, size_t last)
+                         {
+            // Only ZIPs the filter may contain reach the index
+            int candidates[LOOKUP_SLICE];
+            size_t rows[LOOKUP_SLICE];
+            bool hits[LOOKUP_SLICE];
+            size_t count = 0;
+            for (size_t i = first; i < last; i++)
+            {
+                found[i] = false;
+                if (filter.mayContain(points[i]))
+                {
+                    candidates[count] = points[i];
+                    rows[count++] = i;
+                }
+            }
+            index.searchBatch(candidates, count, hits);
+            for (size_t k = 0; k < count; k++)
+            {
+                found[rows[k]] = hits[k];
+            }
+            for (size_t i = first; table != nullptr && i < last; i++)
+            {
+                records[i] = found[i] ? resolve(points[i]) : nullptr;
+            } });
+        if (table == nullptr)
+        {
+            // Only the index's hits are read from the file
+            hitZips.clear();
+            hitRows.clear();
+            for (size_t i = 0; i < points.size(); i++)
+            {
+                records[i] = nullptr;
+                if (found[i])
+                {
+                    hitZips.push_back(points[i]);
+                    hitRows.push_back(i);
+                }
+            }
+            store->fetchBatch(hitZips.data(), hitZips.size(), fetched.data(), readOk, *reader);
+            for (size_t k = 0; k < hitZips.size(); k++)
+            {
+                records[hitRows[k]] = readOk[k] ? &fetched[k] : nullptr;
+            }
+        }
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            writeBatchResult(out, json, points[i], records[i]);
+        }
+        rowCount += points.size();
+        points.clear();
+    };
+
+    auto start = chrono::steady_clock::now();
+    string line;
+    while (getline(input, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        char *end;
+        long lower = strtol(line.c_str(), &end, 10);
+        long upper = lower;
+        bool isRange = end != line.c_str() && *end == '-';
+        if (isRange)
+        {
+            const char *upperStart = end + 1;
+            upper = strtol(upperStart, &end, 10);
+            if (end == upperStart)
+            {
+                end = (char *)line.c_str(); // "501-" is malformed
+            }
+        }
+        if (end == line.c_str() || *end != '\0' || lower < 0 || upper < lower ||
+            upper >= DirectAddressZipTable::ZIP_DOMAIN)
+        {
+            invalidCount++;
+            continue;
+        }
+
+        if (!isRange)
+        {
+            points.push_back(lower);
+            pointCount++;
+            if (points.size() == POINT_BATCH)
+            {
+                drainPoints();
+            }
+            continue;
+        }
+
+        drainPoints();
+        rangeCount++;
+        if (table == nullptr)
+        {
+            // The range's ZIPs go through the point batches so their reads are batched too
+            tree.rangeScan((int)lower, (int)upper, [&](const int &zip)
+                           {
+                points.push_back(zip);
+                if (points.size() == POINT_BATCH)
+                {
+                    drainPoints();
+                } });
+            drainPoints();
+            continue;
+        }
+        rowCount += tree.rangeScan((int)lower, (int)upper, [&](const int &zip)
+                                   { writeBatchResult(out, json, zip, resolve(zip)); });
+    }
+    drainPoints();
+    bool written = out.flush();
+    auto stop = chrono::steady_clock::now();
+
+    double seconds = chrono::duration<double>(stop - start).count();
+    cerr << (pointCount + rangeCount) << " queries (" << pointCount << " ZIPs, "
+         << rangeCount << " ranges, " << invalidCount << " invalid lines), "
+         << rowCount << " rows, " << out.getBytesWritten() << " bytes in "
+         << seconds * 1000 << " ms: "
+         << (long)((pointCount + rangeCount) / (seconds > 0 ? seconds : 1)) << " queries/s ("
+         << index.name() << ")" << endl;
+    return written ? 0 : 1;
 }
 
 /**
@@ -71,49 +447,146 @@ bool lookupPostalRecord(int zip,
  * Steps:
  *  1. Builds a Block Sequence Set from a length-indicated record file.
  *  2. Inserts ZIP codes from each block into a B+ tree.
- *  3. Prints the B+ tree structure to `B+Tree_data.txt`.
+ *  3. Prints the B+ tree structure to `B+Tree_data.txt` and its
+ *     statistics to `B+Tree_stats.json`.
  *  4. Performs user-driven ZIP lookups using:
- *     - B+ tree (index check)
+ *     - The selected ZIP index engine (index check)
  *     - Sequence set (record retrieval)
  *
+ * In batch mode step 3 is skipped and step 4 is replaced by runBatch().
+ *
+ * @param argc Argument count.
+ * @param argv Arguments: index engine, @c --batch, @c --format, @c --snapshot and @c --lazy options.
  * @return int Program exit code.
  */
-int main()
+int main(int argc, char *argv[])
 {
+    string engine = "btree"; ///< ZIP index engine name
+    string batchPath;        ///< Query file for batch mode; empty when interactive
+    string format = "tsv";   ///< Batch output format
+    string snapshotPath;     ///< Snapshot image to load instead of the text file
+    bool lazy = false;       ///< Read records on demand instead of loading them
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc)
+        {
+            batchPath = argv[++i];
+        }
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            format = argv[++i];
+        }
+        else if (arg == "--snapshot" && i + 1 < argc)
+        {
+            snapshotPath = argv[++i];
+        }
+        else if (arg == "--lazy")
+        {
+            lazy = true;
+        }
+        else
+        {
+            engine = arg;
+        }
+    }
+    if (format != "tsv" && format != "json")
+    {
+        cerr << "Unknown output format '" << format << "', use tsv or json" << endl;
+        return 1;
+    }
+
     int degree = 10; ///< B+ tree degree. Higher degree → shorter tree height.
     BPlusTree<int> tree(degree);
 
     string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
-    ofstream outputFile("B+Tree_data.txt"); ///< Output dump containing tree structure
 
     BlockSequenceSetPostalCode myBlockSequenceSetPostalCode; ///< Sequence set structure for all blocks
-    string blockRecord;
-    BlockPostalCode myBlock;
+    vector<int> zips; ///< All ZIP codes, used to build static indexes
+    ZipMembershipFilter filter; ///< Rejects absent ZIPs before the index is touched
+    LazyPostalStore store;      ///< Record source in lazy mode
 
     /**
      * @brief Loads all postal header+records into the Block Sequence Set.
      */
-    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName);
-
-    myBlock = myBlockSequenceSetPostalCode.getHead(); ///< First block pointer
-
-    // Insert first block ZIP into B+ tree
-    tree.insert(myBlock.getBlockItem().getZip());
+    if (lazy)
+    {
+        string error;
+        if (!store.open(fileName, error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+    }
+    else if (!snapshotPath.empty())
+    {
+        PostalSnapshot snapshot;
+        string error;
+        if (!snapshot.open(snapshotPath, error, true))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        snapshot.loadBlockSequenceSet(myBlockSequenceSetPostalCode);
+    }
+    else
+    {
+        inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName);
+    }
 
-    // Move to next block
-    myBlock = *myBlock.getNext();
+    /**
+     * @brief Insert the ZIP code of every block, walking the blocks in place
+     * (or of every record of the lazy store).
+     */
+    for (const BlockPostalCode *block = myBlockSequenceSetPostalCode.getHeadBlock();
+         block != nullptr; block = block->getNext())
+    {
+        zips.push_back(block->getBlockItem().getZip());
+    }
+    zips.insert(zips.end(), store.getZips().begin(), store.getZips().end());
+    for (int zip : zips)
+    {
+        tree.insert(zip);
+        filter.add(zip);
+    }
 
     /**
-     * @brief Insert ZIP codes from all intermediate blocks.
+     * @brief Selects the ZIP index engine used by the lookup loop.
      */
-    while (myBlock.getNext() != nullptr)
+    BPlusTreeZipIndex treeIndex(tree);
+    EytzingerZipIndex eytzingerIndex(zips);
+    unique_ptr<DirectAddressZipTable> directTable; ///< Points at resident blocks, so not built in lazy mode
+    if (!lazy)
     {
-        tree.insert(myBlock.getBlockItem().getZip());
-        myBlock = *myBlock.getNext();
+        directTable.reset(new DirectAddressZipTable(myBlockSequenceSetPostalCode));
     }
+    ZipIndex *index = &treeIndex;
 
-    // Insert last block ZIP
-    tree.insert(myBlock.getBlockItem().getZip());
+    if (engine == "eytzinger")
+    {
+        index = &eytzingerIndex;
+    }
+    else if (engine == "direct" && lazy)
+    {
+        cerr << "The direct engine needs resident records, using B+ tree" << endl;
+    }
+    else if (engine == "direct")
+    {
+        index = directTable.get();
+    }
+    else if (engine != "btree")
+    {
+        cerr << "Unknown index engine '" << engine
+             << "', using B+ tree" << endl;
+    }
+
+    if (!batchPath.empty())
+    {
+        return runBatch(batchPath, format == "json", *index, tree, filter, directTable.get(),
+                        &store, WorkStealingPool::shared());
+    }
+
+    ofstream outputFile("B+Tree_data.txt"); ///< Output dump containing tree structure
 
     // Save original std::cout buffer
     std::streambuf *originalCoutBuffer = std::cout.rdbuf();
@@ -134,6 +607,18 @@ int main()
     cout << "B+tree builded successfully!" << endl;
     cout << "B+ tree file: B+Tree_data.txt" << endl;
 
+    /**
+     * @brief Exports tree shape statistics as JSON for degree tuning.
+     */
+    BPlusTree<int>::TreeStats treeStats = tree.stats();
+    ofstream statsFile("B+Tree_stats.json");
+    statsFile << treeStats.toJson() << endl;
+    statsFile.close();
+
+    cout << "B+ tree stats: B+Tree_stats.json (height " << treeStats.height
+         << ", " << treeStats.nodeCount << " nodes, leaf fill "
+         << treeStats.leafFillFactor << ")" << endl;
+
     /**
      * @brief User search loop for interactive ZIP lookup.
      */
@@ -152,13 +637,26 @@ int main()
             break;
         }
 
-        // B+ tree check
-        if (tree.search(zip))
+        // Membership filter, then index check
+        if (filter.mayContain(zip) && index->search(zip))
         {
             PostalRecord rec;
 
-            // If ZIP exists, retrieve full record from sequence set
-            if (lookupPostalRecord(zip, rec, myBlockSequenceSetPostalCode))
+            // If ZIP exists, retrieve full record (directly when the table is in use)
+            bool fetched;
+            if (lazy)
+            {
+                fetched = lookupPostalRecord(zip, rec, store);
+            }
+            else if (index == directTable.get())
+            {
+                fetched = lookupPostalRecord(zip, rec, *directTable);
+            }
+            else
+            {
+                fetched = lookupPostalRecord(zip, rec, myBlockSequenceSetPostalCode);
+            }
+            if (fetched)
             {
                 std::cout << "\nFOUND ZIP " << rec.zip << "\n"
                           << "Place:  " << rec.place << "\n"
@@ -168,12 +666,13 @@ int main()
             else
             {
                 std::cout << "ZIP " << zip
-                          << " FOUND in B+ tree\n\n";
+                          << " FOUND in " << index->name() << "\n\n";
             }
         }
         else
         {
-            std::cout << "ZIP " << zip << " NOT FOUND in B+ tree\n\n";
+            std::cout << "ZIP " << zip << " NOT FOUND in "
+                      << index->name() << "\n\n";
         }
     }
 
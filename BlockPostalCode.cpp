@@ -5,6 +5,8 @@
 
 #include "BlockPostalCode.h"
 #include "HeaderRecordPostalCodeItem.h"
+#include <charconv>
+#include <utility>
 
 /**
  * @brief Default constructor. Initializes an empty block with null links.
@@ -15,7 +17,7 @@ BlockPostalCode::BlockPostalCode() : prevRBN(nullptr), nextRBN(nullptr) {}
  * @brief Constructor that sets the data item for this block.
  * @param item The HeaderRecordPostalCodeItem to store in the block.
  */
-BlockPostalCode::BlockPostalCode(const HeaderRecordPostalCodeItem &item) : data(item), prevRBN(nullptr), nextRBN(nullptr) {}
+BlockPostalCode::BlockPostalCode(HeaderRecordPostalCodeItem item) : data(move(item)), prevRBN(nullptr), nextRBN(nullptr) {}
 
 /**
  * @brief Constructor that sets data and predecessor/successor links.
@@ -23,15 +25,15 @@ BlockPostalCode::BlockPostalCode(const HeaderRecordPostalCodeItem &item) : data(
  * @param prevBlock Pointer to the previous block.
  * @param nextBlock Pointer to the next block.
  */
-BlockPostalCode::BlockPostalCode(const HeaderRecordPostalCodeItem &item, BlockPostalCode *prevBlock, BlockPostalCode *nextBlock) : data(item), prevRBN(prevBlock), nextRBN(nextBlock) {}
+BlockPostalCode::BlockPostalCode(HeaderRecordPostalCodeItem item, BlockPostalCode *prevBlock, BlockPostalCode *nextBlock) : data(move(item)), prevRBN(prevBlock), nextRBN(nextBlock) {}
 
 /**
  * @brief Sets the header record stored in this block.
  * @param item The new HeaderRecordPostalCodeItem to store.
  */
-void BlockPostalCode::setBlockItem(const HeaderRecordPostalCodeItem &item)
+void BlockPostalCode::setBlockItem(HeaderRecordPostalCodeItem item)
 {
-    data = item;
+    data = move(item);
 }
 
 /**
@@ -56,7 +58,7 @@ void BlockPostalCode::setNextRBN(BlockPostalCode *nextBlock)
  * @brief Retrieves the header record stored in this block.
  * @return The HeaderRecordPostalCodeItem stored inside the block.
  */
-HeaderRecordPostalCodeItem BlockPostalCode::getBlockItem() const
+const HeaderRecordPostalCodeItem &BlockPostalCode::getBlockItem() const
 {
     return data;
 }
@@ -77,4 +79,28 @@ BlockPostalCode *BlockPostalCode::getPrev() const
 BlockPostalCode *BlockPostalCode::getNext() const
 {
     return nextRBN;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Appends the block record "recordLength data prevZip nextZip".
+ * @param out String the record is appended to.
+ */
+void BlockPostalCode::appendRecord(string &out) const
+{
+    char digits[16];
+    out.append(digits, to_chars(digits, digits + sizeof(digits), data.getRecordLength()).ptr);
+    out += ' ';
+    data.appendData(out);
+    for (const BlockPostalCode *link : {prevRBN, nextRBN})
+    {
+        out += ' ';
+        if (link == nullptr)
+        {
+            out += "NULL";
+        }
+        else
+        {
+            out.append(digits, to_chars(digits, digits + sizeof(digits), link->data.getZip()).ptr);
+        }
+    }
+}
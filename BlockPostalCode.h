@@ -46,9 +46,9 @@ public:
 
     /**
      * @brief Constructor that sets the data item for this block.
-     * @param item The HeaderRecordPostalCodeItem to store in the block.
+     * @param item The HeaderRecordPostalCodeItem to store in the block, moved in.
      */
-    BlockPostalCode(const HeaderRecordPostalCodeItem &item);
+    BlockPostalCode(HeaderRecordPostalCodeItem item);
 
     /**
      * @brief Constructor that sets data and predecessor/successor links.
@@ -56,13 +56,13 @@ public:
      * @param prevBlock Pointer to the previous block.
      * @param nextBlock Pointer to the next block.
      */
-    BlockPostalCode(const HeaderRecordPostalCodeItem &item, BlockPostalCode *prevBlock, BlockPostalCode *nextBlock);
+    BlockPostalCode(HeaderRecordPostalCodeItem item, BlockPostalCode *prevBlock, BlockPostalCode *nextBlock);
 
     /**
      * @brief Sets the header record stored in this block.
-     * @param item The new HeaderRecordPostalCodeItem to store.
+     * @param item The new HeaderRecordPostalCodeItem to store, moved in.
      */
-    void setBlockItem(const HeaderRecordPostalCodeItem &item);
+    void setBlockItem(HeaderRecordPostalCodeItem item);
 
     /**
      * @brief Sets the predecessor block link.
@@ -78,9 +78,9 @@ public:
 
     /**
      * @brief Retrieves the header record stored in this block.
-     * @return The HeaderRecordPostalCodeItem stored inside the block.
+     * @return The HeaderRecordPostalCodeItem stored inside the block, by reference.
      */
-    HeaderRecordPostalCodeItem getBlockItem() const;
+    const HeaderRecordPostalCodeItem &getBlockItem() const;
 
     /**
      * @brief Gets the predecessor block pointer.
@@ -93,6 +93,16 @@ public:
      * @return A pointer to the next BlockPostalCode.
      */
     BlockPostalCode *getNext() const;
+
+    /**
+     * @brief Appends the block record "recordLength data prevZip nextZip".
+     *
+     * "NULL" stands in for a missing predecessor or successor. This is the
+     * line format of block_sequence_set_data.txt, without the newline.
+     *
+     * @param out String the record is appended to.
+     */
+    void appendRecord(string &out) const;
 };
 
 #endif
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "BlockSequenceSetPostalCode.h"
 #include "BlockPostalCode.h"
 #include "HeaderRecordPostalCodeItem.h"
+#include <utility>
 
 /**
  * @file BlockSequenceSetPostalCode.cpp
@@ -16,7 +17,21 @@
  * The head and tail block pointers are initialized to nullptr and the
  * item count is set to zero.
  */
-BlockSequenceSetPostalCode::BlockSequenceSetPostalCode() : headBlock(nullptr), itemCount(0) {}
+BlockSequenceSetPostalCode::BlockSequenceSetPostalCode() : headBlock(nullptr), tailBlock(nullptr), itemCount(0) {}
+
+/**
+ * @brief Destructor. Frees every block of the sequence.
+ */
+BlockSequenceSetPostalCode::~BlockSequenceSetPostalCode()
+{
+    BlockPostalCode *block = headBlock;
+    while (block != nullptr)
+    {
+        BlockPostalCode *next = block->getNext();
+        delete block;
+        block = next;
+    }
+}
 
 /**
  * @brief Gets the number of items currently stored in the sequence set.
@@ -37,6 +52,19 @@ BlockPostalCode BlockSequenceSetPostalCode::getHead() const
     return *headBlock;
 }
 
+/**
+ * @brief Returns a pointer to the head block itself.
+ *
+ * Unlike getHead(), the returned pointer refers to the block stored in the
+ * sequence set, so it can be kept as a stable handle to that record.
+ *
+ * @return The first BlockPostalCode in the sequence set, or nullptr if empty.
+ */
+BlockPostalCode *BlockSequenceSetPostalCode::getHeadBlock() const
+{
+    return headBlock;
+}
+
 /**
  * @brief Adds a new header postal code item to the end of the sequence set.
  *
@@ -45,13 +73,12 @@ BlockPostalCode BlockSequenceSetPostalCode::getHead() const
  * the block sequence set. The predecessor and successor links of the tail
  * and new block are updated to maintain the structure.
  *
- * @param newHeaderPostalCodeItem The header record to add as a new block.
+ * @param newHeaderPostalCodeItem The header record to add as a new block, moved in.
  * @return true if the block was successfully added.
  */
-bool BlockSequenceSetPostalCode::add(const HeaderRecordPostalCodeItem &newHeaderPostalCodeItem)
+bool BlockSequenceSetPostalCode::add(HeaderRecordPostalCodeItem newHeaderPostalCodeItem)
 {
-    BlockPostalCode *newBlock = new BlockPostalCode();
-    newBlock->setBlockItem(newHeaderPostalCodeItem);
+    BlockPostalCode *newBlock = new BlockPostalCode(move(newHeaderPostalCodeItem));
 
     if (headBlock == nullptr || tailBlock == nullptr)
     {
@@ -74,4 +101,77 @@ bool BlockSequenceSetPostalCode::add(const HeaderRecordPostalCodeItem &newHeader
     itemCount++;
 
     return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Links a new block in directly after an existing one.
+ *
+ * The new block takes over the successor of @p previousBlock, so the
+ * sequence stays ordered if the caller picks the block with the greatest
+ * smaller key. Head and tail are updated when the block lands at either end.
+ *
+ * @param previousBlock Block to insert after, or nullptr to insert at the head.
+ * @param newHeaderPostalCodeItem The item to store in the new block, moved in.
+ * @return The new block.
+ */
+BlockPostalCode *BlockSequenceSetPostalCode::insertAfter(BlockPostalCode *previousBlock,
+                                                         HeaderRecordPostalCodeItem newHeaderPostalCodeItem)
+{
+    BlockPostalCode *nextBlock = previousBlock == nullptr ? headBlock : previousBlock->getNext();
+    BlockPostalCode *newBlock = new BlockPostalCode(move(newHeaderPostalCodeItem), previousBlock, nextBlock);
+
+    if (previousBlock == nullptr)
+    {
+        headBlock = newBlock;
+    }
+    else
+    {
+        previousBlock->setNextRBN(newBlock);
+    }
+    if (nextBlock == nullptr)
+    {
+        tailBlock = newBlock;
+    }
+    else
+    {
+        nextBlock->setPrevRBN(newBlock);
+    }
+
+    itemCount++;
+
+    return newBlock;
+}
+
+/**
+ * @brief Unlinks a block from the sequence and frees it.
+ *
+ * The neighbours of the block are linked to each other, and head or tail
+ * move when the block was at either end.
+ *
+ * @param block A block of this sequence set; invalid afterwards.
+ */
+void BlockSequenceSetPostalCode::remove(BlockPostalCode *block)
+{
+    BlockPostalCode *previousBlock = block->getPrev();
+    BlockPostalCode *nextBlock = block->getNext();
+
+    if (previousBlock == nullptr)
+    {
+        headBlock = nextBlock;
+    }
+    else
+    {
+        previousBlock->setNextRBN(nextBlock);
+    }
+    if (nextBlock == nullptr)
+    {
+        tailBlock = previousBlock;
+    }
+    else
+    {
+        nextBlock->setPrevRBN(previousBlock);
+    }
+
+    delete block;
+    itemCount--;
+}
@@ -30,7 +30,8 @@
  *   - itemCount → number of stored blocks
  *
  * New blocks are appended to the end (tail), maintaining predecessor and
- * successor relationships.
+ * successor relationships. Blocks can also be linked in after a given
+ * block or unlinked, so a sorted set can be updated in place.
  */
 class BlockSequenceSetPostalCode
 {
@@ -45,12 +46,37 @@ public:
      */
     BlockSequenceSetPostalCode();
 
+    /**
+     * @brief Destructor. Frees every block of the sequence.
+     */
+    ~BlockSequenceSetPostalCode();
+
+    /// @brief Sequence sets own their blocks and are not copyable.
+    BlockSequenceSetPostalCode(const BlockSequenceSetPostalCode &) = delete;
+
+    /// @brief Sequence sets are not copy-assignable.
+    BlockSequenceSetPostalCode &operator=(const BlockSequenceSetPostalCode &) = delete;
+
     /**
      * @brief Adds a new header postal code item as a BlockPostalCode.
-     * @param newHeaderPostalCodeItem The item to insert into a new block.
+     * @param newHeaderPostalCodeItem The item to insert into a new block, moved in.
      * @return true if the block was successfully created and linked.
      */
-    bool add(const HeaderRecordPostalCodeItem &newHeaderPostalCodeItem);
+    bool add(HeaderRecordPostalCodeItem newHeaderPostalCodeItem);
+
+    /**
+     * @brief Links a new block in directly after an existing one.
+     * @param previousBlock Block to insert after, or nullptr to insert at the head.
+     * @param newHeaderPostalCodeItem The item to store in the new block, moved in.
+     * @return The new block.
+     */
+    BlockPostalCode *insertAfter(BlockPostalCode *previousBlock, HeaderRecordPostalCodeItem newHeaderPostalCodeItem);
+
+    /**
+     * @brief Unlinks a block from the sequence and frees it.
+     * @param block A block of this sequence set; invalid afterwards.
+     */
+    void remove(BlockPostalCode *block);
 
     /**
      * @brief Retrieves the head block by value.
@@ -58,6 +84,12 @@ public:
      */
     BlockPostalCode getHead() const;
 
+    /**
+     * @brief Retrieves a pointer to the head block itself.
+     * @return The first BlockPostalCode in the sequence, or nullptr if empty.
+     */
+    BlockPostalCode *getHeadBlock() const;
+
     /**
      * @brief Gets the number of blocks stored in the sequence.
      * @return The total count of blocks.
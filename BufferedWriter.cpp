@@ -0,0 +1,233 @@
+/**
+ * @file BufferedWriter.cpp
+ * @brief Implements the large-buffer output writer.
+ */
+
+#include "BufferedWriter.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <charconv>
+#include <climits>
+#include <unistd.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+/**
+ * @brief Constructs a writer over an open file descriptor.
+ * @param outputFd Destination descriptor (not closed by the writer).
+ * @param capacity Buffer size in bytes.
+ */
+BufferedWriter::BufferedWriter(int outputFd, size_t capacity)
+    : fd(outputFd), buffer(capacity > 64 ? capacity : 64), used(0), written(0), failed(false) {}
+
+/**
+ * @brief Flushes any pending output.
+ */
+BufferedWriter::~BufferedWriter()
+{
+    flush();
+}
+
+/**
+ * @brief Writes a block of bytes straight to the descriptor.
+ *
+ * Retries partial writes and writes interrupted by signals.
+ *
+ * @param data Bytes to write.
+ * @param length Number of bytes.
+ */
+void BufferedWriter::writeAll(const char *data, size_t length)
+{
+    struct iovec part = {(void *)data, length};
+    writeAllVectored(&part, 1);
+}
+
+/**
+ * @brief Writes a list of blocks with as few writev() calls as possible.
+ *
+ * Retries partial writes and writes interrupted by signals.
+ *
+ * @param parts The blocks; entries are advanced past the bytes written.
+ * @param count Number of blocks.
+ */
+void BufferedWriter::writeAllVectored(struct iovec *parts, int count)
+{
+    while (count > 0 && !failed)
+    {
+        if (parts->iov_len == 0)
+        {
+            parts++;
+            count--;
+            continue;
+        }
+        ssize_t n = count == 1 ? ::write(fd, parts->iov_base, parts->iov_len)
+                               : ::writev(fd, parts, count);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            failed = true;
+            break;
+        }
+        // Skip the blocks written completely, then trim the partial one.
+        while (count > 0 && (size_t)n >= parts->iov_len)
+        {
+            n -= parts->iov_len;
+            parts++;
+            count--;
+        }
+        if (count > 0)
+        {
+            parts->iov_base = (char *)parts->iov_base + n;
+            parts->iov_len -= n;
+        }
+    }
+}
+
+/**
+ * @brief Makes room for @p length more bytes in the buffer, flushing if needed.
+ * @param length Bytes needed (at most the capacity).
+ * @return Where the bytes go.
+ */
+char *BufferedWriter::reserve(size_t length)
+{
+    if (used + length > buffer.size())
+    {
+        flush();
+    }
+    return buffer.data() + used;
+}
+
+/**
+ * @brief Appends raw bytes.
+ *
+ * Blocks larger than the buffer bypass it: they are written with one
+ * writev() behind the pending output.
+ *
+ * @param data Bytes to append.
+ * @param length Number of bytes.
+ */
+void BufferedWriter::write(const char *data, size_t length)
+{
+    written += length;
+    if (used + length > buffer.size())
+    {
+        if (length > buffer.size())
+        {
+            struct iovec parts[2] = {{buffer.data(), used}, {(void *)data, length}};
+            writeAllVectored(parts, 2);
+            used = 0;
+            return;
+        }
+        flush();
+    }
+    memcpy(buffer.data() + used, data, length);
+    used += length;
+}
+
+/**
+ * @brief Appends a string.
+ * @param text Text to append.
+ */
+void BufferedWriter::write(const string &text)
+{
+    write(text.data(), text.size());
+}
+
+/**
+ * @brief Appends one character.
+ * @param c Character to append.
+ */
+void BufferedWriter::put(char c)
+{
+    if (used == buffer.size())
+    {
+        flush();
+    }
+    buffer[used++] = c;
+    written++;
+}
+
+/**
+ * @brief Appends an integer in decimal.
+ * @param value Value to append.
+ */
+void BufferedWriter::writeInt(long value)
+{
+    const size_t MAX_DIGITS = 20; // sign and 19 digits
+    char *start = reserve(MAX_DIGITS);
+    char *end = to_chars(start, start + MAX_DIGITS, value).ptr;
+    used += end - start;
+    written += end - start;
+}
+
+/**
+ * @brief Appends a floating-point value in fixed notation.
+ * @param value Value to append.
+ * @param precision Digits after the decimal point.
+ */
+void BufferedWriter::writeDouble(double value, int precision)
+{
+    // Coordinates and the like fit in 64 bytes; huge magnitudes take the slow path.
+    const size_t TYPICAL_DIGITS = 64;
+    char *start = reserve(TYPICAL_DIGITS);
+    to_chars_result result = to_chars(start, start + TYPICAL_DIGITS, value,
+                                      chars_format::fixed, precision);
+    if (result.ec == errc())
+    {
+        used += result.ptr - start;
+        written += result.ptr - start;
+        return;
+    }
+    string digits(400 + precision, '\0');
+    result = to_chars(&digits[0], &digits[0] + digits.size(), value, chars_format::fixed, precision);
+    write(digits.data(), result.ec == errc() ? result.ptr - digits.data() : 0);
+}
+
+/**
+ * @brief Writes the pending output and a list of formatted blocks, in order.
+ * @param blocks Blocks to write.
+ */
+void BufferedWriter::writeBlocks(const vector<string> &blocks)
+{
+    vector<struct iovec> parts;
+    parts.reserve(blocks.size() + 1);
+    parts.push_back({buffer.data(), used});
+    for (const string &block : blocks)
+    {
+        parts.push_back({(void *)block.data(), block.size()});
+        written += block.size();
+    }
+    used = 0;
+    for (size_t first = 0; first < parts.size(); first += IOV_MAX)
+    {
+        writeAllVectored(&parts[first], min(parts.size() - first, (size_t)IOV_MAX));
+    }
+}
+
+/**
+ * @brief Writes all pending output to the descriptor.
+ *
+ * After a failed write the pending output is dropped.
+ *
+ * @return false if any write so far has failed.
+ */
+bool BufferedWriter::flush()
+{
+    writeAll(buffer.data(), used);
+    used = 0;
+    return !failed;
+}
+
+/**
+ * @brief Gets the number of bytes written or pending.
+ * @return Total bytes appended to the writer.
+ */
+size_t BufferedWriter::getBytesWritten() const
+{
+    return written;
+}
@@ -0,0 +1,137 @@
+#ifndef BUFFERED_WRITER
+#define BUFFERED_WRITER
+
+/**
+ * @file BufferedWriter.h
+ * @brief Declares a large-buffer output writer for bulk tool output.
+ *
+ * Tools that print one line per record through @c cout pay a stream call
+ * (and, with @c endl, a flush) per line. BufferedWriter appends into a
+ * single large buffer and hands it to the file descriptor with one
+ * write() call per buffer-full. Numbers are formatted with std::to_chars
+ * straight into the buffer, and blocks that are already formatted
+ * elsewhere (e.g. by parallel tasks) go out with writev() together with
+ * the pending buffer, without being copied.
+ */
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+struct iovec;
+
+using namespace std;
+
+/**
+ * @class BufferedWriter
+ * @brief Appends text into a large buffer and writes it to a file descriptor in bulk.
+ */
+class BufferedWriter
+{
+public:
+    /// @brief Default buffer size (1 MiB).
+    static const size_t DEFAULT_CAPACITY = 1 << 20;
+
+private:
+    int fd;              ///< Destination file descriptor.
+    vector<char> buffer; ///< Pending output.
+    size_t used;         ///< Bytes of @c buffer holding pending output.
+    size_t written;      ///< Bytes appended so far.
+    bool failed;         ///< Set once a write to the descriptor fails.
+
+    /**
+     * @brief Writes a block of bytes straight to the descriptor.
+     * @param data Bytes to write.
+     * @param length Number of bytes.
+     */
+    void writeAll(const char *data, size_t length);
+
+    /**
+     * @brief Writes a list of blocks with as few writev() calls as possible.
+     * @param parts The blocks; entries are advanced past the bytes written.
+     * @param count Number of blocks.
+     */
+    void writeAllVectored(struct iovec *parts, int count);
+
+    /**
+     * @brief Makes room for @p length more bytes in the buffer, flushing if needed.
+     * @param length Bytes needed (at most the capacity).
+     * @return Where the bytes go.
+     */
+    char *reserve(size_t length);
+
+public:
+    /**
+     * @brief Constructs a writer over an open file descriptor.
+     * @param outputFd Destination descriptor (not closed by the writer).
+     * @param capacity Buffer size in bytes.
+     */
+    explicit BufferedWriter(int outputFd, size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief Flushes any pending output.
+     */
+    ~BufferedWriter();
+
+    /// @brief Writers own a buffer bound to one descriptor and are not copyable.
+    BufferedWriter(const BufferedWriter &) = delete;
+
+    /// @brief Writers are not copy-assignable.
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    /**
+     * @brief Appends raw bytes.
+     * @param data Bytes to append.
+     * @param length Number of bytes.
+     */
+    void write(const char *data, size_t length);
+
+    /**
+     * @brief Appends a string.
+     * @param text Text to append.
+     */
+    void write(const string &text);
+
+    /**
+     * @brief Appends one character.
+     * @param c Character to append.
+     */
+    void put(char c);
+
+    /**
+     * @brief Appends an integer in decimal.
+     * @param value Value to append.
+     */
+    void writeInt(long value);
+
+    /**
+     * @brief Appends a floating-point value in fixed notation.
+     * @param value Value to append.
+     * @param precision Digits after the decimal point.
+     */
+    void writeDouble(double value, int precision);
+
+    /**
+     * @brief Writes the pending output and a list of formatted blocks, in order.
+     *
+     * The blocks are not copied into the buffer: they are passed to
+     * writev() behind the pending output, up to IOV_MAX at a time.
+     *
+     * @param blocks Blocks to write.
+     */
+    void writeBlocks(const vector<string> &blocks);
+
+    /**
+     * @brief Writes all pending output to the descriptor.
+     * @return false if any write so far has failed.
+     */
+    bool flush();
+
+    /**
+     * @brief Gets the number of bytes written or pending.
+     * @return Total bytes appended to the writer.
+     */
+    size_t getBytesWritten() const;
+};
+
+#endif
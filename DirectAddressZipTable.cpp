@@ -0,0 +1,136 @@
+/**
+ * @file DirectAddressZipTable.cpp
+ * @brief Implements the direct-address ZIP lookup table.
+ */
+
+#include "DirectAddressZipTable.h"
+
+using namespace std;
+
+/**
+ * @brief Default constructor. Creates an empty table covering the full domain.
+ */
+DirectAddressZipTable::DirectAddressZipTable()
+    : presence((ZIP_DOMAIN + 63) / 64, 0), handles(ZIP_DOMAIN, nullptr), keyCount(0)
+{
+}
+
+/**
+ * @brief Builds the table from every block of a sequence set.
+ *
+ * Walks the sequence set once and records a handle to each block, so the
+ * table can be built in the same pass that ingests the data.
+ *
+ * @param bss The sequence set whose records are indexed.
+ */
+DirectAddressZipTable::DirectAddressZipTable(const BlockSequenceSetPostalCode &bss)
+    : DirectAddressZipTable()
+{
+    for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr;
+         block = block->getNext())
+    {
+        insert(block->getBlockItem().getZip(), block);
+    }
+}
+
+/**
+ * @brief Associates a ZIP code with the block holding its record.
+ * @param zip ZIP code to add.
+ * @param block Handle of the block storing the record.
+ * @return false if @p zip is outside the 5-digit domain.
+ */
+bool DirectAddressZipTable::insert(int zip, const BlockPostalCode *block)
+{
+    if (zip < 0 || zip >= ZIP_DOMAIN)
+    {
+        return false;
+    }
+    if (!contains(zip))
+    {
+        presence[zip >> 6] |= uint64_t(1) << (zip & 63);
+        keyCount++;
+    }
+    handles[zip] = block;
+    return true;
+}
+
+/**
+ * @brief Removes a ZIP code from the table.
+ * @param zip ZIP code to remove.
+ */
+void DirectAddressZipTable::remove(int zip)
+{
+    if (contains(zip))
+    {
+        presence[zip >> 6] &= ~(uint64_t(1) << (zip & 63));
+        handles[zip] = nullptr;
+        keyCount--;
+    }
+}
+
+/**
+ * @brief Gets the block handle for a ZIP code.
+ * @param zip ZIP code to look up.
+ * @return The block holding the record, or nullptr if absent.
+ */
+const BlockPostalCode *DirectAddressZipTable::find(int zip) const
+{
+    if (zip < 0 || zip >= ZIP_DOMAIN)
+    {
+        return nullptr;
+    }
+    return handles[zip];
+}
+
+/**
+ * @brief Checks whether a ZIP code is present using only the bitmap.
+ *
+ * The unsigned comparison rejects negative ZIPs and ZIPs past the domain
+ * with a single branch.
+ *
+ * @param zip ZIP code to search for.
+ * @return true if the ZIP is present.
+ */
+bool DirectAddressZipTable::contains(int zip) const
+{
+    return (unsigned int)zip < (unsigned int)ZIP_DOMAIN &&
+           (presence[zip >> 6] >> (zip & 63)) & 1;
+}
+
+/**
+ * @brief Checks whether a ZIP code is present.
+ * @param zip ZIP code to search for.
+ * @return true if the ZIP is present.
+ */
+bool DirectAddressZipTable::search(int zip)
+{
+    return contains(zip);
+}
+
+/**
+ * @brief Gets the engine name.
+ * @return "Direct table".
+ */
+string DirectAddressZipTable::name() const
+{
+    return "Direct table";
+}
+
+/**
+ * @brief Gets the bytes used by the bitmap and the handle array.
+ * @return The memory footprint in bytes.
+ */
+size_t DirectAddressZipTable::memoryUsage() const
+{
+    return sizeof(*this) + presence.capacity() * sizeof(uint64_t) +
+           handles.capacity() * sizeof(const BlockPostalCode *);
+}
+
+/**
+ * @brief Gets the number of ZIP codes present.
+ * @return The key count.
+ */
+int DirectAddressZipTable::size() const
+{
+    return keyCount;
+}
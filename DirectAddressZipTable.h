@@ -0,0 +1,109 @@
+#ifndef DIRECT_ADDRESS_ZIP_TABLE
+#define DIRECT_ADDRESS_ZIP_TABLE
+
+/**
+ * @file DirectAddressZipTable.h
+ * @brief Declares a direct-address lookup table over the 5-digit ZIP domain.
+ *
+ * Five-digit ZIP codes fit in the domain 0..99999, so a ZIP can be used as
+ * an array subscript. The table keeps one record handle (a pointer to the
+ * block holding the record) per possible ZIP plus a presence bitmap. The
+ * bitmap is only 12.5 KB and stays cache resident, so a membership check
+ * is one load, and a record fetch is one more.
+ */
+
+#include <vector>
+#include <cstdint>
+#include "ZipIndex.h"
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+
+using namespace std;
+
+/**
+ * @class DirectAddressZipTable
+ * @brief Constant-time ZIP → block handle table with a presence bitmap.
+ */
+class DirectAddressZipTable : public ZipIndex
+{
+public:
+    /// @brief Size of the 5-digit ZIP key domain.
+    static const int ZIP_DOMAIN = 100000;
+
+private:
+    /// @brief One bit per ZIP in the domain, set when the ZIP is present.
+    vector<uint64_t> presence;
+
+    /// @brief Record handle per ZIP; nullptr when the ZIP is absent.
+    vector<const BlockPostalCode *> handles;
+
+    /// @brief Number of ZIP codes currently present.
+    int keyCount;
+
+public:
+    /**
+     * @brief Default constructor. Creates an empty table.
+     */
+    DirectAddressZipTable();
+
+    /**
+     * @brief Builds the table from every block of a sequence set.
+     * @param bss The sequence set whose records are indexed.
+     */
+    DirectAddressZipTable(const BlockSequenceSetPostalCode &bss);
+
+    /**
+     * @brief Associates a ZIP code with the block holding its record.
+     * @param zip ZIP code to add.
+     * @param block Handle of the block storing the record.
+     * @return false if @p zip is outside the 5-digit domain.
+     */
+    bool insert(int zip, const BlockPostalCode *block);
+
+    /**
+     * @brief Removes a ZIP code from the table.
+     * @param zip ZIP code to remove.
+     */
+    void remove(int zip);
+
+    /**
+     * @brief Gets the block handle for a ZIP code.
+     * @param zip ZIP code to look up.
+     * @return The block holding the record, or nullptr if absent.
+     */
+    const BlockPostalCode *find(int zip) const;
+
+    /**
+     * @brief Checks whether a ZIP code is present using only the bitmap.
+     * @param zip ZIP code to search for.
+     * @return true if the ZIP is present.
+     */
+    bool contains(int zip) const;
+
+    /**
+     * @brief Checks whether a ZIP code is present.
+     * @param zip ZIP code to search for.
+     * @return true if the ZIP is present.
+     */
+    bool search(int zip);
+
+    /**
+     * @brief Gets the engine name.
+     * @return "Direct table".
+     */
+    string name() const;
+
+    /**
+     * @brief Gets the bytes used by the bitmap and the handle array.
+     * @return The memory footprint in bytes.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Gets the number of ZIP codes present.
+     * @return The key count.
+     */
+    int size() const;
+};
+
+#endif
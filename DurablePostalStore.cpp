@@ -0,0 +1,172 @@
+/**
+ * @file DurablePostalStore.cpp
+ * @brief Implements crash-safe in-place updates of the postal data.
+ */
+
+#include "DurablePostalStore.h"
+#include <sstream>
+#include <unistd.h>
+#include "PostalRecordParser.h"
+#include "PostalRecordPacked.h"
+#include "PostalSnapshot.h"
+
+using namespace std;
+
+/**
+ * @brief Constructs a closed store.
+ * @param commitInterval Commit interval of the log.
+ */
+DurablePostalStore::DurablePostalStore(chrono::microseconds commitInterval)
+    : tree(10), log(commitInterval), replayed(0)
+{
+}
+
+/**
+ * @brief Opens the store, recovering from the checkpoint and the log.
+ * @param imagePath Checkpoint image.
+ * @param logPath Write-ahead log.
+ * @param dataFile Length-indicated data file used when there is no image.
+ * @param error Receives a message on failure.
+ * @return true if the store is ready.
+ */
+bool DurablePostalStore::open(const string &imagePath, const string &logPath, const string &dataFile,
+                              string &error)
+{
+    lock_guard<mutex> guard(lock);
+    snapshotPath = imagePath;
+    bool haveImage = access(imagePath.c_str(), F_OK) == 0;
+    if (haveImage)
+    {
+        PostalSnapshot snapshot;
+        if (!snapshot.open(imagePath, error, true))
+        {
+            return false;
+        }
+        snapshot.loadBlockSequenceSet(bss);
+    }
+    else
+    {
+        PostalRecordParser::loadBlockSequenceSet(bss, dataFile);
+    }
+    for (BlockPostalCode *block = bss.getHeadBlock(); block != nullptr; block = block->getNext())
+    {
+        int zip = block->getBlockItem().getZip();
+        tree.insert(zip);
+        table.insert(zip, block);
+    }
+
+    // Collect the log tail, then replay it as one rebased delta
+    string tail;
+    replayed = 0;
+    if (!log.open(logPath, [&](uint64_t, const string &payload)
+                  { tail += payload;
+                    tail += '\n';
+                    replayed++; },
+                  error))
+    {
+        return false;
+    }
+    if (!haveImage && log.getCheckpointLsn() != 0)
+    {
+        error = logPath + " continues from a checkpoint, but " + imagePath + " is missing";
+        log.close();
+        return false;
+    }
+    PostalDelta redo;
+    istringstream input(tail);
+    PostalDelta::Summary summary;
+    if (!redo.parse(input, error))
+    {
+        error = logPath + ": " + error;
+        log.close();
+        return false;
+    }
+    redo.rebase(table);
+    if (!redo.apply(bss, tree, table, summary, error))
+    {
+        log.close();
+        return false;
+    }
+
+    if (!haveImage)
+    {
+        PackedPostalTable records;
+        records.reserve(bss.getCurrentSize());
+        records.addAll(bss);
+        if (!PostalSnapshot::write(snapshotPath, records, error) || !log.checkpoint(error))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Applies a delta and waits until it is durable.
+ * @param delta The changes.
+ * @param summary Receives the counts of applied changes.
+ * @param error Receives a message on failure.
+ * @param changed Called with the ZIP of every applied change (may be empty).
+ * @return true once the changes are applied and logged to disk.
+ */
+bool DurablePostalStore::apply(const PostalDelta &delta, PostalDelta::Summary &summary, string &error,
+                               const function<void(int)> &changed)
+{
+    uint64_t lastLsn = 0;
+    {
+        // Log order must match apply order, so both happen under the lock
+        lock_guard<mutex> guard(lock);
+        if (!delta.apply(bss, tree, table, summary, error, changed))
+        {
+            return false;
+        }
+        for (const PostalDeltaChange &change : delta.getChanges())
+        {
+            lastLsn = log.append(change.text);
+        }
+    }
+    // Waiting outside the lock lets other updates join the same fsync
+    if (!log.sync(lastLsn))
+    {
+        error = "the log could not be written; the changes are not durable";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a new checkpoint image and restarts the log.
+ *
+ * The image is complete on disk before the log restarts; if the process
+ * dies in between, the next open() replays changes the image already has,
+ * which the rebased replay tolerates.
+ *
+ * @param error Receives a message on failure.
+ * @return true if the checkpoint was written.
+ */
+bool DurablePostalStore::checkpoint(string &error)
+{
+    lock_guard<mutex> guard(lock);
+    PackedPostalTable records;
+    records.reserve(bss.getCurrentSize());
+    records.addAll(bss);
+    return PostalSnapshot::write(snapshotPath, records, error) && log.checkpoint(error);
+}
+
+/**
+ * @brief Copies the record of a ZIP.
+ * @param zip ZIP code to look up.
+ * @param out Receives the record.
+ * @return false if the ZIP is absent.
+ */
+bool DurablePostalStore::lookup(int zip, HeaderRecordPostalCodeItem &out) const
+{
+    lock_guard<mutex> guard(lock);
+    const BlockPostalCode *block = table.find(zip);
+    if (block == nullptr)
+    {
+        return false;
+    }
+    out = block->getBlockItem();
+    return true;
+}
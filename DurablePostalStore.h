@@ -0,0 +1,115 @@
+#ifndef DURABLE_POSTAL_STORE
+#define DURABLE_POSTAL_STORE
+
+/**
+ * @file DurablePostalStore.h
+ * @brief Declares crash-safe in-place updates of the postal data.
+ *
+ * The store keeps the records in a ZIP-ordered sequence set with its
+ * B+ tree and direct-address table, as the other tools do, and makes
+ * delta updates durable with two files:
+ *  - a checkpoint: a PostalSnapshot image of the whole data set, always
+ *    replaced atomically (written aside, fsynced, renamed);
+ *  - a PostalWriteAheadLog holding every change made since the checkpoint.
+ *
+ * apply() changes the in-memory structures, appends the changes to the log
+ * and returns once the log is on disk; concurrent callers share fsyncs
+ * through the log's group commit. checkpoint() writes the records as a new
+ * image and restarts the log. open() loads the image, rebuilds the tree
+ * and the table from it and replays the log tail; the replay is rebased
+ * (see PostalDelta::rebase()), so a crash between writing the image and
+ * restarting the log only replays changes the image already holds.
+ */
+
+#include <string>
+#include <mutex>
+#include <chrono>
+#include "PostalDelta.h"
+#include "PostalWriteAheadLog.h"
+
+using namespace std;
+
+/**
+ * @class DurablePostalStore
+ * @brief Postal records updated in place through a write-ahead log.
+ */
+class DurablePostalStore
+{
+private:
+    BlockSequenceSetPostalCode bss; ///< Records ordered by ZIP
+    BPlusTree<int> tree;            ///< ZIP index
+    DirectAddressZipTable table;    ///< ZIP → block
+    PostalWriteAheadLog log;        ///< Changes since the checkpoint
+    string snapshotPath;            ///< Checkpoint image
+    size_t replayed;                ///< Changes replayed by open()
+    mutable mutex lock;             ///< Serializes updates against each other and lookups
+
+public:
+    /**
+     * @brief Constructs a closed store.
+     * @param commitInterval Commit interval of the log.
+     */
+    explicit DurablePostalStore(chrono::microseconds commitInterval = chrono::microseconds(0));
+
+    /**
+     * @brief Opens the store, recovering from the checkpoint and the log.
+     *
+     * Without a checkpoint image the records are parsed from the data
+     * file and a first checkpoint is written.
+     *
+     * @param imagePath Checkpoint image.
+     * @param logPath Write-ahead log.
+     * @param dataFile Length-indicated data file used when there is no image.
+     * @param error Receives a message on failure.
+     * @return true if the store is ready.
+     */
+    bool open(const string &imagePath, const string &logPath, const string &dataFile, string &error);
+
+    /**
+     * @brief Applies a delta and waits until it is durable.
+     *
+     * The delta is rejected as a whole, changing nothing, if it does not
+     * apply (see PostalDelta::apply()).
+     *
+     * @param delta The changes.
+     * @param summary Receives the counts of applied changes.
+     * @param error Receives a message on failure.
+     * @param changed Called with the ZIP of every applied change, e.g. to
+     *                invalidate cached results (may be empty).
+     * @return true once the changes are applied and logged to disk.
+     */
+    bool apply(const PostalDelta &delta, PostalDelta::Summary &summary, string &error,
+               const function<void(int)> &changed = nullptr);
+
+    /**
+     * @brief Writes a new checkpoint image and restarts the log.
+     * @param error Receives a message on failure.
+     * @return true if the checkpoint was written.
+     */
+    bool checkpoint(string &error);
+
+    /**
+     * @brief Copies the record of a ZIP.
+     * @param zip ZIP code to look up.
+     * @param out Receives the record.
+     * @return false if the ZIP is absent.
+     */
+    bool lookup(int zip, HeaderRecordPostalCodeItem &out) const;
+
+    /// @brief Gets the number of changes replayed from the log by open().
+    size_t getReplayedChanges() const { return replayed; }
+
+    /// @brief Gets the records; not safe while apply() runs on another thread.
+    const BlockSequenceSetPostalCode &getSequenceSet() const { return bss; }
+
+    /// @brief Gets the ZIP tree; not safe while apply() runs on another thread.
+    BPlusTree<int> &getTree() { return tree; }
+
+    /// @brief Gets the direct-address table; not safe while apply() runs on another thread.
+    const DirectAddressZipTable &getTable() const { return table; }
+
+    /// @brief Gets the write-ahead log.
+    const PostalWriteAheadLog &getLog() const { return log; }
+};
+
+#endif
@@ -0,0 +1,161 @@
+/**
+ * @file EytzingerZipIndex.cpp
+ * @brief Implements the read-only Eytzinger ZIP index.
+ */
+
+#include "EytzingerZipIndex.h"
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief Default constructor. Creates an empty index.
+ */
+EytzingerZipIndex::EytzingerZipIndex() : keys(1, 0), keyCount(0) {}
+
+/**
+ * @brief Builds the index from a collection of ZIP codes.
+ *
+ * The keys are sorted, de-duplicated and then laid out by an in-order
+ * traversal of the implicit tree, which fills every slot exactly once.
+ *
+ * @param zips ZIP codes in any order; duplicates are ignored.
+ */
+EytzingerZipIndex::EytzingerZipIndex(const vector<int> &zips)
+{
+    vector<int> sorted(zips);
+    sort(sorted.begin(), sorted.end());
+    sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+
+    keyCount = sorted.size();
+    keys.assign(keyCount + 1, 0);
+    build(sorted, 0, 1);
+}
+
+/**
+ * @brief Recursively places sorted keys into Eytzinger order.
+ * @param sorted The sorted, de-duplicated input keys.
+ * @param i Next position to read from @p sorted.
+ * @param k Current Eytzinger slot.
+ * @return The next unread position in @p sorted.
+ */
+int EytzingerZipIndex::build(const vector<int> &sorted, int i, int k)
+{
+    if (k <= keyCount)
+    {
+        i = build(sorted, i, 2 * k);
+        keys[k] = sorted[i++];
+        i = build(sorted, i, 2 * k + 1);
+    }
+    return i;
+}
+
+/**
+ * @brief Finds the Eytzinger slot of the smallest key >= zip.
+ *
+ * The descent has no data-dependent branch: each step moves to the left or
+ * right child by adding the comparison result. Sixteen 4-byte keys share a
+ * cache line, so the line holding slot @c 16k (the descendants four levels
+ * below @c k) is prefetched while the current comparison completes. When
+ * the walk falls off the tree, the trailing one bits of @c k record the
+ * final run of right turns; shifting them (and one more bit) out recovers
+ * the last node where the walk turned left, i.e. the lower bound.
+ *
+ * @param zip ZIP code to search for.
+ * @return The slot in 1..size(), or 0 if every key is smaller than @p zip.
+ */
+int EytzingerZipIndex::lowerBound(int zip) const
+{
+    const int *base = keys.data();
+    unsigned int k = 1;
+    while (k <= (unsigned int)keyCount)
+    {
+        __builtin_prefetch(base + 16 * k);
+        k = 2 * k + (base[k] < zip);
+    }
+    k >>= __builtin_ffs(~k);
+    return k;
+}
+
+/**
+ * @brief Checks whether a ZIP code is present in the index.
+ * @param zip ZIP code to search for.
+ * @return true if the ZIP is indexed.
+ */
+bool EytzingerZipIndex::search(int zip)
+{
+    int k = lowerBound(zip);
+    return k != 0 && keys[k] == zip;
+}
+
+/**
+ * @brief Checks a batch of ZIP codes with interleaved descents.
+ *
+ * Up to BATCH_LANES lookups descend the tree one level at a time in
+ * lock-step. The lanes do not depend on each other, so their cache misses
+ * overlap instead of being paid one after another. Every walk leaves the
+ * tree after at most floor(log2(size())) + 1 steps; a lane that has
+ * already left simply keeps its slot.
+ *
+ * @param zips ZIP codes to search for.
+ * @param count Number of ZIP codes.
+ * @param found Receives one result per ZIP.
+ */
+void EytzingerZipIndex::searchBatch(const int *zips, size_t count, bool *found)
+{
+    const int *base = keys.data();
+    unsigned int n = keyCount;
+    int levels = n == 0 ? 0 : 32 - __builtin_clz(n);
+    unsigned int k[BATCH_LANES];
+
+    for (size_t start = 0; start < count; start += BATCH_LANES)
+    {
+        size_t lanes = count - start < BATCH_LANES ? count - start : BATCH_LANES;
+        const int *batch = zips + start;
+        for (size_t j = 0; j < lanes; j++)
+        {
+            k[j] = 1;
+        }
+        for (int level = 0; level < levels; level++)
+        {
+            for (size_t j = 0; j < lanes; j++)
+            {
+                unsigned int slot = k[j] <= n ? k[j] : 0;
+                __builtin_prefetch(base + 16 * slot);
+                k[j] = k[j] <= n ? 2 * k[j] + (base[slot] < batch[j]) : k[j];
+            }
+        }
+        for (size_t j = 0; j < lanes; j++)
+        {
+            unsigned int slot = k[j] >> __builtin_ffs(~k[j]);
+            found[start + j] = slot != 0 && base[slot] == batch[j];
+        }
+    }
+}
+
+/**
+ * @brief Gets the engine name.
+ * @return "Eytzinger".
+ */
+string EytzingerZipIndex::name() const
+{
+    return "Eytzinger";
+}
+
+/**
+ * @brief Gets the bytes used by the key array.
+ * @return The memory footprint in bytes.
+ */
+size_t EytzingerZipIndex::memoryUsage() const
+{
+    return sizeof(*this) + keys.capacity() * sizeof(int);
+}
+
+/**
+ * @brief Gets the number of keys in the index.
+ * @return The key count.
+ */
+int EytzingerZipIndex::size() const
+{
+    return keyCount;
+}
@@ -0,0 +1,98 @@
+#ifndef EYTZINGER_ZIP_INDEX
+#define EYTZINGER_ZIP_INDEX
+
+/**
+ * @file EytzingerZipIndex.h
+ * @brief Declares the read-only Eytzinger (BFS-ordered) ZIP index.
+ *
+ * The postal dataset does not change between releases, so the ZIP keys can
+ * be frozen into an implicit binary search tree stored in breadth-first
+ * order. Node @c k has its children at @c 2k and @c 2k+1, so a search needs
+ * no pointers, walks the array with a branch-free loop and can prefetch the
+ * cache line holding the descendants four levels down.
+ */
+
+#include <vector>
+#include "ZipIndex.h"
+
+using namespace std;
+
+/**
+ * @class EytzingerZipIndex
+ * @brief Immutable ZIP index stored in Eytzinger layout.
+ */
+class EytzingerZipIndex : public ZipIndex
+{
+private:
+    /// @brief Keys in Eytzinger order, 1-indexed; slot 0 is unused.
+    vector<int> keys;
+
+    /// @brief Number of keys stored (keys.size() - 1).
+    int keyCount;
+
+    /// @brief Lookups walked in lock-step by searchBatch().
+    static const size_t BATCH_LANES = 16;
+
+    /**
+     * @brief Recursively places sorted keys into Eytzinger order.
+     * @param sorted The sorted, de-duplicated input keys.
+     * @param i Next position to read from @p sorted.
+     * @param k Current Eytzinger slot.
+     * @return The next unread position in @p sorted.
+     */
+    int build(const vector<int> &sorted, int i, int k);
+
+public:
+    /**
+     * @brief Default constructor. Creates an empty index.
+     */
+    EytzingerZipIndex();
+
+    /**
+     * @brief Builds the index from a collection of ZIP codes.
+     * @param zips ZIP codes in any order; duplicates are ignored.
+     */
+    EytzingerZipIndex(const vector<int> &zips);
+
+    /**
+     * @brief Finds the Eytzinger slot of the smallest key >= zip.
+     * @param zip ZIP code to search for.
+     * @return The slot in 1..size(), or 0 if every key is smaller than @p zip.
+     */
+    int lowerBound(int zip) const;
+
+    /**
+     * @brief Checks whether a ZIP code is present in the index.
+     * @param zip ZIP code to search for.
+     * @return true if the ZIP is indexed.
+     */
+    bool search(int zip);
+
+    /**
+     * @brief Checks a batch of ZIP codes with interleaved descents.
+     * @param zips ZIP codes to search for.
+     * @param count Number of ZIP codes.
+     * @param found Receives one result per ZIP.
+     */
+    void searchBatch(const int *zips, size_t count, bool *found);
+
+    /**
+     * @brief Gets the engine name.
+     * @return "Eytzinger".
+     */
+    string name() const;
+
+    /**
+     * @brief Gets the bytes used by the key array.
+     * @return The memory footprint in bytes.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Gets the number of keys in the index.
+     * @return The key count.
+     */
+    int size() const;
+};
+
+#endif
@@ -0,0 +1,452 @@
+/**
+ * @file GeoColumnStore.cpp
+ * @brief Implements the columnar coordinate store and its batch distance kernels.
+ *
+ * The SIMD kernels are compiled with per-function target attributes, so the
+ * file builds without special compiler flags and the instruction set is
+ * chosen at run time from what the CPU reports.
+ *
+ * Because only the kernels are AVX, the scalar tails they call and their
+ * callers are legacy-SSE encoded, and GCC does not insert vzeroupper for
+ * target-attribute functions the way it does under -mavx2. Each wide
+ * kernel therefore calls _mm256_zeroupper() itself before handing off to
+ * SSE code, avoiding the AVX-to-SSE transition penalty.
+ */
+
+#include "GeoColumnStore.h"
+#include "GeoDistance.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GEO_HAVE_X86 1
+#else
+#define GEO_HAVE_X86 0
+#endif
+
+using namespace std;
+
+/**
+ * @brief Scalar squared chord distance kernel.
+ * @param x Unit vector x column.
+ * @param y Unit vector y column.
+ * @param z Unit vector z column.
+ * @param n Number of rows.
+ * @param origin Origin unit vector.
+ * @param out Output array of @p n squared chord distances.
+ */
+static void squaredChordsScalar(const double *x, const double *y, const double *z,
+                                size_t n, const double origin[3], double *out)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        double dx = x[i] - origin[0];
+        double dy = y[i] - origin[1];
+        double dz = z[i] - origin[2];
+        out[i] = dx * dx + dy * dy + dz * dz;
+    }
+}
+
+/**
+ * @brief Scalar radius prefilter kernel.
+ * @param x Unit vector x column.
+ * @param y Unit vector y column.
+ * @param z Unit vector z column.
+ * @param n Number of rows.
+ * @param origin Origin unit vector.
+ * @param maxChord2 Largest squared chord distance accepted.
+ * @param rows Output row numbers.
+ * @return The number of rows written.
+ */
+static size_t filterChordsScalar(const double *x, const double *y, const double *z,
+                                 size_t n, const double origin[3], double maxChord2,
+                                 int *rows)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        double dx = x[i] - origin[0];
+        double dy = y[i] - origin[1];
+        double dz = z[i] - origin[2];
+        rows[count] = i;
+        count += (dx * dx + dy * dy + dz * dz <= maxChord2);
+    }
+    return count;
+}
+
+#if GEO_HAVE_X86
+
+/**
+ * @brief AVX2 squared chord distance kernel (4 rows per step).
+ * @see squaredChordsScalar
+ */
+__attribute__((target("avx2,fma"))) static void
+squaredChordsAvx2(const double *x, const double *y, const double *z,
+                  size_t n, const double origin[3], double *out)
+{
+    __m256d qx = _mm256_set1_pd(origin[0]);
+    __m256d qy = _mm256_set1_pd(origin[1]);
+    __m256d qz = _mm256_set1_pd(origin[2]);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), qx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), qy);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + i), qz);
+        __m256d d2 = _mm256_mul_pd(dx, dx);
+        d2 = _mm256_fmadd_pd(dy, dy, d2);
+        d2 = _mm256_fmadd_pd(dz, dz, d2);
+        _mm256_storeu_pd(out + i, d2);
+    }
+    _mm256_zeroupper();
+    squaredChordsScalar(x + i, y + i, z + i, n - i, origin, out + i);
+}
+
+/**
+ * @brief AVX2 radius prefilter kernel (4 rows per step).
+ * @see filterChordsScalar
+ */
+__attribute__((target("avx2,fma"))) static size_t
+filterChordsAvx2(const double *x, const double *y, const double *z,
+                 size_t n, const double origin[3], double maxChord2, int *rows)
+{
+    __m256d qx = _mm256_set1_pd(origin[0]);
+    __m256d qy = _mm256_set1_pd(origin[1]);
+    __m256d qz = _mm256_set1_pd(origin[2]);
+    __m256d limit = _mm256_set1_pd(maxChord2);
+
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), qx);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), qy);
+        __m256d dz = _mm256_sub_pd(_mm256_loadu_pd(z + i), qz);
+        __m256d d2 = _mm256_mul_pd(dx, dx);
+        d2 = _mm256_fmadd_pd(dy, dy, d2);
+        d2 = _mm256_fmadd_pd(dz, dz, d2);
+
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(d2, limit, _CMP_LE_OQ));
+        while (mask != 0)
+        {
+            rows[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    _mm256_zeroupper();
+    size_t tail = filterChordsScalar(x + i, y + i, z + i, n - i, origin, maxChord2, rows + count);
+    for (size_t j = 0; j < tail; j++)
+    {
+        rows[count + j] += i;
+    }
+    return count + tail;
+}
+
+/**
+ * @brief AVX-512 squared chord distance kernel (8 rows per step).
+ * @see squaredChordsScalar
+ */
+__attribute__((target("avx512f"))) static void
+squaredChordsAvx512(const double *x, const double *y, const double *z,
+                    size_t n, const double origin[3], double *out)
+{
+    __m512d qx = _mm512_set1_pd(origin[0]);
+    __m512d qy = _mm512_set1_pd(origin[1]);
+    __m512d qz = _mm512_set1_pd(origin[2]);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + i), qx);
+        __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + i), qy);
+        __m512d dz = _mm512_sub_pd(_mm512_loadu_pd(z + i), qz);
+        __m512d d2 = _mm512_mul_pd(dx, dx);
+        d2 = _mm512_fmadd_pd(dy, dy, d2);
+        d2 = _mm512_fmadd_pd(dz, dz, d2);
+        _mm512_storeu_pd(out + i, d2);
+    }
+    _mm256_zeroupper();
+    squaredChordsScalar(x + i, y + i, z + i, n - i, origin, out + i);
+}
+
+/**
+ * @brief AVX-512 radius prefilter kernel (8 rows per step).
+ * @see filterChordsScalar
+ */
+__attribute__((target("avx512f"))) static size_t
+filterChordsAvx512(const double *x, const double *y, const double *z,
+                   size_t n, const double origin[3], double maxChord2, int *rows)
+{
+    __m512d qx = _mm512_set1_pd(origin[0]);
+    __m512d qy = _mm512_set1_pd(origin[1]);
+    __m512d qz = _mm512_set1_pd(origin[2]);
+    __m512d limit = _mm512_set1_pd(maxChord2);
+
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512d dx = _mm512_sub_pd(_mm512_loadu_pd(x + i), qx);
+        __m512d dy = _mm512_sub_pd(_mm512_loadu_pd(y + i), qy);
+        __m512d dz = _mm512_sub_pd(_mm512_loadu_pd(z + i), qz);
+        __m512d d2 = _mm512_mul_pd(dx, dx);
+        d2 = _mm512_fmadd_pd(dy, dy, d2);
+        d2 = _mm512_fmadd_pd(dz, dz, d2);
+
+        unsigned int mask = _mm512_cmp_pd_mask(d2, limit, _CMP_LE_OQ);
+        while (mask != 0)
+        {
+            rows[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    _mm256_zeroupper();
+    size_t tail = filterChordsScalar(x + i, y + i, z + i, n - i, origin, maxChord2, rows + count);
+    for (size_t j = 0; j < tail; j++)
+    {
+        rows[count + j] += i;
+    }
+    return count + tail;
+}
+
+#endif
+
+/**
+ * @brief Default constructor. Creates an empty store using the best kernel.
+ */
+GeoColumnStore::GeoColumnStore() : kernel(bestKernel()) {}
+
+/**
+ * @brief Builds the columns from every record of a sequence set.
+ * @param bss The sequence set whose coordinates are copied.
+ */
+GeoColumnStore::GeoColumnStore(const BlockSequenceSetPostalCode &bss)
+    : GeoColumnStore()
+{
+    for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr;
+         block = block->getNext())
+    {
+        const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+        add(item.getLatitude(), item.getLongitude(), block);
+    }
+}
+
+/**
+ * @brief Appends one row and precomputes its unit vector.
+ * @param lat Latitude in degrees.
+ * @param lon Longitude in degrees.
+ * @param block Handle of the block holding the record (may be nullptr).
+ */
+void GeoColumnStore::add(double lat, double lon, const BlockPostalCode *block)
+{
+    double xyz[3];
+    toUnitVector(lat, lon, xyz);
+    latitudes.push_back(lat);
+    longitudes.push_back(lon);
+    xs.push_back(xyz[0]);
+    ys.push_back(xyz[1]);
+    zs.push_back(xyz[2]);
+    blocks.push_back(block);
+}
+
+/**
+ * @brief Computes the distance from an origin to every row.
+ *
+ * The SIMD pass produces squared chord distances; the conversion to
+ * kilometres (one asin per row) is a separate scalar pass.
+ *
+ * @param lat Origin latitude in degrees.
+ * @param lon Origin longitude in degrees.
+ * @param out Output array of size() distances in kilometres.
+ */
+void GeoColumnStore::distancesKm(double lat, double lon, double *out) const
+{
+    double origin[3];
+    toUnitVector(lat, lon, origin);
+
+    size_t n = size();
+    squaredChords(kernel, xs.data(), ys.data(), zs.data(), n, origin, out);
+    for (size_t i = 0; i < n; i++)
+    {
+        out[i] = squaredChordToKm(out[i]);
+    }
+}
+
+/**
+ * @brief Finds every row within a radius of an origin.
+ *
+ * Rows are first filtered by comparing their squared chord distance with
+ * the squared chord of the radius; only the survivors pay for the
+ * conversion to kilometres.
+ *
+ * @param lat Origin latitude in degrees.
+ * @param lon Origin longitude in degrees.
+ * @param radiusKm Radius in kilometres.
+ * @param rows Receives the matching row numbers, in row order.
+ * @param distances If not nullptr, receives the distance of each match.
+ * @return The number of matches.
+ */
+size_t GeoColumnStore::withinRadius(double lat, double lon, double radiusKm,
+                                    vector<int> &rows, vector<double> *distances) const
+{
+    double origin[3];
+    toUnitVector(lat, lon, origin);
+
+    rows.resize(size());
+    size_t count = filterChords(kernel, xs.data(), ys.data(), zs.data(), size(),
+                                origin, kmToSquaredChord(radiusKm), rows.data());
+    rows.resize(count);
+
+    if (distances != nullptr)
+    {
+        distances->resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            int row = rows[i];
+            double dx = xs[row] - origin[0];
+            double dy = ys[row] - origin[1];
+            double dz = zs[row] - origin[2];
+            (*distances)[i] = squaredChordToKm(dx * dx + dy * dy + dz * dz);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Gets the block handle of a row.
+ * @param row Row number.
+ * @return The block holding the record.
+ */
+const BlockPostalCode *GeoColumnStore::getBlock(int row) const
+{
+    return blocks[row];
+}
+
+/**
+ * @brief Gets the latitude of a row.
+ * @param row Row number.
+ * @return The latitude in degrees.
+ */
+double GeoColumnStore::getLatitude(int row) const
+{
+    return latitudes[row];
+}
+
+/**
+ * @brief Gets the longitude of a row.
+ * @param row Row number.
+ * @return The longitude in degrees.
+ */
+double GeoColumnStore::getLongitude(int row) const
+{
+    return longitudes[row];
+}
+
+/**
+ * @brief Gets the number of rows.
+ * @return The row count.
+ */
+size_t GeoColumnStore::size() const
+{
+    return xs.size();
+}
+
+/**
+ * @brief Selects the kernel used by the queries, capped to what the CPU supports.
+ * @param requested The kernel to use.
+ */
+void GeoColumnStore::setKernel(GeoKernel requested)
+{
+    GeoKernel best = bestKernel();
+    kernel = requested > best ? best : requested;
+}
+
+/**
+ * @brief Gets the kernel used by the queries.
+ * @return The active kernel.
+ */
+GeoKernel GeoColumnStore::getKernel() const
+{
+    return kernel;
+}
+
+/**
+ * @brief Gets the best kernel supported by the running CPU.
+ * @return The fastest available kernel.
+ */
+GeoKernel GeoColumnStore::bestKernel()
+{
+#if GEO_HAVE_X86
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return GEO_KERNEL_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return GEO_KERNEL_AVX2;
+    }
+#endif
+    return GEO_KERNEL_SCALAR;
+}
+
+/**
+ * @brief Gets the display name of a kernel.
+ * @param which The kernel.
+ * @return "scalar", "AVX2" or "AVX-512".
+ */
+const char *GeoColumnStore::kernelName(GeoKernel which)
+{
+    switch (which)
+    {
+    case GEO_KERNEL_AVX512:
+        return "AVX-512";
+    case GEO_KERNEL_AVX2:
+        return "AVX2";
+    default:
+        return "scalar";
+    }
+}
+
+/**
+ * @brief Dispatches the squared chord distance kernel.
+ * @see GeoColumnStore::squaredChords
+ */
+void GeoColumnStore::squaredChords(GeoKernel which, const double *x, const double *y,
+                                   const double *z, size_t n, const double origin[3],
+                                   double *out)
+{
+#if GEO_HAVE_X86
+    if (which == GEO_KERNEL_AVX512)
+    {
+        squaredChordsAvx512(x, y, z, n, origin, out);
+        return;
+    }
+    if (which == GEO_KERNEL_AVX2)
+    {
+        squaredChordsAvx2(x, y, z, n, origin, out);
+        return;
+    }
+#endif
+    squaredChordsScalar(x, y, z, n, origin, out);
+}
+
+/**
+ * @brief Dispatches the radius prefilter kernel.
+ * @see GeoColumnStore::filterChords
+ */
+size_t GeoColumnStore::filterChords(GeoKernel which, const double *x, const double *y,
+                                    const double *z, size_t n, const double origin[3],
+                                    double maxChord2, int *rows)
+{
+#if GEO_HAVE_X86
+    if (which == GEO_KERNEL_AVX512)
+    {
+        return filterChordsAvx512(x, y, z, n, origin, maxChord2, rows);
+    }
+    if (which == GEO_KERNEL_AVX2)
+    {
+        return filterChordsAvx2(x, y, z, n, origin, maxChord2, rows);
+    }
+#endif
+    return filterChordsScalar(x, y, z, n, origin, maxChord2, rows);
+}
@@ -0,0 +1,181 @@
+#ifndef GEO_COLUMN_STORE
+#define GEO_COLUMN_STORE
+
+/**
+ * @file GeoColumnStore.h
+ * @brief Declares a columnar copy of record coordinates with batch distance kernels.
+ *
+ * Radius filters, distance-between-ZIPs and delivery zones all need the
+ * great-circle distance from one origin to many records. The store keeps
+ * the coordinates as separate arrays (one column per component) together
+ * with each record's unit vector, computed once at build time. The batch
+ * kernels then compute the squared chord distance to the origin for a
+ * whole column with SIMD, which needs only multiplies and adds:
+ *  - AVX-512 (8 doubles per step) when the CPU supports it,
+ *  - AVX2/FMA (4 doubles per step) otherwise,
+ *  - a portable scalar loop as the fallback.
+ * Radius queries compare the squared chord against a threshold first and
+ * only convert the survivors to kilometres.
+ */
+
+#include <vector>
+#include <cstddef>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+
+using namespace std;
+
+/**
+ * @enum GeoKernel
+ * @brief Instruction set used by the batch distance kernels.
+ */
+enum GeoKernel
+{
+    GEO_KERNEL_SCALAR, ///< Portable scalar loop.
+    GEO_KERNEL_AVX2,   ///< 256-bit AVX2 with FMA.
+    GEO_KERNEL_AVX512  ///< 512-bit AVX-512F.
+};
+
+/**
+ * @class GeoColumnStore
+ * @brief Columnar record coordinates with SIMD batch distance queries.
+ */
+class GeoColumnStore
+{
+private:
+    vector<double> latitudes;              ///< Latitude column, in degrees.
+    vector<double> longitudes;             ///< Longitude column, in degrees.
+    vector<double> xs;                     ///< Unit vector x column.
+    vector<double> ys;                     ///< Unit vector y column.
+    vector<double> zs;                     ///< Unit vector z column.
+    vector<const BlockPostalCode *> blocks; ///< Record handle per row.
+    GeoKernel kernel;                      ///< Kernel used by the queries.
+
+public:
+    /**
+     * @brief Default constructor. Creates an empty store.
+     */
+    GeoColumnStore();
+
+    /**
+     * @brief Builds the columns from every record of a sequence set.
+     * @param bss The sequence set whose coordinates are copied.
+     */
+    GeoColumnStore(const BlockSequenceSetPostalCode &bss);
+
+    /**
+     * @brief Appends one row.
+     * @param lat Latitude in degrees.
+     * @param lon Longitude in degrees.
+     * @param block Handle of the block holding the record (may be nullptr).
+     */
+    void add(double lat, double lon, const BlockPostalCode *block);
+
+    /**
+     * @brief Computes the distance from an origin to every row.
+     * @param lat Origin latitude in degrees.
+     * @param lon Origin longitude in degrees.
+     * @param out Output array of size() distances in kilometres.
+     */
+    void distancesKm(double lat, double lon, double *out) const;
+
+    /**
+     * @brief Finds every row within a radius of an origin.
+     * @param lat Origin latitude in degrees.
+     * @param lon Origin longitude in degrees.
+     * @param radiusKm Radius in kilometres.
+     * @param rows Receives the matching row numbers, in row order.
+     * @param distances If not nullptr, receives the distance of each match.
+     * @return The number of matches.
+     */
+    size_t withinRadius(double lat, double lon, double radiusKm,
+                        vector<int> &rows, vector<double> *distances = nullptr) const;
+
+    /**
+     * @brief Gets the block handle of a row.
+     * @param row Row number.
+     * @return The block holding the record.
+     */
+    const BlockPostalCode *getBlock(int row) const;
+
+    /**
+     * @brief Gets the latitude of a row.
+     * @param row Row number.
+     * @return The latitude in degrees.
+     */
+    double getLatitude(int row) const;
+
+    /**
+     * @brief Gets the longitude of a row.
+     * @param row Row number.
+     * @return The longitude in degrees.
+     */
+    double getLongitude(int row) const;
+
+    /**
+     * @brief Gets the number of rows.
+     * @return The row count.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Selects the kernel used by the queries.
+     *
+     * Requests for an instruction set the CPU lacks fall back to the best
+     * supported one.
+     *
+     * @param requested The kernel to use.
+     */
+    void setKernel(GeoKernel requested);
+
+    /**
+     * @brief Gets the kernel used by the queries.
+     * @return The active kernel.
+     */
+    GeoKernel getKernel() const;
+
+    /**
+     * @brief Gets the best kernel supported by the running CPU.
+     * @return The fastest available kernel.
+     */
+    static GeoKernel bestKernel();
+
+    /**
+     * @brief Gets the display name of a kernel.
+     * @param which The kernel.
+     * @return "scalar", "AVX2" or "AVX-512".
+     */
+    static const char *kernelName(GeoKernel which);
+
+    /**
+     * @brief Computes squared chord distances from an origin for a column range.
+     * @param which The kernel to use.
+     * @param x Unit vector x column.
+     * @param y Unit vector y column.
+     * @param z Unit vector z column.
+     * @param n Number of rows.
+     * @param origin Origin unit vector.
+     * @param out Output array of @p n squared chord distances.
+     */
+    static void squaredChords(GeoKernel which, const double *x, const double *y,
+                              const double *z, size_t n, const double origin[3],
+                              double *out);
+
+    /**
+     * @brief Collects the rows whose squared chord distance is within a bound.
+     * @param which The kernel to use.
+     * @param x Unit vector x column.
+     * @param y Unit vector y column.
+     * @param z Unit vector z column.
+     * @param n Number of rows.
+     * @param origin Origin unit vector.
+     * @param maxChord2 Largest squared chord distance accepted.
+     * @param rows Output array with room for @p n row numbers.
+     * @return The number of rows written to @p rows.
+     */
+    static size_t filterChords(GeoKernel which, const double *x, const double *y,
+                               const double *z, size_t n, const double origin[3],
+                               double maxChord2, int *rows);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef GEO_DISTANCE
+#define GEO_DISTANCE
+
+/**
+ * @file GeoDistance.h
+ * @brief Great-circle distance helpers shared by the geographic features.
+ *
+ * Distances are computed on a sphere of mean Earth radius with the
+ * haversine formula. Points can also be mapped to 3-D unit vectors: the
+ * straight-line (chord) distance between two unit vectors is a monotonic
+ * function of the great-circle distance, so chord distances can be used
+ * for pruning and comparisons without any trigonometry.
+ */
+
+#include <cmath>
+
+/// @brief Mean Earth radius in kilometres.
+const double EARTH_RADIUS_KM = 6371.0088;
+
+/// @brief Degrees to radians conversion factor.
+const double DEG_TO_RAD = M_PI / 180.0;
+
+/**
+ * @brief Computes the haversine great-circle distance between two points.
+ * @param lat1 Latitude of the first point, in degrees.
+ * @param lon1 Longitude of the first point, in degrees.
+ * @param lat2 Latitude of the second point, in degrees.
+ * @param lon2 Longitude of the second point, in degrees.
+ * @return The distance in kilometres.
+ */
+inline double haversineKm(double lat1, double lon1, double lat2, double lon2)
+{
+    double sinHalfDLat = sin((lat2 - lat1) * DEG_TO_RAD / 2);
+    double sinHalfDLon = sin((lon2 - lon1) * DEG_TO_RAD / 2);
+    double a = sinHalfDLat * sinHalfDLat +
+               cos(lat1 * DEG_TO_RAD) * cos(lat2 * DEG_TO_RAD) * sinHalfDLon * sinHalfDLon;
+    return 2 * EARTH_RADIUS_KM * asin(sqrt(fmin(a, 1.0)));
+}
+
+/**
+ * @brief Maps a latitude/longitude to a point on the unit sphere.
+ * @param lat Latitude in degrees.
+ * @param lon Longitude in degrees.
+ * @param xyz Output array receiving the x, y and z coordinates.
+ */
+inline void toUnitVector(double lat, double lon, double xyz[3])
+{
+    double cosLat = cos(lat * DEG_TO_RAD);
+    xyz[0] = cosLat * cos(lon * DEG_TO_RAD);
+    xyz[1] = cosLat * sin(lon * DEG_TO_RAD);
+    xyz[2] = sin(lat * DEG_TO_RAD);
+}
+
+/**
+ * @brief Converts a great-circle distance to the squared chord length.
+ * @param km Great-circle distance in kilometres.
+ * @return The squared straight-line distance between unit vectors.
+ */
+inline double kmToSquaredChord(double km)
+{
+    double halfChord = sin(fmin(km / EARTH_RADIUS_KM, M_PI) / 2);
+    return 4 * halfChord * halfChord;
+}
+
+/**
+ * @brief Converts a squared chord length back to a great-circle distance.
+ * @param squaredChord Squared straight-line distance between unit vectors.
+ * @return The great-circle distance in kilometres.
+ */
+inline double squaredChordToKm(double squaredChord)
+{
+    return 2 * EARTH_RADIUS_KM * asin(fmin(sqrt(squaredChord) / 2, 1.0));
+}
+
+#endif
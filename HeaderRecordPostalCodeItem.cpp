@@ -9,9 +9,16 @@
 #include <iostream>
 #include <string>
 #include <iomanip>
+#include <charconv>
+#include <utility>
+#include <type_traits>
 
 using namespace std;
 
+static_assert(is_nothrow_move_constructible<HeaderRecordPostalCodeItem>::value &&
+                  is_nothrow_move_assignable<HeaderRecordPostalCodeItem>::value,
+              "records must move without throwing so vectors of them move on growth");
+
 /**
  * @brief Default constructor initializing member variables to default values.
  * zip is set to 0, place, state, and county are set to empty strings,
@@ -19,25 +26,17 @@ using namespace std;
  * This ensures that a HeaderRecordPostalCodeItem object starts with a known state.
  * @note This constructor can be used to create an empty HeaderRecordPostalCodeItem object,
  * which can later be populated with actual data using the setter methods.
- * @see HeaderRecordPostalCodeItem(int, const string&, const string&, const string&, double, double)
+ * @see HeaderRecordPostalCodeItem(int, int, string, string, string, double, double)
  * @see setZip(int)
- * @see setPlace(const string&)
- * @see setState(const string&)
- * @see setCounty(const string&)
+ * @see setPlace(string)
+ * @see setState(string)
+ * @see setCounty(string)
  * @see setLatitude(double)
  * @see setLongitude(double)
  * @see printInfo() const
  */
 HeaderRecordPostalCodeItem::HeaderRecordPostalCodeItem()
-{
-    recordLength = 0;
-    zip = 0;
-    place = "";
-    state = "";
-    county = "";
-    latitude = 0;
-    longitude = 0;
-}
+    : recordLength(0), zip(0), latitude(0), longitude(0) {}
 
 /**
  * @brief Parameterized constructor to initialize a HeaderRecordPostalCodeItem with specific values.
@@ -50,16 +49,8 @@ HeaderRecordPostalCodeItem::HeaderRecordPostalCodeItem()
  * This constructor allows for the creation of a fully initialized HeaderRecordPostalCodeItem object.
  * @note Ensure that the provided values are valid and meaningful for the postal code entry.
  */
-HeaderRecordPostalCodeItem::HeaderRecordPostalCodeItem(int r, int z, const string &p, const string &s, const string &c, double lat, double lon)
-{
-    recordLength = r;
-    zip = z;
-    place = p;
-    state = s;
-    county = c;
-    latitude = lat;
-    longitude = lon;
-}
+HeaderRecordPostalCodeItem::HeaderRecordPostalCodeItem(int r, int z, string p, string s, string c, double lat, double lon)
+    : recordLength(r), zip(z), place(move(p)), state(move(s)), county(move(c)), latitude(lat), longitude(lon) {}
 
 int HeaderRecordPostalCodeItem::getRecordLength() const
 {
@@ -77,29 +68,29 @@ int HeaderRecordPostalCodeItem::getZip() const
 
 /**
  * @brief Get the place name of the postal code item.
- * @return The place name as a string.
+ * @return The place name, valid as long as the item is alive and unchanged.
  */
-string HeaderRecordPostalCodeItem::getPlace() const
+const string &HeaderRecordPostalCodeItem::getPlace() const
 {
     return place;
 }
 
 /**
  * @brief Get the state name of the postal code item.
- * @return The state name as a string.
+ * @return The state name, valid as long as the item is alive and unchanged.
  */
-string HeaderRecordPostalCodeItem::getState() const
+const string &HeaderRecordPostalCodeItem::getState() const
 {
     return state;
 }
 
 /**
  * @brief Get the county name of the postal code item.
- * @return The county name as a string.
+ * @return The county name, valid as long as the item is alive and unchanged.
  * @note County names may vary in format and length depending on the region.
  * Ensure that the county name is correctly formatted for display or processing.
  */
-string HeaderRecordPostalCodeItem::getCounty() const
+const string &HeaderRecordPostalCodeItem::getCounty() const
 {
     return county;
 }
@@ -124,12 +115,40 @@ double HeaderRecordPostalCodeItem::getLongitude() const
     return longitude;
 }
 
+/**
+ * @brief Gets the record as "zip,place,state,county,latitude,longitude".
+ * @return A new string; use appendData() to reuse a buffer instead.
+ */
 string HeaderRecordPostalCodeItem::getData() const
 {
-    string zipCodeData = to_string(getZip()) + "," + getPlace() + "," + getState() + "," + getCounty() + "," + to_string(getLatitude()) + "," + to_string(getLongitude());
+    string zipCodeData;
+    // ZIP, two coordinates and five commas fit in 40 bytes
+    zipCodeData.reserve(place.size() + state.size() + county.size() + 40);
+    appendData(zipCodeData);
     return zipCodeData;
 }
 
+/**
+ * @brief Appends the record as "zip,place,state,county,latitude,longitude".
+ * @param out String the record is appended to.
+ */
+void HeaderRecordPostalCodeItem::appendData(string &out) const
+{
+    char digits[64];
+    out.append(digits, to_chars(digits, digits + sizeof(digits), zip).ptr);
+    out += ',';
+    out += place;
+    out += ',';
+    out += state;
+    out += ',';
+    out += county;
+    out += ',';
+    // Six fixed decimals, as to_string(double) prints them
+    out.append(digits, to_chars(digits, digits + sizeof(digits), latitude, chars_format::fixed, 6).ptr);
+    out += ',';
+    out.append(digits, to_chars(digits, digits + sizeof(digits), longitude, chars_format::fixed, 6).ptr);
+}
+
 void HeaderRecordPostalCodeItem::setRecordLength(int newRecordLength)
 {
     recordLength = newRecordLength;
@@ -147,32 +166,32 @@ void HeaderRecordPostalCodeItem::setZip(int newZip)
 
 /**
  * @brief Set the place name of the postal code item.
- * @param newPlace The new place name to be set (string).
+ * @param newPlace The new place name to be set (string), moved in.
  * @note Ensure that the new place name is a valid string value.
  */
-void HeaderRecordPostalCodeItem::setPlace(const string &newPlace)
+void HeaderRecordPostalCodeItem::setPlace(string newPlace)
 {
-    place = newPlace;
+    place = move(newPlace);
 }
 
 /**
  * @brief Set the state name of the postal code item.
- * @param newState The new state name to be set (string).
+ * @param newState The new state name to be set (string), moved in.
  * @note Ensure that the new state name is a valid string value.
  */
-void HeaderRecordPostalCodeItem::setState(const string &newState)
+void HeaderRecordPostalCodeItem::setState(string newState)
 {
-    state = newState;
+    state = move(newState);
 }
 
 /**
  * @brief Set the county name of the postal code item.
- * @param newCounty The new county name to be set (string).
+ * @param newCounty The new county name to be set (string), moved in.
  * @note Ensure that the new county name is a valid string value.
  */
-void HeaderRecordPostalCodeItem::setCounty(const string &newCounty)
+void HeaderRecordPostalCodeItem::setCounty(string newCounty)
 {
-    county = newCounty;
+    county = move(newCounty);
 }
 
 /**
@@ -32,11 +32,11 @@ public:
      * This ensures that a HeaderRecordPostalCodeItem object starts with a known state.
      * @note This constructor can be used to create an empty HeaderRecordPostalCodeItem object,
      * which can later be populated with actual data using the setter methods.
-     * @see HeaderRecordPostalCodeItem(int, const string&, const string&, const string&, double, double)
+     * @see HeaderRecordPostalCodeItem(int, int, string, string, string, double, double)
      * @see setZip(int)
-     * @see setPlace(const string&)
-     * @see setState(const string&)
-     * @see setCounty(const string&)
+     * @see setPlace(string)
+     * @see setState(string)
+     * @see setCounty(string)
      * @see setLatitude(double)
      * @see setLongitude(double)
      * @see printInfo() const
@@ -52,9 +52,23 @@ public:
      * @param lat The latitude (double).
      * @param lon The longitude (double).
      * This constructor allows for the creation of a fully initialized HeaderRecordPostalCodeItem object.
+     * The strings are taken by value and moved in, so callers passing
+     * temporaries (or std::move) do not pay for a copy.
      * @note Ensure that the provided values are valid and meaningful for the postal code entry.
      */
-    HeaderRecordPostalCodeItem(int r, int z, const string &p, const string &s, const string &c, double lat, double lon);
+    HeaderRecordPostalCodeItem(int r, int z, string p, string s, string c, double lat, double lon);
+
+    /// @brief Copies a record (three string copies).
+    HeaderRecordPostalCodeItem(const HeaderRecordPostalCodeItem &other) = default;
+
+    /// @brief Moves a record without allocating; noexcept so containers move instead of copy.
+    HeaderRecordPostalCodeItem(HeaderRecordPostalCodeItem &&other) noexcept = default;
+
+    /// @brief Copy-assigns a record, reusing this record's string capacity.
+    HeaderRecordPostalCodeItem &operator=(const HeaderRecordPostalCodeItem &other) = default;
+
+    /// @brief Move-assigns a record without allocating.
+    HeaderRecordPostalCodeItem &operator=(HeaderRecordPostalCodeItem &&other) noexcept = default;
 
     int getRecordLength() const;
 
@@ -66,23 +80,23 @@ public:
 
     /**
      * @brief Get the place name of the postal code item.
-     * @return The place name as a string.
+     * @return The place name, valid as long as the item is alive and unchanged.
      */
-    string getPlace() const;
+    const string &getPlace() const;
 
     /**
      * @brief Get the state name of the postal code item.
-     * @return The state name as a string.
+     * @return The state name, valid as long as the item is alive and unchanged.
      */
-    string getState() const;
+    const string &getState() const;
 
     /**
      * @brief Get the county name of the postal code item.
-     * @return The county name as a string.
+     * @return The county name, valid as long as the item is alive and unchanged.
      * @note County names may vary in format and length depending on the region.
      * Ensure that the county name is correctly formatted for display or processing.
      */
-    string getCounty() const;
+    const string &getCounty() const;
 
     /**
      * @brief Get the latitude of the postal code item.
@@ -98,8 +112,22 @@ public:
      */
     double getLongitude() const;
 
+    /**
+     * @brief Gets the record as "zip,place,state,county,latitude,longitude".
+     * @return A new string; use appendData() to reuse a buffer instead.
+     */
     string getData() const;
 
+    /**
+     * @brief Appends the record as "zip,place,state,county,latitude,longitude".
+     *
+     * Produces the same text as getData() (coordinates with six decimals)
+     * but formats the numbers in place instead of building temporaries.
+     *
+     * @param out String the record is appended to.
+     */
+    void appendData(string &out) const;
+
     void setRecordLength(int newRecordLength);
 
     /**
@@ -111,24 +139,24 @@ public:
 
     /**
      * @brief Set the place name of the postal code item.
-     * @param newPlace The new place name to be set (string).
+     * @param newPlace The new place name to be set (string), moved in.
      * @note Ensure that the new place name is a valid string value.
      */
-    void setPlace(const string &newPlace);
+    void setPlace(string newPlace);
 
     /**
      * @brief Set the state name of the postal code item.
-     * @param newState The new state name to be set (string).
+     * @param newState The new state name to be set (string), moved in.
      * @note Ensure that the new state name is a valid string value.
      */
-    void setState(const string &newState);
+    void setState(string newState);
 
     /**
      * @brief Set the county name of the postal code item.
-     * @param newCounty The new county name to be set (string).
+     * @param newCounty The new county name to be set (string), moved in.
      * @note Ensure that the new county name is a valid string value.
      */
-    void setCounty(const string &newCounty);
+    void setCounty(string newCounty);
 
     /**
      * @brief Set the latitude of the postal code item.
@@ -0,0 +1,288 @@
+/**
+ * @file KdTreePostalCode.cpp
+ * @brief Implements the k-d tree spatial index over postal records.
+ */
+
+#include "KdTreePostalCode.h"
+#include "GeoDistance.h"
+#include <algorithm>
+
+using namespace std;
+
+/// @brief Subtrees with fewer points are built on the calling thread.
+static const int PARALLEL_BUILD_POINTS = 8192;
+
+/**
+ * @brief Squared Euclidean distance between two 3-D points.
+ * @param a First point.
+ * @param b Second point.
+ * @return The squared distance.
+ */
+static double squaredDistance(const double a[3], const double b[3])
+{
+    double dx = a[0] - b[0];
+    double dy = a[1] - b[1];
+    double dz = a[2] - b[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+/**
+ * @brief Default constructor. Creates an empty index.
+ */
+KdTreePostalCode::KdTreePostalCode() {}
+
+/**
+ * @brief Builds the index over every record of a sequence set.
+ * @param bss The sequence set whose record coordinates are indexed.
+ * @param pool Pool building large subtrees in parallel.
+ */
+KdTreePostalCode::KdTreePostalCode(const BlockSequenceSetPostalCode &bss, WorkStealingPool &pool)
+{
+    for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr;
+         block = block->getNext())
+    {
+        const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+        Point point;
+        toUnitVector(item.getLatitude(), item.getLongitude(), point.xyz);
+        point.latitude = item.getLatitude();
+        point.longitude = item.getLongitude();
+        point.zip = item.getZip();
+        point.block = block;
+        points.push_back(point);
+    }
+
+    axes.assign(points.size(), 0);
+    build(0, points.size(), pool);
+}
+
+/**
+ * @brief Recursively arranges points[lo, hi) into k-d tree order.
+ *
+ * The range is split on the axis with the widest spread, at the median,
+ * so the tree stays balanced and no child pointers are needed. The two
+ * halves are disjoint, so large ones are built as separate pool tasks.
+ *
+ * @param lo First position of the range.
+ * @param hi One past the last position of the range.
+ * @param pool Pool building large subtrees in parallel.
+ */
+void KdTreePostalCode::build(int lo, int hi, WorkStealingPool &pool)
+{
+    if (hi - lo <= 1)
+    {
+        return;
+    }
+
+    double low[3] = {2, 2, 2};
+    double high[3] = {-2, -2, -2};
+    for (int i = lo; i < hi; i++)
+    {
+        for (int d = 0; d < 3; d++)
+        {
+            low[d] = min(low[d], points[i].xyz[d]);
+            high[d] = max(high[d], points[i].xyz[d]);
+        }
+    }
+    int axis = 0;
+    for (int d = 1; d < 3; d++)
+    {
+        if (high[d] - low[d] > high[axis] - low[axis])
+        {
+            axis = d;
+        }
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    nth_element(points.begin() + lo, points.begin() + mid, points.begin() + hi,
+                [axis](const Point &a, const Point &b)
+                { return a.xyz[axis] < b.xyz[axis]; });
+    axes[mid] = axis;
+
+    if (hi - lo >= PARALLEL_BUILD_POINTS)
+    {
+        future<void> lower = pool.submit([this, lo, mid, &pool]()
+                                         { build(lo, mid, pool); });
+        build(mid + 1, hi, pool);
+        pool.waitFor(lower);
+        return;
+    }
+    build(lo, mid, pool);
+    build(mid + 1, hi, pool);
+}
+
+/**
+ * @brief Recursive k-nearest-neighbour search.
+ *
+ * Visits the side of the split containing the query first, and the other
+ * side only if the splitting plane is closer than the current k-th best.
+ *
+ * @param lo First position of the subtree range.
+ * @param hi One past the last position of the subtree range.
+ * @param q Query unit vector.
+ * @param k Number of neighbours wanted.
+ * @param heap Max-heap of (squared chord, position) holding the best candidates.
+ */
+void KdTreePostalCode::nearest(int lo, int hi, const double q[3], int k,
+                               vector<pair<double, int>> &heap) const
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    double d2 = squaredDistance(points[mid].xyz, q);
+    if ((int)heap.size() < k)
+    {
+        heap.push_back(make_pair(d2, mid));
+        push_heap(heap.begin(), heap.end());
+    }
+    else if (d2 < heap.front().first)
+    {
+        pop_heap(heap.begin(), heap.end());
+        heap.back() = make_pair(d2, mid);
+        push_heap(heap.begin(), heap.end());
+    }
+
+    if (hi - lo == 1)
+    {
+        return;
+    }
+
+    int axis = axes[mid];
+    double diff = q[axis] - points[mid].xyz[axis];
+    if (diff < 0)
+    {
+        nearest(lo, mid, q, k, heap);
+        if ((int)heap.size() < k || diff * diff < heap.front().first)
+        {
+            nearest(mid + 1, hi, q, k, heap);
+        }
+    }
+    else
+    {
+        nearest(mid + 1, hi, q, k, heap);
+        if ((int)heap.size() < k || diff * diff < heap.front().first)
+        {
+            nearest(lo, mid, q, k, heap);
+        }
+    }
+}
+
+/**
+ * @brief Recursive radius search.
+ * @param lo First position of the subtree range.
+ * @param hi One past the last position of the subtree range.
+ * @param q Query unit vector.
+ * @param maxChord2 Squared chord length of the search radius.
+ * @param found Positions of the points inside the radius.
+ */
+void KdTreePostalCode::withinRadius(int lo, int hi, const double q[3],
+                                    double maxChord2, vector<int> &found) const
+{
+    if (lo >= hi)
+    {
+        return;
+    }
+
+    int mid = lo + (hi - lo) / 2;
+    if (squaredDistance(points[mid].xyz, q) <= maxChord2)
+    {
+        found.push_back(mid);
+    }
+
+    int axis = axes[mid];
+    double diff = q[axis] - points[mid].xyz[axis];
+    if (diff < 0 || diff * diff <= maxChord2)
+    {
+        withinRadius(lo, mid, q, maxChord2, found);
+    }
+    if (diff >= 0 || diff * diff <= maxChord2)
+    {
+        withinRadius(mid + 1, hi, q, maxChord2, found);
+    }
+}
+
+/**
+ * @brief Builds a result entry for an indexed point.
+ * @param position Position of the point.
+ * @param lat Query latitude in degrees.
+ * @param lon Query longitude in degrees.
+ * @return The match with its haversine distance.
+ */
+SpatialMatch KdTreePostalCode::makeMatch(int position, double lat, double lon) const
+{
+    const Point &point = points[position];
+    SpatialMatch match;
+    match.block = point.block;
+    match.zip = point.zip;
+    match.distanceKm = haversineKm(lat, lon, point.latitude, point.longitude);
+    return match;
+}
+
+/**
+ * @brief Finds the k records nearest to a point.
+ * @param lat Query latitude in degrees.
+ * @param lon Query longitude in degrees.
+ * @param k Number of neighbours wanted.
+ * @return Up to @p k matches, nearest first.
+ */
+vector<SpatialMatch> KdTreePostalCode::nearest(double lat, double lon, int k) const
+{
+    vector<SpatialMatch> result;
+    if (k <= 0)
+    {
+        return result;
+    }
+
+    double q[3];
+    toUnitVector(lat, lon, q);
+
+    vector<pair<double, int>> heap;
+    heap.reserve(k + 1);
+    nearest(0, points.size(), q, k, heap);
+    sort_heap(heap.begin(), heap.end());
+
+    for (const pair<double, int> &entry : heap)
+    {
+        result.push_back(makeMatch(entry.second, lat, lon));
+    }
+    return result;
+}
+
+/**
+ * @brief Finds every record within a great-circle radius of a point.
+ * @param lat Query latitude in degrees.
+ * @param lon Query longitude in degrees.
+ * @param radiusKm Search radius in kilometres.
+ * @return All matches inside the radius, nearest first.
+ */
+vector<SpatialMatch> KdTreePostalCode::withinRadius(double lat, double lon,
+                                                    double radiusKm) const
+{
+    double q[3];
+    toUnitVector(lat, lon, q);
+
+    vector<int> found;
+    withinRadius(0, points.size(), q, kmToSquaredChord(radiusKm), found);
+
+    vector<SpatialMatch> result;
+    result.reserve(found.size());
+    for (int position : found)
+    {
+        result.push_back(makeMatch(position, lat, lon));
+    }
+    sort(result.begin(), result.end(),
+         [](const SpatialMatch &a, const SpatialMatch &b)
+         { return a.distanceKm < b.distanceKm; });
+    return result;
+}
+
+/**
+ * @brief Gets the number of indexed records.
+ * @return The point count.
+ */
+int KdTreePostalCode::size() const
+{
+    return points.size();
+}
@@ -0,0 +1,142 @@
+#ifndef KD_TREE_POSTAL_CODE
+#define KD_TREE_POSTAL_CODE
+
+/**
+ * @file KdTreePostalCode.h
+ * @brief Declares a k-d tree over record coordinates for nearest-ZIP queries.
+ *
+ * Each record's latitude/longitude is mapped to a 3-D unit vector and the
+ * vectors are arranged in an implicit, balanced k-d tree (the median of
+ * every sub-range is the node, its halves are the subtrees). Searching in
+ * 3-D chord space is exact for great-circle distance and has no seam at
+ * the antimeridian or the poles; reported distances use the haversine formula.
+ */
+
+#include <vector>
+#include <cstdint>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "WorkStealingPool.h"
+
+using namespace std;
+
+/**
+ * @struct SpatialMatch
+ * @brief One result of a nearest-neighbour or radius query.
+ */
+struct SpatialMatch
+{
+    /// @brief Block holding the matching record.
+    const BlockPostalCode *block;
+
+    /// @brief ZIP code of the matching record.
+    int zip;
+
+    /// @brief Haversine distance from the query point, in kilometres.
+    double distanceKm;
+};
+
+/**
+ * @class KdTreePostalCode
+ * @brief Static spatial index supporting k-nearest and radius queries.
+ */
+class KdTreePostalCode
+{
+private:
+    /**
+     * @brief One indexed record: its unit vector, coordinates and handle.
+     */
+    struct Point
+    {
+        double xyz[3];                ///< Unit vector on the sphere.
+        double latitude;              ///< Latitude in degrees.
+        double longitude;             ///< Longitude in degrees.
+        int zip;                      ///< ZIP code of the record.
+        const BlockPostalCode *block; ///< Block holding the record.
+    };
+
+    /// @brief Points in implicit k-d tree order.
+    vector<Point> points;
+
+    /// @brief Split axis (0, 1 or 2) of the node stored at the same position.
+    vector<uint8_t> axes;
+
+    /**
+     * @brief Recursively arranges points[lo, hi) into k-d tree order.
+     * @param lo First position of the range.
+     * @param hi One past the last position of the range.
+     * @param pool Pool building large subtrees in parallel.
+     */
+    void build(int lo, int hi, WorkStealingPool &pool);
+
+    /**
+     * @brief Recursive k-nearest-neighbour search.
+     * @param lo First position of the subtree range.
+     * @param hi One past the last position of the subtree range.
+     * @param q Query unit vector.
+     * @param k Number of neighbours wanted.
+     * @param heap Max-heap of (squared chord, position) holding the best candidates.
+     */
+    void nearest(int lo, int hi, const double q[3], int k,
+                 vector<pair<double, int>> &heap) const;
+
+    /**
+     * @brief Recursive radius search.
+     * @param lo First position of the subtree range.
+     * @param hi One past the last position of the subtree range.
+     * @param q Query unit vector.
+     * @param maxChord2 Squared chord length of the search radius.
+     * @param found Positions of the points inside the radius.
+     */
+    void withinRadius(int lo, int hi, const double q[3], double maxChord2,
+                      vector<int> &found) const;
+
+    /**
+     * @brief Builds a result entry for an indexed point.
+     * @param position Position of the point.
+     * @param lat Query latitude in degrees.
+     * @param lon Query longitude in degrees.
+     * @return The match with its haversine distance.
+     */
+    SpatialMatch makeMatch(int position, double lat, double lon) const;
+
+public:
+    /**
+     * @brief Default constructor. Creates an empty index.
+     */
+    KdTreePostalCode();
+
+    /**
+     * @brief Builds the index over every record of a sequence set.
+     * @param bss The sequence set whose record coordinates are indexed.
+     * @param pool Pool building large subtrees in parallel.
+     */
+    KdTreePostalCode(const BlockSequenceSetPostalCode &bss,
+                     WorkStealingPool &pool = WorkStealingPool::shared());
+
+    /**
+     * @brief Finds the k records nearest to a point.
+     * @param lat Query latitude in degrees.
+     * @param lon Query longitude in degrees.
+     * @param k Number of neighbours wanted.
+     * @return Up to @p k matches, nearest first.
+     */
+    vector<SpatialMatch> nearest(double lat, double lon, int k) const;
+
+    /**
+     * @brief Finds every record within a great-circle radius of a point.
+     * @param lat Query latitude in degrees.
+     * @param lon Query longitude in degrees.
+     * @param radiusKm Search radius in kilometres.
+     * @return All matches inside the radius, nearest first.
+     */
+    vector<SpatialMatch> withinRadius(double lat, double lon, double radiusKm) const;
+
+    /**
+     * @brief Gets the number of indexed records.
+     * @return The point count.
+     */
+    int size() const;
+};
+
+#endif
@@ -0,0 +1,368 @@
+/**
+ * @file LazyPostalStore.cpp
+ * @brief Implements the on-demand record store.
+ */
+
+#include "LazyPostalStore.h"
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include "PostalOffsetIndex.h"
+#include "PostalRecordParser.h"
+
+using namespace std;
+
+/**
+ * @brief Spreads ZIPs over the cache shards.
+ * @param zip The ZIP.
+ * @return The hash (splitmix64 finalizer).
+ */
+static uint64_t shardHash(int zip)
+{
+    uint64_t x = (uint64_t)(uint32_t)zip + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Constructs a closed store.
+ * @param cacheCapacity Maximum number of decoded records kept, split evenly over the
+ *                      shards (0 disables the cache).
+ */
+LazyPostalStore::LazyPostalStore(size_t cacheCapacity)
+    : fd(-1), shardCapacity((cacheCapacity + CACHE_SHARDS - 1) / CACHE_SHARDS)
+{
+    for (int i = 0; i < CACHE_SHARDS; i++)
+    {
+        unique_ptr<Shard> shard(new Shard());
+        shard->entries.reserve(shardCapacity);
+        shard->slots.reserve(shardCapacity);
+        shard->hand = 0;
+        shard->hits = 0;
+        shard->misses = 0;
+        shards.push_back(move(shard));
+    }
+}
+
+/**
+ * @brief Destructor. Closes the data file.
+ */
+LazyPostalStore::~LazyPostalStore()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+/**
+ * @brief Opens a data file, loading its offset side-car or building it.
+ * @param dataFile The length-indicated data file.
+ * @param error Receives a message on failure.
+ * @return true if the store is ready.
+ */
+bool LazyPostalStore::open(const string &dataFile, string &error)
+{
+    PostalOffsetIndex index;
+    if (!index.loadOrBuild(dataFile, error))
+    {
+        return false;
+    }
+    if (index.getDataBytes() > UINT32_MAX)
+    {
+        error = dataFile + " is too large to be read lazily";
+        return false;
+    }
+    int opened = ::open(dataFile.c_str(), O_RDONLY);
+    if (opened < 0)
+    {
+        error = "cannot open " + dataFile + ": " + strerror(errno);
+        return false;
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    fd = opened;
+
+    // Keep the locations in ZIP order in compact arrays; the index itself is dropped.
+    vector<RecordLocation> located = index.getLocations();
+    stable_sort(located.begin(), located.end(), [](const RecordLocation &a, const RecordLocation &b)
+                { return a.zip < b.zip; });
+    zips.clear();
+    offsets.clear();
+    lengths.clear();
+    zips.reserve(located.size());
+    offsets.reserve(located.size());
+    lengths.reserve(located.size());
+    for (const RecordLocation &location : located)
+    {
+        if (location.length > MAX_RECORD_BYTES)
+        {
+            error = dataFile + ": record at offset " + to_string(location.offset) + " is too long";
+            zips.clear();
+            return false;
+        }
+        zips.push_back(location.zip);
+        offsets.push_back((uint32_t)location.offset);
+        lengths.push_back((uint16_t)location.length);
+    }
+    clearCache();
+    return true;
+}
+
+/**
+ * @brief Fetches the record of a ZIP.
+ * @param zip ZIP code to fetch.
+ * @param out Receives the record; its strings' capacity is reused.
+ * @return false if the ZIP is absent or its record cannot be read.
+ */
+bool LazyPostalStore::fetch(int zip, HeaderRecordPostalCodeItem &out)
+{
+    if (lookup(zip, out))
+    {
+        return true;
+    }
+
+    auto position = lower_bound(zips.begin(), zips.end(), zip);
+    if (position == zips.end() || *position != zip || fd < 0)
+    {
+        return false;
+    }
+    size_t record = position - zips.begin();
+    size_t length = lengths[record];
+    char line[MAX_RECORD_BYTES + 1];
+    if (pread(fd, line, length, offsets[record]) != (ssize_t)length)
+    {
+        return false;
+    }
+    if (!PostalRecordParser::parseLine(line, length, out))
+    {
+        return false;
+    }
+    remember(zip, out);
+    return true;
+}
+
+/**
+ * @brief Fetches the records of a batch of ZIPs.
+ * @param batchZips ZIP codes to fetch.
+ * @param count Number of ZIPs.
+ * @param out Receives the record of each ZIP (@p count entries).
+ * @param found Set, per ZIP, to whether its record was fetched.
+ * @param reader Reader with no reads in flight, used by this thread only.
+ * @return Number of records fetched.
+ */
+size_t LazyPostalStore::fetchBatch(const int *batchZips, size_t count, HeaderRecordPostalCodeItem *out,
+                                   bool *found, AsyncBlockReader &reader)
+{
+    size_t fetched = 0;
+    vector<size_t> cold; ///< Batch positions missing from the cache
+    for (size_t i = 0; i < count; i++)
+    {
+        found[i] = lookup(batchZips[i], out[i]);
+        if (found[i])
+        {
+            fetched++;
+        }
+        else
+        {
+            cold.push_back(i);
+        }
+    }
+
+    // Locate the cold records; read r lands in buffer slot r and is tagged r
+    vector<size_t> reads;   ///< Record number of each read
+    vector<size_t> targets; ///< Batch position of each read
+    for (size_t i : cold)
+    {
+        auto position = lower_bound(zips.begin(), zips.end(), batchZips[i]);
+        if (position != zips.end() && *position == batchZips[i] && fd >= 0)
+        {
+            reads.push_back(position - zips.begin());
+            targets.push_back(i);
+        }
+    }
+    const size_t SLOT_BYTES = MAX_RECORD_BYTES + 1;
+    vector<char> buffer(reads.size() * SLOT_BYTES);
+    vector<BlockReadCompletion> done;
+    size_t submitted = 0;
+    size_t completed = 0;
+    while (completed < reads.size())
+    {
+        // Submit every read, waiting only when the queue is full
+        while (submitted < reads.size() &&
+               reader.submit({fd, offsets[reads[submitted]], lengths[reads[submitted]],
+                              buffer.data() + submitted * SLOT_BYTES, submitted}))
+        {
+            submitted++;
+        }
+        done.clear();
+        size_t reaped = reader.wait(done, 1);
+        if (reaped == 0)
+        {
+            // io_uring_enter() failed for good and nothing more will complete;
+            // the reads not yet reaped are left not found
+            break;
+        }
+        completed += reaped;
+        for (const BlockReadCompletion &completion : done)
+        {
+            size_t length = lengths[reads[completion.tag]];
+            size_t i = targets[completion.tag];
+            char *line = buffer.data() + completion.tag * SLOT_BYTES;
+            if (completion.result != (int)length)
+            {
+                continue;
+            }
+            if (PostalRecordParser::parseLine(line, length, out[i]))
+            {
+                found[i] = true;
+                remember(batchZips[i], out[i]);
+                fetched++;
+            }
+        }
+    }
+    return fetched;
+}
+
+/**
+ * @brief Selects the shard caching a ZIP.
+ * @param zip The ZIP.
+ * @return The shard.
+ */
+LazyPostalStore::Shard &LazyPostalStore::shardFor(int zip) const
+{
+    return *shards[shardHash(zip) & (shards.size() - 1)];
+}
+
+/**
+ * @brief Copies a cached record out of its shard.
+ * @param zip The record's ZIP.
+ * @param out Receives the record on a hit.
+ * @return true on a hit.
+ */
+bool LazyPostalStore::lookup(int zip, HeaderRecordPostalCodeItem &out)
+{
+    Shard &shard = shardFor(zip);
+    lock_guard<mutex> guard(shard.lock);
+    auto slot = shard.slots.find(zip);
+    if (slot == shard.slots.end())
+    {
+        shard.misses++;
+        return false;
+    }
+    Entry &entry = shard.entries[slot->second];
+    entry.referenced = true;
+    out = entry.record;
+    shard.hits++;
+    return true;
+}
+
+/**
+ * @brief Caches a decoded record, evicting with CLOCK when its shard is full.
+ * @param zip The record's ZIP.
+ * @param record The record.
+ */
+void LazyPostalStore::remember(int zip, const HeaderRecordPostalCodeItem &record)
+{
+    if (shardCapacity == 0)
+    {
+        return;
+    }
+    Shard &shard = shardFor(zip);
+    lock_guard<mutex> guard(shard.lock);
+    if (shard.slots.count(zip) != 0)
+    {
+        return; // another thread read it meanwhile
+    }
+    if (shard.entries.size() < shardCapacity)
+    {
+        shard.slots[zip] = shard.entries.size();
+        shard.entries.push_back({zip, false, record});
+        return;
+    }
+    while (shard.entries[shard.hand].referenced)
+    {
+        shard.entries[shard.hand].referenced = false;
+        shard.hand = (shard.hand + 1) % shard.entries.size();
+    }
+    Entry &victim = shard.entries[shard.hand];
+    shard.slots.erase(victim.zip);
+    victim.zip = zip;
+    victim.record = record;
+    shard.slots[zip] = shard.hand;
+    shard.hand = (shard.hand + 1) % shard.entries.size();
+}
+
+/**
+ * @brief Drops every cached record (counters are kept).
+ */
+void LazyPostalStore::clearCache()
+{
+    for (unique_ptr<Shard> &shard : shards)
+    {
+        lock_guard<mutex> guard(shard->lock);
+        shard->entries.clear();
+        shard->slots.clear();
+        shard->hand = 0;
+    }
+}
+
+/**
+ * @brief Gets the number of ZIPs fetched from the cache.
+ * @return The hit count, summed over the shards.
+ */
+unsigned long LazyPostalStore::getHits() const
+{
+    unsigned long total = 0;
+    for (const unique_ptr<Shard> &shard : shards)
+    {
+        lock_guard<mutex> guard(shard->lock);
+        total += shard->hits;
+    }
+    return total;
+}
+
+/**
+ * @brief Gets the number of ZIPs not found in the cache.
+ * @return The miss count, summed over the shards.
+ */
+unsigned long LazyPostalStore::getMisses() const
+{
+    unsigned long total = 0;
+    for (const unique_ptr<Shard> &shard : shards)
+    {
+        lock_guard<mutex> guard(shard->lock);
+        total += shard->misses;
+    }
+    return total;
+}
+
+/**
+ * @brief Gets the approximate resident bytes of the locations and the cache.
+ * @return Bytes in use.
+ */
+size_t LazyPostalStore::memoryUsage() const
+{
+    size_t bytes = zips.capacity() * sizeof(int) + offsets.capacity() * sizeof(uint32_t) +
+                   lengths.capacity() * sizeof(uint16_t);
+    for (const unique_ptr<Shard> &shard : shards)
+    {
+        lock_guard<mutex> guard(shard->lock);
+        bytes += sizeof(Shard) + shard->entries.capacity() * sizeof(Entry);
+        bytes += shard->slots.size() * (sizeof(pair<const int, size_t>) + 2 * sizeof(void *)) +
+                 shard->slots.bucket_count() * sizeof(void *);
+        for (const Entry &entry : shard->entries)
+        {
+            for (const string *name : {&entry.record.getPlace(), &entry.record.getCounty()})
+            {
+                bytes += name->capacity() > 15 ? name->capacity() + 1 : 0;
+            }
+        }
+    }
+    return bytes;
+}
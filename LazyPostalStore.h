@@ -0,0 +1,163 @@
+#ifndef LAZY_POSTAL_STORE
+#define LAZY_POSTAL_STORE
+
+/**
+ * @file LazyPostalStore.h
+ * @brief Declares a record store that keeps only record locations resident.
+ *
+ * Instead of holding every HeaderRecordPostalCodeItem in memory, the store
+ * keeps only the ZIP, offset and length of every record (10 bytes per
+ * record, taken from the PostalOffsetIndex of the data file) and reads a
+ * record with one pread() when it is asked for, decoding it with
+ * PostalRecordParser::parseLine(). Decoded records are kept in a small
+ * CLOCK cache (second-chance eviction, as in ZipResultCache's shards), so
+ * the hot ZIPs of a skewed workload are served from memory and only cold
+ * lookups touch the file. Like ZipResultCache, the cache is split into
+ * shards with a lock each, so concurrent hits on different ZIPs rarely
+ * contend.
+ *
+ * fetchBatch() serves a batch of ZIPs at once: the records missing from
+ * the cache are submitted together to an AsyncBlockReader, so the device
+ * sees the whole batch instead of one blocking pread() at a time.
+ *
+ * fetch() and fetchBatch() may be called from several threads; no shard
+ * lock is held during file reads.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include "HeaderRecordPostalCodeItem.h"
+#include "AsyncBlockReader.h"
+
+using namespace std;
+
+/**
+ * @class LazyPostalStore
+ * @brief Fetches and decodes postal records from the data file on demand.
+ */
+class LazyPostalStore
+{
+public:
+    static const size_t DEFAULT_CACHE_CAPACITY = 2048; ///< Decoded records kept by default.
+    static const size_t MAX_RECORD_BYTES = 127;        ///< Longest line fetch() reads.
+    static const int CACHE_SHARDS = 16;                ///< Cache shards (a power of two).
+
+private:
+    /**
+     * @struct Entry
+     * @brief One cached record.
+     */
+    struct Entry
+    {
+        int zip;                           ///< Key.
+        bool referenced;                   ///< CLOCK bit, set on every hit.
+        HeaderRecordPostalCodeItem record; ///< The decoded record.
+    };
+
+    /**
+     * @struct Shard
+     * @brief Independent slice of the cache guarded by its own lock.
+     */
+    struct Shard
+    {
+        mutex lock;                       ///< Guards every member below.
+        vector<Entry> entries;            ///< Cache slots (at most shardCapacity)
+        unordered_map<int, size_t> slots; ///< ZIP → index in entries
+        size_t hand;                      ///< CLOCK hand
+        unsigned long hits;               ///< ZIPs answered from the cache
+        unsigned long misses;             ///< ZIPs looked up in the file
+    };
+
+    vector<int> zips;                  ///< ZIP of every record, ascending
+    vector<uint32_t> offsets;          ///< Offset of each record's length prefix
+    vector<uint16_t> lengths;          ///< Bytes of each record, without the newline
+    int fd;                            ///< The data file, -1 when closed
+    size_t shardCapacity;              ///< Maximum cached records per shard
+    vector<unique_ptr<Shard>> shards;  ///< CACHE_SHARDS shards
+
+    Shard &shardFor(int zip) const;
+    bool lookup(int zip, HeaderRecordPostalCodeItem &out);
+    void remember(int zip, const HeaderRecordPostalCodeItem &record);
+
+public:
+    /**
+     * @brief Constructs a closed store.
+     * @param cacheCapacity Maximum number of decoded records kept, split evenly over the
+     *                      shards (0 disables the cache).
+     */
+    explicit LazyPostalStore(size_t cacheCapacity = DEFAULT_CACHE_CAPACITY);
+
+    /**
+     * @brief Destructor. Closes the data file.
+     */
+    ~LazyPostalStore();
+
+    LazyPostalStore(const LazyPostalStore &) = delete;
+    LazyPostalStore &operator=(const LazyPostalStore &) = delete;
+
+    /**
+     * @brief Opens a data file, loading its offset side-car or building it.
+     *
+     * Offsets are kept in 32 bits, so data files of 4 GiB or more are
+     * refused.
+     *
+     * @param dataFile The length-indicated data file.
+     * @param error Receives a message on failure.
+     * @return true if the store is ready.
+     */
+    bool open(const string &dataFile, string &error);
+
+    /**
+     * @brief Gets the ZIP of every record of the open data file.
+     * @return ZIPs in ascending order.
+     */
+    const vector<int> &getZips() const { return zips; }
+
+    /**
+     * @brief Fetches the record of a ZIP.
+     * @param zip ZIP code to fetch.
+     * @param out Receives the record; its strings' capacity is reused.
+     * @return false if the ZIP is absent or its record cannot be read.
+     */
+    bool fetch(int zip, HeaderRecordPostalCodeItem &out);
+
+    /**
+     * @brief Fetches the records of a batch of ZIPs.
+     *
+     * Cached records are copied out as by fetch(); every other record is
+     * read through @p reader, all of them in flight together up to the
+     * reader's queue depth, and decoded as its read completes.
+     *
+     * @param batchZips ZIP codes to fetch.
+     * @param count Number of ZIPs.
+     * @param out Receives the record of each ZIP (@p count entries).
+     * @param found Set, per ZIP, to whether its record was fetched.
+     * @param reader Reader with no reads in flight, used by this thread only.
+     * @return Number of records fetched.
+     */
+    size_t fetchBatch(const int *batchZips, size_t count, HeaderRecordPostalCodeItem *out, bool *found,
+                      AsyncBlockReader &reader);
+
+    /**
+     * @brief Drops every cached record (counters are kept).
+     */
+    void clearCache();
+
+    /// @brief Gets the number of ZIPs fetched from the cache.
+    unsigned long getHits() const;
+
+    /// @brief Gets the number of ZIPs not found in the cache.
+    unsigned long getMisses() const;
+
+    /**
+     * @brief Gets the approximate resident bytes of the locations and the cache.
+     * @return Bytes in use.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif
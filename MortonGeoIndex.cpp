@@ -0,0 +1,258 @@
+/**
+ * @file MortonGeoIndex.cpp
+ * @brief Implements the Z-order bounding-box index over the BPlusTree.
+ */
+
+#include "MortonGeoIndex.h"
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief Builds the index over every record of a sequence set.
+ * @param bss The sequence set whose records are indexed.
+ * @param zipTable Table used to resolve ZIPs in keys back to records.
+ * @param degree Minimum degree of the underlying B+ tree.
+ */
+MortonGeoIndex::MortonGeoIndex(const BlockSequenceSetPostalCode &bss,
+                               const DirectAddressZipTable &zipTable, int degree)
+    : tree(degree), records(zipTable)
+{
+    for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr;
+         block = block->getNext())
+    {
+        const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+        tree.insert(makeKey(item.getLatitude(), item.getLongitude(), item.getZip()));
+    }
+}
+
+/**
+ * @brief Spreads the low COORD_BITS bits of a value to the even bit positions.
+ * @param value The value to spread.
+ * @return The spread bits.
+ */
+uint64_t MortonGeoIndex::spreadBits(uint64_t value)
+{
+    value &= (uint64_t(1) << COORD_BITS) - 1;
+    value = (value | (value << 16)) & 0x0000FFFF0000FFFFULL;
+    value = (value | (value << 8)) & 0x00FF00FF00FF00FFULL;
+    value = (value | (value << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    value = (value | (value << 2)) & 0x3333333333333333ULL;
+    value = (value | (value << 1)) & 0x5555555555555555ULL;
+    return value;
+}
+
+/**
+ * @brief Quantizes a latitude to COORD_BITS bits.
+ * @param lat Latitude in degrees.
+ * @return The quantized latitude, clamped to the valid range.
+ */
+uint32_t MortonGeoIndex::quantizeLatitude(double lat)
+{
+    double scaled = (lat + 90.0) / 180.0 * (1 << COORD_BITS);
+    return (uint32_t)min(max(scaled, 0.0), (double)((1 << COORD_BITS) - 1));
+}
+
+/**
+ * @brief Quantizes a longitude to COORD_BITS bits.
+ * @param lon Longitude in degrees.
+ * @return The quantized longitude, clamped to the valid range.
+ */
+uint32_t MortonGeoIndex::quantizeLongitude(double lon)
+{
+    double scaled = (lon + 180.0) / 360.0 * (1 << COORD_BITS);
+    return (uint32_t)min(max(scaled, 0.0), (double)((1 << COORD_BITS) - 1));
+}
+
+/**
+ * @brief Computes the Morton code of a coordinate.
+ * @param lat Latitude in degrees.
+ * @param lon Longitude in degrees.
+ * @return The 46-bit Z-order code.
+ */
+uint64_t MortonGeoIndex::mortonCode(double lat, double lon)
+{
+    return spreadBits(quantizeLongitude(lon)) | (spreadBits(quantizeLatitude(lat)) << 1);
+}
+
+/**
+ * @brief Computes the tree key of a record.
+ * @param lat Latitude in degrees.
+ * @param lon Longitude in degrees.
+ * @param zip ZIP code of the record.
+ * @return The Morton code with the ZIP packed into the low bits.
+ */
+uint64_t MortonGeoIndex::makeKey(double lat, double lon, int zip)
+{
+    return (mortonCode(lat, lon) << ZIP_BITS) | ((uint64_t)zip & ((1 << ZIP_BITS) - 1));
+}
+
+/**
+ * @brief Splits a quantized box into Morton key ranges.
+ *
+ * Walks a quadtree over the key space level by level. Cells fully inside
+ * the box become ranges; cells straddling the edge are split again while
+ * the range budget allows, and are emitted whole (accepting false
+ * positives) once it does not. Adjacent ranges are merged at the end.
+ *
+ * @param latLow First quantized latitude (inclusive).
+ * @param latHigh Last quantized latitude (inclusive).
+ * @param lonLow First quantized longitude (inclusive).
+ * @param lonHigh Last quantized longitude (inclusive).
+ * @param maxRanges Upper bound on the number of ranges produced.
+ * @param ranges Receives the Morton code ranges (without ZIP bits).
+ */
+void MortonGeoIndex::decompose(uint32_t latLow, uint32_t latHigh,
+                               uint32_t lonLow, uint32_t lonHigh, size_t maxRanges,
+                               vector<pair<uint64_t, uint64_t>> &ranges)
+{
+    // A cell at a level fixes the top `level` bits of each coordinate
+    struct Cell
+    {
+        uint32_t lat;
+        uint32_t lon;
+    };
+
+    vector<pair<uint64_t, uint64_t>> found;
+    vector<Cell> partial(1, Cell{0, 0});
+    int level = 0;
+
+    while (!partial.empty())
+    {
+        int shift = COORD_BITS - level;
+        if (level == COORD_BITS || found.size() + 4 * partial.size() > maxRanges)
+        {
+            for (const Cell &cell : partial)
+            {
+                uint64_t low = spreadBits((uint64_t)cell.lon << shift) |
+                               (spreadBits((uint64_t)cell.lat << shift) << 1);
+                found.push_back(make_pair(low, low | ((uint64_t(1) << (2 * shift)) - 1)));
+            }
+            break;
+        }
+
+        level++;
+        shift--;
+        vector<Cell> next;
+        for (const Cell &parent : partial)
+        {
+            for (int child = 0; child < 4; child++)
+            {
+                Cell cell = {parent.lat * 2 + (child >> 1), parent.lon * 2 + (child & 1)};
+                uint32_t cellLatLow = cell.lat << shift;
+                uint32_t cellLatHigh = cellLatLow + ((1u << shift) - 1);
+                uint32_t cellLonLow = cell.lon << shift;
+                uint32_t cellLonHigh = cellLonLow + ((1u << shift) - 1);
+
+                if (cellLatHigh < latLow || cellLatLow > latHigh ||
+                    cellLonHigh < lonLow || cellLonLow > lonHigh)
+                {
+                    continue;
+                }
+                if (cellLatLow >= latLow && cellLatHigh <= latHigh &&
+                    cellLonLow >= lonLow && cellLonHigh <= lonHigh)
+                {
+                    uint64_t low = spreadBits(cellLonLow) | (spreadBits(cellLatLow) << 1);
+                    found.push_back(make_pair(low, low | ((uint64_t(1) << (2 * shift)) - 1)));
+                }
+                else
+                {
+                    next.push_back(cell);
+                }
+            }
+        }
+        partial.swap(next);
+    }
+
+    sort(found.begin(), found.end());
+    for (const pair<uint64_t, uint64_t> &range : found)
+    {
+        if (!ranges.empty() && ranges.back().second + 1 == range.first)
+        {
+            ranges.back().second = range.second;
+        }
+        else
+        {
+            ranges.push_back(range);
+        }
+    }
+}
+
+/**
+ * @brief Finds every record inside a latitude/longitude box.
+ *
+ * Each key range is scanned with BPlusTree::rangeScan(); the record of
+ * every key found is checked against the exact box.
+ *
+ * @param minLat Southern edge in degrees.
+ * @param minLon Western edge in degrees.
+ * @param maxLat Northern edge in degrees.
+ * @param maxLon Eastern edge in degrees.
+ * @param maxRanges Upper bound on the key ranges per box (at least 1).
+ * @return Matching records and per-range statistics.
+ */
+MortonBoxResult MortonGeoIndex::boxQuery(double minLat, double minLon,
+                                         double maxLat, double maxLon, size_t maxRanges)
+{
+    MortonBoxResult result;
+    if (minLat > maxLat)
+    {
+        return result;
+    }
+    if (minLon > maxLon)
+    {
+        MortonBoxResult east = boxQuery(minLat, minLon, maxLat, 180.0, maxRanges);
+        result = boxQuery(minLat, -180.0, maxLat, maxLon, maxRanges);
+        result.matches.insert(result.matches.end(), east.matches.begin(), east.matches.end());
+        result.ranges.insert(result.ranges.end(), east.ranges.begin(), east.ranges.end());
+        return result;
+    }
+
+    vector<pair<uint64_t, uint64_t>> ranges;
+    decompose(quantizeLatitude(minLat), quantizeLatitude(maxLat),
+              quantizeLongitude(minLon), quantizeLongitude(maxLon),
+              max(maxRanges, (size_t)1), ranges);
+
+    const uint64_t zipMask = (uint64_t(1) << ZIP_BITS) - 1;
+    for (const pair<uint64_t, uint64_t> &range : ranges)
+    {
+        MortonRangeReport report;
+        report.lowKey = range.first << ZIP_BITS;
+        report.highKey = (range.second << ZIP_BITS) | zipMask;
+        report.matched = 0;
+        report.falsePositives = 0;
+
+        report.scanned = tree.rangeScan(report.lowKey, report.highKey,
+                                        [&](const uint64_t &key)
+                                        {
+            const BlockPostalCode *block = records.find(key & zipMask);
+            if (block == nullptr)
+            {
+                report.falsePositives++;
+                return;
+            }
+            const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+            if (item.getLatitude() >= minLat && item.getLatitude() <= maxLat &&
+                item.getLongitude() >= minLon && item.getLongitude() <= maxLon)
+            {
+                result.matches.push_back(block);
+                report.matched++;
+            }
+            else
+            {
+                report.falsePositives++;
+            } });
+
+        result.ranges.push_back(report);
+    }
+    return result;
+}
+
+/**
+ * @brief Gets the underlying tree.
+ * @return The B+ tree holding the packed keys.
+ */
+BPlusTree<uint64_t> &MortonGeoIndex::getTree()
+{
+    return tree;
+}
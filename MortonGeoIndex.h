@@ -0,0 +1,158 @@
+#ifndef MORTON_GEO_INDEX
+#define MORTON_GEO_INDEX
+
+/**
+ * @file MortonGeoIndex.h
+ * @brief Declares a bounding-box index that stores Z-order keys in a BPlusTree.
+ *
+ * Latitude and longitude are each quantized to 23 bits and interleaved into
+ * a 46-bit Morton (Z-order) code, so points close on the map tend to be
+ * close in key order. The ZIP code is packed into the low 17 bits, which
+ * keeps keys unique for records that share a location:
+ * @code
+ * key = morton(lat, lon) << 17 | zip
+ * @endcode
+ * A bounding box is split into a small set of Morton key ranges (cells of
+ * a quadtree over the key space) and each range is answered by a range
+ * scan of the tree. Cells that straddle the box edge can return points
+ * outside it; those are counted as false positives and dropped.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "B+tree.cpp"
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "DirectAddressZipTable.h"
+
+using namespace std;
+
+/**
+ * @struct MortonRangeReport
+ * @brief Result counts for one key range scanned by a box query.
+ */
+struct MortonRangeReport
+{
+    uint64_t lowKey;       ///< First key of the range (inclusive).
+    uint64_t highKey;      ///< Last key of the range (inclusive).
+    size_t scanned;        ///< Keys returned by the range scan.
+    size_t matched;        ///< Keys whose record lies inside the box.
+    size_t falsePositives; ///< Keys whose record lies outside the box.
+};
+
+/**
+ * @struct MortonBoxResult
+ * @brief Records found by a box query plus per-range statistics.
+ */
+struct MortonBoxResult
+{
+    vector<const BlockPostalCode *> matches; ///< Blocks of the records inside the box.
+    vector<MortonRangeReport> ranges;        ///< One report per key range scanned.
+};
+
+/**
+ * @class MortonGeoIndex
+ * @brief Z-order keys in a BPlusTree<uint64_t> for bounding-box queries.
+ */
+class MortonGeoIndex
+{
+public:
+    /// @brief Bits per quantized coordinate.
+    static const int COORD_BITS = 23;
+
+    /// @brief Bits reserved for the ZIP code below the Morton code.
+    static const int ZIP_BITS = 17;
+
+private:
+    /// @brief Tree holding one packed key per record.
+    BPlusTree<uint64_t> tree;
+
+    /// @brief Resolves the ZIP in a key back to its record.
+    const DirectAddressZipTable &records;
+
+    /**
+     * @brief Spreads the low COORD_BITS bits of a value to the even bit positions.
+     * @param value The value to spread.
+     * @return The spread bits.
+     */
+    static uint64_t spreadBits(uint64_t value);
+
+    /**
+     * @brief Splits a quantized box into Morton key ranges.
+     * @param latLow First quantized latitude (inclusive).
+     * @param latHigh Last quantized latitude (inclusive).
+     * @param lonLow First quantized longitude (inclusive).
+     * @param lonHigh Last quantized longitude (inclusive).
+     * @param maxRanges Upper bound on the number of ranges produced.
+     * @param ranges Receives the Morton code ranges (without ZIP bits).
+     */
+    static void decompose(uint32_t latLow, uint32_t latHigh,
+                          uint32_t lonLow, uint32_t lonHigh, size_t maxRanges,
+                          vector<pair<uint64_t, uint64_t>> &ranges);
+
+public:
+    /**
+     * @brief Builds the index over every record of a sequence set.
+     * @param bss The sequence set whose records are indexed.
+     * @param zipTable Table used to resolve ZIPs in keys back to records.
+     * @param degree Minimum degree of the underlying B+ tree.
+     */
+    MortonGeoIndex(const BlockSequenceSetPostalCode &bss,
+                   const DirectAddressZipTable &zipTable, int degree = 10);
+
+    /**
+     * @brief Quantizes a latitude to COORD_BITS bits.
+     * @param lat Latitude in degrees.
+     * @return The quantized latitude.
+     */
+    static uint32_t quantizeLatitude(double lat);
+
+    /**
+     * @brief Quantizes a longitude to COORD_BITS bits.
+     * @param lon Longitude in degrees.
+     * @return The quantized longitude.
+     */
+    static uint32_t quantizeLongitude(double lon);
+
+    /**
+     * @brief Computes the Morton code of a coordinate.
+     * @param lat Latitude in degrees.
+     * @param lon Longitude in degrees.
+     * @return The 46-bit Z-order code (longitude on even bits, latitude on odd bits).
+     */
+    static uint64_t mortonCode(double lat, double lon);
+
+    /**
+     * @brief Computes the tree key of a record.
+     * @param lat Latitude in degrees.
+     * @param lon Longitude in degrees.
+     * @param zip ZIP code of the record.
+     * @return The Morton code with the ZIP packed into the low bits.
+     */
+    static uint64_t makeKey(double lat, double lon, int zip);
+
+    /**
+     * @brief Finds every record inside a latitude/longitude box.
+     *
+     * A box whose minimum longitude is greater than its maximum longitude
+     * is taken to cross the antimeridian and is queried as two boxes.
+     *
+     * @param minLat Southern edge in degrees.
+     * @param minLon Western edge in degrees.
+     * @param maxLat Northern edge in degrees.
+     * @param maxLon Eastern edge in degrees.
+     * @param maxRanges Upper bound on the key ranges per box (at least 1).
+     * @return Matching records and per-range statistics.
+     */
+    MortonBoxResult boxQuery(double minLat, double minLon,
+                             double maxLat, double maxLon, size_t maxRanges = 16);
+
+    /**
+     * @brief Gets the underlying tree.
+     * @return The B+ tree holding the packed keys.
+     */
+    BPlusTree<uint64_t> &getTree();
+};
+
+#endif
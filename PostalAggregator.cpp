@@ -0,0 +1,193 @@
+/**
+ * @file PostalAggregator.cpp
+ * @brief Implements the single-pass, multi-threaded group aggregation engine.
+ */
+
+#include "PostalAggregator.h"
+#include "GeoDistance.h"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @brief Gets the latitude of the group's geographic centroid.
+ *
+ * The centroid is the direction of the summed unit vectors, which stays
+ * correct for groups that straddle the antimeridian.
+ *
+ * @return The centroid latitude in degrees.
+ */
+double GroupAggregate::centroidLatitude() const
+{
+    return atan2(sumXyz[2], hypot(sumXyz[0], sumXyz[1])) / DEG_TO_RAD;
+}
+
+/**
+ * @brief Gets the longitude of the group's geographic centroid.
+ * @return The centroid longitude in degrees.
+ */
+double GroupAggregate::centroidLongitude() const
+{
+    return atan2(sumXyz[1], sumXyz[0]) / DEG_TO_RAD;
+}
+
+/**
+ * @brief Replaces an extreme when a candidate is strictly better, or ties with a smaller ZIP.
+ * @param current The extreme so far.
+ * @param candidate The competing record.
+ * @param better Difference (candidate - current) in the direction being maximized.
+ */
+static void keepExtreme(ExtremePoint &current, const ExtremePoint &candidate, double better)
+{
+    if (better > 0 || (better == 0 && candidate.zip < current.zip))
+    {
+        current = candidate;
+    }
+}
+
+/**
+ * @brief Folds one record into a group aggregate.
+ * @param group The aggregate to update (count 0 means empty).
+ * @param record The record to add.
+ */
+void PostalAggregator::accumulate(GroupAggregate &group, const HeaderRecordPostalCodeItem &record)
+{
+    ExtremePoint point = {record.getZip(), record.getLatitude(), record.getLongitude()};
+    double xyz[3];
+    toUnitVector(point.latitude, point.longitude, xyz);
+
+    if (group.count == 0)
+    {
+        group.northmost = group.southmost = group.eastmost = group.westmost = point;
+        group.sumXyz[0] = group.sumXyz[1] = group.sumXyz[2] = 0;
+    }
+    else
+    {
+        keepExtreme(group.northmost, point, point.latitude - group.northmost.latitude);
+        keepExtreme(group.southmost, point, group.southmost.latitude - point.latitude);
+        keepExtreme(group.eastmost, point, point.longitude - group.eastmost.longitude);
+        keepExtreme(group.westmost, point, group.westmost.longitude - point.longitude);
+    }
+    group.count++;
+    for (int d = 0; d < 3; d++)
+    {
+        group.sumXyz[d] += xyz[d];
+    }
+}
+
+/**
+ * @brief Merges a partial aggregate of the same group into another.
+ * @param into The aggregate receiving the merge.
+ * @param from The partial aggregate to fold in.
+ */
+void PostalAggregator::merge(GroupAggregate &into, const GroupAggregate &from)
+{
+    if (from.count == 0)
+    {
+        return;
+    }
+    if (into.count == 0)
+    {
+        into = from;
+        return;
+    }
+    keepExtreme(into.northmost, from.northmost, from.northmost.latitude - into.northmost.latitude);
+    keepExtreme(into.southmost, from.southmost, into.southmost.latitude - from.southmost.latitude);
+    keepExtreme(into.eastmost, from.eastmost, from.eastmost.longitude - into.eastmost.longitude);
+    keepExtreme(into.westmost, from.westmost, into.westmost.longitude - from.westmost.longitude);
+    into.count += from.count;
+    for (int d = 0; d < 3; d++)
+    {
+        into.sumXyz[d] += from.sumXyz[d];
+    }
+}
+
+/// @brief Fewest records reduced by one partition, so merging stays cheaper than the pass.
+static const size_t PARTITION_RECORDS = 4096;
+
+/**
+ * @brief Reduces one contiguous partition of the records into a private table.
+ * @param records All records.
+ * @param begin First record of the partition.
+ * @param end One past the last record of the partition.
+ * @param groupBy The grouping key.
+ * @return The partition's group table.
+ */
+static unordered_map<string, GroupAggregate> aggregatePartition(
+    const vector<HeaderRecordPostalCodeItem> &records, size_t begin, size_t end, GroupBy groupBy)
+{
+    unordered_map<string, GroupAggregate> groups;
+    string key;
+    for (size_t i = begin; i < end; i++)
+    {
+        const HeaderRecordPostalCodeItem &record = records[i];
+        key = record.getState();
+        if (groupBy == GROUP_BY_STATE_COUNTY)
+        {
+            key += '\0';
+            key += record.getCounty();
+        }
+
+        auto it = groups.find(key);
+        if (it == groups.end())
+        {
+            GroupAggregate group;
+            group.state = record.getState();
+            group.county = groupBy == GROUP_BY_STATE_COUNTY ? record.getCounty() : "";
+            group.count = 0;
+            it = groups.emplace(key, group).first;
+        }
+        PostalAggregator::accumulate(it->second, record);
+    }
+    return groups;
+}
+
+/**
+ * @brief Aggregates records by group.
+ *
+ * Each partition is reduced into its own table, so no locking is needed
+ * during the pass; the partial tables are merged in partition order.
+ * About eight partitions per worker leave idle workers something to steal
+ * without multiplying the merge work.
+ *
+ * @param records The records to reduce.
+ * @param groupBy The grouping key.
+ * @param pool Pool running the partitions.
+ * @return One aggregate per group, sorted by state then county.
+ */
+vector<GroupAggregate> PostalAggregator::aggregate(const vector<HeaderRecordPostalCodeItem> &records,
+                                                   GroupBy groupBy, WorkStealingPool &pool)
+{
+    size_t grain = max(PARTITION_RECORDS, records.size() / (8 * pool.size()));
+    unordered_map<string, GroupAggregate> groups = pool.parallelReduce(
+        0, records.size(), grain, unordered_map<string, GroupAggregate>(),
+        [&records, groupBy](size_t begin, size_t end)
+        { return aggregatePartition(records, begin, end, groupBy); },
+        [](unordered_map<string, GroupAggregate> &into, unordered_map<string, GroupAggregate> &from)
+        {
+            for (auto &entry : from)
+            {
+                auto it = into.find(entry.first);
+                if (it == into.end())
+                {
+                    into.emplace(entry.first, move(entry.second));
+                }
+                else
+                {
+                    merge(it->second, entry.second);
+                }
+            }
+        });
+
+    vector<GroupAggregate> result;
+    result.reserve(groups.size());
+    for (const auto &entry : groups)
+    {
+        result.push_back(entry.second);
+    }
+    sort(result.begin(), result.end(),
+         [](const GroupAggregate &a, const GroupAggregate &b)
+         { return a.state != b.state ? a.state < b.state : a.county < b.county; });
+    return result;
+}
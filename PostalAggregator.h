@@ -0,0 +1,107 @@
+#ifndef POSTAL_AGGREGATOR
+#define POSTAL_AGGREGATOR
+
+/**
+ * @file PostalAggregator.h
+ * @brief Declares the single-pass, multi-threaded group aggregation engine.
+ *
+ * Computes per-group reductions over postal records in one pass:
+ * record count, the northernmost / southernmost / easternmost /
+ * westernmost ZIP, and the geographic centroid. The records are split
+ * into contiguous partitions run on a WorkStealingPool; each partition is
+ * reduced into a private table, and the partial tables are merged at the end.
+ */
+
+#include <string>
+#include <vector>
+#include "HeaderRecordPostalCodeItem.h"
+#include "WorkStealingPool.h"
+
+using namespace std;
+
+/**
+ * @enum GroupBy
+ * @brief Grouping key used by the aggregation engine.
+ */
+enum GroupBy
+{
+    GROUP_BY_STATE,       ///< One group per state.
+    GROUP_BY_STATE_COUNTY ///< One group per (state, county) pair.
+};
+
+/**
+ * @struct ExtremePoint
+ * @brief A record holding an extreme coordinate of a group.
+ */
+struct ExtremePoint
+{
+    int zip;          ///< ZIP code of the record.
+    double latitude;  ///< Latitude of the record.
+    double longitude; ///< Longitude of the record.
+};
+
+/**
+ * @struct GroupAggregate
+ * @brief Reductions computed for one group.
+ *
+ * Ties on an extreme coordinate are broken by the smaller ZIP, so the
+ * result does not depend on how the records were partitioned.
+ */
+struct GroupAggregate
+{
+    string state;           ///< State of the group.
+    string county;          ///< County of the group (empty when grouped by state).
+    long count;             ///< Number of records in the group.
+    ExtremePoint northmost; ///< Record with the largest latitude.
+    ExtremePoint southmost; ///< Record with the smallest latitude.
+    ExtremePoint eastmost;  ///< Record with the largest longitude.
+    ExtremePoint westmost;  ///< Record with the smallest longitude.
+    double sumXyz[3];       ///< Sum of the records' unit vectors (for the centroid).
+
+    /**
+     * @brief Gets the latitude of the group's geographic centroid.
+     * @return The centroid latitude in degrees.
+     */
+    double centroidLatitude() const;
+
+    /**
+     * @brief Gets the longitude of the group's geographic centroid.
+     * @return The centroid longitude in degrees.
+     */
+    double centroidLongitude() const;
+};
+
+/**
+ * @class PostalAggregator
+ * @brief Parallel one-pass per-group aggregation over postal records.
+ */
+class PostalAggregator
+{
+public:
+    /**
+     * @brief Aggregates records by group.
+     * @param records The records to reduce.
+     * @param groupBy The grouping key.
+     * @param pool Pool running the partitions.
+     * @return One aggregate per group, sorted by state then county.
+     */
+    static vector<GroupAggregate> aggregate(const vector<HeaderRecordPostalCodeItem> &records,
+                                            GroupBy groupBy,
+                                            WorkStealingPool &pool = WorkStealingPool::shared());
+
+    /**
+     * @brief Folds one record into a group aggregate.
+     * @param group The aggregate to update (count 0 means empty).
+     * @param record The record to add.
+     */
+    static void accumulate(GroupAggregate &group, const HeaderRecordPostalCodeItem &record);
+
+    /**
+     * @brief Merges a partial aggregate of the same group into another.
+     * @param into The aggregate receiving the merge.
+     * @param from The partial aggregate to fold in.
+     */
+    static void merge(GroupAggregate &into, const GroupAggregate &from);
+};
+
+#endif
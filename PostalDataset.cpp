@@ -0,0 +1,66 @@
+/**
+ * @file PostalDataset.cpp
+ * @brief Implements loading of one postal release and its indexes.
+ */
+
+#include "PostalDataset.h"
+#include "PostalRecordParser.h"
+
+using namespace std;
+
+/**
+ * @brief Constructs an empty dataset.
+ */
+PostalDataset::PostalDataset() : tree(10), version(0)
+{
+}
+
+/**
+ * @brief Parses a data file and builds every index over its records.
+ * @param dataFile Length-indicated data file.
+ * @param error Receives a message on failure.
+ * @return false if the file holds no records.
+ */
+bool PostalDataset::load(const string &dataFile, string &error)
+{
+    if (PostalRecordParser::loadBlockSequenceSet(bss, dataFile) == 0)
+    {
+        error = "no records could be read from " + dataFile;
+        return false;
+    }
+    source = dataFile;
+    table = DirectAddressZipTable(bss);
+    for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr; block = block->getNext())
+    {
+        tree.insert(block->getBlockItem().getZip());
+    }
+    spatialIndex = KdTreePostalCode(bss);
+    return true;
+}
+
+/**
+ * @brief Builds the dataset as a copy of another with a delta applied.
+ * @param base The dataset to start from.
+ * @param delta The changes.
+ * @param summary Receives the counts of applied changes.
+ * @param error Receives a message on failure.
+ * @param changed Called with the ZIP of every applied change (may be empty).
+ * @return false if the delta does not apply to @p base.
+ */
+bool PostalDataset::derive(const PostalDataset &base, const PostalDelta &delta, PostalDelta::Summary &summary,
+                           string &error, const function<void(int)> &changed)
+{
+    for (const BlockPostalCode *block = base.bss.getHeadBlock(); block != nullptr; block = block->getNext())
+    {
+        bss.add(block->getBlockItem());
+        tree.insert(block->getBlockItem().getZip());
+    }
+    table = DirectAddressZipTable(bss);
+    if (!delta.apply(bss, tree, table, summary, error, changed))
+    {
+        return false;
+    }
+    source = base.source;
+    spatialIndex = KdTreePostalCode(bss);
+    return true;
+}
@@ -0,0 +1,100 @@
+#ifndef POSTAL_DATASET
+#define POSTAL_DATASET
+
+/**
+ * @file PostalDataset.h
+ * @brief Declares one loaded version of the postal data with its indexes.
+ *
+ * A PostalDataset bundles everything the query paths read: the sequence
+ * set of records, the direct-address ZIP table, the ZIP B+ tree and the
+ * k-d tree. It is built once by load() or derive() and only read
+ * afterwards, so a whole release can be prepared on one thread and handed
+ * to readers as a unit (see PostalDatasetPublisher).
+ */
+
+#include <cstdint>
+#include <string>
+#include <functional>
+#include "B+tree.cpp"
+#include "BlockSequenceSetPostalCode.h"
+#include "DirectAddressZipTable.h"
+#include "KdTreePostalCode.h"
+#include "PostalDelta.h"
+
+using namespace std;
+
+/**
+ * @class PostalDataset
+ * @brief Records and indexes of one postal release.
+ */
+class PostalDataset
+{
+private:
+    BlockSequenceSetPostalCode bss;  ///< Records in file order
+    DirectAddressZipTable table;     ///< ZIP → block
+    BPlusTree<int> tree;             ///< ZIP index for range queries
+    KdTreePostalCode spatialIndex;   ///< Nearest and radius queries
+    string source;                   ///< File the records came from
+    uint64_t version;                ///< Number given by the publisher
+
+public:
+    /**
+     * @brief Constructs an empty dataset.
+     */
+    PostalDataset();
+
+    /// @brief Datasets own their records and are not copyable.
+    PostalDataset(const PostalDataset &) = delete;
+
+    /// @brief Datasets are not copy-assignable.
+    PostalDataset &operator=(const PostalDataset &) = delete;
+
+    /**
+     * @brief Parses a data file and builds every index over its records.
+     * @param dataFile Length-indicated data file.
+     * @param error Receives a message on failure.
+     * @return false if the file holds no records.
+     * @pre The dataset is empty.
+     */
+    bool load(const string &dataFile, string &error);
+
+    /**
+     * @brief Builds the dataset as a copy of another with a delta applied.
+     *
+     * @p base is only read, so it can keep serving while the copy is
+     * built. The delta is applied as by PostalDelta::apply().
+     *
+     * @param base The dataset to start from.
+     * @param delta The changes.
+     * @param summary Receives the counts of applied changes.
+     * @param error Receives a message on failure.
+     * @param changed Called with the ZIP of every applied change (may be empty).
+     * @return false if the delta does not apply to @p base.
+     * @pre The dataset is empty.
+     */
+    bool derive(const PostalDataset &base, const PostalDelta &delta, PostalDelta::Summary &summary,
+                string &error, const function<void(int)> &changed = nullptr);
+
+    /// @brief Gets the records.
+    const BlockSequenceSetPostalCode &getSequenceSet() const { return bss; }
+
+    /// @brief Gets the direct-address ZIP table.
+    const DirectAddressZipTable &getTable() const { return table; }
+
+    /// @brief Gets the ZIP B+ tree; readers must not modify it.
+    BPlusTree<int> &getTree() { return tree; }
+
+    /// @brief Gets the spatial index.
+    const KdTreePostalCode &getSpatialIndex() const { return spatialIndex; }
+
+    /// @brief Gets the file the records were loaded from.
+    const string &getSource() const { return source; }
+
+    /// @brief Gets the version number, 0 until published.
+    uint64_t getVersion() const { return version; }
+
+    /// @brief Sets the version number (done by the publisher).
+    void setVersion(uint64_t number) { version = number; }
+};
+
+#endif
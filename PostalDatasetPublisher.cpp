@@ -0,0 +1,124 @@
+/**
+ * @file PostalDatasetPublisher.cpp
+ * @brief Implements read-copy-update publication of postal datasets.
+ */
+
+#include "PostalDatasetPublisher.h"
+#include <chrono>
+#include <thread>
+
+using namespace std;
+
+/**
+ * @brief Enters a read-side critical section.
+ *
+ * The counter is incremented before the pointer is loaded, so a
+ * publish() that misses the increment has already swapped the pointer
+ * and this reader gets the new version.
+ *
+ * @param from The publisher.
+ */
+PostalDatasetPublisher::ReadGuard::ReadGuard(PostalDatasetPublisher &from)
+    : publisher(from), counter(from.slots[slotOfThread()].active[from.epoch.load() & 1])
+{
+    counter.fetch_add(1);
+    dataset = publisher.current.load();
+}
+
+/**
+ * @brief Leaves the read-side critical section.
+ */
+PostalDatasetPublisher::ReadGuard::~ReadGuard()
+{
+    counter.fetch_sub(1, memory_order_release);
+}
+
+/**
+ * @brief Constructs a publisher of a first version.
+ * @param initial The first dataset.
+ */
+PostalDatasetPublisher::PostalDatasetPublisher(unique_ptr<PostalDataset> initial)
+    : epoch(0), current(nullptr), published(1), reclaimed(0)
+{
+    for (ReaderSlot &slot : slots)
+    {
+        slot.active[0] = 0;
+        slot.active[1] = 0;
+    }
+    initial->setVersion(1);
+    current = initial.release();
+}
+
+/**
+ * @brief Destructor. Deletes the current version.
+ */
+PostalDatasetPublisher::~PostalDatasetPublisher()
+{
+    delete current.load();
+}
+
+/**
+ * @brief Gets the reader slot of the calling thread.
+ *
+ * Threads take slots round-robin the first time they read, so up to
+ * READER_SLOTS threads count on separate cache lines.
+ *
+ * @return The slot index.
+ */
+size_t PostalDatasetPublisher::slotOfThread()
+{
+    static atomic<size_t> nextSlot(0);
+    thread_local size_t slot = nextSlot.fetch_add(1) % READER_SLOTS;
+    return slot;
+}
+
+/**
+ * @brief Advances the epoch and waits until the readers of the previous one leave.
+ *
+ * Readers entering from now on count on the other parity, so the counters
+ * being waited on only go down.
+ */
+void PostalDatasetPublisher::waitForReaders()
+{
+    size_t parity = epoch.fetch_add(1) & 1;
+    for (ReaderSlot &slot : slots)
+    {
+        for (int spins = 0; slot.active[parity].load() != 0; spins++)
+        {
+            if (spins < 100)
+            {
+                this_thread::yield();
+            }
+            else
+            {
+                this_thread::sleep_for(chrono::microseconds(50));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Makes a new version current and reclaims the old one.
+ *
+ * After the swap both parities are waited out: a reader that read the
+ * epoch before the previous publish() but incremented its counter only
+ * now counts on the parity that is not current, and may have loaded the
+ * old pointer.
+ *
+ * @param next The new dataset.
+ * @return The version number given to @p next.
+ */
+uint64_t PostalDatasetPublisher::publish(unique_ptr<PostalDataset> next)
+{
+    lock_guard<mutex> guard(publishLock);
+    uint64_t number = published + 1;
+    next->setVersion(number);
+    PostalDataset *old = current.exchange(next.release());
+    published = number;
+
+    waitForReaders();
+    waitForReaders();
+    delete old;
+    reclaimed++;
+    return number;
+}
@@ -0,0 +1,140 @@
+#ifndef POSTAL_DATASET_PUBLISHER
+#define POSTAL_DATASET_PUBLISHER
+
+/**
+ * @file PostalDatasetPublisher.h
+ * @brief Declares read-copy-update publication of postal datasets.
+ *
+ * Readers reach the current PostalDataset through an atomic pointer and
+ * never take a lock: a ReadGuard announces the reader in the current
+ * epoch, loads the pointer and keeps that version alive until the guard
+ * is destroyed. A new release is built off to the side (typically on a
+ * background thread) and handed to publish(), which swaps the pointer in
+ * one store. Readers that started before the swap finish on the old
+ * version, readers that start after it see the new one.
+ *
+ * Readers announce themselves by incrementing a counter of their slot for
+ * the parity of the epoch they saw. publish() swaps the pointer, then
+ * waits out both parities in turn (advancing the epoch before each wait so
+ * that new readers count on the other one), after which no reader can
+ * still hold the old version, and deletes it. Only the publishing thread
+ * ever waits or frees memory; readers pay two atomic increments on a slot
+ * that is mostly private to their thread.
+ */
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include "PostalDataset.h"
+
+using namespace std;
+
+/**
+ * @class PostalDatasetPublisher
+ * @brief Epoch-protected pointer to the current PostalDataset.
+ */
+class PostalDatasetPublisher
+{
+public:
+    static const size_t READER_SLOTS = 64; ///< Reader counters; threads are spread over them.
+
+    /**
+     * @class ReadGuard
+     * @brief Keeps the version that was current at construction alive.
+     *
+     * Guards are cheap and meant to cover one request or one batch of
+     * requests; a guard held forever blocks the next publish().
+     */
+    class ReadGuard
+    {
+    private:
+        PostalDatasetPublisher &publisher; ///< Publisher read from
+        atomic<long> &counter;             ///< Counter incremented on entry
+        PostalDataset *dataset;            ///< Version being read
+
+    public:
+        /**
+         * @brief Enters a read-side critical section.
+         * @param from The publisher.
+         */
+        explicit ReadGuard(PostalDatasetPublisher &from);
+
+        /**
+         * @brief Leaves the read-side critical section.
+         */
+        ~ReadGuard();
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        /// @brief Gets the dataset being read.
+        PostalDataset &operator*() const { return *dataset; }
+
+        /// @brief Accesses the dataset being read.
+        PostalDataset *operator->() const { return dataset; }
+    };
+
+private:
+    /**
+     * @struct ReaderSlot
+     * @brief Active readers per epoch parity, on its own cache line.
+     */
+    struct alignas(64) ReaderSlot
+    {
+        atomic<long> active[2]; ///< Readers that entered in an even / odd epoch.
+    };
+
+    ReaderSlot slots[READER_SLOTS];  ///< Reader counters
+    atomic<uint64_t> epoch;          ///< Advanced twice by every publish()
+    atomic<PostalDataset *> current; ///< The published version
+    mutex publishLock;               ///< Serializes publish()
+    atomic<uint64_t> published;      ///< Versions published so far
+    atomic<uint64_t> reclaimed;      ///< Old versions deleted so far
+
+    /**
+     * @brief Advances the epoch and waits until the readers of the previous one leave.
+     */
+    void waitForReaders();
+
+    /**
+     * @brief Gets the reader slot of the calling thread.
+     * @return The slot index.
+     */
+    static size_t slotOfThread();
+
+public:
+    /**
+     * @brief Constructs a publisher of a first version.
+     * @param initial The first dataset.
+     */
+    explicit PostalDatasetPublisher(unique_ptr<PostalDataset> initial);
+
+    /**
+     * @brief Destructor. Deletes the current version.
+     * @pre No ReadGuard is alive.
+     */
+    ~PostalDatasetPublisher();
+
+    PostalDatasetPublisher(const PostalDatasetPublisher &) = delete;
+    PostalDatasetPublisher &operator=(const PostalDatasetPublisher &) = delete;
+
+    /**
+     * @brief Makes a new version current and reclaims the old one.
+     *
+     * Returns once no reader can still hold the old version, which has
+     * then been deleted on the calling thread. Readers are never blocked.
+     *
+     * @param next The new dataset.
+     * @return The version number given to @p next.
+     */
+    uint64_t publish(unique_ptr<PostalDataset> next);
+
+    /// @brief Gets the number of the current version.
+    uint64_t getVersion() const { return published; }
+
+    /// @brief Gets the number of old versions deleted so far.
+    uint64_t getReclaimed() const { return reclaimed; }
+};
+
+#endif
@@ -0,0 +1,245 @@
+/**
+ * @file PostalDelta.cpp
+ * @brief Implements the delta file parser and its in-place applier.
+ */
+
+#include "PostalDelta.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include "PostalRecordParser.h"
+
+using namespace std;
+
+/**
+ * @brief Reads a delta file.
+ * @param path The delta file, or "-" for stdin.
+ * @param error Receives a message on failure.
+ * @return true if every line was parsed.
+ */
+bool PostalDelta::read(const string &path, string &error)
+{
+    if (path == "-")
+    {
+        return parse(cin, error);
+    }
+    ifstream file(path);
+    if (!file)
+    {
+        error = "cannot open delta " + path;
+        return false;
+    }
+    return parse(file, error);
+}
+
+/**
+ * @brief Parses a delta from a stream, appending its changes.
+ * @param input The delta text.
+ * @param error Receives the first malformed line.
+ * @return true if every line was parsed.
+ */
+bool PostalDelta::parse(istream &input, string &error)
+{
+    string line;
+    int lineNumber = 0;
+    while (getline(input, line))
+    {
+        lineNumber++;
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        PostalDeltaChange change;
+        if (!parseChange(line, change))
+        {
+            error = "line " + to_string(lineNumber) + ": malformed change '" + line + "'";
+            return false;
+        }
+        change.line = lineNumber;
+        changes.push_back(move(change));
+    }
+    return true;
+}
+
+/**
+ * @brief Parses one change line.
+ *
+ * The record length of an added or updated record is its length in
+ * characters, as in the length-indicated data file.
+ *
+ * @param line The line, without its newline.
+ * @param change Receives the change.
+ * @return false if the line is not a valid change.
+ */
+bool PostalDelta::parseChange(const string &line, PostalDeltaChange &change)
+{
+    if (line.size() < 3 || line[1] != ',')
+    {
+        return false;
+    }
+    change.op = line[0];
+    change.text = line;
+    const char *fields = line.c_str() + 2;
+    char *end;
+
+    if (change.op == OP_DELETE)
+    {
+        long zip = strtol(fields, &end, 10);
+        if (end == fields || *end != '\0' || zip < 0 || zip >= DirectAddressZipTable::ZIP_DOMAIN)
+        {
+            return false;
+        }
+        change.item = HeaderRecordPostalCodeItem();
+        change.item.setZip((int)zip);
+        return true;
+    }
+
+    if (change.op != OP_ADD && change.op != OP_UPDATE)
+    {
+        return false;
+    }
+    long zip = strtol(fields, &end, 10);
+    if (end == fields || *end != ',' || zip < 0 || zip >= DirectAddressZipTable::ZIP_DOMAIN ||
+        !PostalRecordParser::parseFields(fields, line.size() - 2, change.item))
+    {
+        return false;
+    }
+    int characters = 0;
+    for (const char *c = fields; *c != '\0'; c++)
+    {
+        characters += ((unsigned char)*c & 0xC0) != 0x80;
+    }
+    if (characters > 99)
+    {
+        return false; // the length prefix has two digits
+    }
+    change.item.setRecordLength(characters);
+    return true;
+}
+
+/**
+ * @brief Rewrites the changes so the delta applies to the given data.
+ * @param table Direct-address table over the data the delta will be applied to.
+ */
+void PostalDelta::rebase(const DirectAddressZipTable &table)
+{
+    unordered_map<int, bool> present; ///< ZIPs touched so far → present after the change
+    size_t kept = 0;
+    for (PostalDeltaChange &change : changes)
+    {
+        int zip = change.item.getZip();
+        auto touched = present.find(zip);
+        bool exists = touched != present.end() ? touched->second : table.contains(zip);
+        if (change.op == OP_DELETE && !exists)
+        {
+            continue;
+        }
+        if (change.op != OP_DELETE)
+        {
+            change.op = exists ? OP_UPDATE : OP_ADD;
+            change.text[0] = change.op;
+        }
+        present[zip] = change.op != OP_DELETE;
+        if (&changes[kept] != &change)
+        {
+            changes[kept] = move(change);
+        }
+        kept++;
+    }
+    changes.resize(kept);
+}
+
+/**
+ * @brief Finds the block with the greatest ZIP below a given one.
+ * @param table Direct-address table over the sequence set.
+ * @param zip The ZIP.
+ * @return The block, or nullptr if no smaller ZIP exists.
+ */
+static BlockPostalCode *predecessorBlock(const DirectAddressZipTable &table, int zip)
+{
+    for (int smaller = zip - 1; smaller >= 0; smaller--)
+    {
+        const BlockPostalCode *block = table.find(smaller);
+        if (block != nullptr)
+        {
+            // The table hands out read-only handles; the blocks belong to the caller's set.
+            return const_cast<BlockPostalCode *>(block);
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Applies the delta to a ZIP-ordered sequence set and its indexes.
+ *
+ * Runs in two passes: the first checks every change against the ZIPs
+ * present at that point of the delta, the second links and unlinks
+ * blocks, keeping the table and the tree in step. Updates rewrite the
+ * record in its block, so only handles to deleted blocks become invalid.
+ *
+ * @param bss Sequence set ordered by ZIP.
+ * @param tree B+ tree holding every ZIP of @p bss.
+ * @param table Direct-address table over @p bss.
+ * @param summary Receives the counts of applied changes.
+ * @param error Receives a message on failure.
+ * @param changed Called with the ZIP of every applied change (may be empty).
+ * @return true if the delta was applied.
+ */
+bool PostalDelta::apply(BlockSequenceSetPostalCode &bss, BPlusTree<int> &tree, DirectAddressZipTable &table,
+                        Summary &summary, string &error, const function<void(int)> &changed) const
+{
+    summary = Summary{0, 0, 0};
+
+    unordered_map<int, bool> present; ///< ZIPs touched so far → present after the change
+    for (const PostalDeltaChange &change : changes)
+    {
+        int zip = change.item.getZip();
+        auto touched = present.find(zip);
+        bool exists = touched != present.end() ? touched->second : table.contains(zip);
+        if (change.op == OP_ADD ? exists : !exists)
+        {
+            error = "line " + to_string(change.line) + ": ZIP " + to_string(zip) +
+                    (exists ? " already exists" : " does not exist");
+            return false;
+        }
+        present[zip] = change.op != OP_DELETE;
+    }
+
+    for (const PostalDeltaChange &change : changes)
+    {
+        int zip = change.item.getZip();
+        if (change.op == OP_ADD)
+        {
+            BlockPostalCode *block = bss.insertAfter(predecessorBlock(table, zip), change.item);
+            table.insert(zip, block);
+            tree.insert(zip);
+            summary.added++;
+        }
+        else
+        {
+            BlockPostalCode *block = const_cast<BlockPostalCode *>(table.find(zip));
+            if (change.op == OP_UPDATE)
+            {
+                block->setBlockItem(change.item);
+                summary.updated++;
+            }
+            else
+            {
+                table.remove(zip);
+                tree.remove(zip);
+                bss.remove(block);
+                summary.deleted++;
+            }
+        }
+        if (changed)
+        {
+            changed(zip);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,135 @@
+#ifndef POSTAL_DELTA
+#define POSTAL_DELTA
+
+/**
+ * @file PostalDelta.h
+ * @brief Declares the delta file format and its in-place applier.
+ *
+ * A delta lists the records added, updated or deleted since the data was
+ * generated, one change per line:
+ * @code
+ * # comment
+ * A,99951,Newtown,AK,Kenai Peninsula,60.5544,-151.2583
+ * U,501,Holtsville,NY,Suffolk,40.8154,-73.0451
+ * D,544
+ * @endcode
+ * The fields after @c A and @c U are those of us_postal_codes.csv. Blank
+ * lines and lines starting with '#' are skipped.
+ *
+ * PostalDelta::apply() updates a ZIP-ordered sequence set, its B+ tree
+ * and its direct-address table in place: added records are linked in
+ * after the block with the next smaller ZIP and inserted into the tree,
+ * deleted ones are unlinked and removed from the tree, updates replace the
+ * record in its block. The whole delta is checked against the current
+ * data first, so a delta that does not apply changes nothing.
+ */
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <functional>
+#include "B+tree.cpp"
+#include "HeaderRecordPostalCodeItem.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "DirectAddressZipTable.h"
+
+using namespace std;
+
+/**
+ * @struct PostalDeltaChange
+ * @brief One line of a delta.
+ */
+struct PostalDeltaChange
+{
+    char op;                         ///< PostalDelta::OP_ADD, OP_UPDATE or OP_DELETE.
+    int line;                        ///< Line number in the delta, for messages.
+    string text;                     ///< The line as written, so it can be logged unchanged.
+    HeaderRecordPostalCodeItem item; ///< The new record; only the ZIP is set for a delete.
+};
+
+/**
+ * @class PostalDelta
+ * @brief A parsed delta and the applier that brings the in-memory data up to date.
+ */
+class PostalDelta
+{
+public:
+    static const char OP_ADD = 'A';    ///< Adds a record for a new ZIP.
+    static const char OP_UPDATE = 'U'; ///< Replaces the record of an existing ZIP.
+    static const char OP_DELETE = 'D'; ///< Retires an existing ZIP.
+
+    /**
+     * @struct Summary
+     * @brief Changes made by apply().
+     */
+    struct Summary
+    {
+        size_t added;   ///< Records added.
+        size_t updated; ///< Records replaced.
+        size_t deleted; ///< Records deleted.
+    };
+
+    /**
+     * @brief Reads a delta file.
+     * @param path The delta file, or "-" for stdin.
+     * @param error Receives a message on failure.
+     * @return true if every line was parsed.
+     */
+    bool read(const string &path, string &error);
+
+    /**
+     * @brief Parses a delta from a stream, appending its changes.
+     * @param input The delta text.
+     * @param error Receives the first malformed line.
+     * @return true if every line was parsed.
+     */
+    bool parse(istream &input, string &error);
+
+    /**
+     * @brief Parses one change line.
+     * @param line The line, without its newline.
+     * @param change Receives the change.
+     * @return false if the line is not a valid change.
+     */
+    static bool parseChange(const string &line, PostalDeltaChange &change);
+
+    /// @brief Gets the parsed changes in file order.
+    const vector<PostalDeltaChange> &getChanges() const { return changes; }
+
+    /// @brief Gets the number of parsed changes.
+    size_t size() const { return changes.size(); }
+
+    /**
+     * @brief Rewrites the changes so the delta applies to the given data.
+     *
+     * Adds of existing ZIPs become updates, updates of missing ZIPs become
+     * adds and deletes of missing ZIPs are dropped. Replaying a logged
+     * delta this way is idempotent: it gives the same records whether or
+     * not some of its changes were already applied.
+     *
+     * @param table Direct-address table over the data the delta will be applied to.
+     */
+    void rebase(const DirectAddressZipTable &table);
+
+    /**
+     * @brief Applies the delta to a ZIP-ordered sequence set and its indexes.
+     *
+     * Fails without changing anything if a change adds a ZIP that exists,
+     * or updates or deletes one that does not, at its point in the delta.
+     *
+     * @param bss Sequence set ordered by ZIP.
+     * @param tree B+ tree holding every ZIP of @p bss.
+     * @param table Direct-address table over @p bss.
+     * @param summary Receives the counts of applied changes.
+     * @param error Receives a message on failure.
+     * @param changed Called with the ZIP of every applied change (may be empty).
+     * @return true if the delta was applied.
+     */
+    bool apply(BlockSequenceSetPostalCode &bss, BPlusTree<int> &tree, DirectAddressZipTable &table,
+               Summary &summary, string &error, const function<void(int)> &changed = nullptr) const;
+
+private:
+    vector<PostalDeltaChange> changes; ///< Parsed changes in file order
+};
+
+#endif
@@ -0,0 +1,324 @@
+/**
+ * @file PostalOffsetIndex.cpp
+ * @brief Implements the byte-offset side index of the length-indicated data file.
+ */
+
+#include "PostalOffsetIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "BufferedWriter.h"
+
+using namespace std;
+
+/// @brief First eight bytes of every side-car.
+static const char OFFSETS_MAGIC[8] = {'P', 'O', 'S', 'T', 'O', 'F', 'F', 'S'};
+
+/**
+ * @struct OffsetsHeader
+ * @brief The fixed header of a side-car file.
+ */
+struct OffsetsHeader
+{
+    char magic[8];        ///< OFFSETS_MAGIC
+    uint32_t version;     ///< PostalOffsetIndex::FORMAT_VERSION
+    uint32_t entryBytes;  ///< sizeof(RecordLocation)
+    uint64_t dataBytes;   ///< Size of the data file
+    int64_t dataModified; ///< Modification time of the data file, in ns
+    uint64_t count;       ///< Records indexed
+};
+
+/**
+ * @brief Reads the size and modification time of a file.
+ * @param path The file.
+ * @param bytes Receives the size.
+ * @param modified Receives the modification time in ns.
+ * @return false if the file cannot be examined.
+ */
+static bool fileStamp(const string &path, uint64_t &bytes, int64_t &modified)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0)
+    {
+        return false;
+    }
+    bytes = info.st_size;
+    modified = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+/**
+ * @brief Default constructor. Creates an empty index.
+ */
+PostalOffsetIndex::PostalOffsetIndex() : dataBytes(0), dataModified(0) {}
+
+/**
+ * @brief Indexes the contents of a data file already in memory.
+ * @param data Contents of the file.
+ * @param size Bytes of contents.
+ */
+void PostalOffsetIndex::buildFromBuffer(const char *data, size_t size)
+{
+    locations.clear();
+    locations.reserve(size / 48);
+    uint64_t offset = 0;
+    bool header = true;
+    while (offset < size)
+    {
+        bool prefixed = offset + 2 <= size && isdigit((unsigned char)data[offset]) &&
+                        isdigit((unsigned char)data[offset + 1]);
+        uint64_t lineEnd = prefixed ? offset + 2 + (data[offset] - '0') * 10 + (data[offset + 1] - '0') : size;
+        if (!prefixed || lineEnd >= size || data[lineEnd] != '\n')
+        {
+            const char *newline = (const char *)memchr(data + offset, '\n', size - offset);
+            lineEnd = newline == nullptr ? size : newline - data;
+        }
+        if (!header && prefixed && lineEnd > offset + 2)
+        {
+            locations.push_back({atoi(data + offset + 2), (uint32_t)(lineEnd - offset), offset});
+        }
+        header = false;
+        offset = lineEnd + 1;
+    }
+    dataBytes = size;
+    sortByZip();
+}
+
+/**
+ * @brief Orders the record positions by ZIP, keeping file order among equal ZIPs.
+ */
+void PostalOffsetIndex::sortByZip()
+{
+    byZip.resize(locations.size());
+    iota(byZip.begin(), byZip.end(), 0);
+    if (!is_sorted(locations.begin(), locations.end(), [](const RecordLocation &a, const RecordLocation &b)
+                   { return a.zip < b.zip; }))
+    {
+        stable_sort(byZip.begin(), byZip.end(), [this](uint32_t a, uint32_t b)
+                    { return locations[a].zip < locations[b].zip; });
+    }
+}
+
+/**
+ * @brief Indexes a data file in one prefix-hopping pass.
+ * @param dataFile The length-indicated data file.
+ * @param error Receives a message on failure.
+ * @return true if the file was indexed.
+ */
+bool PostalOffsetIndex::build(const string &dataFile, string &error)
+{
+    uint64_t bytes;
+    int64_t modified;
+    int fd = open(dataFile.c_str(), O_RDONLY);
+    if (fd < 0 || !fileStamp(dataFile, bytes, modified))
+    {
+        error = "cannot open " + dataFile + ": " + strerror(errno);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+    if (bytes == 0)
+    {
+        close(fd);
+        buildFromBuffer("", 0);
+        dataModified = modified;
+        return true;
+    }
+    void *mapped = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        error = "cannot map " + dataFile + ": " + strerror(errno);
+        return false;
+    }
+    madvise(mapped, bytes, MADV_SEQUENTIAL);
+    buildFromBuffer((const char *)mapped, bytes);
+    munmap(mapped, bytes);
+    dataModified = modified;
+    return true;
+}
+
+/**
+ * @brief Writes the index as a side-car file.
+ * @param indexFile Side-car path.
+ * @param error Receives a message on failure.
+ * @return true if the side-car was written.
+ */
+bool PostalOffsetIndex::save(const string &indexFile, string &error) const
+{
+    OffsetsHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, OFFSETS_MAGIC, sizeof(header.magic));
+    header.version = FORMAT_VERSION;
+    header.entryBytes = sizeof(RecordLocation);
+    header.dataBytes = dataBytes;
+    header.dataModified = dataModified;
+    header.count = locations.size();
+
+    string temporary = indexFile + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        error = "cannot create " + temporary + ": " + strerror(errno);
+        return false;
+    }
+    bool written;
+    {
+        BufferedWriter out(fd);
+        out.write((const char *)&header, sizeof(header));
+        out.write((const char *)locations.data(), locations.size() * sizeof(RecordLocation));
+        out.write((const char *)byZip.data(), byZip.size() * sizeof(uint32_t));
+        written = out.flush();
+    }
+    close(fd);
+    if (!written || rename(temporary.c_str(), indexFile.c_str()) != 0)
+    {
+        error = "cannot write " + indexFile + ": " + strerror(errno);
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Reads a side-car file, rejecting it if the data file has changed.
+ * @param indexFile Side-car path.
+ * @param dataFile The data file the side-car describes.
+ * @param error Receives a message on failure.
+ * @return true if the index was loaded.
+ */
+bool PostalOffsetIndex::load(const string &indexFile, const string &dataFile, string &error)
+{
+    uint64_t bytes;
+    int64_t modified;
+    if (!fileStamp(dataFile, bytes, modified))
+    {
+        error = "cannot open " + dataFile + ": " + strerror(errno);
+        return false;
+    }
+    int fd = open(indexFile.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + indexFile + ": " + strerror(errno);
+        return false;
+    }
+    OffsetsHeader header;
+    bool ok = pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    if (!ok || memcmp(header.magic, OFFSETS_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != FORMAT_VERSION || header.entryBytes != sizeof(RecordLocation))
+    {
+        error = indexFile + ": not an offset index of this version";
+        close(fd);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 ||
+        (uint64_t)info.st_size != sizeof(header) + header.count * (sizeof(RecordLocation) + sizeof(uint32_t)))
+    {
+        error = indexFile + ": truncated or corrupt";
+        close(fd);
+        return false;
+    }
+    if (header.dataBytes != bytes || header.dataModified != modified)
+    {
+        error = indexFile + ": " + dataFile + " has changed since it was indexed";
+        close(fd);
+        return false;
+    }
+
+    vector<RecordLocation> loaded(header.count);
+    vector<uint32_t> order(header.count);
+    size_t locationBytes = header.count * sizeof(RecordLocation);
+    size_t orderBytes = header.count * sizeof(uint32_t);
+    ok = pread(fd, loaded.data(), locationBytes, sizeof(header)) == (ssize_t)locationBytes &&
+         pread(fd, order.data(), orderBytes, sizeof(header) + locationBytes) == (ssize_t)orderBytes;
+    close(fd);
+    for (size_t i = 0; ok && i < loaded.size(); i++)
+    {
+        ok = loaded[i].offset + loaded[i].length <= bytes && order[i] < loaded.size();
+    }
+    if (!ok)
+    {
+        error = indexFile + ": truncated or corrupt";
+        return false;
+    }
+    locations = move(loaded);
+    byZip = move(order);
+    dataBytes = bytes;
+    dataModified = modified;
+    return true;
+}
+
+/**
+ * @brief Loads the default side-car, or builds the index and saves it.
+ * @param dataFile The data file.
+ * @param error Receives a message on failure.
+ * @return true if the index is ready.
+ */
+bool PostalOffsetIndex::loadOrBuild(const string &dataFile, string &error)
+{
+    string ignored;
+    if (load(sideCarPath(dataFile), dataFile, ignored))
+    {
+        return true;
+    }
+    if (!build(dataFile, error))
+    {
+        return false;
+    }
+    save(sideCarPath(dataFile), ignored);
+    return true;
+}
+
+/**
+ * @brief Finds a record by ZIP.
+ * @param zip ZIP code to search for.
+ * @return The first record with that ZIP in file order, or nullptr.
+ */
+const RecordLocation *PostalOffsetIndex::find(int zip) const
+{
+    auto position = lower_bound(byZip.begin(), byZip.end(), zip, [this](uint32_t index, int key)
+                                { return locations[index].zip < key; });
+    if (position == byZip.end() || locations[*position].zip != zip)
+    {
+        return nullptr;
+    }
+    return &locations[*position];
+}
+
+/**
+ * @brief Splits the records into runs of about equal bytes.
+ * @param parts Number of runs wanted.
+ * @return parts + 1 record positions; run k is [result[k], result[k + 1]).
+ */
+vector<size_t> PostalOffsetIndex::partition(size_t parts) const
+{
+    parts = max<size_t>(parts, 1);
+    vector<size_t> bounds(parts + 1, locations.size());
+    bounds[0] = 0;
+    if (locations.empty())
+    {
+        return bounds;
+    }
+    uint64_t first = locations.front().offset;
+    uint64_t span = locations.back().offset + locations.back().length - first;
+    for (size_t k = 1; k < parts; k++)
+    {
+        uint64_t target = first + span * k / parts;
+        bounds[k] = lower_bound(locations.begin(), locations.end(), target,
+                                [](const RecordLocation &location, uint64_t offset)
+                                { return location.offset < offset; }) -
+                    locations.begin();
+    }
+    return bounds;
+}
@@ -0,0 +1,148 @@
+#ifndef POSTAL_OFFSET_INDEX
+#define POSTAL_OFFSET_INDEX
+
+/**
+ * @file PostalOffsetIndex.h
+ * @brief Declares the byte-offset side index of the length-indicated data file.
+ *
+ * Every line of the data file starts with a two-digit record length, so
+ * the records can be located by hopping from prefix to prefix without
+ * parsing their bodies. The index keeps, per record, its ZIP, the offset
+ * of its length prefix and its length, plus the records ordered by ZIP.
+ *
+ * The index can be saved next to the data file as a side-car (by default
+ * "<data file>.offsets") and reloaded without touching the data. The
+ * side-car records the data file's size and modification time and is
+ * ignored once either changes.
+ *
+ * @code
+ * magic "POSTOFFS", version, entry size, data size, data mtime (ns), count
+ * RecordLocation[count]   file order
+ * uint32[count]           record positions in ZIP order
+ * @endcode
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @struct RecordLocation
+ * @brief Where one record lives in the data file.
+ */
+struct RecordLocation
+{
+    int zip;         ///< ZIP code of the record.
+    uint32_t length; ///< Prefix plus record bytes (without the newline).
+    uint64_t offset; ///< Offset of the record's length prefix.
+};
+
+/**
+ * @class PostalOffsetIndex
+ * @brief Record byte offsets of a length-indicated file, by position and by ZIP.
+ */
+class PostalOffsetIndex
+{
+public:
+    static const uint32_t FORMAT_VERSION = 1; ///< Version written to and accepted from side-cars.
+
+    /**
+     * @brief Gets the default side-car path of a data file.
+     * @param dataFile The data file.
+     * @return "<dataFile>.offsets".
+     */
+    static string sideCarPath(const string &dataFile) { return dataFile + ".offsets"; }
+
+    /**
+     * @brief Default constructor. Creates an empty index.
+     */
+    PostalOffsetIndex();
+
+    /**
+     * @brief Indexes a data file in one prefix-hopping pass.
+     * @param dataFile The length-indicated data file.
+     * @param error Receives a message on failure.
+     * @return true if the file was indexed.
+     */
+    bool build(const string &dataFile, string &error);
+
+    /**
+     * @brief Indexes the contents of a data file already in memory.
+     *
+     * The first line is the header record and is skipped. A few lines
+     * hold multi-byte UTF-8 text whose prefix counts characters rather
+     * than bytes; when a hop does not land on a newline the record is
+     * measured up to the next newline instead.
+     *
+     * @param data Contents of the file.
+     * @param size Bytes of contents.
+     */
+    void buildFromBuffer(const char *data, size_t size);
+
+    /**
+     * @brief Writes the index as a side-car file.
+     * @param indexFile Side-car path.
+     * @param error Receives a message on failure.
+     * @return true if the side-car was written.
+     */
+    bool save(const string &indexFile, string &error) const;
+
+    /**
+     * @brief Reads a side-car file, rejecting it if the data file has changed.
+     * @param indexFile Side-car path.
+     * @param dataFile The data file the side-car describes.
+     * @param error Receives a message on failure.
+     * @return true if the index was loaded.
+     */
+    bool load(const string &indexFile, const string &dataFile, string &error);
+
+    /**
+     * @brief Loads the default side-car, or builds the index and saves it.
+     *
+     * A side-car that cannot be written is not an error; the built index
+     * is still used.
+     *
+     * @param dataFile The data file.
+     * @param error Receives a message on failure.
+     * @return true if the index is ready.
+     */
+    bool loadOrBuild(const string &dataFile, string &error);
+
+    /// @brief Gets the number of records.
+    size_t size() const { return locations.size(); }
+
+    /// @brief Gets a record location by file position.
+    const RecordLocation &operator[](size_t index) const { return locations[index]; }
+
+    /// @brief Gets all record locations in file order.
+    const vector<RecordLocation> &getLocations() const { return locations; }
+
+    /// @brief Gets the size of the indexed data file.
+    uint64_t getDataBytes() const { return dataBytes; }
+
+    /**
+     * @brief Finds a record by ZIP.
+     * @param zip ZIP code to search for.
+     * @return The first record with that ZIP in file order, or nullptr.
+     */
+    const RecordLocation *find(int zip) const;
+
+    /**
+     * @brief Splits the records into runs of about equal bytes.
+     * @param parts Number of runs wanted.
+     * @return parts + 1 record positions; run k is [result[k], result[k + 1]).
+     */
+    vector<size_t> partition(size_t parts) const;
+
+private:
+    vector<RecordLocation> locations; ///< Records in file order
+    vector<uint32_t> byZip;           ///< Positions in @c locations, sorted by ZIP
+    uint64_t dataBytes;               ///< Size of the data file
+    int64_t dataModified;             ///< Modification time of the data file, in ns
+
+    void sortByZip();
+};
+
+#endif
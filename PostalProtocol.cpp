@@ -0,0 +1,249 @@
+/**
+ * @file PostalProtocol.cpp
+ * @brief Implements encoding and decoding of postal server protocol frames.
+ */
+
+#include "PostalProtocol.h"
+#include <cstring>
+
+using namespace std;
+
+/**
+ * @brief Appends the bytes of a value.
+ * @param out Destination buffer.
+ * @param value The value.
+ */
+template <typename T>
+static void put(string &out, T value)
+{
+    out.append((const char *)&value, sizeof(value));
+}
+
+/**
+ * @brief Reads a value and advances the cursor.
+ * @param cursor Read position, advanced past the value.
+ * @param end End of the readable bytes.
+ * @param value Receives the value.
+ * @return false if fewer than sizeof(T) bytes remain.
+ */
+template <typename T>
+static bool take(const char *&cursor, const char *end, T &value)
+{
+    if ((size_t)(end - cursor) < sizeof(value))
+    {
+        return false;
+    }
+    memcpy(&value, cursor, sizeof(value));
+    cursor += sizeof(value);
+    return true;
+}
+
+/**
+ * @brief Reads a length-prefixed string and advances the cursor.
+ * @param cursor Read position, advanced past the string.
+ * @param end End of the readable bytes.
+ * @param text Receives the string.
+ * @return false if the string is truncated.
+ */
+static bool takeString(const char *&cursor, const char *end, string &text)
+{
+    uint8_t length;
+    if (!take(cursor, end, length) || end - cursor < length)
+    {
+        return false;
+    }
+    text.assign(cursor, length);
+    cursor += length;
+    return true;
+}
+
+/**
+ * @brief Checks whether a buffer starts with a complete frame.
+ * @param data Buffered bytes.
+ * @param size Number of buffered bytes.
+ * @param bodyLength Receives the body length when a length prefix is present.
+ * @return true if the whole frame (prefix and body) is buffered.
+ */
+bool PostalProtocol::completeFrame(const char *data, size_t size, uint32_t &bodyLength)
+{
+    if (size < LENGTH_BYTES)
+    {
+        return false;
+    }
+    memcpy(&bodyLength, data, LENGTH_BYTES);
+    return size - LENGTH_BYTES >= bodyLength;
+}
+
+/**
+ * @brief Appends a request frame.
+ * @param request The request.
+ * @param out Buffer receiving the frame.
+ */
+void PostalProtocol::encodeRequest(const ProtocolRequest &request, string &out)
+{
+    size_t frame = out.size();
+    put<uint32_t>(out, 0);
+    put(out, request.id);
+    put(out, request.op);
+    if (request.op == OP_LOOKUP)
+    {
+        put(out, request.zip);
+    }
+    else if (request.op == OP_RANGE)
+    {
+        put(out, request.lower);
+        put(out, request.upper);
+        put(out, request.limit);
+    }
+    else if (request.op == OP_NEAREST)
+    {
+        put(out, request.latitude);
+        put(out, request.longitude);
+        put(out, request.limit);
+    }
+    uint32_t length = out.size() - frame - LENGTH_BYTES;
+    memcpy(&out[frame], &length, LENGTH_BYTES);
+}
+
+/**
+ * @brief Decodes a request body.
+ * @param body The body (after the length prefix).
+ * @param length Body length.
+ * @param request Receives the request; its id is set whenever the body holds one.
+ * @return false if the body is malformed.
+ */
+bool PostalProtocol::decodeRequest(const char *body, size_t length, ProtocolRequest &request)
+{
+    const char *cursor = body;
+    const char *end = body + length;
+    request.id = 0;
+    if (!take(cursor, end, request.id) || !take(cursor, end, request.op))
+    {
+        return false;
+    }
+
+    bool ok = false;
+    if (request.op == OP_LOOKUP)
+    {
+        ok = take(cursor, end, request.zip);
+    }
+    else if (request.op == OP_RANGE)
+    {
+        ok = take(cursor, end, request.lower) && take(cursor, end, request.upper) &&
+             take(cursor, end, request.limit);
+    }
+    else if (request.op == OP_NEAREST)
+    {
+        ok = take(cursor, end, request.latitude) && take(cursor, end, request.longitude) &&
+             take(cursor, end, request.limit);
+    }
+    return ok && cursor == end;
+}
+
+/**
+ * @brief Starts a response frame with no records.
+ * @param out Buffer receiving the frame.
+ * @param id Request id.
+ * @param status Response status.
+ * @return Offset of the frame in @p out.
+ */
+size_t PostalProtocol::beginResponse(string &out, uint32_t id, uint8_t status)
+{
+    size_t frame = out.size();
+    put<uint32_t>(out, 0);
+    put(out, id);
+    put(out, status);
+    put<uint32_t>(out, 0);
+    return frame;
+}
+
+/**
+ * @brief Appends a record to the response frame started at @p frame.
+ * @param out Buffer holding the frame.
+ * @param frame Offset returned by beginResponse().
+ * @param record The record (text fields are truncated to 255 bytes).
+ */
+void PostalProtocol::appendRecord(string &out, size_t frame, const ProtocolRecord &record)
+{
+    encodeRecord(record, out);
+    countRecord(out, frame);
+}
+
+/**
+ * @brief Appends the wire encoding of a record without counting it.
+ * @param record The record (text fields are truncated to 255 bytes).
+ * @param out Buffer receiving the encoded record.
+ */
+void PostalProtocol::encodeRecord(const ProtocolRecord &record, string &out)
+{
+    put(out, record.zip);
+    put(out, record.latitude);
+    put(out, record.longitude);
+    put(out, record.distanceKm);
+    for (const string *text : {&record.place, &record.state, &record.county})
+    {
+        uint8_t length = text->size() < 255 ? text->size() : 255;
+        put(out, length);
+        out.append(text->data(), length);
+    }
+}
+
+/**
+ * @brief Counts one more record in the response frame started at @p frame.
+ * @param out Buffer holding the frame.
+ * @param frame Offset returned by beginResponse().
+ */
+void PostalProtocol::countRecord(string &out, size_t frame)
+{
+    size_t countOffset = frame + LENGTH_BYTES + sizeof(uint32_t) + sizeof(uint8_t);
+    uint32_t count;
+    memcpy(&count, &out[countOffset], sizeof(count));
+    count++;
+    memcpy(&out[countOffset], &count, sizeof(count));
+}
+
+/**
+ * @brief Fills in the length of the response frame started at @p frame.
+ * @param out Buffer holding the frame.
+ * @param frame Offset returned by beginResponse().
+ */
+void PostalProtocol::finishResponse(string &out, size_t frame)
+{
+    uint32_t length = out.size() - frame - LENGTH_BYTES;
+    memcpy(&out[frame], &length, LENGTH_BYTES);
+}
+
+/**
+ * @brief Decodes a response body.
+ * @param body The body (after the length prefix).
+ * @param length Body length.
+ * @param id Receives the request id.
+ * @param status Receives the status.
+ * @param records Receives the records.
+ * @return false if the body is malformed.
+ */
+bool PostalProtocol::decodeResponse(const char *body, size_t length, uint32_t &id,
+                                    uint8_t &status, vector<ProtocolRecord> &records)
+{
+    const char *cursor = body;
+    const char *end = body + length;
+    uint32_t count;
+    records.clear();
+    if (!take(cursor, end, id) || !take(cursor, end, status) || !take(cursor, end, count))
+    {
+        return false;
+    }
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ProtocolRecord record;
+        if (!take(cursor, end, record.zip) || !take(cursor, end, record.latitude) ||
+            !take(cursor, end, record.longitude) || !take(cursor, end, record.distanceKm) ||
+            !takeString(cursor, end, record.place) || !takeString(cursor, end, record.state) ||
+            !takeString(cursor, end, record.county))
+        {
+            return false;
+        }
+        records.push_back(record);
+    }
+    return cursor == end;
+}
@@ -0,0 +1,182 @@
+#ifndef POSTAL_PROTOCOL
+#define POSTAL_PROTOCOL
+
+/**
+ * @file PostalProtocol.h
+ * @brief Declares the binary request/response protocol of the postal query server.
+ *
+ * Every message is a frame: a 4-byte length (of the bytes that follow it)
+ * and a body. Integers and doubles are sent in host byte order, since the
+ * protocol only runs over a local Unix domain socket.
+ *
+ * Request body:
+ * @code
+ * uint32 id | uint8 op | payload
+ *   OP_LOOKUP:  int32 zip
+ *   OP_RANGE:   int32 lower | int32 upper | uint32 limit
+ *   OP_NEAREST: double latitude | double longitude | uint32 k
+ * @endcode
+ * Response body:
+ * @code
+ * uint32 id | uint8 status | uint32 count | count records
+ *   record: int32 zip | double latitude | double longitude | double distanceKm |
+ *           uint8 length + place | uint8 length + state | uint8 length + county
+ * @endcode
+ * Clients may send any number of requests without waiting (pipelining);
+ * responses carry the request id and can arrive in a different order.
+ */
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * @enum RequestOp
+ * @brief Request types.
+ */
+enum RequestOp : uint8_t
+{
+    OP_LOOKUP = 1,  ///< Record of one ZIP.
+    OP_RANGE = 2,   ///< Records of the ZIPs in [lower, upper], ascending.
+    OP_NEAREST = 3  ///< The k records nearest to a point, nearest first.
+};
+
+/**
+ * @enum ResponseStatus
+ * @brief Outcome of a request.
+ */
+enum ResponseStatus : uint8_t
+{
+    STATUS_OK = 0,         ///< At least one record returned.
+    STATUS_NOT_FOUND = 1,  ///< The query matched no record.
+    STATUS_BAD_REQUEST = 2 ///< The request could not be decoded.
+};
+
+/**
+ * @struct ProtocolRequest
+ * @brief A decoded request.
+ */
+struct ProtocolRequest
+{
+    uint32_t id;      ///< Client-chosen id echoed in the response.
+    uint8_t op;       ///< One of RequestOp.
+    int32_t zip;      ///< OP_LOOKUP: ZIP to look up.
+    int32_t lower;    ///< OP_RANGE: first ZIP of the range.
+    int32_t upper;    ///< OP_RANGE: last ZIP of the range.
+    double latitude;  ///< OP_NEAREST: query latitude.
+    double longitude; ///< OP_NEAREST: query longitude.
+    uint32_t limit;   ///< OP_RANGE: maximum records; OP_NEAREST: k.
+};
+
+/**
+ * @struct ProtocolRecord
+ * @brief A decoded record of a response.
+ */
+struct ProtocolRecord
+{
+    int32_t zip;       ///< ZIP code.
+    double latitude;   ///< Latitude.
+    double longitude;  ///< Longitude.
+    double distanceKm; ///< Distance to the query point (OP_NEAREST), else 0.
+    string place;      ///< Place name.
+    string state;      ///< State.
+    string county;     ///< County.
+};
+
+/**
+ * @class PostalProtocol
+ * @brief Encoding and decoding of protocol frames.
+ */
+class PostalProtocol
+{
+public:
+    /// @brief Size of the length prefix of every frame.
+    static const size_t LENGTH_BYTES = 4;
+
+    /// @brief Largest request body accepted by the server.
+    static const size_t MAX_REQUEST_BYTES = 64;
+
+    /**
+     * @brief Checks whether a buffer starts with a complete frame.
+     * @param data Buffered bytes.
+     * @param size Number of buffered bytes.
+     * @param bodyLength Receives the body length when a length prefix is present.
+     * @return true if the whole frame (prefix and body) is buffered.
+     */
+    static bool completeFrame(const char *data, size_t size, uint32_t &bodyLength);
+
+    /**
+     * @brief Appends a request frame.
+     * @param request The request.
+     * @param out Buffer receiving the frame.
+     */
+    static void encodeRequest(const ProtocolRequest &request, string &out);
+
+    /**
+     * @brief Decodes a request body.
+     * @param body The body (after the length prefix).
+     * @param length Body length.
+     * @param request Receives the request; its id is set whenever the body holds one.
+     * @return false if the body is malformed.
+     */
+    static bool decodeRequest(const char *body, size_t length, ProtocolRequest &request);
+
+    /**
+     * @brief Starts a response frame with no records.
+     * @param out Buffer receiving the frame.
+     * @param id Request id.
+     * @param status Response status.
+     * @return Offset of the frame in @p out, passed to appendRecord() and finishResponse().
+     */
+    static size_t beginResponse(string &out, uint32_t id, uint8_t status);
+
+    /**
+     * @brief Appends a record to the response frame started at @p frame.
+     * @param out Buffer holding the frame.
+     * @param frame Offset returned by beginResponse().
+     * @param record The record (text fields are truncated to 255 bytes).
+     */
+    static void appendRecord(string &out, size_t frame, const ProtocolRecord &record);
+
+    /**
+     * @brief Appends the wire encoding of a record without counting it.
+     *
+     * Lets callers keep encoded records (e.g. in a result cache) and add
+     * them to later responses with countRecord().
+     *
+     * @param record The record (text fields are truncated to 255 bytes).
+     * @param out Buffer receiving the encoded record.
+     */
+    static void encodeRecord(const ProtocolRecord &record, string &out);
+
+    /**
+     * @brief Counts one more record in the response frame started at @p frame.
+     * @param out Buffer holding the frame.
+     * @param frame Offset returned by beginResponse().
+     */
+    static void countRecord(string &out, size_t frame);
+
+    /**
+     * @brief Fills in the length of the response frame started at @p frame.
+     * @param out Buffer holding the frame.
+     * @param frame Offset returned by beginResponse().
+     */
+    static void finishResponse(string &out, size_t frame);
+
+    /**
+     * @brief Decodes a response body.
+     * @param body The body (after the length prefix).
+     * @param length Body length.
+     * @param id Receives the request id.
+     * @param status Receives the status.
+     * @param records Receives the records.
+     * @return false if the body is malformed.
+     */
+    static bool decodeResponse(const char *body, size_t length, uint32_t &id,
+                               uint8_t &status, vector<ProtocolRecord> &records);
+};
+
+#endif
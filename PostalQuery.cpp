@@ -0,0 +1,772 @@
+/**
+ * @file PostalQuery.cpp
+ * @brief Implements the filter / group-by query engine over postal records.
+ */
+
+#include "PostalQuery.h"
+#include <cmath>
+#include <map>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * @brief Adds a numeric predicate.
+ * @param field Numeric field (zip, latitude or longitude).
+ * @param op Comparison operator.
+ * @param value Constant to compare with.
+ * @return This query, for chaining.
+ */
+PostalQuery &PostalQuery::where(QueryField field, CompareOp op, double value)
+{
+    predicates.push_back({field, op, value, ""});
+    return *this;
+}
+
+/**
+ * @brief Adds a text predicate.
+ * @param field Text field (place, state or county).
+ * @param op Comparison operator.
+ * @param value Constant to compare with.
+ * @return This query, for chaining.
+ */
+PostalQuery &PostalQuery::where(QueryField field, CompareOp op, const string &value)
+{
+    predicates.push_back({field, op, 0, value});
+    return *this;
+}
+
+/**
+ * @brief Adds a group-by field.
+ * @param field Field to group on.
+ * @return This query, for chaining.
+ */
+PostalQuery &PostalQuery::groupBy(QueryField field)
+{
+    groupFields.push_back(field);
+    return *this;
+}
+
+/**
+ * @brief Adds an aggregate column.
+ * @param kind Aggregate function.
+ * @param field Numeric input field (ignored by AGG_COUNT).
+ * @return This query, for chaining.
+ */
+PostalQuery &PostalQuery::aggregate(AggregateKind kind, QueryField field)
+{
+    aggregates.push_back({kind, field});
+    return *this;
+}
+
+/**
+ * @brief Checks whether a field holds text.
+ * @param field The field.
+ * @return true for place, state and county.
+ */
+bool PostalQuery::isTextField(QueryField field)
+{
+    return field == FIELD_PLACE || field == FIELD_STATE || field == FIELD_COUNTY;
+}
+
+/**
+ * @brief Gets the name of a field.
+ * @param field The field.
+ * @return The lower-case field name.
+ */
+string PostalQuery::fieldName(QueryField field)
+{
+    switch (field)
+    {
+    case FIELD_ZIP:
+        return "zip";
+    case FIELD_PLACE:
+        return "place";
+    case FIELD_STATE:
+        return "state";
+    case FIELD_COUNTY:
+        return "county";
+    case FIELD_LATITUDE:
+        return "latitude";
+    case FIELD_LONGITUDE:
+        return "longitude";
+    }
+    return "";
+}
+
+/**
+ * @brief Parses a field name.
+ * @param name Field name as returned by fieldName().
+ * @param field Receives the parsed field.
+ * @return false if the name is unknown.
+ */
+bool PostalQuery::parseField(const string &name, QueryField &field)
+{
+    static const QueryField fields[] = {FIELD_ZIP, FIELD_PLACE, FIELD_STATE,
+                                        FIELD_COUNTY, FIELD_LATITUDE, FIELD_LONGITUDE};
+    for (QueryField candidate : fields)
+    {
+        if (fieldName(candidate) == name)
+        {
+            field = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Parses a predicate such as "state=TX" or "latitude>30".
+ *
+ * Accepted operators are =, !=, <, <=, > and >=.
+ *
+ * @param text The predicate text.
+ * @param predicate Receives the parsed predicate.
+ * @return false if the text is not a valid predicate.
+ */
+bool PostalQuery::parsePredicate(const string &text, Predicate &predicate)
+{
+    size_t opStart = text.find_first_of("=!<>");
+    if (opStart == string::npos || !parseField(text.substr(0, opStart), predicate.field))
+    {
+        return false;
+    }
+
+    size_t opEnd = opStart + 1;
+    char first = text[opStart];
+    bool withEquals = opEnd < text.size() && text[opEnd] == '=';
+    if (first == '=')
+    {
+        predicate.op = OP_EQ;
+    }
+    else if (first == '!' && withEquals)
+    {
+        predicate.op = OP_NE;
+    }
+    else if (first == '<')
+    {
+        predicate.op = withEquals ? OP_LE : OP_LT;
+    }
+    else if (first == '>')
+    {
+        predicate.op = withEquals ? OP_GE : OP_GT;
+    }
+    else
+    {
+        return false;
+    }
+    if (first != '=' && withEquals)
+    {
+        opEnd++;
+    }
+
+    string value = text.substr(opEnd);
+    predicate.text = "";
+    predicate.number = 0;
+    if (isTextField(predicate.field))
+    {
+        predicate.text = value;
+        return true;
+    }
+    try
+    {
+        size_t used = 0;
+        predicate.number = stod(value, &used);
+        return used == value.size();
+    }
+    catch (const exception &)
+    {
+        return false;
+    }
+}
+
+/**
+ * @brief Gets a numeric field of a record.
+ * @param record The record.
+ * @param field Numeric field.
+ * @return The field value.
+ */
+static double numericValue(const HeaderRecordPostalCodeItem &record, QueryField field)
+{
+    switch (field)
+    {
+    case FIELD_LATITUDE:
+        return record.getLatitude();
+    case FIELD_LONGITUDE:
+        return record.getLongitude();
+    default:
+        return record.getZip();
+    }
+}
+
+/**
+ * @brief Gets a text field of a record.
+ * @param record The record.
+ * @param field Text field.
+ * @return The field value.
+ */
+static string textValue(const HeaderRecordPostalCodeItem &record, QueryField field)
+{
+    switch (field)
+    {
+    case FIELD_PLACE:
+        return record.getPlace();
+    case FIELD_STATE:
+        return record.getState();
+    default:
+        return record.getCounty();
+    }
+}
+
+/**
+ * @brief Formats any field of a record as text.
+ * @param record The record.
+ * @param field The field.
+ * @return The formatted value.
+ */
+static string formatField(const HeaderRecordPostalCodeItem &record, QueryField field)
+{
+    if (PostalQuery::isTextField(field))
+    {
+        return textValue(record, field);
+    }
+    if (field == FIELD_ZIP)
+    {
+        return to_string(record.getZip());
+    }
+    ostringstream out;
+    out << fixed << setprecision(4) << numericValue(record, field);
+    return out.str();
+}
+
+/**
+ * @brief Applies a comparison to the sign of a three-way comparison.
+ * @param op The comparison.
+ * @param order Negative, zero or positive as the value is below, equal or above the constant.
+ * @return Whether the comparison holds.
+ */
+static bool compareOrder(CompareOp op, int order)
+{
+    switch (op)
+    {
+    case OP_EQ:
+        return order == 0;
+    case OP_NE:
+        return order != 0;
+    case OP_LT:
+        return order < 0;
+    case OP_LE:
+        return order <= 0;
+    case OP_GT:
+        return order > 0;
+    default:
+        return order >= 0;
+    }
+}
+
+/**
+ * @brief Evaluates one predicate on a record.
+ * @param predicate The predicate.
+ * @param record The record.
+ * @return Whether the predicate holds.
+ */
+static bool matches(const Predicate &predicate, const HeaderRecordPostalCodeItem &record)
+{
+    if (PostalQuery::isTextField(predicate.field))
+    {
+        return compareOrder(predicate.op, textValue(record, predicate.field).compare(predicate.text));
+    }
+    double value = numericValue(record, predicate.field);
+    return compareOrder(predicate.op, (value > predicate.number) - (value < predicate.number));
+}
+
+/**
+ * @brief Formats a predicate for plan output.
+ * @param predicate The predicate.
+ * @return Text such as "state = TX".
+ */
+static string describe(const Predicate &predicate)
+{
+    static const char *ops[] = {"=", "!=", "<", "<=", ">", ">="};
+    ostringstream out;
+    out << PostalQuery::fieldName(predicate.field) << ' ' << ops[predicate.op] << ' ';
+    if (PostalQuery::isTextField(predicate.field))
+    {
+        out << predicate.text;
+    }
+    else
+    {
+        out << predicate.number;
+    }
+    return out.str();
+}
+
+/**
+ * @brief Gets the name of an aggregate column.
+ * @param spec The aggregate.
+ * @return Text such as "count" or "avg(latitude)".
+ */
+static string aggregateName(const AggregateSpec &spec)
+{
+    static const char *names[] = {"count", "sum", "min", "max", "avg"};
+    if (spec.kind == AGG_COUNT)
+    {
+        return names[spec.kind];
+    }
+    return string(names[spec.kind]) + "(" + PostalQuery::fieldName(spec.field) + ")";
+}
+
+/**
+ * @class SeqScanOperator
+ * @brief Walks the block chain of the sequence set.
+ */
+class SeqScanOperator : public QueryOperator
+{
+private:
+    const BlockPostalCode *block; ///< Next block to read.
+
+public:
+    /**
+     * @brief Starts a scan at the head of the sequence set.
+     * @param records The sequence set.
+     */
+    explicit SeqScanOperator(const BlockSequenceSetPostalCode &records)
+        : block(records.getHeadBlock()) {}
+
+    bool next(QueryBatch &batch) override
+    {
+        batch.size = 0;
+        while (block != nullptr && batch.size < BATCH_SIZE)
+        {
+            batch.rows[batch.size++] = block->getBlockItem();
+            block = block->getNext();
+        }
+        return batch.size > 0;
+    }
+
+    string explain(int depth) const override
+    {
+        return string(2 * depth, ' ') + "SeqScan(blocks)\n";
+    }
+};
+
+/**
+ * @class IndexRangeScanOperator
+ * @brief Walks a ZIP range of the B+ tree in ZIP order.
+ *
+ * The operator takes a snapshot of the tree when the plan is built and
+ * iterates over it batch by batch, so a long scan sees one consistent
+ * set of ZIPs even if the tree is updated between batches; ZIPs are
+ * resolved to records through the direct-address table.
+ */
+class IndexRangeScanOperator : public QueryOperator
+{
+private:
+    BPlusTree<int>::Snapshot keys;         ///< ZIP index as of planning.
+    BPlusTree<int>::Iterator position;     ///< Next ZIP to return.
+    const DirectAddressZipTable &table;    ///< ZIP → block handles.
+    int lower;                             ///< First ZIP of the range.
+    int upper;                             ///< Last ZIP of the range.
+
+public:
+    /**
+     * @brief Prepares a scan of the ZIPs in [lower, upper].
+     * @param zipTree The ZIP index.
+     * @param zipTable The direct-address table.
+     * @param lowerZip First ZIP of the range.
+     * @param upperZip Last ZIP of the range.
+     */
+    IndexRangeScanOperator(BPlusTree<int> &zipTree, const DirectAddressZipTable &zipTable,
+                           int lowerZip, int upperZip)
+        : keys(zipTree.snapshot()), position(keys.lowerBound(lowerZip)), table(zipTable), lower(lowerZip),
+          upper(upperZip) {}
+
+    bool next(QueryBatch &batch) override
+    {
+        batch.size = 0;
+        for (; batch.size < BATCH_SIZE && position != keys.end() && *position <= upper; ++position)
+        {
+            const BlockPostalCode *block = table.find(*position);
+            if (block != nullptr)
+            {
+                batch.rows[batch.size++] = block->getBlockItem();
+            }
+        }
+        return batch.size > 0;
+    }
+
+    string explain(int depth) const override
+    {
+        return string(2 * depth, ' ') + "IndexRangeScan(zip in [" + to_string(lower) + ", " +
+               to_string(upper) + "])\n";
+    }
+};
+
+/**
+ * @class FilterOperator
+ * @brief Drops the rows of its child's batches that fail any predicate.
+ */
+class FilterOperator : public QueryOperator
+{
+private:
+    unique_ptr<QueryOperator> child; ///< Row source.
+    vector<Predicate> predicates;    ///< Predicates, all of which must hold.
+
+public:
+    /**
+     * @brief Wraps a row source with a filter.
+     * @param input The row source.
+     * @param conditions Predicates to apply.
+     */
+    FilterOperator(unique_ptr<QueryOperator> input, const vector<Predicate> &conditions)
+        : child(move(input)), predicates(conditions) {}
+
+    bool next(QueryBatch &batch) override
+    {
+        while (child->next(batch))
+        {
+            size_t kept = 0;
+            for (size_t i = 0; i < batch.size; i++)
+            {
+                bool keep = true;
+                for (const Predicate &predicate : predicates)
+                {
+                    if (!matches(predicate, batch.rows[i]))
+                    {
+                        keep = false;
+                        break;
+                    }
+                }
+                if (keep)
+                {
+                    if (kept != i)
+                    {
+                        swap(batch.rows[kept], batch.rows[i]);
+                    }
+                    kept++;
+                }
+            }
+            batch.size = kept;
+            if (kept > 0)
+            {
+                return true;
+            }
+        }
+        batch.size = 0;
+        return false;
+    }
+
+    string explain(int depth) const override
+    {
+        string line = string(2 * depth, ' ') + "Filter(";
+        for (size_t i = 0; i < predicates.size(); i++)
+        {
+            line += (i > 0 ? " AND " : "") + describe(predicates[i]);
+        }
+        return line + ")\n" + child->explain(depth + 1);
+    }
+};
+
+/**
+ * @brief Constructs an engine over a dataset and its indexes.
+ * @param records The sequence set holding the records.
+ * @param tree The ZIP B+ tree.
+ * @param table The direct-address table mapping ZIPs to blocks.
+ */
+QueryEngine::QueryEngine(const BlockSequenceSetPostalCode &records, BPlusTree<int> &tree,
+                         const DirectAddressZipTable &table)
+    : bss(records), zipTree(tree), zipTable(table) {}
+
+/**
+ * @brief Builds the row pipeline (scan and filter) for a query.
+ * @param query The query.
+ * @return The root operator of the row pipeline.
+ */
+unique_ptr<QueryOperator> QueryEngine::plan(const PostalQuery &query)
+{
+    long lower = 0;
+    long upper = DirectAddressZipTable::ZIP_DOMAIN - 1;
+    bool zipBounded = false;
+    vector<Predicate> residual;
+
+    for (const Predicate &predicate : query.predicates)
+    {
+        if (predicate.field != FIELD_ZIP || predicate.op == OP_NE)
+        {
+            residual.push_back(predicate);
+            continue;
+        }
+        zipBounded = true;
+        double value = predicate.number;
+        if (std::isnan(value))
+        {
+            upper = lower - 1; // NaN compares false with every ZIP
+            continue;
+        }
+        // Constants beyond the ZIP domain bound the range as tightly as its edges
+        value = std::min(std::max(value, -1.0), (double)DirectAddressZipTable::ZIP_DOMAIN);
+        if (predicate.op == OP_EQ)
+        {
+            if (value != floor(value))
+            {
+                upper = lower - 1; // no integer ZIP can match
+            }
+            lower = max(lower, (long)ceil(value));
+            upper = min(upper, (long)floor(value));
+        }
+        else if (predicate.op == OP_LT)
+        {
+            upper = min(upper, (long)ceil(value) - 1);
+        }
+        else if (predicate.op == OP_LE)
+        {
+            upper = min(upper, (long)floor(value));
+        }
+        else if (predicate.op == OP_GT)
+        {
+            lower = max(lower, (long)floor(value) + 1);
+        }
+        else
+        {
+            lower = max(lower, (long)ceil(value));
+        }
+    }
+
+    unique_ptr<QueryOperator> source;
+    if (zipBounded)
+    {
+        source.reset(new IndexRangeScanOperator(zipTree, zipTable, (int)lower,
+                                                (int)max(lower - 1, upper)));
+    }
+    else
+    {
+        source.reset(new SeqScanOperator(bss));
+    }
+    if (!residual.empty())
+    {
+        source.reset(new FilterOperator(move(source), residual));
+    }
+    return source;
+}
+
+/**
+ * @brief Names the final stage of a query.
+ * @param query The query.
+ * @return "HashAggregate(...)" or "Project(...)".
+ */
+static string finalStage(const PostalQuery &query)
+{
+    string line;
+    if (query.groupFields.empty() && query.aggregates.empty())
+    {
+        return "Project(zip, place, state, county, latitude, longitude)\n";
+    }
+    line = "HashAggregate(group by ";
+    for (size_t i = 0; i < query.groupFields.size(); i++)
+    {
+        line += (i > 0 ? ", " : "") + PostalQuery::fieldName(query.groupFields[i]);
+    }
+    if (query.groupFields.empty())
+    {
+        line += "()";
+    }
+    line += "; ";
+    if (query.aggregates.empty())
+    {
+        line += "count";
+    }
+    for (size_t i = 0; i < query.aggregates.size(); i++)
+    {
+        line += (i > 0 ? ", " : "") + aggregateName(query.aggregates[i]);
+    }
+    return line + ")\n";
+}
+
+/**
+ * @brief Describes the plan chosen for a query without running it.
+ * @param query The query.
+ * @return The plan, one operator per line.
+ */
+string QueryEngine::explain(const PostalQuery &query)
+{
+    return finalStage(query) + plan(query)->explain(1);
+}
+
+/**
+ * @struct AggregateState
+ * @brief Running state of one aggregate column in one group.
+ */
+struct AggregateState
+{
+    long count; ///< Rows folded in.
+    double sum; ///< Sum of the input field.
+    double min; ///< Smallest input value.
+    double max; ///< Largest input value.
+};
+
+/**
+ * @brief Orders group keys by their typed values.
+ *
+ * Text fields compare as strings; numeric fields compare as numbers, so
+ * that ZIP 501 sorts before 1001 and negative longitudes sort by value.
+ *
+ * @param fields The group-by fields.
+ * @param a A group key.
+ * @param b Another group key.
+ * @return Whether @p a sorts before @p b.
+ */
+static bool groupKeyLess(const vector<QueryField> &fields, const vector<string> &a, const vector<string> &b)
+{
+    for (size_t g = 0; g < fields.size(); g++)
+    {
+        if (a[g] == b[g])
+        {
+            continue;
+        }
+        if (PostalQuery::isTextField(fields[g]))
+        {
+            return a[g] < b[g];
+        }
+        return stod(a[g]) < stod(b[g]);
+    }
+    return false;
+}
+
+/**
+ * @brief Plans and runs a query.
+ *
+ * Without group-by fields or aggregates every matching row is returned.
+ * Otherwise rows are grouped by the group-by fields (a query with no
+ * group-by field forms a single group) and one value per aggregate is
+ * returned; a grouped query without aggregates counts rows. Groups are
+ * sorted by their key, numeric fields by value. Min, max and avg of an
+ * empty group are NULL (empty).
+ *
+ * @param query The query.
+ * @return The result table.
+ */
+QueryResult QueryEngine::execute(const PostalQuery &query)
+{
+    static const QueryField allFields[] = {FIELD_ZIP, FIELD_PLACE, FIELD_STATE,
+                                           FIELD_COUNTY, FIELD_LATITUDE, FIELD_LONGITUDE};
+    QueryResult result;
+    unique_ptr<QueryOperator> root = plan(query);
+    QueryBatch batch;
+    batch.rows.resize(QueryOperator::BATCH_SIZE);
+    batch.size = 0;
+
+    if (query.groupFields.empty() && query.aggregates.empty())
+    {
+        for (QueryField field : allFields)
+        {
+            result.columns.push_back(PostalQuery::fieldName(field));
+        }
+        while (root->next(batch))
+        {
+            for (size_t i = 0; i < batch.size; i++)
+            {
+                vector<string> row;
+                for (QueryField field : allFields)
+                {
+                    row.push_back(formatField(batch.rows[i], field));
+                }
+                result.rows.push_back(move(row));
+            }
+        }
+        return result;
+    }
+
+    vector<AggregateSpec> aggregates = query.aggregates;
+    if (aggregates.empty())
+    {
+        aggregates.push_back({AGG_COUNT, FIELD_ZIP});
+    }
+    for (QueryField field : query.groupFields)
+    {
+        result.columns.push_back(PostalQuery::fieldName(field));
+    }
+    for (const AggregateSpec &spec : aggregates)
+    {
+        result.columns.push_back(aggregateName(spec));
+    }
+
+    map<vector<string>, vector<AggregateState>> groups;
+    vector<string> key(query.groupFields.size());
+    while (root->next(batch))
+    {
+        for (size_t i = 0; i < batch.size; i++)
+        {
+            const HeaderRecordPostalCodeItem &record = batch.rows[i];
+            for (size_t g = 0; g < key.size(); g++)
+            {
+                key[g] = formatField(record, query.groupFields[g]);
+            }
+            vector<AggregateState> &states = groups[key];
+            if (states.empty())
+            {
+                states.assign(aggregates.size(), {0, 0, 0, 0});
+            }
+            for (size_t a = 0; a < aggregates.size(); a++)
+            {
+                double value = numericValue(record, aggregates[a].field);
+                AggregateState &state = states[a];
+                state.min = state.count == 0 ? value : std::min(state.min, value);
+                state.max = state.count == 0 ? value : std::max(state.max, value);
+                state.sum += value;
+                state.count++;
+            }
+        }
+    }
+
+    if (key.empty() && groups.empty())
+    {
+        groups[key].assign(aggregates.size(), {0, 0, 0, 0}); // ungrouped query over no rows
+    }
+
+    vector<const pair<const vector<string>, vector<AggregateState>> *> ordered;
+    for (const auto &group : groups)
+    {
+        ordered.push_back(&group);
+    }
+    sort(ordered.begin(), ordered.end(), [&query](const auto *a, const auto *b)
+         { return groupKeyLess(query.groupFields, a->first, b->first); });
+
+    for (const auto *group : ordered)
+    {
+        vector<string> row = group->first;
+        for (size_t a = 0; a < aggregates.size(); a++)
+        {
+            const AggregateState &state = group->second[a];
+            if (state.count == 0 && aggregates[a].kind != AGG_COUNT && aggregates[a].kind != AGG_SUM)
+            {
+                row.push_back(""); // NULL over no rows
+                continue;
+            }
+            ostringstream out;
+            out << fixed << setprecision(aggregates[a].field == FIELD_ZIP ? 0 : 4);
+            switch (aggregates[a].kind)
+            {
+            case AGG_COUNT:
+                out << state.count;
+                break;
+            case AGG_SUM:
+                out << state.sum;
+                break;
+            case AGG_MIN:
+                out << state.min;
+                break;
+            case AGG_MAX:
+                out << state.max;
+                break;
+            case AGG_AVG:
+                out << setprecision(4) << state.sum / state.count;
+                break;
+            }
+            row.push_back(out.str());
+        }
+        result.rows.push_back(move(row));
+    }
+    return result;
+}
@@ -0,0 +1,270 @@
+#ifndef POSTAL_QUERY
+#define POSTAL_QUERY
+
+/**
+ * @file PostalQuery.h
+ * @brief Declares a small filter / group-by query engine over postal records.
+ *
+ * A PostalQuery lists predicates (combined with AND), optional group-by
+ * fields and aggregates. The QueryEngine turns it into a pipeline of
+ * batch-at-a-time operators:
+ * @code
+ * HashAggregate | Project  (final stage, run by QueryEngine::execute)
+ *   Filter                 (predicates not answered by the source)
+ *     IndexRangeScan       (when the query bounds the ZIP)
+ *     | SeqScan            (otherwise)
+ * @endcode
+ * Each operator pulls batches of up to BATCH_SIZE rows from its child, so
+ * no stage materializes the whole dataset. The chosen plan can be
+ * inspected with QueryEngine::explain().
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "B+tree.cpp"
+#include "HeaderRecordPostalCodeItem.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "DirectAddressZipTable.h"
+
+using namespace std;
+
+/**
+ * @enum QueryField
+ * @brief Record fields that queries can filter, group or aggregate on.
+ */
+enum QueryField
+{
+    FIELD_ZIP,
+    FIELD_PLACE,
+    FIELD_STATE,
+    FIELD_COUNTY,
+    FIELD_LATITUDE,
+    FIELD_LONGITUDE
+};
+
+/**
+ * @enum CompareOp
+ * @brief Comparison used by a predicate.
+ */
+enum CompareOp
+{
+    OP_EQ,
+    OP_NE,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE
+};
+
+/**
+ * @enum AggregateKind
+ * @brief Aggregate functions computed per group.
+ */
+enum AggregateKind
+{
+    AGG_COUNT,
+    AGG_SUM,
+    AGG_MIN,
+    AGG_MAX,
+    AGG_AVG
+};
+
+/**
+ * @struct Predicate
+ * @brief One comparison between a record field and a constant.
+ *
+ * Numeric fields (zip, latitude, longitude) compare against @c number;
+ * text fields compare against @c text.
+ */
+struct Predicate
+{
+    QueryField field; ///< Field being compared.
+    CompareOp op;     ///< Comparison operator.
+    double number;    ///< Constant for numeric fields.
+    string text;      ///< Constant for text fields.
+};
+
+/**
+ * @struct AggregateSpec
+ * @brief One aggregate column of a grouped query.
+ */
+struct AggregateSpec
+{
+    AggregateKind kind; ///< Aggregate function.
+    QueryField field;   ///< Numeric input field (ignored by AGG_COUNT).
+};
+
+/**
+ * @class PostalQuery
+ * @brief Builder describing a filter / group-by query.
+ */
+class PostalQuery
+{
+public:
+    vector<Predicate> predicates;     ///< Predicates, all of which must hold.
+    vector<QueryField> groupFields;   ///< Group-by fields, in output order.
+    vector<AggregateSpec> aggregates; ///< Aggregate columns.
+
+    /**
+     * @brief Adds a numeric predicate.
+     * @param field Numeric field (zip, latitude or longitude).
+     * @param op Comparison operator.
+     * @param value Constant to compare with.
+     * @return This query, for chaining.
+     */
+    PostalQuery &where(QueryField field, CompareOp op, double value);
+
+    /**
+     * @brief Adds a text predicate.
+     * @param field Text field (place, state or county).
+     * @param op Comparison operator.
+     * @param value Constant to compare with.
+     * @return This query, for chaining.
+     */
+    PostalQuery &where(QueryField field, CompareOp op, const string &value);
+
+    /**
+     * @brief Adds a group-by field.
+     * @param field Field to group on.
+     * @return This query, for chaining.
+     */
+    PostalQuery &groupBy(QueryField field);
+
+    /**
+     * @brief Adds an aggregate column.
+     * @param kind Aggregate function.
+     * @param field Numeric input field (ignored by AGG_COUNT).
+     * @return This query, for chaining.
+     */
+    PostalQuery &aggregate(AggregateKind kind, QueryField field = FIELD_ZIP);
+
+    /**
+     * @brief Checks whether a field holds text.
+     * @param field The field.
+     * @return true for place, state and county.
+     */
+    static bool isTextField(QueryField field);
+
+    /**
+     * @brief Gets the name of a field.
+     * @param field The field.
+     * @return The lower-case field name (e.g. "county").
+     */
+    static string fieldName(QueryField field);
+
+    /**
+     * @brief Parses a field name.
+     * @param name Field name as returned by fieldName().
+     * @param field Receives the parsed field.
+     * @return false if the name is unknown.
+     */
+    static bool parseField(const string &name, QueryField &field);
+
+    /**
+     * @brief Parses a predicate such as "state=TX" or "latitude>30".
+     * @param text The predicate text.
+     * @param predicate Receives the parsed predicate.
+     * @return false if the text is not a valid predicate.
+     */
+    static bool parsePredicate(const string &text, Predicate &predicate);
+};
+
+/**
+ * @struct QueryBatch
+ * @brief A batch of rows passed between operators.
+ */
+struct QueryBatch
+{
+    vector<HeaderRecordPostalCodeItem> rows; ///< Row storage, reused across batches.
+    size_t size;                             ///< Number of valid rows in @c rows.
+};
+
+/**
+ * @class QueryOperator
+ * @brief A pull-based, batch-at-a-time plan operator.
+ */
+class QueryOperator
+{
+public:
+    /// @brief Maximum number of rows per batch.
+    static const size_t BATCH_SIZE = 1024;
+
+    /**
+     * @brief Virtual destructor so plans can be owned through the base class.
+     */
+    virtual ~QueryOperator() {}
+
+    /**
+     * @brief Produces the next batch of rows.
+     * @param batch Receives the rows.
+     * @return false when the operator is exhausted.
+     */
+    virtual bool next(QueryBatch &batch) = 0;
+
+    /**
+     * @brief Describes this operator and its inputs.
+     * @param depth Indentation depth.
+     * @return One line per operator, indented by depth.
+     */
+    virtual string explain(int depth) const = 0;
+};
+
+/**
+ * @struct QueryResult
+ * @brief Result table of a query.
+ */
+struct QueryResult
+{
+    vector<string> columns;      ///< Column names.
+    vector<vector<string>> rows; ///< Row values, formatted as text.
+};
+
+/**
+ * @class QueryEngine
+ * @brief Plans and executes PostalQuery objects over the loaded dataset.
+ */
+class QueryEngine
+{
+private:
+    const BlockSequenceSetPostalCode &bss; ///< Records for sequential scans.
+    BPlusTree<int> &zipTree;               ///< ZIP index for range scans.
+    const DirectAddressZipTable &zipTable; ///< Resolves ZIPs to records.
+
+public:
+    /**
+     * @brief Constructs an engine over a dataset and its indexes.
+     * @param records The sequence set holding the records.
+     * @param tree The ZIP B+ tree.
+     * @param table The direct-address table mapping ZIPs to blocks.
+     */
+    QueryEngine(const BlockSequenceSetPostalCode &records, BPlusTree<int> &tree,
+                const DirectAddressZipTable &table);
+
+    /**
+     * @brief Builds the row pipeline (scan and filter) for a query.
+     *
+     * ZIP predicates other than != become the bounds of an index range
+     * scan; everything else is evaluated by a Filter operator.
+     *
+     * @param query The query.
+     * @return The root operator of the row pipeline.
+     */
+    unique_ptr<QueryOperator> plan(const PostalQuery &query);
+
+    /**
+     * @brief Describes the plan chosen for a query without running it.
+     * @param query The query.
+     * @return The plan, one operator per line.
+     */
+    string explain(const PostalQuery &query);
+
+    /**
+     * @brief Plans and runs a query.
+     * @param query The query.
+     * @return The result table.
+     */
+    QueryResult execute(const PostalQuery &query);
+};
+
+#endif
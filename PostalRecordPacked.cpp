@@ -0,0 +1,154 @@
+/**
+ * @file PostalRecordPacked.cpp
+ * @brief Implements the packed postal record and its table.
+ */
+
+#include "PostalRecordPacked.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+using namespace std;
+
+static_assert(sizeof(PostalRecordPacked) == 64, "a packed record is one cache line");
+static_assert(is_trivially_copyable<PostalRecordPacked>::value, "packed records are copied with memcpy");
+static_assert(is_trivial<PostalRecordPacked>::value, "packed records can live in raw or mapped memory");
+
+/**
+ * @brief Stores a name inline, or in the overflow table if it does not fit.
+ * @param name The name.
+ * @param bytes Inline storage.
+ * @param capacity Inline bytes.
+ * @param length Receives the inline length or OVERFLOW_LENGTH.
+ * @param overflow Overflow table.
+ */
+void PostalRecordPacked::packName(const string &name, char *bytes, size_t capacity, uint8_t &length,
+                                  vector<string> &overflow)
+{
+    memset(bytes, 0, capacity);
+    if (name.size() <= capacity)
+    {
+        memcpy(bytes, name.data(), name.size());
+        length = (uint8_t)name.size();
+        return;
+    }
+    uint32_t index = (uint32_t)overflow.size();
+    overflow.push_back(name);
+    memcpy(bytes, &index, sizeof(index));
+    length = OVERFLOW_LENGTH;
+}
+
+/**
+ * @brief Packs a record.
+ * @param item The record.
+ * @param overflow Overflow table that receives names too long to inline.
+ * @return The packed record.
+ */
+PostalRecordPacked PostalRecordPacked::pack(const HeaderRecordPostalCodeItem &item, vector<string> &overflow)
+{
+    PostalRecordPacked record;
+    record.zip = item.getZip();
+    record.latitudeE6 = (int32_t)lround(item.getLatitude() * COORDINATE_SCALE);
+    record.longitudeE6 = (int32_t)lround(item.getLongitude() * COORDINATE_SCALE);
+    record.recordLength = (uint16_t)item.getRecordLength();
+    const string &stateName = item.getState();
+    record.state[0] = stateName.size() > 0 ? stateName[0] : '\0';
+    record.state[1] = stateName.size() > 1 ? stateName[1] : '\0';
+    packName(item.getPlace(), record.place, PLACE_CAPACITY, record.placeLength, overflow);
+    packName(item.getCounty(), record.county, COUNTY_CAPACITY, record.countyLength, overflow);
+    return record;
+}
+
+/**
+ * @brief Rebuilds the full record.
+ * @param overflow The overflow table used when packing.
+ * @return The record.
+ */
+HeaderRecordPostalCodeItem PostalRecordPacked::unpack(const vector<string> &overflow) const
+{
+    return HeaderRecordPostalCodeItem(recordLength, zip, string(getPlace(overflow)), string(getState()),
+                                      string(getCounty(overflow)), getLatitude(), getLongitude());
+}
+
+/**
+ * @brief Appends a fixed-point coordinate with six decimals.
+ * @param out String the value is appended to.
+ * @param millionths The coordinate in millionths of a degree.
+ */
+static void appendCoordinate(string &out, int32_t millionths)
+{
+    if (millionths < 0)
+    {
+        out += '-';
+    }
+    uint32_t magnitude = millionths < 0 ? 0u - (uint32_t)millionths : (uint32_t)millionths;
+    char digits[16];
+    out.append(digits, to_chars(digits, digits + sizeof(digits), magnitude / 1000000).ptr);
+    uint32_t fraction = magnitude % 1000000;
+    char decimals[7] = {'.'};
+    for (int i = 6; i >= 1; i--)
+    {
+        decimals[i] = (char)('0' + fraction % 10);
+        fraction /= 10;
+    }
+    out.append(decimals, sizeof(decimals));
+}
+
+/**
+ * @brief Appends the record as "zip,place,state,county,latitude,longitude".
+ * @param out String the record is appended to.
+ * @param placeName The resolved place name.
+ * @param countyName The resolved county name.
+ */
+void PostalRecordPacked::appendFields(string &out, string_view placeName, string_view countyName) const
+{
+    char digits[16];
+    out.append(digits, to_chars(digits, digits + sizeof(digits), zip).ptr);
+    out += ',';
+    out += placeName;
+    out += ',';
+    out += getState();
+    out += ',';
+    out += countyName;
+    out += ',';
+    appendCoordinate(out, latitudeE6);
+    out += ',';
+    appendCoordinate(out, longitudeE6);
+}
+
+/**
+ * @brief Packs and appends a record.
+ * @param item The record.
+ */
+void PackedPostalTable::add(const HeaderRecordPostalCodeItem &item)
+{
+    records.push_back(PostalRecordPacked::pack(item, overflow));
+}
+
+/**
+ * @brief Packs and appends every record of a sequence set, in list order.
+ * @param bss The sequence set.
+ */
+void PackedPostalTable::addAll(const BlockSequenceSetPostalCode &bss)
+{
+    records.reserve(records.size() + bss.getCurrentSize());
+    for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr; block = block->getNext())
+    {
+        add(block->getBlockItem());
+    }
+}
+
+/**
+ * @brief Gets the heap bytes used by the records and the overflow names.
+ * @return Bytes in use (capacity, not size).
+ */
+size_t PackedPostalTable::memoryBytes() const
+{
+    size_t bytes = records.capacity() * sizeof(PostalRecordPacked) + overflow.capacity() * sizeof(string);
+    for (const string &name : overflow)
+    {
+        bytes += name.capacity() > 15 ? name.capacity() + 1 : 0;
+    }
+    return bytes;
+}
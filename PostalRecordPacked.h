@@ -0,0 +1,235 @@
+#ifndef POSTAL_RECORD_PACKED
+#define POSTAL_RECORD_PACKED
+
+/**
+ * @file PostalRecordPacked.h
+ * @brief Declares a fixed-width, trivially copyable postal record and a table of them.
+ *
+ * A HeaderRecordPostalCodeItem holds three std::string members (32 bytes
+ * each, plus a heap block for names over 15 characters) and two doubles,
+ * 120 bytes before any heap use. PostalRecordPacked stores the same record
+ * in one 64-byte cache line:
+ *
+ * @code
+ * offset  size  field
+ *      0     4  zip
+ *      4     4  latitude  (millionths of a degree)
+ *      8     4  longitude (millionths of a degree)
+ *     12     2  record length
+ *     14     2  state
+ *     16     1  place length   (OVERFLOW_LENGTH: name is in the overflow table)
+ *     17     1  county length  (OVERFLOW_LENGTH: name is in the overflow table)
+ *     18    24  place
+ *     42    22  county
+ * @endcode
+ *
+ * Names longer than their inline capacity (about 0.3% of counties and a
+ * handful of places) are kept in an overflow vector owned by whoever owns
+ * the records; the inline bytes then hold the name's index. Millionths of
+ * a degree are the six decimals appendData() prints, so coordinates and
+ * formatted output round-trip exactly.
+ *
+ * Because the record is trivially copyable it can be memcpy'd into and
+ * out of blocks, files or mapped memory as is.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "HeaderRecordPostalCodeItem.h"
+#include "BlockSequenceSetPostalCode.h"
+
+using namespace std;
+
+/**
+ * @class PostalRecordPacked
+ * @brief One postal record in 64 bytes with inline names and fixed-point coordinates.
+ *
+ * The type has no constructors so that it stays trivial; records are made
+ * with pack(). Accessors that may need an overflow name take the name
+ * table as a template argument: anything with size() that is indexed by
+ * the overflow index and yields a string or string_view, such as the
+ * vector<string> of a PackedPostalTable or a table read from a mapped file.
+ */
+class alignas(64) PostalRecordPacked
+{
+public:
+    static const size_t PLACE_CAPACITY = 24;         ///< Inline bytes for the place name.
+    static const size_t COUNTY_CAPACITY = 22;        ///< Inline bytes for the county name.
+    static const uint8_t OVERFLOW_LENGTH = 0xFF;     ///< Length marking a name stored in the overflow table.
+    static const int32_t COORDINATE_SCALE = 1000000; ///< Fixed-point units per degree.
+
+    /**
+     * @brief Packs a record.
+     * @param item The record.
+     * @param overflow Overflow table that receives names too long to inline.
+     * @return The packed record.
+     */
+    static PostalRecordPacked pack(const HeaderRecordPostalCodeItem &item, vector<string> &overflow);
+
+    /**
+     * @brief Rebuilds the full record.
+     * @param overflow The overflow table used when packing.
+     * @return The record.
+     */
+    HeaderRecordPostalCodeItem unpack(const vector<string> &overflow) const;
+
+    /// @brief Gets the ZIP code.
+    int getZip() const { return zip; }
+
+    /// @brief Gets the length prefix of the original data line.
+    int getRecordLength() const { return recordLength; }
+
+    /// @brief Gets the latitude in millionths of a degree.
+    int32_t getLatitudeE6() const { return latitudeE6; }
+
+    /// @brief Gets the longitude in millionths of a degree.
+    int32_t getLongitudeE6() const { return longitudeE6; }
+
+    /// @brief Gets the latitude in degrees.
+    double getLatitude() const { return (double)latitudeE6 / COORDINATE_SCALE; }
+
+    /// @brief Gets the longitude in degrees.
+    double getLongitude() const { return (double)longitudeE6 / COORDINATE_SCALE; }
+
+    /// @brief Gets the state abbreviation.
+    string_view getState() const { return string_view(state, state[1] ? 2 : state[0] ? 1 : 0); }
+
+    /**
+     * @brief Gets the place name.
+     * @param overflow The overflow table used when packing.
+     * @return The name, valid while this record and the table are.
+     */
+    template <class Names>
+    string_view getPlace(const Names &overflow) const
+    {
+        return nameOf(place, placeLength, PLACE_CAPACITY, overflow);
+    }
+
+    /**
+     * @brief Gets the county name.
+     * @param overflow The overflow table used when packing.
+     * @return The name, valid while this record and the table are.
+     */
+    template <class Names>
+    string_view getCounty(const Names &overflow) const
+    {
+        return nameOf(county, countyLength, COUNTY_CAPACITY, overflow);
+    }
+
+    /**
+     * @brief Appends the record as "zip,place,state,county,latitude,longitude".
+     *
+     * Byte-identical to HeaderRecordPostalCodeItem::appendData() for the
+     * same record; the coordinates are printed from the fixed-point values.
+     *
+     * @param out String the record is appended to.
+     * @param overflow The overflow table used when packing.
+     */
+    template <class Names>
+    void appendData(string &out, const Names &overflow) const
+    {
+        appendFields(out, getPlace(overflow), getCounty(overflow));
+    }
+
+private:
+    int32_t zip;           ///< ZIP code
+    int32_t latitudeE6;    ///< Latitude in millionths of a degree
+    int32_t longitudeE6;   ///< Longitude in millionths of a degree
+    uint16_t recordLength; ///< Length prefix of the data line
+    char state[2];         ///< State abbreviation, NUL-padded
+    uint8_t placeLength;   ///< Inline place bytes, or OVERFLOW_LENGTH
+    uint8_t countyLength;  ///< Inline county bytes, or OVERFLOW_LENGTH
+    char place[PLACE_CAPACITY];   ///< Place bytes, or the overflow index
+    char county[COUNTY_CAPACITY]; ///< County bytes, or the overflow index
+
+    static void packName(const string &name, char *bytes, size_t capacity, uint8_t &length,
+                         vector<string> &overflow);
+    void appendFields(string &out, string_view placeName, string_view countyName) const;
+
+    // Lengths and indexes may come from a mapped file, so both are checked
+    // and a damaged name reads as empty rather than out of bounds.
+    template <class Names>
+    static string_view nameOf(const char *bytes, uint8_t length, size_t capacity, const Names &overflow)
+    {
+        if (length != OVERFLOW_LENGTH)
+        {
+            return length <= capacity ? string_view(bytes, length) : string_view();
+        }
+        uint32_t index;
+        memcpy(&index, bytes, sizeof(index));
+        return index < overflow.size() ? string_view(overflow[index]) : string_view();
+    }
+};
+
+/**
+ * @class PackedPostalTable
+ * @brief A contiguous array of packed records and the overflow names they refer to.
+ */
+class PackedPostalTable
+{
+private:
+    vector<PostalRecordPacked> records; ///< Records in insertion order
+    vector<string> overflow;            ///< Names too long to inline
+
+public:
+    /**
+     * @brief Reserves room for a number of records.
+     * @param count Records the table will hold.
+     */
+    void reserve(size_t count) { records.reserve(count); }
+
+    /**
+     * @brief Packs and appends a record.
+     * @param item The record.
+     */
+    void add(const HeaderRecordPostalCodeItem &item);
+
+    /**
+     * @brief Packs and appends every record of a sequence set, in list order.
+     * @param bss The sequence set.
+     */
+    void addAll(const BlockSequenceSetPostalCode &bss);
+
+    /// @brief Gets the number of records.
+    size_t size() const { return records.size(); }
+
+    /// @brief Gets a record by position.
+    const PostalRecordPacked &operator[](size_t index) const { return records[index]; }
+
+    /// @brief Gets all records, contiguous and memcpy-able.
+    const vector<PostalRecordPacked> &getRecords() const { return records; }
+
+    /// @brief Gets the overflow names the records refer to.
+    const vector<string> &getOverflow() const { return overflow; }
+
+    /// @brief Gets the place name of a record.
+    string_view getPlace(size_t index) const { return records[index].getPlace(overflow); }
+
+    /// @brief Gets the county name of a record.
+    string_view getCounty(size_t index) const { return records[index].getCounty(overflow); }
+
+    /**
+     * @brief Appends a record as "zip,place,state,county,latitude,longitude".
+     * @param index Record position.
+     * @param out String the record is appended to.
+     */
+    void appendData(size_t index, string &out) const { records[index].appendData(out, overflow); }
+
+    /**
+     * @brief Rebuilds a full record.
+     * @param index Record position.
+     * @return The record.
+     */
+    HeaderRecordPostalCodeItem unpack(size_t index) const { return records[index].unpack(overflow); }
+
+    /**
+     * @brief Gets the heap bytes used by the records and the overflow names.
+     * @return Bytes in use (capacity, not size).
+     */
+    size_t memoryBytes() const;
+};
+
+#endif
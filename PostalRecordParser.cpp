@@ -0,0 +1,279 @@
+/**
+ * @file PostalRecordParser.cpp
+ * @brief Implements the parallel parser of the length-indicated postal data file.
+ */
+
+#include "PostalRecordParser.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+using namespace std;
+
+/// @brief Lines parsed by one pool task.
+static const size_t LINES_PER_TASK = 2048;
+
+/// @brief Byte-balanced runs per pool worker when parsing through an offset index.
+static const size_t RUNS_PER_WORKER = 8;
+
+/**
+ * @brief Reads a whole file.
+ * @param fileName The file.
+ * @param data Receives the contents.
+ * @return false if the file cannot be read.
+ */
+static bool readFile(const string &fileName, string &data)
+{
+    ifstream input(fileName, ios::binary);
+    if (!input)
+    {
+        return false;
+    }
+    ostringstream contents;
+    contents << input.rdbuf();
+    data = contents.str();
+    return true;
+}
+
+/// @brief Longest numeric field accepted, plus its terminator.
+static const size_t NUMBER_BUFFER = 32;
+
+/**
+ * @brief Copies a numeric field into a terminated buffer.
+ *
+ * The C parsers skip leading whitespace, newlines included, so parsing in
+ * place would let an empty field read the number at the start of the next
+ * line. A copy keeps them inside the field.
+ *
+ * @param text Start of the field.
+ * @param length Bytes in the field.
+ * @param buffer Receives the field and a terminator.
+ * @return false if the field is empty or too long.
+ */
+static bool copyNumber(const char *text, size_t length, char (&buffer)[NUMBER_BUFFER])
+{
+    if (length == 0 || length >= NUMBER_BUFFER)
+    {
+        return false;
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    return true;
+}
+
+/**
+ * @brief Parses a ZIP field.
+ * @param text Start of the field.
+ * @param length Bytes in the field.
+ * @param value Receives the ZIP.
+ * @return false unless the whole field is an integer in the range of int.
+ */
+static bool parseInteger(const char *text, size_t length, int &value)
+{
+    char buffer[NUMBER_BUFFER];
+    if (!copyNumber(text, length, buffer))
+    {
+        return false;
+    }
+    char *stop;
+    errno = 0;
+    long parsed = strtol(buffer, &stop, 10);
+    value = (int)parsed;
+    return stop != buffer && *stop == '\0' && errno == 0 && parsed == value;
+}
+
+/**
+ * @brief Parses a coordinate field.
+ * @param text Start of the field.
+ * @param length Bytes in the field.
+ * @param value Receives the coordinate.
+ * @return false unless the whole field is a number.
+ */
+static bool parseDecimal(const char *text, size_t length, double &value)
+{
+    char buffer[NUMBER_BUFFER];
+    if (!copyNumber(text, length, buffer))
+    {
+        return false;
+    }
+    char *stop;
+    value = strtod(buffer, &stop);
+    return stop != buffer && *stop == '\0';
+}
+
+/**
+ * @brief Drops records whose line did not parse, keeping the order of the rest.
+ * @param records The records.
+ * @param valid One flag per record.
+ */
+static void dropInvalid(vector<HeaderRecordPostalCodeItem> &records, const vector<char> &valid)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        if (valid[i] && kept++ != i)
+        {
+            records[kept - 1] = move(records[i]);
+        }
+    }
+    records.resize(kept);
+}
+
+/**
+ * @brief Parses one record line.
+ * @param line Start of the line.
+ * @param length Bytes in the line, without the newline.
+ * @param item Receives the record.
+ * @return false if the line does not have six well-formed fields.
+ */
+bool PostalRecordParser::parseLine(const char *line, size_t length, HeaderRecordPostalCodeItem &item)
+{
+    if (length < 2 || !parseFields(line + 2, length - 2, item))
+    {
+        return false;
+    }
+    item.setRecordLength((line[0] - '0') * 10 + (line[1] - '0'));
+    return true;
+}
+
+/**
+ * @brief Parses the six fields of a record without a length prefix.
+ * @param fields Start of zip,place,state,county,latitude,longitude.
+ * @param length Bytes of fields.
+ * @param item Receives the record.
+ * @return false if there are not six fields or a numeric field is not a number.
+ */
+bool PostalRecordParser::parseFields(const char *fields, size_t length, HeaderRecordPostalCodeItem &item)
+{
+    const char *end = fields + length;
+    const char *field[6];
+    size_t fieldLength[6];
+    const char *cursor = fields;
+    for (int f = 0; f < 6; f++)
+    {
+        const char *comma = f < 5 ? (const char *)memchr(cursor, ',', end - cursor) : end;
+        if (comma == nullptr)
+        {
+            return false;
+        }
+        field[f] = cursor;
+        fieldLength[f] = comma - cursor;
+        cursor = comma + 1;
+    }
+
+    int zip;
+    double latitude, longitude;
+    if (!parseInteger(field[0], fieldLength[0], zip) || !parseDecimal(field[4], fieldLength[4], latitude) ||
+        !parseDecimal(field[5], fieldLength[5], longitude))
+    {
+        return false;
+    }
+    item.setZip(zip);
+    item.setPlace(string(field[1], fieldLength[1]));
+    item.setState(string(field[2], fieldLength[2]));
+    item.setCounty(string(field[3], fieldLength[3]));
+    item.setLatitude(latitude);
+    item.setLongitude(longitude);
+    return true;
+}
+
+/**
+ * @brief Parses every record of a file, skipping the header line.
+ * @param fileName The length-indicated data file.
+ * @param pool Pool parsing the lines.
+ * @return The records in file order (empty if the file cannot be read).
+ */
+vector<HeaderRecordPostalCodeItem> PostalRecordParser::parseFile(const string &fileName,
+                                                                 WorkStealingPool &pool)
+{
+    string data;
+    if (!readFile(fileName, data))
+    {
+        return {};
+    }
+
+    // Line starts, skipping the header
+    vector<size_t> starts;
+    const char *base = data.c_str();
+    const char *newline = (const char *)memchr(base, '\n', data.size());
+    while (newline != nullptr && (size_t)(newline + 1 - base) < data.size())
+    {
+        size_t start = newline + 1 - base;
+        starts.push_back(start);
+        newline = (const char *)memchr(base + start, '\n', data.size() - start);
+    }
+
+    vector<HeaderRecordPostalCodeItem> records(starts.size());
+    vector<char> valid(starts.size());
+    pool.parallelFor(0, starts.size(), LINES_PER_TASK, [&](size_t first, size_t last)
+                     {
+        for (size_t i = first; i < last; i++)
+        {
+            size_t end = i + 1 < starts.size() ? starts[i + 1] - 1 : data.size();
+            if (end > starts[i] && data[end - 1] == '\n')
+            {
+                end--;
+            }
+            valid[i] = parseLine(base + starts[i], end - starts[i], records[i]);
+        } });
+
+    // Drop malformed lines (e.g. a blank last line) without reordering.
+    dropInvalid(records, valid);
+    return records;
+}
+
+/**
+ * @brief Parses every record of a file at the positions given by an offset index.
+ * @param fileName The length-indicated data file.
+ * @param index Offset index of that file.
+ * @param pool Pool parsing the records.
+ * @return The records in file order (empty if the file cannot be read or does not match the index).
+ */
+vector<HeaderRecordPostalCodeItem> PostalRecordParser::parseFile(const string &fileName,
+                                                                 const PostalOffsetIndex &index,
+                                                                 WorkStealingPool &pool)
+{
+    string data;
+    if (!readFile(fileName, data) || data.size() != index.getDataBytes())
+    {
+        return {};
+    }
+
+    vector<size_t> bounds = index.partition(pool.size() * RUNS_PER_WORKER);
+    vector<HeaderRecordPostalCodeItem> records(index.size());
+    vector<char> valid(index.size());
+    pool.parallelFor(0, bounds.size() - 1, 1, [&](size_t first, size_t last)
+                     {
+        for (size_t run = first; run < last; run++)
+        {
+            for (size_t i = bounds[run]; i < bounds[run + 1]; i++)
+            {
+                const RecordLocation &location = index[i];
+                valid[i] = parseLine(data.data() + location.offset, location.length, records[i]);
+            }
+        } });
+
+    dropInvalid(records, valid);
+    return records;
+}
+
+/**
+ * @brief Parses a file in parallel and appends its records to a sequence set in file order.
+ * @param bss The sequence set.
+ * @param fileName The length-indicated data file.
+ * @param pool Pool parsing the lines.
+ * @return Number of records added.
+ */
+size_t PostalRecordParser::loadBlockSequenceSet(BlockSequenceSetPostalCode &bss,
+                                                const string &fileName, WorkStealingPool &pool)
+{
+    vector<HeaderRecordPostalCodeItem> records = parseFile(fileName, pool);
+    for (HeaderRecordPostalCodeItem &record : records)
+    {
+        bss.add(move(record));
+    }
+    return records.size();
+}
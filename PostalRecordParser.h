@@ -0,0 +1,93 @@
+#ifndef POSTAL_RECORD_PARSER
+#define POSTAL_RECORD_PARSER
+
+/**
+ * @file PostalRecordParser.h
+ * @brief Declares the parallel parser of the length-indicated postal data file.
+ *
+ * The file is read in one go and its line starts are found with one
+ * memchr() sweep; the lines are then parsed in parallel on a
+ * WorkStealingPool straight from the buffer, without the per-field
+ * substring copies of inputDatatoBlockSequenceSet(). Records keep their
+ * file order.
+ */
+
+#include <string>
+#include <vector>
+#include "HeaderRecordPostalCodeItem.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "WorkStealingPool.h"
+#include "PostalOffsetIndex.h"
+
+using namespace std;
+
+/**
+ * @class PostalRecordParser
+ * @brief Parses length-indicated postal records in parallel.
+ */
+class PostalRecordParser
+{
+public:
+    /**
+     * @brief Parses one record line.
+     *
+     * The line is a two-digit record length followed by
+     * zip,place,state,county,latitude,longitude. The ZIP and the
+     * coordinates must each fill their field; an empty or partly numeric
+     * field rejects the line.
+     *
+     * @param line Start of the line.
+     * @param length Bytes in the line, without the newline.
+     * @param item Receives the record.
+     * @return false if the line does not have six well-formed fields.
+     */
+    static bool parseLine(const char *line, size_t length, HeaderRecordPostalCodeItem &item);
+
+    /**
+     * @brief Parses the six fields of a record without a length prefix.
+     *
+     * Sets every field but the record length. Numeric fields are checked
+     * as by parseLine().
+     *
+     * @param fields Start of zip,place,state,county,latitude,longitude.
+     * @param length Bytes of fields.
+     * @param item Receives the record.
+     * @return false if there are not six well-formed fields.
+     */
+    static bool parseFields(const char *fields, size_t length, HeaderRecordPostalCodeItem &item);
+
+    /**
+     * @brief Parses every record of a file, skipping the header line.
+     * @param fileName The length-indicated data file.
+     * @param pool Pool parsing the lines.
+     * @return The records in file order (empty if the file cannot be read).
+     */
+    static vector<HeaderRecordPostalCodeItem> parseFile(const string &fileName,
+                                                        WorkStealingPool &pool = WorkStealingPool::shared());
+
+    /**
+     * @brief Parses every record of a file at the positions given by an offset index.
+     *
+     * No line sweep is needed: the index's byte-balanced partition() gives
+     * each pool task an exact run of records.
+     *
+     * @param fileName The length-indicated data file.
+     * @param index Offset index of that file.
+     * @param pool Pool parsing the records.
+     * @return The records in file order (empty if the file cannot be read or does not match the index).
+     */
+    static vector<HeaderRecordPostalCodeItem> parseFile(const string &fileName, const PostalOffsetIndex &index,
+                                                        WorkStealingPool &pool = WorkStealingPool::shared());
+
+    /**
+     * @brief Parses a file in parallel and appends its records to a sequence set in file order.
+     * @param bss The sequence set.
+     * @param fileName The length-indicated data file.
+     * @param pool Pool parsing the lines.
+     * @return Number of records added.
+     */
+    static size_t loadBlockSequenceSet(BlockSequenceSetPostalCode &bss, const string &fileName,
+                                       WorkStealingPool &pool = WorkStealingPool::shared());
+};
+
+#endif
@@ -0,0 +1,627 @@
+/**
+ * @file PostalServer.cpp
+ * @brief Implements the Unix domain socket query server.
+ */
+
+#include "PostalServer.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+/**
+ * @brief Converts a block's record into a protocol record.
+ * @param block The block.
+ * @param distanceKm Distance to report.
+ * @return The protocol record.
+ */
+static ProtocolRecord toProtocolRecord(const BlockPostalCode *block, double distanceKm)
+{
+    const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+    return {item.getZip(), item.getLatitude(), item.getLongitude(), distanceKm,
+            item.getPlace(), item.getState(), item.getCounty()};
+}
+
+/**
+ * @brief Constructs a server over published datasets.
+ * @param publisher Publisher of the dataset to serve; must outlive the server.
+ */
+PostalServer::PostalServer(PostalDatasetPublisher &publisher)
+    : datasets(publisher), cache(nullptr),
+      listenFd(-1), epollFd(-1), wakeFd(-1), stopping(false),
+      stopRequested(false), served(0) {}
+
+/**
+ * @brief Closes all sockets and removes the socket file.
+ */
+PostalServer::~PostalServer()
+{
+    for (auto &entry : connections)
+    {
+        closeClient(entry.second);
+    }
+    for (int fd : {listenFd, epollFd, wakeFd})
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+    if (!socketPath.empty())
+    {
+        unlink(socketPath.c_str());
+    }
+}
+
+/**
+ * @brief Binds and listens on a Unix domain socket.
+ * @param path Filesystem path of the socket.
+ * @return false (after printing the reason) if the socket cannot be set up.
+ */
+bool PostalServer::listen(const string &path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        cerr << "Socket path too long: " << path << endl;
+        return false;
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (listenFd < 0 || epollFd < 0 || wakeFd < 0)
+    {
+        cerr << "Cannot create server sockets: " << strerror(errno) << endl;
+        return false;
+    }
+
+    unlink(path.c_str());
+    if (bind(listenFd, (sockaddr *)&address, sizeof(address)) < 0 ||
+        ::listen(listenFd, SOMAXCONN) < 0)
+    {
+        cerr << "Cannot listen on " << path << ": " << strerror(errno) << endl;
+        return false;
+    }
+    socketPath = path;
+
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    return true;
+}
+
+/**
+ * @brief Serves lookups through a result cache of encoded records.
+ * @param resultCache The cache, or nullptr to disable caching.
+ */
+void PostalServer::setCache(ZipResultCache *resultCache)
+{
+    cache = resultCache;
+}
+
+/**
+ * @brief Runs the event loop until stop() is called.
+ *
+ * The loop handles four kinds of events: new clients on the listening
+ * socket, readable clients, writable clients with queued responses, and
+ * the wake eventfd, which workers signal when a connection's watched
+ * events may have to change and stop() signals on shutdown. A client
+ * that hung up or failed is closed at once, since nothing more can be
+ * delivered to it.
+ *
+ * @param workerCount Number of worker threads; 0 uses one per hardware thread.
+ */
+void PostalServer::run(int workerCount)
+{
+    if (workerCount <= 0)
+    {
+        workerCount = max(1u, thread::hardware_concurrency());
+    }
+    vector<thread> workers;
+    for (int w = 0; w < workerCount; w++)
+    {
+        workers.emplace_back(&PostalServer::workerLoop, this);
+    }
+
+    epoll_event events[64];
+    while (!stopRequested)
+    {
+        int ready = epoll_wait(epollFd, events, 64, -1);
+        if (ready < 0 && errno != EINTR)
+        {
+            cerr << "epoll_wait failed: " << strerror(errno) << endl;
+            break;
+        }
+        for (int e = 0; e < ready; e++)
+        {
+            int fd = events[e].data.fd;
+            if (fd == listenFd)
+            {
+                acceptClients();
+                continue;
+            }
+            if (fd == wakeFd)
+            {
+                uint64_t count;
+                while (read(wakeFd, &count, sizeof(count)) > 0)
+                {
+                }
+                vector<shared_ptr<Connection>> wanting;
+                {
+                    lock_guard<mutex> guard(writeLock);
+                    wanting.swap(pendingEvents);
+                }
+                for (const shared_ptr<Connection> &connection : wanting)
+                {
+                    bool open;
+                    {
+                        lock_guard<mutex> guard(connection->lock);
+                        if (connection->closed)
+                        {
+                            continue;
+                        }
+                        open = watch(*connection);
+                    }
+                    if (!open)
+                    {
+                        closeClient(connection);
+                        connections.erase(connection->fd);
+                    }
+                }
+                continue;
+            }
+
+            auto it = connections.find(fd);
+            if (it == connections.end())
+            {
+                continue;
+            }
+            shared_ptr<Connection> connection = it->second;
+            bool open = (events[e].events & (EPOLLHUP | EPOLLERR)) == 0;
+            if (open && (events[e].events & EPOLLOUT))
+            {
+                open = flushClient(connection);
+            }
+            if (open && (events[e].events & EPOLLIN))
+            {
+                open = readClient(connection);
+            }
+            if (!open)
+            {
+                closeClient(connection);
+                connections.erase(fd);
+            }
+        }
+    }
+
+    {
+        lock_guard<mutex> guard(taskLock);
+        stopping = true;
+    }
+    taskReady.notify_all();
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Asks the event loop to exit. Safe to call from a signal handler.
+ */
+void PostalServer::stop()
+{
+    stopRequested = true;
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0)
+    {
+        // the loop is already awake
+    }
+}
+
+/**
+ * @brief Accepts every pending client connection.
+ */
+void PostalServer::acceptClients()
+{
+    while (true)
+    {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+        shared_ptr<Connection> connection = make_shared<Connection>();
+        connection->fd = fd;
+        connection->closed = false;
+        connection->wantWrite = false;
+        connection->readClosed = false;
+        connection->pendingTasks = 0;
+        connection->events = EPOLLIN;
+        connections[fd] = connection;
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+/**
+ * @brief Reads available bytes from a client and queues its complete frames.
+ *
+ * All complete frames of one read (at most READ_BYTES) become one task,
+ * so a pipelined burst costs one queue hand-off; a partial trailing frame stays buffered. At
+ * end of file the connection stops being read but stays open until its
+ * tasks are answered and their responses written.
+ *
+ * @param connection The client.
+ * @return false if the connection failed, sent an invalid frame or is finished.
+ */
+bool PostalServer::readClient(const shared_ptr<Connection> &connection)
+{
+    // One read per event: the loop comes back while more is readable, after
+    // watch() has had a chance to stop reading a client that is behind
+    char chunk[READ_BYTES];
+    ssize_t n;
+    do
+    {
+        n = read(connection->fd, chunk, sizeof(chunk));
+    } while (n < 0 && errno == EINTR);
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        return false;
+    }
+    if (n > 0)
+    {
+        connection->input.append(chunk, n);
+    }
+    bool ended = n == 0;
+
+    size_t offset = 0;
+    uint32_t bodyLength;
+    string &input = connection->input;
+    while (input.size() - offset >= PostalProtocol::LENGTH_BYTES)
+    {
+        bool complete = PostalProtocol::completeFrame(input.data() + offset, input.size() - offset,
+                                                      bodyLength);
+        if (bodyLength > PostalProtocol::MAX_REQUEST_BYTES)
+        {
+            return false;
+        }
+        if (!complete)
+        {
+            break;
+        }
+        offset += PostalProtocol::LENGTH_BYTES + bodyLength;
+    }
+
+    if (offset > 0)
+    {
+        Task task;
+        task.connection = connection;
+        task.frames.assign(input, 0, offset);
+        input.erase(0, offset);
+        {
+            lock_guard<mutex> guard(connection->lock);
+            connection->pendingTasks++;
+        }
+        {
+            lock_guard<mutex> guard(taskLock);
+            tasks.push_back(move(task));
+        }
+        taskReady.notify_one();
+    }
+
+    lock_guard<mutex> guard(connection->lock);
+    connection->readClosed = ended;
+    return watch(*connection);
+}
+
+/**
+ * @brief Writes queued response bytes of a client.
+ *
+ * Once the queue is empty the connection goes back to waiting for input only.
+ *
+ * @param connection The client.
+ * @return false if the connection is finished and should be closed.
+ */
+bool PostalServer::flushClient(const shared_ptr<Connection> &connection)
+{
+    lock_guard<mutex> guard(connection->lock);
+    if (connection->closed)
+    {
+        return false;
+    }
+    string &output = connection->output;
+    size_t offset = 0;
+    while (offset < output.size())
+    {
+        ssize_t n = ::send(connection->fd, output.data() + offset, output.size() - offset, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        offset += n;
+    }
+    output.erase(0, offset);
+    if (output.empty())
+    {
+        connection->wantWrite = false;
+    }
+    return watch(*connection);
+}
+
+/**
+ * @brief Updates the events the event loop watches on a client.
+ *
+ * EPOLLIN is watched unless the client has shut down its side,
+ * MAX_PENDING_TASKS of its tasks are waiting or OUTPUT_HIGH_WATER response
+ * bytes are queued; EPOLLOUT is watched while any are queued. Called by
+ * the event loop only.
+ *
+ * @param connection The client; its lock must be held.
+ * @return false if the client has shut down its side and every response has been sent.
+ */
+bool PostalServer::watch(Connection &connection)
+{
+    if (connection.readClosed && connection.pendingTasks == 0 && connection.output.empty())
+    {
+        return false;
+    }
+    uint32_t events = 0;
+    if (!connection.readClosed && connection.pendingTasks < MAX_PENDING_TASKS &&
+        connection.output.size() < OUTPUT_HIGH_WATER)
+    {
+        events |= EPOLLIN;
+    }
+    if (!connection.output.empty())
+    {
+        events |= EPOLLOUT;
+    }
+    if (events != connection.events)
+    {
+        epoll_event event;
+        event.events = events;
+        event.data.fd = connection.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+        connection.events = events;
+    }
+    return true;
+}
+
+/**
+ * @brief Asks the event loop to update the events watched on a client.
+ * @param connection The client.
+ */
+void PostalServer::requestWatch(const shared_ptr<Connection> &connection)
+{
+    {
+        lock_guard<mutex> guard(writeLock);
+        pendingEvents.push_back(connection);
+    }
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0)
+    {
+        // the loop is already awake
+    }
+}
+
+/**
+ * @brief Closes a client connection.
+ *
+ * The socket is closed under the connection lock, so a worker still
+ * holding the connection cannot write to a reused descriptor.
+ *
+ * @param connection The client.
+ */
+void PostalServer::closeClient(const shared_ptr<Connection> &connection)
+{
+    lock_guard<mutex> guard(connection->lock);
+    if (!connection->closed)
+    {
+        connection->closed = true;
+        close(connection->fd);
+    }
+}
+
+/**
+ * @brief Sends response bytes to a client, queueing what the socket does not take.
+ *
+ * Responses are written directly when nothing is queued; otherwise they
+ * are appended behind the queued bytes to keep frames intact, and the
+ * event loop is asked to watch for EPOLLOUT, and to stop reading once the
+ * queue reaches OUTPUT_HIGH_WATER.
+ *
+ * @param connection The client.
+ * @param data Response frames.
+ */
+void PostalServer::send(const shared_ptr<Connection> &connection, const string &data)
+{
+    lock_guard<mutex> guard(connection->lock);
+    if (connection->closed)
+    {
+        return;
+    }
+    size_t offset = 0;
+    if (connection->output.empty())
+    {
+        while (offset < data.size())
+        {
+            ssize_t n = ::send(connection->fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                break;
+            }
+            offset += n;
+        }
+    }
+    if (offset == data.size())
+    {
+        return;
+    }
+    size_t queued = connection->output.size();
+    connection->output.append(data, offset, string::npos);
+    bool full = queued < OUTPUT_HIGH_WATER && connection->output.size() >= OUTPUT_HIGH_WATER;
+    if (!connection->wantWrite || full)
+    {
+        connection->wantWrite = true;
+        requestWatch(connection);
+    }
+}
+
+/**
+ * @brief Worker thread body: answers queued tasks until shutdown.
+ */
+void PostalServer::workerLoop()
+{
+    string responses;
+    while (true)
+    {
+        Task task;
+        {
+            unique_lock<mutex> guard(taskLock);
+            taskReady.wait(guard, [this]
+                           { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+            {
+                return;
+            }
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+
+        responses.clear();
+        {
+            // The whole task reads one dataset version
+            PostalDatasetPublisher::ReadGuard dataset(datasets);
+            const char *frames = task.frames.data();
+            size_t offset = 0;
+            uint32_t bodyLength;
+            while (PostalProtocol::completeFrame(frames + offset, task.frames.size() - offset, bodyLength))
+            {
+                ProtocolRequest request;
+                const char *body = frames + offset + PostalProtocol::LENGTH_BYTES;
+                if (PostalProtocol::decodeRequest(body, bodyLength, request))
+                {
+                    answer(request, *dataset, responses);
+                }
+                else
+                {
+                    size_t frame = PostalProtocol::beginResponse(responses, request.id, STATUS_BAD_REQUEST);
+                    PostalProtocol::finishResponse(responses, frame);
+                }
+                offset += PostalProtocol::LENGTH_BYTES + bodyLength;
+            }
+        }
+        send(task.connection, responses);
+
+        // The event loop resumes reading a client that was at its task limit,
+        // and closes a half-closed client once its last task is answered
+        bool rewatch;
+        {
+            lock_guard<mutex> guard(task.connection->lock);
+            unsigned left = --task.connection->pendingTasks;
+            rewatch = left == MAX_PENDING_TASKS - 1 || (left == 0 && task.connection->readClosed);
+        }
+        if (rewatch)
+        {
+            requestWatch(task.connection);
+        }
+    }
+}
+
+/**
+ * @brief Answers one request.
+ *
+ * Lookups are answered from the result cache when one is set; on a miss
+ * the encoded record is offered to the cache. Cache entries are tagged
+ * with the dataset version, so a reload never serves stale payloads. Range and nearest requests
+ * return at most MAX_RECORDS records; a limit of 0 means MAX_RECORDS.
+ *
+ * @param request The decoded request.
+ * @param dataset Dataset to answer from.
+ * @param out Buffer receiving the response frame.
+ */
+void PostalServer::answer(const ProtocolRequest &request, PostalDataset &dataset, string &out)
+{
+    const DirectAddressZipTable &zipTable = dataset.getTable();
+    uint32_t limit = request.limit == 0 || request.limit > MAX_RECORDS ? MAX_RECORDS : request.limit;
+    size_t frame = PostalProtocol::beginResponse(out, request.id, STATUS_OK);
+    size_t count = 0;
+
+    if (request.op == OP_LOOKUP)
+    {
+        uint64_t ticket = 0;
+        size_t recordStart = out.size();
+        if (cache != nullptr && cache->fetch(request.zip, out, &ticket, dataset.getVersion()))
+        {
+            PostalProtocol::countRecord(out, frame);
+            count++;
+        }
+        else if (const BlockPostalCode *block = zipTable.find(request.zip))
+        {
+            PostalProtocol::appendRecord(out, frame, toProtocolRecord(block, 0));
+            count++;
+            if (cache != nullptr)
+            {
+                cache->put(request.zip, out.substr(recordStart), ticket, dataset.getVersion());
+            }
+        }
+    }
+    else if (request.op == OP_RANGE)
+    {
+        count = dataset.getTree().rangeScan(request.lower, request.upper, [&](const int &zip)
+                                  {
+            const BlockPostalCode *block = zipTable.find(zip);
+            if (block != nullptr)
+            {
+                PostalProtocol::appendRecord(out, frame, toProtocolRecord(block, 0));
+            } }, limit);
+    }
+    else
+    {
+        for (const SpatialMatch &match : dataset.getSpatialIndex().nearest(request.latitude, request.longitude, limit))
+        {
+            PostalProtocol::appendRecord(out, frame, toProtocolRecord(match.block, match.distanceKm));
+            count++;
+        }
+    }
+
+    if (count == 0)
+    {
+        out[frame + PostalProtocol::LENGTH_BYTES + sizeof(uint32_t)] = STATUS_NOT_FOUND;
+    }
+    PostalProtocol::finishResponse(out, frame);
+    served++;
+}
+
+/**
+ * @brief Gets the number of requests answered so far.
+ * @return The request count.
+ */
+unsigned long PostalServer::requestsServed() const
+{
+    return served;
+}
@@ -0,0 +1,231 @@
+#ifndef POSTAL_SERVER
+#define POSTAL_SERVER
+
+/**
+ * @file PostalServer.h
+ * @brief Declares the Unix domain socket query server.
+ *
+ * One event-loop thread owns the listening socket and every connection:
+ * it accepts clients, reads whatever bytes are available, cuts them into
+ * request frames (see PostalProtocol.h) and hands each read's frames to a
+ * pool of worker threads as one task. A worker answers the requests from
+ * the in-memory indexes and writes the responses straight to the socket;
+ * if the socket is full, the rest is queued on the connection and the
+ * event loop finishes the write once the socket is writable again. While
+ * a connection's queue holds OUTPUT_HIGH_WATER bytes or more, or
+ * MAX_PENDING_TASKS of its tasks are still waiting, the loop stops reading
+ * from it, so a client that does not read its responses cannot grow the
+ * server's memory without bound.
+ *
+ * A client may shut down its sending side once its requests are written:
+ * the connection is then closed only after every request read has been
+ * answered and its responses have been written.
+ *
+ * The indexes are read through a PostalDatasetPublisher: each task is
+ * answered from the dataset that was current when the task started, so a
+ * new release can be published while the server runs without pausing it.
+ */
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <unordered_map>
+#include "PostalDatasetPublisher.h"
+#include "PostalProtocol.h"
+#include "ZipResultCache.h"
+
+using namespace std;
+
+/**
+ * @class PostalServer
+ * @brief Serves lookup, range and nearest queries over a Unix domain socket.
+ */
+class PostalServer
+{
+public:
+    /// @brief Largest number of records returned by one range or nearest request.
+    static const uint32_t MAX_RECORDS = 1000;
+
+    /// @brief Queued response bytes at which the server stops reading a client's requests.
+    static const size_t OUTPUT_HIGH_WATER = 1 << 20;
+
+    /// @brief Tasks of one client waiting or being answered at which the server stops reading it.
+    static const unsigned MAX_PENDING_TASKS = 4;
+
+    /// @brief Largest number of request bytes read from a client per readable event.
+    static const size_t READ_BYTES = 4096;
+
+private:
+    /**
+     * @struct Connection
+     * @brief State of one client connection.
+     *
+     * @c input is only touched by the event loop. @c output and the flags
+     * are shared with the workers and guarded by @c lock.
+     */
+    struct Connection
+    {
+        int fd;                ///< Client socket (non-blocking).
+        string input;          ///< Bytes read but not yet cut into frames.
+        mutex lock;            ///< Guards the members below.
+        string output;         ///< Response bytes the socket did not accept yet.
+        bool closed;           ///< Set once the socket has been closed.
+        bool wantWrite;        ///< Set while the event loop waits for EPOLLOUT.
+        bool readClosed;       ///< Set once the client has shut down its sending side.
+        unsigned pendingTasks; ///< Tasks queued or being answered.
+        uint32_t events;       ///< Events the event loop watches.
+    };
+
+    /**
+     * @struct Task
+     * @brief Request frames read from one connection in one go.
+     */
+    struct Task
+    {
+        shared_ptr<Connection> connection; ///< Where to send the responses.
+        string frames;                     ///< Complete request frames.
+    };
+
+    PostalDatasetPublisher &datasets; ///< Current records and indexes.
+    ZipResultCache *cache;            ///< Encoded OP_LOOKUP records, or nullptr.
+
+    int listenFd; ///< Listening socket, or -1.
+    int epollFd;  ///< Event loop's epoll instance, or -1.
+    int wakeFd;   ///< eventfd used by workers and stop() to wake the event loop.
+    string socketPath; ///< Path of the bound socket, removed on shutdown.
+
+    unordered_map<int, shared_ptr<Connection>> connections; ///< Open connections by fd.
+
+    mutex taskLock;               ///< Guards tasks and stopping.
+    condition_variable taskReady; ///< Signalled when a task is queued or on shutdown.
+    deque<Task> tasks;            ///< Tasks waiting for a worker.
+    bool stopping;                ///< Set when workers should exit.
+
+    mutex writeLock;                              ///< Guards pendingEvents.
+    vector<shared_ptr<Connection>> pendingEvents; ///< Connections whose watched events may change.
+
+    atomic<bool> stopRequested;   ///< Set by stop().
+    atomic<unsigned long> served; ///< Requests answered so far.
+
+    /**
+     * @brief Worker thread body: answers queued tasks until shutdown.
+     */
+    void workerLoop();
+
+    /**
+     * @brief Accepts every pending client connection.
+     */
+    void acceptClients();
+
+    /**
+     * @brief Reads available bytes from a client and queues its complete frames.
+     * @param connection The client.
+     * @return false if the connection failed, sent an invalid frame or is finished.
+     */
+    bool readClient(const shared_ptr<Connection> &connection);
+
+    /**
+     * @brief Writes queued response bytes of a client.
+     * @param connection The client.
+     * @return false if the connection is finished and should be closed.
+     */
+    bool flushClient(const shared_ptr<Connection> &connection);
+
+    /**
+     * @brief Updates the events the event loop watches on a client.
+     * @param connection The client; its lock must be held.
+     * @return false if the client has shut down its side and every response has been sent.
+     */
+    bool watch(Connection &connection);
+
+    /**
+     * @brief Asks the event loop to update the events watched on a client.
+     * @param connection The client.
+     */
+    void requestWatch(const shared_ptr<Connection> &connection);
+
+    /**
+     * @brief Closes a client connection.
+     * @param connection The client.
+     */
+    void closeClient(const shared_ptr<Connection> &connection);
+
+    /**
+     * @brief Sends response bytes to a client, queueing what the socket does not take.
+     * @param connection The client.
+     * @param data Response frames.
+     */
+    void send(const shared_ptr<Connection> &connection, const string &data);
+
+public:
+    /**
+     * @brief Constructs a server over published datasets.
+     * @param publisher Publisher of the dataset to serve; must outlive the server.
+     */
+    explicit PostalServer(PostalDatasetPublisher &publisher);
+
+    /**
+     * @brief Closes all sockets and removes the socket file.
+     */
+    ~PostalServer();
+
+    /// @brief Servers own sockets and are not copyable.
+    PostalServer(const PostalServer &) = delete;
+
+    /// @brief Servers are not copy-assignable.
+    PostalServer &operator=(const PostalServer &) = delete;
+
+    /**
+     * @brief Binds and listens on a Unix domain socket.
+     *
+     * A stale socket file at @p path is replaced.
+     *
+     * @param path Filesystem path of the socket.
+     * @return false (after printing the reason) if the socket cannot be set up.
+     */
+    bool listen(const string &path);
+
+    /**
+     * @brief Serves lookups through a result cache of encoded records.
+     *
+     * The cache is not owned; it must outlive the server and be
+     * invalidated by whoever updates the records in place. Entries are
+     * tagged with the dataset version, so entries of a replaced dataset
+     * are never served.
+     *
+     * @param resultCache The cache, or nullptr to disable caching.
+     */
+    void setCache(ZipResultCache *resultCache);
+
+    /**
+     * @brief Runs the event loop until stop() is called.
+     * @param workerCount Number of worker threads; 0 uses one per hardware thread.
+     */
+    void run(int workerCount);
+
+    /**
+     * @brief Asks the event loop to exit. Safe to call from a signal handler.
+     */
+    void stop();
+
+    /**
+     * @brief Answers one request.
+     * @param request The decoded request.
+     * @param dataset Dataset to answer from.
+     * @param out Buffer receiving the response frame.
+     */
+    void answer(const ProtocolRequest &request, PostalDataset &dataset, string &out);
+
+    /**
+     * @brief Gets the number of requests answered so far.
+     * @return The request count.
+     */
+    unsigned long requestsServed() const;
+};
+
+#endif
@@ -0,0 +1,443 @@
+/**
+ * @file PostalSnapshot.cpp
+ * @brief Implements writing, mapping and querying of snapshot images.
+ */
+
+#include "PostalSnapshot.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "BufferedWriter.h"
+
+using namespace std;
+
+/// @brief First eight bytes of every image.
+static const char SNAPSHOT_MAGIC[8] = {'P', 'O', 'S', 'T', 'S', 'N', 'A', 'P'};
+
+/// @brief Alignment of every section.
+static const size_t SECTION_ALIGNMENT = 64;
+
+/// @brief Section positions in the header's section table.
+enum SnapshotSectionId
+{
+    SECTION_RECORDS,
+    SECTION_ZIPS,
+    SECTION_DIRECT,
+    SECTION_NAME_OFFSETS,
+    SECTION_NAME_BYTES,
+    SECTION_COUNT
+};
+
+/**
+ * @struct SnapshotSection
+ * @brief Location of one section in the image.
+ */
+struct SnapshotSection
+{
+    uint64_t offset; ///< Bytes from the start of the image
+    uint64_t bytes;  ///< Section length
+};
+
+/**
+ * @struct SnapshotHeader
+ * @brief The fixed header at offset 0 of an image.
+ */
+struct SnapshotHeader
+{
+    char magic[8];                            ///< SNAPSHOT_MAGIC
+    uint32_t version;                         ///< PostalSnapshot::FORMAT_VERSION
+    uint32_t headerBytes;                     ///< sizeof(SnapshotHeader)
+    uint64_t fileBytes;                       ///< Length of the whole image
+    uint32_t recordCount;                     ///< Records in the record section
+    uint32_t nameCount;                       ///< Overflow names
+    uint32_t zipDomain;                       ///< Entries in the direct table
+    uint32_t sectionCount;                    ///< SECTION_COUNT
+    SnapshotSection sections[SECTION_COUNT];  ///< Section table
+    uint64_t payloadChecksum;                 ///< checksum() of every byte after the header
+    uint64_t headerChecksum;                  ///< checksum() of the header with this field zero
+};
+
+static_assert(is_trivially_copyable<SnapshotHeader>::value, "the header is copied to and from the image");
+
+/**
+ * @brief FNV-1a over 64-bit words, then over the trailing bytes.
+ * @param data Bytes to hash.
+ * @param length Number of bytes.
+ * @return The checksum.
+ */
+static uint64_t checksum(const char *data, size_t length)
+{
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i = 0;
+    for (; i + 8 <= length; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < length; i++)
+    {
+        hash = (hash ^ (unsigned char)data[i]) * prime;
+    }
+    return hash;
+}
+
+/**
+ * @brief Gets the checksum of a header, excluding its own checksum field.
+ * @param header The header.
+ * @return The checksum.
+ */
+static uint64_t headerChecksumOf(SnapshotHeader header)
+{
+    header.headerChecksum = 0;
+    return checksum((const char *)&header, sizeof(header));
+}
+
+/**
+ * @brief Rounds a size up to the section alignment.
+ * @param bytes The size.
+ * @return The aligned size.
+ */
+static size_t alignSection(size_t bytes)
+{
+    return (bytes + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+/**
+ * @brief Makes a rename in a file's directory durable.
+ * @param path A file in the directory.
+ * @return false if the directory cannot be synced.
+ */
+static bool syncDirectory(const string &path)
+{
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+/**
+ * @brief Writes a snapshot image of a table.
+ * @param path Image file.
+ * @param table The records and overflow names.
+ * @param error Receives a message on failure.
+ * @return true if the image was written.
+ */
+bool PostalSnapshot::write(const string &path, const PackedPostalTable &table, string &error)
+{
+    const vector<PostalRecordPacked> &source = table.getRecords();
+    const vector<string> &overflow = table.getOverflow();
+    uint32_t n = (uint32_t)source.size();
+
+    // Records go in ZIP order; equal ZIPs keep their table order.
+    vector<uint32_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&source](uint32_t a, uint32_t b)
+                { return source[a].getZip() < source[b].getZip(); });
+
+    size_t nameBytes = 0;
+    for (const string &name : overflow)
+    {
+        nameBytes += name.size();
+    }
+
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = FORMAT_VERSION;
+    header.headerBytes = sizeof(SnapshotHeader);
+    header.recordCount = n;
+    header.nameCount = (uint32_t)overflow.size();
+    header.zipDomain = ZIP_DOMAIN;
+    header.sectionCount = SECTION_COUNT;
+    const size_t sectionBytes[SECTION_COUNT] = {
+        n * sizeof(PostalRecordPacked),
+        n * sizeof(int32_t),
+        ZIP_DOMAIN * sizeof(int32_t),
+        (overflow.size() + 1) * sizeof(uint32_t),
+        nameBytes,
+    };
+    size_t offset = alignSection(sizeof(SnapshotHeader));
+    for (int s = 0; s < SECTION_COUNT; s++)
+    {
+        header.sections[s].offset = offset;
+        header.sections[s].bytes = sectionBytes[s];
+        offset = alignSection(offset + sectionBytes[s]);
+    }
+    header.fileBytes = offset;
+
+    vector<char> image(offset, 0);
+    // The vector is only malloc-aligned, so records are copied in as bytes.
+    char *outRecords = image.data() + header.sections[SECTION_RECORDS].offset;
+    int32_t *outZips = (int32_t *)(image.data() + header.sections[SECTION_ZIPS].offset);
+    int32_t *outDirect = (int32_t *)(image.data() + header.sections[SECTION_DIRECT].offset);
+    uint32_t *outOffsets = (uint32_t *)(image.data() + header.sections[SECTION_NAME_OFFSETS].offset);
+    char *outNames = image.data() + header.sections[SECTION_NAME_BYTES].offset;
+
+    fill(outDirect, outDirect + ZIP_DOMAIN, NO_RECORD);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const PostalRecordPacked &record = source[order[i]];
+        memcpy(outRecords + (size_t)i * sizeof(record), &record, sizeof(record));
+        outZips[i] = record.getZip();
+        if (record.getZip() >= 0 && record.getZip() < ZIP_DOMAIN && outDirect[record.getZip()] == NO_RECORD)
+        {
+            outDirect[record.getZip()] = (int32_t)i;
+        }
+    }
+    uint32_t nameOffset = 0;
+    for (size_t i = 0; i < overflow.size(); i++)
+    {
+        outOffsets[i] = nameOffset;
+        memcpy(outNames + nameOffset, overflow[i].data(), overflow[i].size());
+        nameOffset += (uint32_t)overflow[i].size();
+    }
+    outOffsets[overflow.size()] = nameOffset;
+
+    header.payloadChecksum = checksum(image.data() + header.headerBytes, image.size() - header.headerBytes);
+    header.headerChecksum = headerChecksumOf(header);
+    memcpy(image.data(), &header, sizeof(header));
+
+    string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        error = "cannot create " + temporary + ": " + strerror(errno);
+        return false;
+    }
+    bool written;
+    {
+        BufferedWriter out(fd);
+        out.write(image.data(), image.size());
+        written = out.flush();
+    }
+    written = written && fsync(fd) == 0;
+    ::close(fd);
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        error = "cannot write " + path + ": " + strerror(errno);
+        unlink(temporary.c_str());
+        return false;
+    }
+    if (!syncDirectory(path))
+    {
+        error = "cannot sync the directory of " + path + ": " + strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Default constructor. Creates a closed snapshot.
+ */
+PostalSnapshot::PostalSnapshot()
+    : image(nullptr), imageBytes(0), records(nullptr), zips(nullptr), direct(nullptr), recordCount(0) {}
+
+/**
+ * @brief Destructor. Unmaps the image.
+ */
+PostalSnapshot::~PostalSnapshot()
+{
+    close();
+}
+
+/**
+ * @brief Maps an image and checks its header and section table.
+ * @param path Image file.
+ * @param error Receives a message on failure.
+ * @param verifyPayload Also check the payload checksum.
+ * @return true if the image is open.
+ */
+bool PostalSnapshot::open(const string &path, string &error, bool verifyPayload)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + path + ": " + strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(SnapshotHeader))
+    {
+        error = path + " is too short to be a snapshot";
+        ::close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        error = "cannot map " + path + ": " + strerror(errno);
+        return false;
+    }
+    image = (const char *)mapped;
+    imageBytes = info.st_size;
+
+    SnapshotHeader header;
+    memcpy(&header, image, sizeof(header));
+    const char *problem = nullptr;
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+    {
+        problem = "not a snapshot";
+    }
+    else if (header.version != FORMAT_VERSION)
+    {
+        problem = "unsupported snapshot version";
+    }
+    else if (header.headerBytes != sizeof(SnapshotHeader) || header.sectionCount != SECTION_COUNT ||
+             header.zipDomain != ZIP_DOMAIN || header.headerChecksum != headerChecksumOf(header))
+    {
+        problem = "corrupt snapshot header";
+    }
+    else if (header.fileBytes != imageBytes)
+    {
+        problem = "truncated snapshot";
+    }
+    else
+    {
+        const size_t expected[SECTION_COUNT] = {
+            (size_t)header.recordCount * sizeof(PostalRecordPacked),
+            (size_t)header.recordCount * sizeof(int32_t),
+            ZIP_DOMAIN * sizeof(int32_t),
+            ((size_t)header.nameCount + 1) * sizeof(uint32_t),
+            header.sections[SECTION_NAME_BYTES].bytes,
+        };
+        for (int s = 0; s < SECTION_COUNT && problem == nullptr; s++)
+        {
+            const SnapshotSection &section = header.sections[s];
+            if (section.bytes != expected[s] || section.offset % SECTION_ALIGNMENT != 0 ||
+                section.offset < header.headerBytes || section.offset > imageBytes ||
+                section.bytes > imageBytes - section.offset)
+            {
+                problem = "corrupt snapshot section table";
+            }
+        }
+    }
+    if (problem == nullptr)
+    {
+        const uint32_t *offsets = (const uint32_t *)(image + header.sections[SECTION_NAME_OFFSETS].offset);
+        for (uint32_t i = 0; i < header.nameCount && problem == nullptr; i++)
+        {
+            if (offsets[i] > offsets[i + 1])
+            {
+                problem = "corrupt snapshot name table";
+            }
+        }
+        if (offsets[header.nameCount] != header.sections[SECTION_NAME_BYTES].bytes)
+        {
+            problem = "corrupt snapshot name table";
+        }
+    }
+    if (problem != nullptr)
+    {
+        error = path + ": " + problem;
+        close();
+        return false;
+    }
+
+    records = (const PostalRecordPacked *)(image + header.sections[SECTION_RECORDS].offset);
+    zips = (const int32_t *)(image + header.sections[SECTION_ZIPS].offset);
+    direct = (const int32_t *)(image + header.sections[SECTION_DIRECT].offset);
+    names = NameTable((const uint32_t *)(image + header.sections[SECTION_NAME_OFFSETS].offset),
+                      image + header.sections[SECTION_NAME_BYTES].offset, header.nameCount);
+    recordCount = header.recordCount;
+    if (verifyPayload && !verify())
+    {
+        error = path + ": snapshot checksum mismatch";
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Unmaps the image, if one is open.
+ */
+void PostalSnapshot::close()
+{
+    if (image != nullptr)
+    {
+        munmap((void *)image, imageBytes);
+    }
+    image = nullptr;
+    imageBytes = 0;
+    records = nullptr;
+    zips = nullptr;
+    direct = nullptr;
+    names = NameTable();
+    recordCount = 0;
+}
+
+/**
+ * @brief Recomputes the payload checksum and compares it with the header.
+ * @return true if the payload is intact.
+ */
+bool PostalSnapshot::verify() const
+{
+    if (image == nullptr)
+    {
+        return false;
+    }
+    SnapshotHeader header;
+    memcpy(&header, image, sizeof(header));
+    return checksum(image + header.headerBytes, imageBytes - header.headerBytes) == header.payloadChecksum;
+}
+
+/**
+ * @brief Finds a record by ZIP through the direct table.
+ * @param zip ZIP code to search for.
+ * @return The record, or nullptr if the ZIP is absent or out of the domain.
+ */
+const PostalRecordPacked *PostalSnapshot::find(int zip) const
+{
+    if (zip < 0 || zip >= ZIP_DOMAIN)
+    {
+        return nullptr;
+    }
+    int32_t index = direct[zip];
+    return index >= 0 && (uint32_t)index < recordCount ? &records[index] : nullptr;
+}
+
+/**
+ * @brief Finds the first record whose ZIP is not less than a bound.
+ * @param zip The bound.
+ * @return The record position, or size() if every ZIP is smaller.
+ */
+size_t PostalSnapshot::lowerBound(int zip) const
+{
+    return lower_bound(zips, zips + recordCount, zip) - zips;
+}
+
+/**
+ * @brief Appends the records, in ZIP order, to a sequence set.
+ * @param bss The sequence set.
+ * @return Number of records added.
+ */
+size_t PostalSnapshot::loadBlockSequenceSet(BlockSequenceSetPostalCode &bss) const
+{
+    for (uint32_t i = 0; i < recordCount; i++)
+    {
+        const PostalRecordPacked &record = records[i];
+        bss.add(HeaderRecordPostalCodeItem(record.getRecordLength(), record.getZip(),
+                                           string(record.getPlace(names)), string(record.getState()),
+                                           string(record.getCounty(names)),
+                                           record.getLatitude(), record.getLongitude()));
+    }
+    return recordCount;
+}
@@ -0,0 +1,183 @@
+#ifndef POSTAL_SNAPSHOT
+#define POSTAL_SNAPSHOT
+
+/**
+ * @file PostalSnapshot.h
+ * @brief Declares a relocatable binary image of the loaded postal dataset.
+ *
+ * A snapshot holds everything the lookup tools build at startup in one
+ * file that is reopened with a single read-only mmap(). Nothing in it is a
+ * pointer: sections are addressed by file offset, so the image works at
+ * whatever address it is mapped and opening it costs the same for any
+ * dataset size.
+ *
+ * @code
+ * header     magic "POSTSNAP", format version, file size, record and name
+ *            counts, ZIP domain, the section table, a checksum of the
+ *            payload and a checksum of the header itself
+ * records    PostalRecordPacked[recordCount], sorted by ZIP (stable)
+ * zips       int32[recordCount], the ZIP column of the records
+ * direct     int32[ZIP_DOMAIN], record index per ZIP, NO_RECORD if absent
+ * nameOffsets uint32[nameCount + 1], start of each overflow name
+ * nameBytes  the overflow names back to back
+ * @endcode
+ *
+ * Every section starts on a 64-byte boundary, so the records stay one
+ * cache line each. Integers are in native byte order. The record array
+ * is the sequence set in ZIP order; the ZIP column takes the place of
+ * the B+ tree for ranges (binary search, then a sequential walk) and the
+ * direct table answers point lookups. The name sections hold the names
+ * that did not fit inline in a packed record.
+ *
+ * open() checks the header, its checksum and the section table, which is
+ * constant work; verify() also checksums the payload, which reads the
+ * whole file. Names are bounds-checked on every access, so even an
+ * unverified image cannot make a lookup read outside the mapping.
+ */
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "PostalRecordPacked.h"
+#include "BlockSequenceSetPostalCode.h"
+
+using namespace std;
+
+/**
+ * @class PostalSnapshot
+ * @brief Writes snapshot images and serves lookups from a mapped one.
+ */
+class PostalSnapshot
+{
+public:
+    static const uint32_t FORMAT_VERSION = 1; ///< Version written to and accepted from the header.
+    static const int ZIP_DOMAIN = 100000;     ///< Entries in the direct table.
+    static const int32_t NO_RECORD = -1;      ///< Direct-table entry of an absent ZIP.
+
+    /**
+     * @class NameTable
+     * @brief The overflow names of a mapped image, indexed like PackedPostalTable::getOverflow().
+     */
+    class NameTable
+    {
+    private:
+        const uint32_t *offsets; ///< count + 1 offsets into @c bytes
+        const char *bytes;       ///< Name bytes
+        size_t count;            ///< Number of names
+
+    public:
+        NameTable() : offsets(nullptr), bytes(nullptr), count(0) {}
+        NameTable(const uint32_t *nameOffsets, const char *nameBytes, size_t nameCount)
+            : offsets(nameOffsets), bytes(nameBytes), count(nameCount) {}
+
+        /// @brief Gets the number of names.
+        size_t size() const { return count; }
+
+        /// @brief Gets an overflow name, or an empty one if @p index is out of range.
+        string_view operator[](size_t index) const
+        {
+            if (index >= count)
+            {
+                return string_view();
+            }
+            return string_view(bytes + offsets[index], offsets[index + 1] - offsets[index]);
+        }
+    };
+
+    /**
+     * @brief Writes a snapshot image of a table.
+     *
+     * The image is written to "<path>.tmp", synced and renamed over
+     * @p path, so readers see either the old image or the new one.
+     *
+     * @param path Image file.
+     * @param table The records and overflow names.
+     * @param error Receives a message on failure.
+     * @return true if the image was written.
+     */
+    static bool write(const string &path, const PackedPostalTable &table, string &error);
+
+    /**
+     * @brief Default constructor. Creates a closed snapshot.
+     */
+    PostalSnapshot();
+
+    /**
+     * @brief Destructor. Unmaps the image.
+     */
+    ~PostalSnapshot();
+
+    PostalSnapshot(const PostalSnapshot &) = delete;
+    PostalSnapshot &operator=(const PostalSnapshot &) = delete;
+
+    /**
+     * @brief Maps an image and checks its header and section table.
+     *
+     * Callers that read every record anyway should pass @p verifyPayload
+     * so a damaged image is rejected before it is loaded.
+     *
+     * @param path Image file.
+     * @param error Receives a message on failure.
+     * @param verifyPayload Also check the payload checksum (see verify()).
+     * @return true if the image is open.
+     */
+    bool open(const string &path, string &error, bool verifyPayload = false);
+
+    /**
+     * @brief Unmaps the image, if one is open.
+     */
+    void close();
+
+    /**
+     * @brief Recomputes the payload checksum and compares it with the header.
+     * @return true if the payload is intact.
+     */
+    bool verify() const;
+
+    /// @brief Gets the number of records.
+    size_t size() const { return recordCount; }
+
+    /// @brief Gets the size of the mapped image in bytes.
+    size_t getImageBytes() const { return imageBytes; }
+
+    /// @brief Gets a record by position (ZIP order).
+    const PostalRecordPacked &operator[](size_t index) const { return records[index]; }
+
+    /// @brief Gets the ZIP of a record by position.
+    int getZip(size_t index) const { return zips[index]; }
+
+    /// @brief Gets the overflow names the records refer to.
+    const NameTable &getNames() const { return names; }
+
+    /**
+     * @brief Finds a record by ZIP through the direct table.
+     * @param zip ZIP code to search for.
+     * @return The record, or nullptr if the ZIP is absent or out of the domain.
+     */
+    const PostalRecordPacked *find(int zip) const;
+
+    /**
+     * @brief Finds the first record whose ZIP is not less than a bound.
+     * @param zip The bound.
+     * @return The record position, or size() if every ZIP is smaller.
+     */
+    size_t lowerBound(int zip) const;
+
+    /**
+     * @brief Appends the records, in ZIP order, to a sequence set.
+     * @param bss The sequence set.
+     * @return Number of records added.
+     */
+    size_t loadBlockSequenceSet(BlockSequenceSetPostalCode &bss) const;
+
+private:
+    const char *image;                 ///< Mapped image, nullptr when closed
+    size_t imageBytes;                 ///< Mapped length
+    const PostalRecordPacked *records; ///< Record section
+    const int32_t *zips;               ///< ZIP column
+    const int32_t *direct;             ///< Direct table
+    NameTable names;                   ///< Overflow names
+    uint32_t recordCount;              ///< Records in the image
+};
+
+#endif
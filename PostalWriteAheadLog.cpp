@@ -0,0 +1,447 @@
+/**
+ * @file PostalWriteAheadLog.cpp
+ * @brief Implements the append-only redo log with group commit.
+ */
+
+#include "PostalWriteAheadLog.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/// @brief First eight bytes of every log.
+static const char LOG_MAGIC[8] = {'P', 'O', 'S', 'T', 'W', 'A', 'L', '1'};
+
+/**
+ * @struct LogHeader
+ * @brief The fixed header of a log file.
+ */
+struct LogHeader
+{
+    char magic[8];          ///< LOG_MAGIC
+    uint32_t version;       ///< PostalWriteAheadLog::FORMAT_VERSION
+    uint32_t reserved;      ///< Zero
+    uint64_t checkpointLsn; ///< Last LSN contained in the checkpoint
+    uint64_t checksum;      ///< FNV-1a of the fields above
+};
+
+/**
+ * @struct RecordHeader
+ * @brief Precedes the payload of every record.
+ */
+struct RecordHeader
+{
+    uint64_t lsn;      ///< Log sequence number
+    uint32_t bytes;    ///< Payload bytes
+    uint32_t checksum; ///< FNV-1a of lsn, bytes and the payload
+};
+
+/**
+ * @brief Continues an FNV-1a hash over a byte range.
+ * @param hash Hash so far.
+ * @param data Bytes to hash.
+ * @param size Number of bytes.
+ * @return The updated hash.
+ */
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/// @brief FNV-1a offset basis.
+static const uint64_t FNV_BASIS = 14695981039346656037ULL;
+
+/**
+ * @brief Computes the checksum of a record.
+ * @param header The record header (its checksum field is ignored).
+ * @param payload The payload.
+ * @return The checksum.
+ */
+static uint32_t recordChecksum(const RecordHeader &header, const char *payload)
+{
+    uint64_t hash = fnv1a(FNV_BASIS, &header.lsn, sizeof(header.lsn));
+    hash = fnv1a(hash, &header.bytes, sizeof(header.bytes));
+    hash = fnv1a(hash, payload, header.bytes);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/**
+ * @brief Builds the header of a log.
+ * @param checkpointLsn Last LSN contained in the checkpoint.
+ * @return The header.
+ */
+static LogHeader makeHeader(uint64_t checkpointLsn)
+{
+    LogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOG_MAGIC, sizeof(header.magic));
+    header.version = PostalWriteAheadLog::FORMAT_VERSION;
+    header.checkpointLsn = checkpointLsn;
+    header.checksum = fnv1a(FNV_BASIS, &header, offsetof(LogHeader, checksum));
+    return header;
+}
+
+/**
+ * @brief Makes a rename or creation in a file's directory durable.
+ * @param path A file in the directory.
+ * @return false if the directory cannot be synced.
+ */
+static bool syncDirectory(const string &path)
+{
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+/**
+ * @brief Constructs a closed log.
+ * @param commitInterval Longest time a record waits for the fsync that makes it durable.
+ */
+PostalWriteAheadLog::PostalWriteAheadLog(chrono::microseconds commitInterval)
+    : fd(-1), interval(commitInterval), checkpointLsn(0), nextLsn(1), durableLsn(0), waiters(0),
+      flushing(false), stopping(false), failed(false), stats{0, 0, 0}
+{
+}
+
+/**
+ * @brief Destructor. Flushes and closes the log.
+ */
+PostalWriteAheadLog::~PostalWriteAheadLog()
+{
+    close();
+}
+
+/**
+ * @brief Writes a whole buffer to the log, retrying short writes.
+ * @param data Bytes to write.
+ * @param size Number of bytes.
+ * @return false on a write error.
+ */
+bool PostalWriteAheadLog::writeAll(const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+/**
+ * @brief Opens a log, creating it if missing, and replays its records.
+ * @param logPath The log file.
+ * @param replay Called with the LSN and payload of every record after the checkpoint.
+ * @param error Receives a message on failure.
+ * @return true if the log is open.
+ */
+bool PostalWriteAheadLog::open(const string &logPath, const function<void(uint64_t, const string &)> &replay,
+                               string &error)
+{
+    close();
+    path = logPath;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0)
+    {
+        error = "cannot open log " + path + ": " + strerror(errno);
+        close();
+        return false;
+    }
+
+    if (info.st_size == 0)
+    {
+        LogHeader header = makeHeader(0);
+        if (!writeAll((const char *)&header, sizeof(header)) || fdatasync(fd) != 0 || !syncDirectory(path))
+        {
+            error = "cannot create log " + path + ": " + strerror(errno);
+            close();
+            return false;
+        }
+        info.st_size = sizeof(header);
+    }
+
+    string contents(info.st_size, '\0');
+    LogHeader header;
+    if (pread(fd, &contents[0], contents.size(), 0) != (ssize_t)contents.size() ||
+        contents.size() < sizeof(header))
+    {
+        error = "cannot read log " + path;
+        close();
+        return false;
+    }
+    memcpy(&header, contents.data(), sizeof(header));
+    if (memcmp(header.magic, LOG_MAGIC, sizeof(header.magic)) != 0 || header.version != FORMAT_VERSION ||
+        header.checksum != fnv1a(FNV_BASIS, &header, offsetof(LogHeader, checksum)))
+    {
+        error = path + ": not a log of this version, or its header is corrupt";
+        close();
+        return false;
+    }
+    checkpointLsn = header.checkpointLsn;
+
+    // Replay up to the first record that is cut short, corrupt or out of sequence
+    size_t offset = sizeof(header);
+    uint64_t lastLsn = checkpointLsn;
+    string payload;
+    while (offset + sizeof(RecordHeader) <= contents.size())
+    {
+        RecordHeader record;
+        memcpy(&record, contents.data() + offset, sizeof(record));
+        const char *body = contents.data() + offset + sizeof(record);
+        if (record.bytes > contents.size() - offset - sizeof(record) || record.lsn <= lastLsn ||
+            record.checksum != recordChecksum(record, body))
+        {
+            break;
+        }
+        payload.assign(body, record.bytes);
+        replay(record.lsn, payload);
+        lastLsn = record.lsn;
+        offset += sizeof(record) + record.bytes;
+    }
+    if (offset < contents.size() && (ftruncate(fd, offset) != 0 || fdatasync(fd) != 0))
+    {
+        error = "cannot truncate the damaged tail of " + path + ": " + strerror(errno);
+        close();
+        return false;
+    }
+
+    nextLsn = lastLsn + 1;
+    durableLsn = lastLsn;
+    waiters = 0;
+    flushing = false;
+    stopping = false;
+    failed = false;
+    failure.clear();
+    pending.clear();
+    stats = Stats{0, 0, 0};
+    flusher = thread(&PostalWriteAheadLog::flushLoop, this);
+    return true;
+}
+
+/**
+ * @brief Flushes every record and closes the log.
+ */
+void PostalWriteAheadLog::close()
+{
+    if (flusher.joinable())
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wakeFlusher.notify_one();
+        flusher.join();
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+/**
+ * @brief Writes buffered records whenever someone waits for them.
+ *
+ * After a flush the next one starts no sooner than the commit interval
+ * later (unless the buffer fills up or the log closes), so records
+ * appended meanwhile share its fsync.
+ */
+void PostalWriteAheadLog::flushLoop()
+{
+    string writing;
+    auto lastFlush = chrono::steady_clock::now() - interval;
+    unique_lock<mutex> guard(lock);
+    while (true)
+    {
+        wakeFlusher.wait(guard, [this]
+                         { return stopping || (!pending.empty() && (waiters > 0 || pending.size() >= MAX_PENDING_BYTES)); });
+        if (!stopping && pending.size() < MAX_PENDING_BYTES)
+        {
+            wakeFlusher.wait_until(guard, lastFlush + interval, [this]
+                                   { return stopping || pending.size() >= MAX_PENDING_BYTES; });
+        }
+        if (pending.empty())
+        {
+            if (stopping)
+            {
+                break;
+            }
+            continue;
+        }
+
+        writing.clear();
+        writing.swap(pending);
+        uint64_t batchLsn = nextLsn - 1;
+        bool skip = failed;
+        flushing = true; // checkpoint() must not swap the file under this write
+        guard.unlock();
+        bool ok = !skip && writeAll(writing.data(), writing.size()) && fdatasync(fd) == 0;
+        int code = errno;
+        lastFlush = chrono::steady_clock::now();
+        guard.lock();
+        flushing = false;
+
+        if (ok)
+        {
+            durableLsn = batchLsn;
+            stats.bytes += writing.size();
+            stats.syncs++;
+        }
+        else if (!failed)
+        {
+            failed = true;
+            failure = "cannot write log " + path + ": " + strerror(code);
+        }
+        flushed.notify_all();
+    }
+}
+
+/**
+ * @brief Appends a record; it is durable once sync() returns for its LSN.
+ * @param payload The record.
+ * @return The record's LSN.
+ */
+uint64_t PostalWriteAheadLog::append(const string &payload)
+{
+    lock_guard<mutex> guard(lock);
+    RecordHeader record;
+    record.lsn = nextLsn++;
+    record.bytes = (uint32_t)payload.size();
+    record.checksum = recordChecksum(record, payload.data());
+    pending.append((const char *)&record, sizeof(record));
+    pending += payload;
+    stats.records++;
+    if (pending.size() >= MAX_PENDING_BYTES)
+    {
+        wakeFlusher.notify_one();
+    }
+    return record.lsn;
+}
+
+/**
+ * @brief Waits until a record and every record before it are on disk.
+ * @param lsn LSN returned by append().
+ * @return false if the log could not be written.
+ */
+bool PostalWriteAheadLog::sync(uint64_t lsn)
+{
+    unique_lock<mutex> guard(lock);
+    if (durableLsn >= lsn)
+    {
+        return true;
+    }
+    if (fd < 0)
+    {
+        return false;
+    }
+    waiters++;
+    wakeFlusher.notify_one();
+    flushed.wait(guard, [this, lsn]
+                 { return durableLsn >= lsn || failed; });
+    waiters--;
+    return durableLsn >= lsn;
+}
+
+/**
+ * @brief Restarts the log after a checkpoint covering every appended record.
+ * @param error Receives a message on failure.
+ * @return true if the log was restarted.
+ */
+bool PostalWriteAheadLog::checkpoint(string &error)
+{
+    // Drain the buffer and any flush in progress; from then on the lock
+    // keeps appends and the flusher away from the file until it is replaced.
+    unique_lock<mutex> guard(lock);
+    if (fd < 0)
+    {
+        error = "log is not open";
+        return false;
+    }
+    waiters++;
+    wakeFlusher.notify_one();
+    flushed.wait(guard, [this]
+                 { return (pending.empty() && !flushing) || failed; });
+    waiters--;
+    if (failed)
+    {
+        error = failure;
+        return false;
+    }
+
+    uint64_t covered = nextLsn - 1;
+    string temporary = path + ".tmp";
+    int fresh = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    LogHeader header = makeHeader(covered);
+    bool ok = fresh >= 0 && write(fresh, &header, sizeof(header)) == (ssize_t)sizeof(header) &&
+              fdatasync(fresh) == 0 && rename(temporary.c_str(), path.c_str()) == 0 && syncDirectory(path);
+    if (!ok)
+    {
+        error = "cannot restart log " + path + ": " + strerror(errno);
+        if (fresh >= 0)
+        {
+            ::close(fresh);
+        }
+        unlink(temporary.c_str());
+        return false;
+    }
+    ::close(fd);
+    fd = fresh;
+    checkpointLsn = covered;
+    return true;
+}
+
+/**
+ * @brief Gets the LSN covered by the last checkpoint.
+ * @return The checkpoint LSN.
+ */
+uint64_t PostalWriteAheadLog::getCheckpointLsn() const
+{
+    lock_guard<mutex> guard(lock);
+    return checkpointLsn;
+}
+
+/**
+ * @brief Gets the LSN of the last appended record.
+ * @return The LSN, or the checkpoint LSN if nothing was appended since.
+ */
+uint64_t PostalWriteAheadLog::getLastLsn() const
+{
+    lock_guard<mutex> guard(lock);
+    return nextLsn - 1;
+}
+
+/**
+ * @brief Gets the counters since open().
+ * @return The counters.
+ */
+PostalWriteAheadLog::Stats PostalWriteAheadLog::getStats() const
+{
+    lock_guard<mutex> guard(lock);
+    return stats;
+}
@@ -0,0 +1,154 @@
+#ifndef POSTAL_WRITE_AHEAD_LOG
+#define POSTAL_WRITE_AHEAD_LOG
+
+/**
+ * @file PostalWriteAheadLog.h
+ * @brief Declares an append-only redo log with group commit.
+ *
+ * Every change to the postal data is appended to the log as one record
+ * with a log sequence number (LSN) before it is acknowledged. Records are
+ * buffered and written by a flusher thread, which issues one fdatasync()
+ * for every record appended since its last flush: all threads waiting in
+ * sync() during a commit interval share that fsync. With an interval of
+ * zero (the default) a flush starts as soon as somebody waits, and the
+ * records appended while it runs share the next one; a longer interval
+ * trades commit latency for fewer fsyncs.
+ *
+ * @code
+ * header:  magic "POSTWAL1", version, checkpoint LSN, checksum
+ * record:  LSN, payload bytes, checksum, payload
+ * @endcode
+ * A checkpoint (see DurablePostalStore) saves the data elsewhere and then
+ * restarts the log with the LSN it covers, so recovery only replays the
+ * records appended since. A record cut short by a crash fails its
+ * checksum; open() drops it and everything after it.
+ */
+
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+
+using namespace std;
+
+/**
+ * @class PostalWriteAheadLog
+ * @brief Append-only log file with batched fsyncs.
+ */
+class PostalWriteAheadLog
+{
+public:
+    static const uint32_t FORMAT_VERSION = 1;           ///< Version written to and accepted from logs.
+    static const size_t MAX_PENDING_BYTES = 1 << 20;   ///< Buffered bytes that start a flush early.
+
+    /**
+     * @struct Stats
+     * @brief Counters since open().
+     */
+    struct Stats
+    {
+        uint64_t records; ///< Records appended.
+        uint64_t bytes;   ///< Bytes written, headers included.
+        uint64_t syncs;   ///< fdatasync() calls by the flusher.
+    };
+
+private:
+    string path;                     ///< The log file
+    int fd;                          ///< Open log, -1 when closed
+    chrono::microseconds interval;   ///< Commit interval
+    uint64_t checkpointLsn;          ///< Every change up to this LSN is in the checkpoint
+    mutable mutex lock;              ///< Guards every member below.
+    condition_variable wakeFlusher;  ///< Signalled when records wait to be flushed.
+    condition_variable flushed;      ///< Signalled after every flush.
+    string pending;                  ///< Encoded records not yet written
+    uint64_t nextLsn;                ///< LSN of the next appended record
+    uint64_t durableLsn;             ///< Highest LSN known to be on disk
+    size_t waiters;                  ///< Threads blocked in sync() or checkpoint()
+    bool flushing;                   ///< The flusher is writing a batch outside the lock
+    bool stopping;                   ///< Set by close() to end the flusher
+    bool failed;                     ///< A write or fsync failed; the log is unusable
+    string failure;                  ///< Message of the failed write
+    Stats stats;                     ///< Counters
+    thread flusher;                  ///< Runs flushLoop()
+
+    void flushLoop();
+    bool writeAll(const char *data, size_t size);
+
+public:
+    /**
+     * @brief Constructs a closed log.
+     * @param commitInterval Longest time a record waits for the fsync that makes it durable.
+     */
+    explicit PostalWriteAheadLog(chrono::microseconds commitInterval = chrono::microseconds(0));
+
+    /**
+     * @brief Destructor. Flushes and closes the log.
+     */
+    ~PostalWriteAheadLog();
+
+    PostalWriteAheadLog(const PostalWriteAheadLog &) = delete;
+    PostalWriteAheadLog &operator=(const PostalWriteAheadLog &) = delete;
+
+    /**
+     * @brief Opens a log, creating it if missing, and replays its records.
+     *
+     * Records after the first incomplete or corrupt one are dropped and
+     * the file is truncated there, so new records follow the last good one.
+     *
+     * @param logPath The log file.
+     * @param replay Called with the LSN and payload of every record after the checkpoint.
+     * @param error Receives a message on failure.
+     * @return true if the log is open.
+     */
+    bool open(const string &logPath, const function<void(uint64_t, const string &)> &replay, string &error);
+
+    /**
+     * @brief Flushes every record and closes the log.
+     */
+    void close();
+
+    /**
+     * @brief Appends a record; it is durable once sync() returns for its LSN.
+     * @param payload The record.
+     * @return The record's LSN.
+     */
+    uint64_t append(const string &payload);
+
+    /**
+     * @brief Waits until a record and every record before it are on disk.
+     * @param lsn LSN returned by append().
+     * @return false if the log could not be written.
+     */
+    bool sync(uint64_t lsn);
+
+    /**
+     * @brief Restarts the log after a checkpoint covering every appended record.
+     *
+     * Flushes the buffered records, waits for a flush in progress and
+     * then, holding the log's lock so appends and the flusher wait, writes
+     * a new, empty log whose header holds the last appended LSN and
+     * renames it over the old one. The caller's checkpoint must include
+     * every record appended before the call.
+     *
+     * @param error Receives a message on failure.
+     * @return true if the log was restarted.
+     */
+    bool checkpoint(string &error);
+
+    /// @brief Gets the LSN covered by the last checkpoint.
+    uint64_t getCheckpointLsn() const;
+
+    /// @brief Gets the LSN of the last appended record.
+    uint64_t getLastLsn() const;
+
+    /// @brief Gets the counters since open().
+    Stats getStats() const;
+
+    /// @brief Gets the commit interval.
+    chrono::microseconds getCommitInterval() const { return interval; }
+};
+
+#endif
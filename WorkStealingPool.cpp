@@ -0,0 +1,286 @@
+/**
+ * @file WorkStealingPool.cpp
+ * @brief Implements the work-stealing thread pool.
+ */
+
+#include "WorkStealingPool.h"
+#include <algorithm>
+
+using namespace std;
+
+static thread_local const WorkStealingPool *workerPool = nullptr; ///< Pool the calling thread works for
+static thread_local int workerIndex = -1;                         ///< Index of the calling worker
+
+/**
+ * @brief Starts the workers.
+ * @param threadCount Number of workers; 0 uses one per hardware thread.
+ */
+WorkStealingPool::WorkStealingPool(int threadCount)
+    : queuedTasks(0), sleepingWorkers(0), stopping(false), nextQueue(0), executed(0), stolen(0)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = max(1u, thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threadCount; i++)
+    {
+        queues.emplace_back(new WorkerQueue());
+    }
+    for (int i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+/**
+ * @brief Runs the tasks still queued, then stops and joins the workers.
+ */
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        lock_guard<mutex> guard(sleepLock);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+/**
+ * @brief Gets the process-wide pool, sized to the hardware, created on first use.
+ * @return The shared pool.
+ */
+WorkStealingPool &WorkStealingPool::shared()
+{
+    static WorkStealingPool pool;
+    return pool;
+}
+
+/**
+ * @brief Gets the index of the calling worker of this pool.
+ * @return The worker index, or -1 for threads outside the pool.
+ */
+int WorkStealingPool::currentWorker() const
+{
+    return workerPool == this ? workerIndex : -1;
+}
+
+/**
+ * @brief Queues a task on the caller's deque, or round-robin from outside the pool.
+ * @param task The task.
+ */
+void WorkStealingPool::push(Task task)
+{
+    int self = currentWorker();
+    unsigned target = self >= 0 ? self : nextQueue.fetch_add(1, memory_order_relaxed) % queues.size();
+    {
+        lock_guard<mutex> guard(queues[target]->lock);
+        queues[target]->tasks.push_back(move(task));
+    }
+
+    // queuedTasks and sleepingWorkers are sequentially consistent, so
+    // either this thread sees the sleeper or the sleeper sees the task.
+    queuedTasks++;
+    if (sleepingWorkers > 0)
+    {
+        {
+            lock_guard<mutex> guard(sleepLock);
+        }
+        workAvailable.notify_one();
+    }
+}
+
+/**
+ * @brief Takes a task from the caller's own deque, else steals one.
+ * @param self Index of the calling worker, or -1.
+ * @param task Receives the task.
+ * @return false if every deque is empty.
+ */
+bool WorkStealingPool::take(int self, Task &task)
+{
+    if (queuedTasks == 0)
+    {
+        return false;
+    }
+    if (self >= 0)
+    {
+        WorkerQueue &own = *queues[self];
+        lock_guard<mutex> guard(own.lock);
+        if (!own.tasks.empty())
+        {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            queuedTasks--;
+            return true;
+        }
+    }
+
+    size_t count = queues.size();
+    size_t start = self >= 0 ? self + 1 : nextQueue.load(memory_order_relaxed);
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t victim = (start + i) % count;
+        if ((int)victim == self)
+        {
+            continue;
+        }
+        WorkerQueue &other = *queues[victim];
+        lock_guard<mutex> guard(other.lock);
+        if (!other.tasks.empty())
+        {
+            task = move(other.tasks.front());
+            other.tasks.pop_front();
+            queuedTasks--;
+            if (self >= 0)
+            {
+                stolen.fetch_add(1, memory_order_relaxed);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Worker thread body.
+ * @param index Index of the worker.
+ */
+void WorkStealingPool::workerLoop(int index)
+{
+    workerPool = this;
+    workerIndex = index;
+    Task task;
+    while (true)
+    {
+        if (take(index, task))
+        {
+            task();
+            task = nullptr;
+            executed.fetch_add(1, memory_order_relaxed);
+            continue;
+        }
+
+        unique_lock<mutex> guard(sleepLock);
+        sleepingWorkers++;
+        workAvailable.wait(guard, [this]
+                           { return stopping || queuedTasks > 0; });
+        sleepingWorkers--;
+        if (stopping && queuedTasks == 0)
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Runs one queued task on the calling thread, if any.
+ * @return false if no task was available.
+ */
+bool WorkStealingPool::runPendingTask()
+{
+    Task task;
+    if (!take(currentWorker(), task))
+    {
+        return false;
+    }
+    task();
+    executed.fetch_add(1, memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Runs a range of a parallelFor(), splitting off halves for thieves.
+ *
+ * The upper half is queued and the lower half kept until the range is no
+ * larger than the grain, so an idle worker steals the biggest pieces first.
+ *
+ * @param job The parallelFor() state.
+ * @param begin First index.
+ * @param end One past the last index.
+ */
+void WorkStealingPool::runRange(RangeJob *job, size_t begin, size_t end)
+{
+    while (end - begin > job->grain)
+    {
+        size_t mid = begin + (end - begin) / 2;
+        push([this, job, mid, end]()
+             { runRange(job, mid, end); });
+        end = mid;
+    }
+    try
+    {
+        (*job->body)(begin, end);
+    }
+    catch (...)
+    {
+        lock_guard<mutex> guard(job->errorLock);
+        if (!job->error)
+        {
+            job->error = current_exception();
+        }
+    }
+    // The caller may return as soon as this reaches zero; job is not
+    // touched afterwards.
+    job->remaining.fetch_sub(end - begin, memory_order_acq_rel);
+}
+
+/**
+ * @brief Runs @p body over [begin, end) split into ranges of at most @p grain indices.
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param grain Largest range passed to one body call; 0 picks about eight ranges per worker.
+ * @param body Called with each range [begin, end).
+ */
+void WorkStealingPool::parallelFor(size_t begin, size_t end, size_t grain, const RangeBody &body)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+    RangeJob job;
+    job.body = &body;
+    job.grain = grain > 0 ? grain : max((size_t)1, (end - begin) / (8 * queues.size()));
+    job.remaining = end - begin;
+
+    runRange(&job, begin, end);
+    while (job.remaining.load(memory_order_acquire) > 0)
+    {
+        if (!runPendingTask())
+        {
+            this_thread::yield();
+        }
+    }
+    if (job.error)
+    {
+        rethrow_exception(job.error);
+    }
+}
+
+/**
+ * @brief Gets the number of workers.
+ * @return The worker count.
+ */
+size_t WorkStealingPool::size() const
+{
+    return queues.size();
+}
+
+/**
+ * @brief Gets the number of tasks run so far.
+ * @return The task count.
+ */
+unsigned long WorkStealingPool::tasksExecuted() const
+{
+    return executed.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of tasks taken from another worker's deque.
+ * @return The steal count.
+ */
+unsigned long WorkStealingPool::steals() const
+{
+    return stolen.load(memory_order_relaxed);
+}
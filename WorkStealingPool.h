@@ -0,0 +1,290 @@
+#ifndef WORK_STEALING_POOL
+#define WORK_STEALING_POOL
+
+/**
+ * @file WorkStealingPool.h
+ * @brief Declares the work-stealing thread pool shared by the parallel code paths.
+ *
+ * Every worker owns a deque of tasks. A worker pushes and pops at the back
+ * of its own deque (newest first, which keeps recursively split work
+ * cache-warm) and, when it runs dry, steals from the front of another
+ * worker's deque (oldest first, i.e. the largest pieces of split work).
+ * Threads outside the pool hand tasks to the workers round-robin.
+ *
+ * A thread that waits for pool work (parallelFor(), parallelReduce(),
+ * waitFor()) runs pending tasks while it waits, so pool tasks may
+ * themselves fork and join without tying up workers or deadlocking.
+ */
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <future>
+#include <functional>
+#include <condition_variable>
+
+using namespace std;
+
+/**
+ * @class WorkStealingPool
+ * @brief Fixed-size thread pool with per-worker deques and task stealing.
+ */
+class WorkStealingPool
+{
+public:
+    /// @brief Unit of work run by the pool.
+    typedef function<void()> Task;
+
+    /// @brief Loop body of parallelFor(): processes indices [begin, end).
+    typedef function<void(size_t, size_t)> RangeBody;
+
+private:
+    /**
+     * @struct WorkerQueue
+     * @brief Task deque of one worker.
+     */
+    struct WorkerQueue
+    {
+        mutex lock;        ///< Guards tasks.
+        deque<Task> tasks; ///< Owner uses the back, thieves the front.
+    };
+
+    /**
+     * @struct RangeJob
+     * @brief Shared state of one parallelFor() call.
+     */
+    struct RangeJob
+    {
+        const RangeBody *body;    ///< Loop body.
+        size_t grain;             ///< Largest range run without splitting further.
+        atomic<size_t> remaining; ///< Indices not yet processed.
+        mutex errorLock;          ///< Guards error.
+        exception_ptr error;      ///< First exception thrown by the body.
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues; ///< One deque per worker.
+    vector<thread> workers;                 ///< Worker threads.
+
+    mutex sleepLock;                  ///< Guards sleeping transitions.
+    condition_variable workAvailable; ///< Signalled when a task is pushed or on shutdown.
+    atomic<size_t> queuedTasks;       ///< Tasks sitting in any deque.
+    atomic<int> sleepingWorkers;      ///< Workers blocked on workAvailable.
+    atomic<bool> stopping;            ///< Set when workers should exit.
+    atomic<unsigned> nextQueue;       ///< Round-robin target for outside submissions.
+
+    atomic<unsigned long> executed; ///< Tasks run so far.
+    atomic<unsigned long> stolen;   ///< Tasks taken from another worker's deque.
+
+    /**
+     * @brief Gets the index of the calling worker of this pool.
+     * @return The worker index, or -1 for threads outside the pool.
+     */
+    int currentWorker() const;
+
+    /**
+     * @brief Queues a task on the caller's deque, or round-robin from outside the pool.
+     * @param task The task.
+     */
+    void push(Task task);
+
+    /**
+     * @brief Takes a task from the caller's own deque, else steals one.
+     * @param self Index of the calling worker, or -1.
+     * @param task Receives the task.
+     * @return false if every deque is empty.
+     */
+    bool take(int self, Task &task);
+
+    /**
+     * @brief Worker thread body.
+     * @param index Index of the worker.
+     */
+    void workerLoop(int index);
+
+    /**
+     * @brief Runs a range of a parallelFor(), splitting off halves for thieves.
+     * @param job The parallelFor() state.
+     * @param begin First index.
+     * @param end One past the last index.
+     */
+    void runRange(RangeJob *job, size_t begin, size_t end);
+
+public:
+    /**
+     * @brief Starts the workers.
+     * @param threadCount Number of workers; 0 uses one per hardware thread.
+     */
+    explicit WorkStealingPool(int threadCount = 0);
+
+    /**
+     * @brief Runs the tasks still queued, then stops and joins the workers.
+     */
+    ~WorkStealingPool();
+
+    /// @brief Pools own threads and are not copyable.
+    WorkStealingPool(const WorkStealingPool &) = delete;
+
+    /// @brief Pools are not copy-assignable.
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    /**
+     * @brief Gets the process-wide pool, sized to the hardware, created on first use.
+     * @return The shared pool.
+     */
+    static WorkStealingPool &shared();
+
+    /**
+     * @brief Queues a callable and returns a future for its result.
+     *
+     * Exceptions thrown by the callable are delivered through the future.
+     * Pool tasks that wait for the future should use waitFor() rather than
+     * future::get(), so the worker keeps running tasks meanwhile.
+     *
+     * @param task The callable, taking no arguments.
+     * @return Future for the callable's result.
+     */
+    template <typename F>
+    auto submit(F task) -> future<decltype(task())>;
+
+    /**
+     * @brief Waits for a future, running pending pool tasks while it is not ready.
+     * @param result The future.
+     * @return The future's value (rethrows its exception).
+     */
+    template <typename T>
+    T waitFor(future<T> &result);
+
+    /**
+     * @brief Runs @p body over [begin, end) split into ranges of at most @p grain indices.
+     *
+     * The calling thread takes part. Blocks until every index has been
+     * processed; the first exception thrown by the body is rethrown.
+     *
+     * @param begin First index.
+     * @param end One past the last index.
+     * @param grain Largest range passed to one body call; 0 picks about eight ranges per worker.
+     * @param body Called with each range [begin, end).
+     */
+    void parallelFor(size_t begin, size_t end, size_t grain, const RangeBody &body);
+
+    /**
+     * @brief Maps fixed ranges of [begin, end) in parallel and folds the results in order.
+     *
+     * The range is cut into pieces of @p grain indices; @p map turns each
+     * piece into a partial result, and the partials are combined left to
+     * right, so the result does not depend on scheduling.
+     *
+     * @param begin First index.
+     * @param end One past the last index.
+     * @param grain Indices per piece; 0 picks about eight pieces per worker.
+     * @param identity Result of an empty range.
+     * @param map Called as map(begin, end), returns the partial result of a piece.
+     * @param combine Called as combine(T &accumulated, T &partial).
+     * @return The combined result.
+     */
+    template <typename T, typename Map, typename Combine>
+    T parallelReduce(size_t begin, size_t end, size_t grain, T identity, Map map, Combine combine);
+
+    /**
+     * @brief Runs one queued task on the calling thread, if any.
+     * @return false if no task was available.
+     */
+    bool runPendingTask();
+
+    /**
+     * @brief Gets the number of workers.
+     * @return The worker count.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Gets the number of tasks run so far.
+     * @return The task count.
+     */
+    unsigned long tasksExecuted() const;
+
+    /**
+     * @brief Gets the number of tasks taken from another worker's deque.
+     * @return The steal count.
+     */
+    unsigned long steals() const;
+};
+
+/**
+ * @brief Queues a callable and returns a future for its result.
+ * @param task The callable, taking no arguments.
+ * @return Future for the callable's result.
+ */
+template <typename F>
+auto WorkStealingPool::submit(F task) -> future<decltype(task())>
+{
+    typedef decltype(task()) Result;
+    auto packaged = make_shared<packaged_task<Result()>>(move(task));
+    future<Result> result = packaged->get_future();
+    push([packaged]()
+         { (*packaged)(); });
+    return result;
+}
+
+/**
+ * @brief Waits for a future, running pending pool tasks while it is not ready.
+ * @param result The future.
+ * @return The future's value (rethrows its exception).
+ */
+template <typename T>
+T WorkStealingPool::waitFor(future<T> &result)
+{
+    while (result.wait_for(chrono::seconds(0)) != future_status::ready)
+    {
+        if (!runPendingTask())
+        {
+            this_thread::yield();
+        }
+    }
+    return result.get();
+}
+
+/**
+ * @brief Maps fixed ranges of [begin, end) in parallel and folds the results in order.
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param grain Indices per piece; 0 picks about eight pieces per worker.
+ * @param identity Result of an empty range.
+ * @param map Called as map(begin, end), returns the partial result of a piece.
+ * @param combine Called as combine(T &accumulated, T &partial).
+ * @return The combined result.
+ */
+template <typename T, typename Map, typename Combine>
+T WorkStealingPool::parallelReduce(size_t begin, size_t end, size_t grain, T identity, Map map,
+                                   Combine combine)
+{
+    if (begin >= end)
+    {
+        return identity;
+    }
+    if (grain == 0)
+    {
+        grain = (end - begin + 8 * size() - 1) / (8 * size());
+    }
+    size_t pieces = (end - begin + grain - 1) / grain;
+    vector<T> partials(pieces, identity);
+    parallelFor(0, pieces, 1, [&](size_t first, size_t last)
+                {
+        for (size_t piece = first; piece < last; piece++)
+        {
+            size_t from = begin + piece * grain;
+            partials[piece] = map(from, end - from < grain ? end : from + grain);
+        } });
+
+    T result = move(identity);
+    for (T &partial : partials)
+    {
+        combine(result, partial);
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef ZIP_INDEX
+#define ZIP_INDEX
+
+/**
+ * @file ZipIndex.h
+ * @brief Declares the common lookup interface shared by all ZIP index engines.
+ *
+ * The driver and the benchmarks talk to every ZIP index (the dynamic
+ * BPlusTree, the static Eytzinger index, ...) through this interface so
+ * that engines can be swapped without touching the lookup loop.
+ */
+
+#include <string>
+#include <cstddef>
+#include "B+tree.cpp"
+
+using namespace std;
+
+/**
+ * @class ZipIndex
+ * @brief Abstract point-lookup interface over a set of ZIP codes.
+ */
+class ZipIndex
+{
+public:
+    /**
+     * @brief Virtual destructor so engines can be owned through the interface.
+     */
+    virtual ~ZipIndex() {}
+
+    /**
+     * @brief Checks whether a ZIP code is present in the index.
+     * @param zip ZIP code to search for.
+     * @return true if the ZIP is indexed, false otherwise.
+     */
+    virtual bool search(int zip) = 0;
+
+    /**
+     * @brief Checks a batch of ZIP codes.
+     *
+     * The default implementation calls search() once per ZIP; engines that
+     * can overlap the memory accesses of independent lookups override it.
+     *
+     * @param zips ZIP codes to search for.
+     * @param count Number of ZIP codes.
+     * @param found Receives one result per ZIP.
+     */
+    virtual void searchBatch(const int *zips, size_t count, bool *found)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            found[i] = search(zips[i]);
+        }
+    }
+
+    /**
+     * @brief Gets a short human-readable name of the engine.
+     * @return The engine name (e.g. "B+ tree").
+     */
+    virtual string name() const = 0;
+
+    /**
+     * @brief Gets the heap and object bytes used by the engine.
+     * @return The approximate memory footprint in bytes.
+     */
+    virtual size_t memoryUsage() const = 0;
+};
+
+/**
+ * @class BPlusTreeZipIndex
+ * @brief Adapts an existing BPlusTree<int> to the ZipIndex interface.
+ *
+ * The adapter does not own the tree; the tree must outlive the adapter.
+ */
+class BPlusTreeZipIndex : public ZipIndex
+{
+private:
+    BPlusTree<int> &tree; ///< The wrapped dynamic B+ tree.
+
+public:
+    /**
+     * @brief Constructs an adapter around a tree.
+     * @param indexTree The B+ tree holding the ZIP keys.
+     */
+    BPlusTreeZipIndex(BPlusTree<int> &indexTree) : tree(indexTree) {}
+
+    /**
+     * @brief Searches the wrapped B+ tree.
+     * @param zip ZIP code to search for.
+     * @return true if the ZIP is in the tree.
+     */
+    bool search(int zip) { return tree.search(zip); }
+
+    /**
+     * @brief Gets the engine name.
+     * @return "B+ tree".
+     */
+    string name() const { return "B+ tree"; }
+
+    /**
+     * @brief Gets the bytes used by all tree nodes.
+     * @return The tree's memory footprint in bytes.
+     */
+    size_t memoryUsage() const { return sizeof(tree) + tree.memoryUsage().totalBytes(); }
+};
+
+#endif
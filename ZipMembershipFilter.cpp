@@ -0,0 +1,189 @@
+/**
+ * @file ZipMembershipFilter.cpp
+ * @brief Implements the ZIP membership filter and the blocked Bloom filter.
+ */
+
+#include "ZipMembershipFilter.h"
+#include <cmath>
+
+using namespace std;
+
+/**
+ * @brief Mixes a key into a well-distributed 64-bit hash (splitmix64 finalizer).
+ * @param key The key to hash.
+ * @return The hash value.
+ */
+uint64_t BlockedBloomFilter::hash(uint64_t key)
+{
+    key += 0x9E3779B97F4A7C15ULL;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+/**
+ * @brief Constructs a filter sized for an expected number of keys.
+ *
+ * The bit count is rounded up to whole 512-bit blocks; at least one block
+ * is always allocated so an empty filter can still be queried.
+ *
+ * @param expectedKeys Number of keys the filter is sized for.
+ * @param bitsPerKey Filter bits per expected key (10 gives ~1% FPR).
+ */
+BlockedBloomFilter::BlockedBloomFilter(size_t expectedKeys, int bitsPerKey)
+    : keyCount(0)
+{
+    uint64_t bits = (uint64_t)expectedKeys * bitsPerKey;
+    blockCount = (bits + 511) / 512;
+    if (blockCount == 0)
+    {
+        blockCount = 1;
+    }
+    words.assign(blockCount * 8, 0);
+}
+
+/**
+ * @brief Adds a key to the filter.
+ *
+ * The upper half of the hash selects the block; a second hash drives the
+ * PROBES bit positions inside that block by double hashing.
+ *
+ * @param key The key to add.
+ */
+void BlockedBloomFilter::add(uint64_t key)
+{
+    uint64_t h1 = hash(key);
+    uint64_t h2 = hash(h1) | 1;
+    uint64_t *block = &words[((h1 >> 32) * blockCount >> 32) * 8];
+
+    for (int i = 0; i < PROBES; i++)
+    {
+        uint64_t bit = (h1 + i * h2) & 511;
+        block[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+    keyCount++;
+}
+
+/**
+ * @brief Tests whether a key may be in the filter.
+ * @param key The key to test.
+ * @return false if the key is definitely absent.
+ */
+bool BlockedBloomFilter::mayContain(uint64_t key) const
+{
+    uint64_t h1 = hash(key);
+    uint64_t h2 = hash(h1) | 1;
+    const uint64_t *block = &words[((h1 >> 32) * blockCount >> 32) * 8];
+
+    for (int i = 0; i < PROBES; i++)
+    {
+        uint64_t bit = (h1 + i * h2) & 511;
+        if (!((block[bit >> 6] >> (bit & 63)) & 1))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Estimates the false-positive rate from the current bit density.
+ *
+ * An absent key passes only if all of its probes hit set bits, so the rate
+ * is approximately (fraction of bits set)^PROBES.
+ *
+ * @return The probability that an absent key passes the filter.
+ */
+double BlockedBloomFilter::expectedFalsePositiveRate() const
+{
+    uint64_t setBits = 0;
+    for (uint64_t word : words)
+    {
+        setBits += __builtin_popcountll(word);
+    }
+    double fill = (double)setBits / (words.size() * 64);
+    return pow(fill, PROBES);
+}
+
+/**
+ * @brief Gets the bytes used by the filter bits.
+ * @return The memory footprint in bytes.
+ */
+size_t BlockedBloomFilter::memoryUsage() const
+{
+    return sizeof(*this) + words.capacity() * sizeof(uint64_t);
+}
+
+/**
+ * @brief Gets the number of keys added.
+ * @return The key count.
+ */
+size_t BlockedBloomFilter::size() const
+{
+    return keyCount;
+}
+
+/**
+ * @brief Constructs a filter.
+ * @param expectedWideKeys Number of keys outside 0..99999 to size the Bloom filter for.
+ * @param bitsPerKey Bloom filter bits per expected wide key.
+ */
+ZipMembershipFilter::ZipMembershipFilter(size_t expectedWideKeys, int bitsPerKey)
+    : bitmap((ZIP_DOMAIN + 63) / 64, 0), wideKeys(expectedWideKeys, bitsPerKey), zipCount(0)
+{
+}
+
+/**
+ * @brief Adds a key to the filter.
+ * @param key A 5-digit ZIP or a wider key.
+ */
+void ZipMembershipFilter::add(int64_t key)
+{
+    if (key >= 0 && key < ZIP_DOMAIN)
+    {
+        bitmap[key >> 6] |= uint64_t(1) << (key & 63);
+        zipCount++;
+    }
+    else
+    {
+        wideKeys.add((uint64_t)key);
+    }
+}
+
+/**
+ * @brief Tests whether a key may be present.
+ *
+ * 5-digit keys are answered exactly from the bitmap. Wider keys are
+ * rejected outright when none were ever added, and otherwise go to the
+ * Bloom filter.
+ *
+ * @param key A 5-digit ZIP or a wider key.
+ * @return false if the key is definitely absent.
+ */
+bool ZipMembershipFilter::mayContain(int64_t key) const
+{
+    if (key >= 0 && key < ZIP_DOMAIN)
+    {
+        return (bitmap[key >> 6] >> (key & 63)) & 1;
+    }
+    return wideKeys.size() != 0 && wideKeys.mayContain((uint64_t)key);
+}
+
+/**
+ * @brief Gets the false-positive rate of the wide-key Bloom filter.
+ * @return The estimated false-positive rate (the bitmap part is exact).
+ */
+double ZipMembershipFilter::expectedFalsePositiveRate() const
+{
+    return wideKeys.expectedFalsePositiveRate();
+}
+
+/**
+ * @brief Gets the bytes used by the bitmap and the Bloom filter.
+ * @return The memory footprint in bytes.
+ */
+size_t ZipMembershipFilter::memoryUsage() const
+{
+    return sizeof(*this) + bitmap.capacity() * sizeof(uint64_t) +
+           wideKeys.memoryUsage() - sizeof(wideKeys);
+}
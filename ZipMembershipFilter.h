@@ -0,0 +1,142 @@
+#ifndef ZIP_MEMBERSHIP_FILTER
+#define ZIP_MEMBERSHIP_FILTER
+
+/**
+ * @file ZipMembershipFilter.h
+ * @brief Declares the membership filter checked before any ZIP index lookup.
+ *
+ * A large share of lookups are for invalid or retired ZIP codes. The filter
+ * answers "definitely absent" without touching the index:
+ *  - 5-digit keys (0..99999) use an exact bitmap (no false positives).
+ *  - Wider keys (e.g. ZIP+4 as a 9-digit number) use a blocked Bloom filter
+ *    in which all probes for a key fall in one 64-byte cache line.
+ */
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+/**
+ * @class BlockedBloomFilter
+ * @brief Cache-line blocked Bloom filter over 64-bit keys.
+ */
+class BlockedBloomFilter
+{
+public:
+    /// @brief Number of bits tested per key inside its block.
+    static const int PROBES = 8;
+
+private:
+    /// @brief Filter blocks; each block is 8 words (512 bits, one cache line).
+    vector<uint64_t> words;
+
+    /// @brief Number of 512-bit blocks.
+    uint64_t blockCount;
+
+    /// @brief Number of keys added.
+    size_t keyCount;
+
+    /**
+     * @brief Mixes a key into a well-distributed 64-bit hash.
+     * @param key The key to hash.
+     * @return The hash value.
+     */
+    static uint64_t hash(uint64_t key);
+
+public:
+    /**
+     * @brief Constructs a filter sized for an expected number of keys.
+     * @param expectedKeys Number of keys the filter is sized for.
+     * @param bitsPerKey Filter bits per expected key (10 gives ~1% FPR).
+     */
+    BlockedBloomFilter(size_t expectedKeys = 0, int bitsPerKey = 10);
+
+    /**
+     * @brief Adds a key to the filter.
+     * @param key The key to add.
+     */
+    void add(uint64_t key);
+
+    /**
+     * @brief Tests whether a key may be in the filter.
+     * @param key The key to test.
+     * @return false if the key is definitely absent.
+     */
+    bool mayContain(uint64_t key) const;
+
+    /**
+     * @brief Estimates the false-positive rate from the current bit density.
+     * @return The probability that an absent key passes the filter.
+     */
+    double expectedFalsePositiveRate() const;
+
+    /**
+     * @brief Gets the bytes used by the filter bits.
+     * @return The memory footprint in bytes.
+     */
+    size_t memoryUsage() const;
+
+    /**
+     * @brief Gets the number of keys added.
+     * @return The key count.
+     */
+    size_t size() const;
+};
+
+/**
+ * @class ZipMembershipFilter
+ * @brief Exact bitmap for 5-digit ZIPs plus a Bloom filter for wider keys.
+ */
+class ZipMembershipFilter
+{
+public:
+    /// @brief Size of the 5-digit ZIP key domain covered by the bitmap.
+    static const int ZIP_DOMAIN = 100000;
+
+private:
+    /// @brief One bit per 5-digit ZIP.
+    vector<uint64_t> bitmap;
+
+    /// @brief Filter for keys outside the 5-digit domain.
+    BlockedBloomFilter wideKeys;
+
+    /// @brief Number of 5-digit keys added.
+    size_t zipCount;
+
+public:
+    /**
+     * @brief Constructs a filter.
+     * @param expectedWideKeys Number of keys outside 0..99999 to size the Bloom filter for.
+     * @param bitsPerKey Bloom filter bits per expected wide key.
+     */
+    ZipMembershipFilter(size_t expectedWideKeys = 0, int bitsPerKey = 10);
+
+    /**
+     * @brief Adds a key to the filter.
+     * @param key A 5-digit ZIP or a wider key.
+     */
+    void add(int64_t key);
+
+    /**
+     * @brief Tests whether a key may be present.
+     * @param key A 5-digit ZIP or a wider key.
+     * @return false if the key is definitely absent.
+     */
+    bool mayContain(int64_t key) const;
+
+    /**
+     * @brief Gets the false-positive rate of the wide-key Bloom filter.
+     * @return The estimated false-positive rate (the bitmap part is exact).
+     */
+    double expectedFalsePositiveRate() const;
+
+    /**
+     * @brief Gets the bytes used by the bitmap and the Bloom filter.
+     * @return The memory footprint in bytes.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif
@@ -0,0 +1,328 @@
+/**
+ * @file ZipResultCache.cpp
+ * @brief Implements the sharded CLOCK / TinyLFU result cache.
+ */
+
+#include "ZipResultCache.h"
+#include <algorithm>
+#include <sstream>
+
+using namespace std;
+
+/**
+ * @brief Gets the fraction of fetch() calls that hit.
+ * @return The hit rate in [0, 1] (0 before any fetch).
+ */
+double ZipResultCache::CacheStats::hitRate() const
+{
+    unsigned long lookups = hits + misses;
+    return lookups == 0 ? 0 : (double)hits / lookups;
+}
+
+/**
+ * @brief Serializes the counters as a JSON object.
+ * @return The JSON text.
+ */
+string ZipResultCache::CacheStats::toJson() const
+{
+    ostringstream out;
+    out << "{\"capacity\": " << capacity << ", \"size\": " << size
+        << ", \"hits\": " << hits << ", \"misses\": " << misses
+        << ", \"hitRate\": " << hitRate() << ", \"admitted\": " << admitted
+        << ", \"rejected\": " << rejected << ", \"evictions\": " << evictions
+        << ", \"invalidations\": " << invalidations << "}";
+    return out.str();
+}
+
+/**
+ * @brief Constructs an empty cache.
+ *
+ * Each shard's sketch has four counters per cached entry per row and is
+ * halved after ten increments per entry, the sizing suggested for TinyLFU.
+ *
+ * @param capacity Maximum number of entries, split evenly over the shards.
+ * @param shardCount Number of shards, rounded up to a power of two.
+ */
+ZipResultCache::ZipResultCache(size_t capacity, int shardCount)
+{
+    size_t count = 1;
+    while ((int)count < shardCount)
+    {
+        count *= 2;
+    }
+    shardCapacity = max<size_t>(1, (capacity + count - 1) / count);
+
+    size_t width = 64;
+    while (width < 4 * shardCapacity)
+    {
+        width *= 2;
+    }
+    for (size_t s = 0; s < count; s++)
+    {
+        unique_ptr<Shard> shard(new Shard());
+        shard->entries.reserve(shardCapacity);
+        shard->hand = 0;
+        shard->sketch.assign(SKETCH_ROWS * width, 0);
+        shard->sketchMask = width - 1;
+        shard->additions = 0;
+        shard->epoch = 1;
+        shard->hits = shard->misses = shard->admitted = 0;
+        shard->rejected = shard->evictions = shard->invalidations = 0;
+        shards.push_back(move(shard));
+    }
+}
+
+/**
+ * @brief Hashes a ZIP for one sketch row or shard selection.
+ * @param zip The ZIP.
+ * @param seed Row number, or SKETCH_ROWS for the shard hash.
+ * @return The hash (splitmix64 finalizer).
+ */
+uint64_t ZipResultCache::hash(int zip, int seed)
+{
+    uint64_t x = (uint64_t)(uint32_t)zip + 0x9e3779b97f4a7c15ULL * (seed + 1);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @brief Selects the shard holding a ZIP.
+ * @param zip The ZIP.
+ * @return The shard.
+ */
+ZipResultCache::Shard &ZipResultCache::shardFor(int zip) const
+{
+    return *shards[hash(zip, SKETCH_ROWS) & (shards.size() - 1)];
+}
+
+/**
+ * @brief Counts one request for a ZIP in the shard's sketch.
+ *
+ * Once the shard has seen ten requests per entry, every counter is
+ * halved so old popularity fades.
+ *
+ * @param shard The shard (locked).
+ * @param zip The ZIP.
+ */
+void ZipResultCache::recordAccess(Shard &shard, int zip)
+{
+    size_t width = shard.sketchMask + 1;
+    for (int row = 0; row < SKETCH_ROWS; row++)
+    {
+        uint8_t &counter = shard.sketch[row * width + (hash(zip, row) & shard.sketchMask)];
+        if (counter < SKETCH_MAX)
+        {
+            counter++;
+        }
+    }
+    if (++shard.additions >= 10 * shardCapacity)
+    {
+        for (uint8_t &counter : shard.sketch)
+        {
+            counter >>= 1;
+        }
+        shard.additions = 0;
+    }
+}
+
+/**
+ * @brief Estimates the recent request count of a ZIP.
+ * @param shard The shard (locked).
+ * @param zip The ZIP.
+ * @return The smallest counter over the sketch rows.
+ */
+int ZipResultCache::frequency(const Shard &shard, int zip) const
+{
+    size_t width = shard.sketchMask + 1;
+    int estimate = SKETCH_MAX;
+    for (int row = 0; row < SKETCH_ROWS; row++)
+    {
+        estimate = min<int>(estimate, shard.sketch[row * width + (hash(zip, row) & shard.sketchMask)]);
+    }
+    return estimate;
+}
+
+/**
+ * @brief Appends the cached payload of a ZIP.
+ * @param zip The ZIP.
+ * @param out Buffer the payload is appended to on a hit.
+ * @param ticket On a miss, receives a value to pass to put(). May be nullptr.
+ * @param version Version of the data the caller reads.
+ * @return true on a hit.
+ */
+bool ZipResultCache::fetch(int zip, string &out, uint64_t *ticket, uint64_t version)
+{
+    Shard &shard = shardFor(zip);
+    lock_guard<mutex> guard(shard.lock);
+    recordAccess(shard, zip);
+    auto it = shard.slots.find(zip);
+    if (it == shard.slots.end() || shard.entries[it->second].version != version)
+    {
+        shard.misses++;
+        if (ticket != nullptr)
+        {
+            *ticket = shard.epoch;
+        }
+        return false;
+    }
+    Entry &entry = shard.entries[it->second];
+    entry.referenced = true;
+    out.append(entry.payload);
+    shard.hits++;
+    return true;
+}
+
+/**
+ * @brief Offers a payload for a ZIP.
+ * @param zip The ZIP.
+ * @param payload Pre-formatted result bytes.
+ * @param ticket Value from the fetch() that missed, or 0 to store unconditionally.
+ * @param version Version of the data the payload was computed from.
+ */
+void ZipResultCache::put(int zip, const string &payload, uint64_t ticket, uint64_t version)
+{
+    Shard &shard = shardFor(zip);
+    lock_guard<mutex> guard(shard.lock);
+    if (ticket != 0 && ticket != shard.epoch)
+    {
+        return; // computed before an invalidation
+    }
+
+    auto it = shard.slots.find(zip);
+    if (it != shard.slots.end())
+    {
+        // A reader still on an older version must not undo a newer entry
+        Entry &cached = shard.entries[it->second];
+        if (cached.version <= version)
+        {
+            cached.version = version;
+            cached.payload = payload;
+        }
+        return;
+    }
+
+    size_t slot;
+    if (!shard.freeSlots.empty())
+    {
+        slot = shard.freeSlots.back();
+        shard.freeSlots.pop_back();
+    }
+    else if (shard.entries.size() < shardCapacity)
+    {
+        slot = shard.entries.size();
+        shard.entries.push_back(Entry());
+    }
+    else
+    {
+        // CLOCK: give referenced entries a second chance
+        while (shard.entries[shard.hand].referenced)
+        {
+            shard.entries[shard.hand].referenced = false;
+            shard.hand = (shard.hand + 1) % shard.entries.size();
+        }
+        slot = shard.hand;
+        Entry &victim = shard.entries[slot];
+        if (frequency(shard, zip) <= frequency(shard, victim.zip))
+        {
+            shard.rejected++;
+            return;
+        }
+        shard.slots.erase(victim.zip);
+        shard.evictions++;
+        shard.hand = (shard.hand + 1) % shard.entries.size();
+    }
+
+    Entry &entry = shard.entries[slot];
+    entry.zip = zip;
+    entry.referenced = false;
+    entry.version = version;
+    entry.payload = payload;
+    shard.slots[zip] = slot;
+    shard.admitted++;
+}
+
+/**
+ * @brief Drops the entry of a ZIP whose record changed.
+ *
+ * Also advances the shard's epoch, so payloads computed from the old
+ * record by a concurrent miss are not stored afterwards.
+ *
+ * @param zip The ZIP.
+ */
+void ZipResultCache::invalidate(int zip)
+{
+    Shard &shard = shardFor(zip);
+    lock_guard<mutex> guard(shard.lock);
+    shard.epoch++;
+    auto it = shard.slots.find(zip);
+    if (it == shard.slots.end())
+    {
+        return;
+    }
+    Entry &entry = shard.entries[it->second];
+    entry.referenced = false;
+    entry.payload.clear();
+    entry.payload.shrink_to_fit();
+    shard.freeSlots.push_back(it->second);
+    shard.slots.erase(it);
+    shard.invalidations++;
+}
+
+/**
+ * @brief Keeps the entries of one data version valid for the next.
+ * @param from Version of the entries to keep.
+ * @param to Version they are valid for from now on.
+ */
+void ZipResultCache::carryOver(uint64_t from, uint64_t to)
+{
+    for (const unique_ptr<Shard> &shard : shards)
+    {
+        lock_guard<mutex> guard(shard->lock);
+        for (const auto &slot : shard->slots)
+        {
+            Entry &entry = shard->entries[slot.second];
+            if (entry.version == from)
+            {
+                entry.version = to;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Drops every entry (counters are kept).
+ */
+void ZipResultCache::clear()
+{
+    for (const unique_ptr<Shard> &shard : shards)
+    {
+        lock_guard<mutex> guard(shard->lock);
+        shard->epoch++;
+        shard->entries.clear();
+        shard->freeSlots.clear();
+        shard->slots.clear();
+        shard->hand = 0;
+    }
+}
+
+/**
+ * @brief Gets the counters summed over all shards.
+ * @return The statistics.
+ */
+ZipResultCache::CacheStats ZipResultCache::stats() const
+{
+    CacheStats result = {shardCapacity * shards.size(), 0, 0, 0, 0, 0, 0, 0};
+    for (const unique_ptr<Shard> &shard : shards)
+    {
+        lock_guard<mutex> guard(shard->lock);
+        result.size += shard->slots.size();
+        result.hits += shard->hits;
+        result.misses += shard->misses;
+        result.admitted += shard->admitted;
+        result.rejected += shard->rejected;
+        result.evictions += shard->evictions;
+        result.invalidations += shard->invalidations;
+    }
+    return result;
+}
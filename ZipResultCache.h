@@ -0,0 +1,220 @@
+#ifndef ZIP_RESULT_CACHE
+#define ZIP_RESULT_CACHE
+
+/**
+ * @file ZipResultCache.h
+ * @brief Declares a bounded, sharded cache of pre-formatted lookup results.
+ *
+ * Lookup traffic concentrates on a few thousand metro ZIPs. Instead of
+ * walking the index and materializing a record (with its three string
+ * copies) on every hit, callers format the result once, in whatever wire
+ * or text format they emit, and keep the bytes here keyed by ZIP.
+ *
+ * The cache is split into shards, each with its own lock, so concurrent
+ * lookups of different ZIPs rarely contend. Each shard evicts with CLOCK
+ * (a second-chance approximation of LRU) and guards its contents with a
+ * TinyLFU admission filter: a small count-min sketch estimates how often
+ * every ZIP has been requested recently, and a new entry only displaces
+ * the CLOCK victim if it has been requested more often. One-off lookups
+ * therefore cannot flush the hot set. The sketch counters are halved
+ * periodically so the estimate follows shifts in traffic.
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+using namespace std;
+
+/**
+ * @class ZipResultCache
+ * @brief Sharded CLOCK cache with TinyLFU admission, keyed by ZIP.
+ */
+class ZipResultCache
+{
+public:
+    /**
+     * @struct CacheStats
+     * @brief Counters summed over all shards.
+     */
+    struct CacheStats
+    {
+        size_t capacity;             ///< Maximum number of entries.
+        size_t size;                 ///< Entries currently cached.
+        unsigned long hits;          ///< fetch() calls answered from the cache.
+        unsigned long misses;        ///< fetch() calls not answered.
+        unsigned long admitted;      ///< put() calls that stored the payload.
+        unsigned long rejected;      ///< put() calls refused by the admission filter.
+        unsigned long evictions;     ///< Entries displaced to admit another.
+        unsigned long invalidations; ///< Entries dropped by invalidate().
+
+        /**
+         * @brief Gets the fraction of fetch() calls that hit.
+         * @return The hit rate in [0, 1] (0 before any fetch).
+         */
+        double hitRate() const;
+
+        /**
+         * @brief Serializes the counters as a JSON object.
+         * @return The JSON text.
+         */
+        string toJson() const;
+    };
+
+private:
+    /**
+     * @struct Entry
+     * @brief One cached result.
+     */
+    struct Entry
+    {
+        int zip;          ///< Key.
+        bool referenced;  ///< CLOCK bit, set on every hit.
+        uint64_t version; ///< Data version the payload was computed from.
+        string payload;   ///< Pre-formatted result bytes.
+    };
+
+    /**
+     * @struct Shard
+     * @brief Independent slice of the cache guarded by its own lock.
+     */
+    struct Shard
+    {
+        mutex lock;                     ///< Guards every member below.
+        vector<Entry> entries;          ///< Entry slots (at most shardCapacity).
+        vector<size_t> freeSlots;       ///< Slots emptied by invalidate().
+        unordered_map<int, size_t> slots; ///< ZIP → index in entries.
+        size_t hand;                    ///< CLOCK hand.
+        vector<uint8_t> sketch;         ///< Count-min sketch, SKETCH_ROWS rows of counters.
+        size_t sketchMask;              ///< Row width - 1 (width is a power of two).
+        size_t additions;               ///< Sketch increments since the last halving.
+        uint64_t epoch;                 ///< Bumped by invalidate(); see fetch().
+        unsigned long hits;             ///< See CacheStats.
+        unsigned long misses;           ///< See CacheStats.
+        unsigned long admitted;         ///< See CacheStats.
+        unsigned long rejected;         ///< See CacheStats.
+        unsigned long evictions;        ///< See CacheStats.
+        unsigned long invalidations;    ///< See CacheStats.
+    };
+
+    /// @brief Rows of the count-min sketch.
+    static const int SKETCH_ROWS = 4;
+
+    /// @brief Saturation value of a sketch counter.
+    static const uint8_t SKETCH_MAX = 15;
+
+    vector<unique_ptr<Shard>> shards; ///< Power-of-two number of shards.
+    size_t shardCapacity;             ///< Entries per shard.
+
+    /**
+     * @brief Selects the shard holding a ZIP.
+     * @param zip The ZIP.
+     * @return The shard.
+     */
+    Shard &shardFor(int zip) const;
+
+    /**
+     * @brief Hashes a ZIP for one sketch row or shard selection.
+     * @param zip The ZIP.
+     * @param seed Row number, or SKETCH_ROWS for the shard hash.
+     * @return The hash.
+     */
+    static uint64_t hash(int zip, int seed);
+
+    /**
+     * @brief Counts one request for a ZIP in the shard's sketch.
+     * @param shard The shard (locked).
+     * @param zip The ZIP.
+     */
+    void recordAccess(Shard &shard, int zip);
+
+    /**
+     * @brief Estimates the recent request count of a ZIP.
+     * @param shard The shard (locked).
+     * @param zip The ZIP.
+     * @return The smallest counter over the sketch rows.
+     */
+    int frequency(const Shard &shard, int zip) const;
+
+public:
+    /**
+     * @brief Constructs an empty cache.
+     * @param capacity Maximum number of entries, split evenly over the shards.
+     * @param shardCount Number of shards, rounded up to a power of two.
+     */
+    explicit ZipResultCache(size_t capacity, int shardCount = 16);
+
+    /**
+     * @brief Appends the cached payload of a ZIP.
+     *
+     * Every call, hit or miss, counts as a request for the admission filter.
+     * An entry stored for another data version counts as a miss, so a
+     * reader of a newly published dataset is never served a payload of
+     * the previous one.
+     *
+     * @param zip The ZIP.
+     * @param out Buffer the payload is appended to on a hit.
+     * @param ticket On a miss, receives a value to pass to put() so a
+     *               payload computed before a concurrent invalidate() of
+     *               the same shard is not stored. May be nullptr.
+     * @param version Version of the data the caller reads.
+     * @return true on a hit.
+     */
+    bool fetch(int zip, string &out, uint64_t *ticket = nullptr, uint64_t version = 0);
+
+    /**
+     * @brief Offers a payload for a ZIP.
+     *
+     * Replaces the payload if the ZIP is cached, unless the cached one was
+     * computed from a newer version. Otherwise the payload is stored in a
+     * free slot, or displaces the CLOCK victim when the ZIP has been
+     * requested more often than the victim.
+     *
+     * @param zip The ZIP.
+     * @param payload Pre-formatted result bytes.
+     * @param ticket Value from the fetch() that missed, or 0 to store unconditionally.
+     * @param version Version of the data the payload was computed from.
+     */
+    void put(int zip, const string &payload, uint64_t ticket = 0, uint64_t version = 0);
+
+    /**
+     * @brief Drops the entry of a ZIP whose record changed.
+     *
+     * Call it from the path that changes records, such as the @c changed
+     * callback of PostalDelta::apply(), which reports adds, updates and
+     * deletes alike.
+     *
+     * @param zip The ZIP.
+     */
+    void invalidate(int zip);
+
+    /**
+     * @brief Keeps the entries of one data version valid for the next.
+     *
+     * For a new version that differs from the old one only in some ZIPs:
+     * call it before the new version is published, then invalidate() each
+     * changed ZIP, so the rest of the cache stays warm. In that order, a
+     * payload an old-version reader stores in between is either dropped or
+     * left tagged with the old version.
+     *
+     * @param from Version of the entries to keep.
+     * @param to Version they are valid for from now on.
+     */
+    void carryOver(uint64_t from, uint64_t to);
+
+    /**
+     * @brief Drops every entry (counters are kept).
+     */
+    void clear();
+
+    /**
+     * @brief Gets the counters summed over all shards.
+     * @return The statistics.
+     */
+    CacheStats stats() const;
+};
+
+#endif
@@ -0,0 +1,294 @@
+/**
+ * @file main_apply_delta.cpp
+ * @brief Applies a delta of added, updated and deleted records in place.
+ *
+ * Usage:
+ * @code
+ * apply_delta <delta file|->
+ * apply_delta --generate [count] [seed]
+ * @endcode
+ * The first form loads the data file into a sequence set with its B+ tree
+ * and direct-address table, applies the delta (see PostalDelta.h) and
+ * checks the result: the sequence set is still ordered by ZIP, the tree,
+ * the table and the set hold the same ZIPs, and every change is visible.
+ * A ZipResultCache holding the old records of the delta's ZIPs is
+ * invalidated through the change callback and must then serve the new
+ * record, or none for a deleted ZIP. The time of the full build and of
+ * the delta are reported.
+ *
+ * @c --generate writes a random delta against the current data to stdout,
+ * about a third each of adds, updates and deletes (default 300 changes),
+ * to exercise the applier with a monthly-sized delta.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "PostalDelta.h"
+#include "PostalRecordParser.h"
+#include "ZipResultCache.h"
+
+using namespace std;
+
+/**
+ * @brief Gets the time since a start point.
+ * @param start The start point.
+ * @return Elapsed milliseconds.
+ */
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Writes a random delta against a sequence set.
+ * @param bss The current records, ordered by ZIP.
+ * @param table Direct-address table over @p bss.
+ * @param count Number of changes.
+ * @param seed Random seed.
+ */
+static void generateDelta(const BlockSequenceSetPostalCode &bss, const DirectAddressZipTable &table,
+                          size_t count, unsigned seed)
+{
+    vector<const HeaderRecordPostalCodeItem *> records;
+    for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr; block = block->getNext())
+    {
+        records.push_back(&block->getBlockItem());
+    }
+    mt19937 rng(seed);
+    shuffle(records.begin(), records.end(), rng);
+
+    /// Writes ",place,state,county,lat,lon" as the data file has them.
+    auto writeFields = [](const HeaderRecordPostalCodeItem &record, const string &place)
+    {
+        cout << "," << place << "," << record.getState() << "," << record.getCounty() << "," << fixed
+             << setprecision(4) << record.getLatitude() << "," << record.getLongitude() << endl;
+    };
+
+    cout << "# " << count << " random changes, seed " << seed << endl;
+    vector<int> added;
+    size_t next = 0;
+    for (size_t i = 0; i < count && next < records.size(); i++)
+    {
+        const HeaderRecordPostalCodeItem &record = *records[next++];
+        switch (i % 3)
+        {
+        case 0:
+        {
+            // A new ZIP next to an existing one, in the same county
+            int zip = record.getZip() + 1;
+            while (zip < DirectAddressZipTable::ZIP_DOMAIN &&
+                   (table.contains(zip) || find(added.begin(), added.end(), zip) != added.end()))
+            {
+                zip++;
+            }
+            if (zip == DirectAddressZipTable::ZIP_DOMAIN)
+            {
+                continue;
+            }
+            added.push_back(zip);
+            cout << "A," << zip;
+            writeFields(record, record.getPlace());
+            break;
+        }
+        case 1:
+            cout << "U," << record.getZip();
+            writeFields(record, record.getPlace() + " Station");
+            break;
+        default:
+            cout << "D," << record.getZip() << endl;
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Checks that a sequence set and its indexes agree after a delta.
+ * @param bss The sequence set.
+ * @param tree The B+ tree.
+ * @param table The direct-address table.
+ * @param delta The applied delta.
+ * @return The number of inconsistencies found.
+ */
+static size_t verify(const BlockSequenceSetPostalCode &bss, BPlusTree<int> &tree,
+                     const DirectAddressZipTable &table, const PostalDelta &delta)
+{
+    size_t problems = 0;
+    int blocks = 0;
+    int previousZip = -1;
+    const BlockPostalCode *previous = nullptr;
+    for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr; block = block->getNext())
+    {
+        int zip = block->getBlockItem().getZip();
+        problems += zip <= previousZip || block->getPrev() != previous || table.find(zip) != block ||
+                    !tree.search(zip);
+        previousZip = zip;
+        previous = block;
+        blocks++;
+    }
+    size_t treeKeys = tree.stats().keyCount;
+    problems += blocks != bss.getCurrentSize() || blocks != table.size() || (size_t)blocks != treeKeys;
+
+    // The last change of every ZIP decides what must be there now
+    vector<const PostalDeltaChange *> last(DirectAddressZipTable::ZIP_DOMAIN, nullptr);
+    for (const PostalDeltaChange &change : delta.getChanges())
+    {
+        last[change.item.getZip()] = &change;
+    }
+    for (const PostalDeltaChange *change : last)
+    {
+        if (change == nullptr)
+        {
+            continue;
+        }
+        const BlockPostalCode *block = table.find(change->item.getZip());
+        if (change->op == PostalDelta::OP_DELETE)
+        {
+            problems += block != nullptr || tree.search(change->item.getZip());
+        }
+        else
+        {
+            problems += block == nullptr || block->getBlockItem().getData() != change->item.getData();
+        }
+    }
+    if (problems != 0)
+    {
+        cerr << "set " << blocks << " / " << bss.getCurrentSize() << " blocks, table " << table.size()
+             << " ZIPs, tree " << treeKeys << " keys" << endl;
+    }
+    return problems;
+}
+
+/**
+ * @brief Caches the current record of every ZIP a delta touches.
+ * @param cache The cache.
+ * @param table Direct-address table over the current records.
+ * @param delta The delta about to be applied.
+ */
+static void warmCache(ZipResultCache &cache, const DirectAddressZipTable &table, const PostalDelta &delta)
+{
+    for (const PostalDeltaChange &change : delta.getChanges())
+    {
+        const BlockPostalCode *block = table.find(change.item.getZip());
+        if (block != nullptr)
+        {
+            cache.put(change.item.getZip(), block->getBlockItem().getData());
+        }
+    }
+}
+
+/**
+ * @brief Checks that a cache invalidated by a delta serves the new records.
+ *
+ * Every ZIP of the delta is looked up twice the way the server does it: a
+ * miss reads the table and caches the record. An entry the delta left
+ * behind would be served by the first lookup.
+ *
+ * @param cache The cache, invalidated while the delta was applied.
+ * @param table Direct-address table after the delta.
+ * @param delta The applied delta.
+ * @return The number of lookups that did not return the current record.
+ */
+static size_t verifyCache(ZipResultCache &cache, const DirectAddressZipTable &table, const PostalDelta &delta)
+{
+    size_t problems = 0;
+    for (const PostalDeltaChange &change : delta.getChanges())
+    {
+        int zip = change.item.getZip();
+        const BlockPostalCode *block = table.find(zip);
+        string expected = block == nullptr ? "" : block->getBlockItem().getData();
+        for (int lookup = 0; lookup < 2; lookup++)
+        {
+            string payload;
+            if (!cache.fetch(zip, payload) && block != nullptr)
+            {
+                payload = expected;
+                cache.put(zip, payload);
+            }
+            problems += payload != expected;
+        }
+    }
+    if (problems != 0)
+    {
+        cerr << problems << " cached lookups did not return the current record" << endl;
+    }
+    return problems;
+}
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: a delta file, or @c --generate with its count and seed.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    if (argc < 2)
+    {
+        cerr << "Usage: apply_delta <delta file|-> | apply_delta --generate [count] [seed]" << endl;
+        return 1;
+    }
+    string deltaPath = argv[1];
+
+    auto start = chrono::steady_clock::now();
+    BlockSequenceSetPostalCode bss;
+    PostalRecordParser::loadBlockSequenceSet(bss, fileName);
+    BPlusTree<int> tree(10);
+    for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr; block = block->getNext())
+    {
+        tree.insert(block->getBlockItem().getZip());
+    }
+    DirectAddressZipTable table(bss);
+    double buildMs = millisecondsSince(start);
+
+    if (deltaPath == "--generate")
+    {
+        generateDelta(bss, table, argc > 2 ? stoul(argv[2]) : 300, argc > 3 ? stoul(argv[3]) : 42);
+        return 0;
+    }
+
+    PostalDelta delta;
+    string error;
+    start = chrono::steady_clock::now();
+    if (!delta.read(deltaPath, error))
+    {
+        cerr << error << endl;
+        return 1;
+    }
+    double readMs = millisecondsSince(start);
+
+    ZipResultCache cache(4 * delta.size() + 64);
+    warmCache(cache, table, delta);
+
+    PostalDelta::Summary summary;
+    size_t notified = 0;
+    start = chrono::steady_clock::now();
+    if (!delta.apply(bss, tree, table, summary, error, [&notified, &cache](int zip)
+                     {
+                         notified++;
+                         cache.invalidate(zip);
+                     }))
+    {
+        cerr << error << "; nothing was changed" << endl;
+        return 1;
+    }
+    double applyMs = millisecondsSince(start);
+
+    size_t problems = verify(bss, tree, table, delta);
+    size_t invalidated = cache.stats().invalidations;
+    problems += verifyCache(cache, table, delta);
+    cout << "full build: " << bss.getCurrentSize() - summary.added + summary.deleted << " records in "
+         << buildMs << " ms" << endl;
+    cout << "delta: " << summary.added << " added, " << summary.updated << " updated, " << summary.deleted
+         << " deleted (" << notified << " change notifications), read in " << readMs << " ms, applied in "
+         << applyMs << " ms" << endl;
+    cout << "now " << bss.getCurrentSize() << " records; "
+         << (problems == 0 ? "sequence set, tree, table and cache agree" : "INCONSISTENT") << " ("
+         << invalidated << " cached records invalidated)" << endl;
+    return problems == 0 ? 0 : 1;
+}
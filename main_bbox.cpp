@@ -0,0 +1,90 @@
+/**
+ * @file main_bbox.cpp
+ * @brief Answers latitude/longitude bounding-box queries with Morton keys.
+ *
+ * Usage:
+ * @code
+ * bbox <minLat> <minLon> <maxLat> <maxLon> [maxRanges]
+ * @endcode
+ * Prints each Morton key range scanned in the B+ tree with how many keys
+ * it returned, how many were inside the box and how many were false
+ * positives, and checks the total against a full scan.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "readHeaderPostalCodetoBSSBuffer.cpp"
+#include "DirectAddressZipTable.h"
+#include "MortonGeoIndex.h"
+
+using namespace std;
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: box edges and an optional range budget.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    if (argc < 5)
+    {
+        cout << "Usage: bbox <minLat> <minLon> <maxLat> <maxLon> [maxRanges]" << endl;
+        return 1;
+    }
+
+    double minLat = stod(argv[1]);
+    double minLon = stod(argv[2]);
+    double maxLat = stod(argv[3]);
+    double maxLon = stod(argv[4]);
+    size_t maxRanges = argc > 5 ? stoi(argv[5]) : 16;
+
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+
+    BlockSequenceSetPostalCode myBlockSequenceSetPostalCode;
+    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName);
+
+    DirectAddressZipTable zipTable(myBlockSequenceSetPostalCode);
+    MortonGeoIndex geoIndex(myBlockSequenceSetPostalCode, zipTable);
+
+    auto start = chrono::steady_clock::now();
+    MortonBoxResult result = geoIndex.boxQuery(minLat, minLon, maxLat, maxLon, maxRanges);
+    auto stop = chrono::steady_clock::now();
+
+    cout << left << setw(20) << "Range low key" << setw(20) << "Range high key"
+         << right << setw(10) << "Scanned" << setw(10) << "Matched" << setw(10) << "FalsePos" << endl;
+
+    size_t scanned = 0;
+    for (const MortonRangeReport &range : result.ranges)
+    {
+        cout << left << setw(20) << range.lowKey << setw(20) << range.highKey
+             << right << setw(10) << range.scanned << setw(10) << range.matched
+             << setw(10) << range.falsePositives << endl;
+        scanned += range.scanned;
+    }
+
+    // Full scan of the sequence set for comparison
+    size_t expected = 0;
+    for (const BlockPostalCode *block = myBlockSequenceSetPostalCode.getHeadBlock();
+         block != nullptr; block = block->getNext())
+    {
+        const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+        bool insideLon = minLon <= maxLon
+                             ? item.getLongitude() >= minLon && item.getLongitude() <= maxLon
+                             : item.getLongitude() >= minLon || item.getLongitude() <= maxLon;
+        expected += item.getLatitude() >= minLat && item.getLatitude() <= maxLat && insideLon;
+    }
+
+    cout << "\n"
+         << result.ranges.size() << " ranges, " << scanned << " keys scanned, "
+         << result.matches.size() << " ZIPs in box (full scan: " << expected << ") in "
+         << fixed << setprecision(1)
+         << chrono::duration<double, micro>(stop - start).count() << " us" << endl;
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+/**
+ * @file main_benchmark_allocations.cpp
+ * @brief Counts heap allocations on the record access, formatting and build paths.
+ *
+ * Global operator new/delete are replaced with counting versions, and each
+ * phase below reports allocations, bytes and nanoseconds per record:
+ *  - lookup:      reading ZIP, place, state and county of a stored block,
+ *                 as PostalQuery and the batch writer do.
+ *  - getData:     formatting a record into a new string.
+ *  - appendData:  formatting a record into one reused buffer.
+ *  - setters:     filling a record from freshly parsed field strings.
+ *  - bss add:     moving finished records into a BlockSequenceSetPostalCode.
+ *  - vector grow: push_back of records without reserve(); with a noexcept
+ *                 move constructor, regrowth moves records instead of
+ *                 copying their strings, so only the buffer reallocations
+ *                 are counted.
+ *
+ * Strings of up to 15 characters fit the small-string buffer and never
+ * allocate, so the counts reflect only the longer place and county names.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <iostream>
+#include <iomanip>
+#include <utility>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "readHeaderPostalCodetoBSSBuffer.cpp"
+
+using namespace std;
+
+static unsigned long allocationCount = 0; ///< Calls to operator new since the last reset
+static unsigned long allocationBytes = 0; ///< Bytes requested since the last reset
+
+void *operator new(size_t size)
+{
+    allocationCount++;
+    allocationBytes += size;
+    void *memory = malloc(size ? size : 1);
+    if (memory == nullptr)
+    {
+        throw bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+/**
+ * @class PhaseCounter
+ * @brief Snapshots the allocation counters and clock at the start of a phase.
+ */
+class PhaseCounter
+{
+private:
+    unsigned long count;                      ///< allocationCount at start
+    unsigned long bytes;                      ///< allocationBytes at start
+    chrono::steady_clock::time_point started; ///< Clock at start
+
+public:
+    PhaseCounter() : count(allocationCount), bytes(allocationBytes), started(chrono::steady_clock::now()) {}
+
+    /**
+     * @brief Prints the per-record counts since construction.
+     * @param name Phase name.
+     * @param records Records processed.
+     */
+    void report(const char *name, size_t records) const
+    {
+        double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - started).count();
+        unsigned long allocations = allocationCount - count;
+        unsigned long allocated = allocationBytes - bytes;
+        cout << left << setw(14) << name << right
+             << setw(10) << allocations
+             << setw(14) << (double)allocations / records
+             << setw(14) << (double)allocated / records
+             << setw(12) << ns / records << endl;
+    }
+};
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_allocations @endcode
+ *
+ * @return int Exit status
+ */
+int main()
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+
+    BlockSequenceSetPostalCode source;
+    inputDatatoBlockSequenceSet(source, fileName);
+    vector<const BlockPostalCode *> blocks;
+    for (const BlockPostalCode *block = source.getHeadBlock(); block != nullptr; block = block->getNext())
+    {
+        blocks.push_back(block);
+    }
+    size_t n = blocks.size();
+
+    cout << fixed << setprecision(2);
+    cout << n << " records" << endl;
+    cout << left << setw(14) << "phase" << right << setw(10) << "allocs"
+         << setw(14) << "allocs/rec" << setw(14) << "bytes/rec" << setw(12) << "ns/rec" << endl;
+
+    size_t checksum = 0;
+    {
+        PhaseCounter phase;
+        for (const BlockPostalCode *block : blocks)
+        {
+            const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+            const string &place = item.getPlace();
+            const string &state = item.getState();
+            const string &county = item.getCounty();
+            checksum += item.getZip() + place.size() + state.size() + county.size();
+        }
+        phase.report("lookup", n);
+    }
+    {
+        PhaseCounter phase;
+        for (const BlockPostalCode *block : blocks)
+        {
+            string data = block->getBlockItem().getData();
+            checksum += data.size();
+        }
+        phase.report("getData", n);
+    }
+    {
+        string buffer;
+        PhaseCounter phase;
+        for (const BlockPostalCode *block : blocks)
+        {
+            buffer.clear();
+            block->getBlockItem().appendData(buffer);
+            checksum += buffer.size();
+        }
+        phase.report("appendData", n);
+    }
+
+    // Field strings as a parser would produce them, made before counting starts
+    vector<string> fields;
+    fields.reserve(3 * n);
+    for (const BlockPostalCode *block : blocks)
+    {
+        const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+        fields.push_back(item.getPlace());
+        fields.push_back(item.getState());
+        fields.push_back(item.getCounty());
+    }
+    vector<HeaderRecordPostalCodeItem> records(n);
+    {
+        PhaseCounter phase;
+        for (size_t i = 0; i < n; i++)
+        {
+            const HeaderRecordPostalCodeItem &item = blocks[i]->getBlockItem();
+            records[i].setRecordLength(item.getRecordLength());
+            records[i].setZip(item.getZip());
+            records[i].setPlace(move(fields[3 * i]));
+            records[i].setState(move(fields[3 * i + 1]));
+            records[i].setCounty(move(fields[3 * i + 2]));
+            records[i].setLatitude(item.getLatitude());
+            records[i].setLongitude(item.getLongitude());
+        }
+        phase.report("setters", n);
+    }
+    {
+        vector<HeaderRecordPostalCodeItem> grown;
+        PhaseCounter phase;
+        for (HeaderRecordPostalCodeItem &record : records)
+        {
+            grown.push_back(move(record));
+        }
+        phase.report("vector grow", n);
+        records = move(grown);
+    }
+    {
+        BlockSequenceSetPostalCode bss;
+        PhaseCounter phase;
+        for (HeaderRecordPostalCodeItem &record : records)
+        {
+            bss.add(move(record));
+        }
+        phase.report("bss add", n);
+        for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr; block = block->getNext())
+        {
+            checksum += block->getBlockItem().getCounty().size();
+        }
+    }
+
+    cout << "checksum " << checksum << endl;
+    return 0;
+}
@@ -0,0 +1,283 @@
+/**
+ * @file main_benchmark_async_read.cpp
+ * @brief Measures disk-backed record reads through AsyncBlockReader at several queue depths.
+ *
+ * The length-indicated data file is indexed once by hopping over the
+ * record length prefixes (ZIP → byte offset and length). Records are then
+ * fetched straight from the file in 4 KiB-aligned blocks:
+ *  - Point lookups: random ZIPs, one block read each (two if the record
+ *    straddles a block boundary), with up to @c depth reads in flight.
+ *  - Range scans: RANGE_WIDTH consecutive ZIPs, whose covering blocks are
+ *    all submitted together and completed out of order.
+ *
+ * Every fetched record is parsed back and its ZIP compared with the one
+ * requested. The page cache is dropped for the file (POSIX_FADV_DONTNEED)
+ * before each run so reads reach the device; with @c --direct the file is
+ * opened with O_DIRECT and bypasses the cache entirely. On tmpfs or
+ * overlay file systems the advice may be ignored, in which case the
+ * numbers show submission overhead rather than device parallelism.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <fcntl.h>
+#include <unistd.h>
+#include "AsyncBlockReader.h"
+#include "PostalOffsetIndex.h"
+
+using namespace std;
+
+static const uint64_t BLOCK_BYTES = 4096; ///< Read granularity and O_DIRECT alignment
+static const int RANGE_WIDTH = 1000;      ///< ZIPs per range scan
+
+/**
+ * @brief Gets the first block of a record.
+ * @param record The record.
+ * @return Offset of the aligned block holding its first byte.
+ */
+static uint64_t firstBlock(const RecordLocation &record)
+{
+    return record.offset & ~(BLOCK_BYTES - 1);
+}
+
+/**
+ * @brief Gets the end of the last block of a record.
+ * @param record The record.
+ * @return Offset just past the aligned block holding its last byte.
+ */
+static uint64_t blockEnd(const RecordLocation &record)
+{
+    return (record.offset + record.length + BLOCK_BYTES - 1) & ~(BLOCK_BYTES - 1);
+}
+
+/**
+ * @brief Evicts the file from the page cache.
+ * @param fd The file.
+ */
+static void dropCache(int fd)
+{
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+/**
+ * @brief Fetches random records with up to the reader's capacity of reads in flight.
+ * @param reader The reader.
+ * @param fd The data file.
+ * @param queries Records to fetch.
+ * @param mismatches Incremented for every record whose ZIP does not match.
+ * @return Number of block reads issued.
+ */
+static size_t runLookups(AsyncBlockReader &reader, int fd, const vector<RecordLocation> &queries,
+                         int &mismatches)
+{
+    // One two-block buffer per queue slot; the tag is the slot number.
+    unsigned slots = reader.capacity();
+    char *arena = (char *)aligned_alloc(BLOCK_BYTES, slots * 2 * BLOCK_BYTES);
+    vector<const RecordLocation *> slotRecord(slots, nullptr);
+    vector<unsigned> freeSlots;
+    for (unsigned slot = 0; slot < slots; slot++)
+    {
+        freeSlots.push_back(slots - 1 - slot);
+    }
+
+    vector<BlockReadCompletion> done;
+    size_t next = 0;
+    size_t reads = 0;
+    while (next < queries.size() || reader.pending() > 0)
+    {
+        while (next < queries.size() && !freeSlots.empty())
+        {
+            const RecordLocation &record = queries[next++];
+            unsigned slot = freeSlots.back();
+            freeSlots.pop_back();
+            slotRecord[slot] = &record;
+            uint64_t start = firstBlock(record);
+            reader.submit({fd, start, (uint32_t)(blockEnd(record) - start),
+                           arena + slot * 2 * BLOCK_BYTES, slot});
+            reads++;
+        }
+
+        done.clear();
+        reader.wait(done, 1);
+        for (const BlockReadCompletion &completion : done)
+        {
+            const RecordLocation &record = *slotRecord[completion.tag];
+            const char *bytes = arena + completion.tag * 2 * BLOCK_BYTES +
+                                (record.offset - firstBlock(record));
+            if (completion.result < (int)(record.offset - firstBlock(record) + record.length) ||
+                atoi(bytes + 2) != record.zip)
+            {
+                mismatches++;
+            }
+            freeSlots.push_back(completion.tag);
+        }
+    }
+    free(arena);
+    return reads;
+}
+
+/**
+ * @brief Runs range scans, submitting the blocks of each scan together.
+ * @param reader The reader.
+ * @param fd The data file.
+ * @param records All records, in ZIP order.
+ * @param starts Index of the first record of each scan.
+ * @param mismatches Incremented for every record whose ZIP does not match.
+ * @return Number of block reads issued.
+ */
+static size_t runRangeScans(AsyncBlockReader &reader, int fd, const vector<RecordLocation> &records,
+                            const vector<size_t> &starts, int &mismatches)
+{
+    // The data file is in ZIP order, so a scan covers one run of blocks;
+    // a line is at most 102 bytes (two-digit prefix, 99 bytes, newline).
+    size_t maxBlocks = RANGE_WIDTH * 102 / BLOCK_BYTES + 2;
+    char *arena = (char *)aligned_alloc(BLOCK_BYTES, maxBlocks * BLOCK_BYTES);
+    vector<BlockReadCompletion> done;
+    size_t reads = 0;
+
+    for (size_t first : starts)
+    {
+        size_t last = first + RANGE_WIDTH - 1 < records.size() ? first + RANGE_WIDTH - 1
+                                                                 : records.size() - 1;
+        uint64_t base = firstBlock(records[first]);
+        size_t blocks = (blockEnd(records[last]) - base) / BLOCK_BYTES;
+
+        // Submit every block of the scan, waiting only when the queue is full.
+        size_t submitted = 0;
+        size_t completed = 0;
+        while (completed < blocks)
+        {
+            while (submitted < blocks &&
+                   reader.submit({fd, base + submitted * BLOCK_BYTES, (uint32_t)BLOCK_BYTES,
+                                  arena + submitted * BLOCK_BYTES, submitted}))
+            {
+                submitted++;
+                reads++;
+            }
+            done.clear();
+            completed += reader.wait(done, 1);
+        }
+
+        for (size_t i = first; i <= last; i++)
+        {
+            if (records[i].offset + records[i].length > base + blocks * BLOCK_BYTES ||
+                atoi(arena + (records[i].offset - base) + 2) != records[i].zip)
+            {
+                mismatches++;
+            }
+        }
+    }
+    free(arena);
+    return reads;
+}
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_async_read [lookups] [scans] [--direct] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments: lookup count, range scan count and the O_DIRECT switch.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    int lookupCount = 20000; ///< Random point lookups per run
+    int scanCount = 200;     ///< Range scans per run
+    bool direct = false;     ///< Open the file with O_DIRECT
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--direct")
+        {
+            direct = true;
+        }
+        else if (positional++ == 0)
+        {
+            lookupCount = stoi(arg);
+        }
+        else
+        {
+            scanCount = stoi(arg);
+        }
+    }
+
+    // Build the offset index with one prefix-hopping pass.
+    PostalOffsetIndex offsets;
+    string error;
+    if (!offsets.build(fileName, error))
+    {
+        cerr << error << endl;
+        return 1;
+    }
+    const vector<RecordLocation> &records = offsets.getLocations();
+
+    int fd = open(fileName.c_str(), O_RDONLY | (direct ? O_DIRECT : 0));
+    if (fd < 0)
+    {
+        cerr << "Cannot open " << fileName << (direct ? " with O_DIRECT" : "") << endl;
+        return 1;
+    }
+
+    mt19937 rng(42);
+    uniform_int_distribution<size_t> pickRecord(0, records.size() - 1);
+    vector<RecordLocation> lookups(lookupCount);
+    for (RecordLocation &lookup : lookups)
+    {
+        lookup = records[pickRecord(rng)];
+    }
+    uniform_int_distribution<size_t> pickStart(0, records.size() - RANGE_WIDTH);
+    vector<size_t> starts(scanCount);
+    for (size_t &start : starts)
+    {
+        start = pickStart(rng);
+    }
+
+    cout << records.size() << " records indexed; " << lookupCount << " lookups, " << scanCount
+         << " scans of " << RANGE_WIDTH << " ZIPs" << (direct ? ", O_DIRECT" : "") << endl;
+    cout << left << setw(13) << "backend" << right << setw(7) << "depth" << setw(14)
+         << "lookups/s" << setw(14) << "scans/s" << setw(14) << "reads/s" << setw(12)
+         << "mismatches" << endl;
+
+    for (AsyncBackend preferred : {ASYNC_IO_URING, ASYNC_THREAD_POOL})
+    {
+        for (unsigned depth : {1u, 4u, 16u, 64u, 256u})
+        {
+            AsyncBlockReader reader(depth, preferred);
+            if (reader.backend() != preferred)
+            {
+                cout << "io_uring unavailable; only the thread pool is measured" << endl;
+                break;
+            }
+            int mismatches = 0;
+
+            dropCache(fd);
+            auto start = chrono::steady_clock::now();
+            size_t reads = runLookups(reader, fd, lookups, mismatches);
+            auto mid = chrono::steady_clock::now();
+            dropCache(fd);
+            auto scanStart = chrono::steady_clock::now();
+            reads += runRangeScans(reader, fd, records, starts, mismatches);
+            auto stop = chrono::steady_clock::now();
+
+            double lookupSeconds = chrono::duration<double>(mid - start).count();
+            double scanSeconds = chrono::duration<double>(stop - scanStart).count();
+            cout << left << setw(13) << reader.backendName() << right << setw(7) << depth
+                 << fixed << setprecision(0) << setw(14) << lookupCount / lookupSeconds
+                 << setw(14) << scanCount / scanSeconds << setw(14)
+                 << reads / (lookupSeconds + scanSeconds) << setw(12) << mismatches << endl;
+        }
+    }
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ * @file main_benchmark_filter.cpp
+ * @brief Measures the ZIP membership filter in front of the B+ tree.
+ *
+ * Reports:
+ *  - The cost of negative lookups with and without the filter.
+ *  - The measured and estimated false-positive rate of the Bloom filter
+ *    on synthetic ZIP+4 (9-digit) keys.
+ *  - The memory used by the filter.
+ */
+
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "readHeaderPostalCodetoBSSBuffer.cpp"
+#include "B+tree.cpp"
+#include "ZipMembershipFilter.h"
+
+using namespace std;
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_filter [queryCount] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments; argv[1] optionally sets the number of queries.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    int queryCount = argc > 1 ? stoi(argv[1]) : 1000000;                   ///< Number of timed lookups
+
+    BlockSequenceSetPostalCode myBlockSequenceSetPostalCode;
+    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName);
+
+    BPlusTree<int> tree(10);
+    vector<int> zips;
+    for (const BlockPostalCode *block = myBlockSequenceSetPostalCode.getHeadBlock();
+         block != nullptr; block = block->getNext())
+    {
+        tree.insert(block->getBlockItem().getZip());
+        zips.push_back(block->getBlockItem().getZip());
+    }
+
+    // Synthetic ZIP+4 keys: four add-on codes per ZIP, stored as 9-digit numbers
+    mt19937 rng(42);
+    uniform_int_distribution<int> plus4(0, 9999);
+    ZipMembershipFilter filter(zips.size() * 4);
+    vector<int64_t> wideKeys;
+    for (int zip : zips)
+    {
+        filter.add(zip);
+        for (int i = 0; i < 4; i++)
+        {
+            int64_t key = (int64_t)zip * 10000 + plus4(rng);
+            filter.add(key);
+            wideKeys.push_back(key);
+        }
+    }
+    sort(wideKeys.begin(), wideKeys.end());
+
+    // Negative-heavy traffic: 80% invalid or retired ZIPs, 20% hits
+    uniform_int_distribution<int> pickZip(0, zips.size() - 1);
+    uniform_int_distribution<int> badZip(0, 999999999);
+    vector<int> queries(queryCount);
+    for (int i = 0; i < queryCount; i++)
+    {
+        queries[i] = (i % 5 == 0) ? zips[pickZip(rng)] : badZip(rng);
+    }
+
+    auto start = chrono::steady_clock::now();
+    int foundTree = 0;
+    for (int zip : queries)
+    {
+        foundTree += tree.search(zip);
+    }
+    auto mid = chrono::steady_clock::now();
+    int foundFiltered = 0;
+    int rejected = 0;
+    for (int zip : queries)
+    {
+        if (!filter.mayContain(zip))
+        {
+            rejected++;
+            continue;
+        }
+        foundFiltered += tree.search(zip);
+    }
+    auto stop = chrono::steady_clock::now();
+
+    double treeNs = chrono::duration<double, nano>(mid - start).count() / queryCount;
+    double filteredNs = chrono::duration<double, nano>(stop - mid).count() / queryCount;
+
+    cout << fixed << setprecision(1);
+    cout << "Tree only:       " << treeNs << " ns/lookup (" << foundTree << " found)" << endl;
+    cout << "Filter + tree:   " << filteredNs << " ns/lookup (" << foundFiltered << " found, "
+         << rejected << " rejected by filter)" << endl;
+
+    // False-positive rate on 9-digit keys that were never added
+    int probes = 0;
+    int falsePositives = 0;
+    uniform_int_distribution<int64_t> anyWide(100000, 999999999);
+    while (probes < queryCount)
+    {
+        int64_t key = anyWide(rng);
+        if (binary_search(wideKeys.begin(), wideKeys.end(), key))
+        {
+            continue;
+        }
+        probes++;
+        falsePositives += filter.mayContain(key);
+    }
+
+    cout << setprecision(4);
+    cout << "Wide-key FPR:    " << 100.0 * falsePositives / probes << "% measured, "
+         << 100.0 * filter.expectedFalsePositiveRate() << "% estimated" << endl;
+    cout << "Filter memory:   " << filter.memoryUsage() << " bytes" << endl;
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file main_benchmark_haversine.cpp
+ * @brief Benchmarks the batch great-circle distance kernels.
+ *
+ * Replicates the record coordinates into a large column store, then for
+ * random origins times:
+ *  - the per-record scalar haversine formula (the baseline),
+ *  - GeoColumnStore::distancesKm with each available kernel,
+ *  - GeoColumnStore::withinRadius (squared chord prefilter) with each kernel.
+ * The largest difference from the haversine baseline is reported as a
+ * correctness check.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "readHeaderPostalCodetoBSSBuffer.cpp"
+#include "GeoColumnStore.h"
+#include "GeoDistance.h"
+
+using namespace std;
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_haversine [copies] [radiusKm] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments: how many copies of the dataset to load, and the radius.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    int copies = argc > 1 ? stoi(argv[1]) : 25;                             ///< Dataset replication factor
+    double radiusKm = argc > 2 ? stod(argv[2]) : 100;                       ///< Radius filter distance
+    const int origins = 20;                                                 ///< Query origins per kernel
+
+    BlockSequenceSetPostalCode myBlockSequenceSetPostalCode;
+    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName);
+
+    GeoColumnStore store;
+    for (int copy = 0; copy < copies; copy++)
+    {
+        for (const BlockPostalCode *block = myBlockSequenceSetPostalCode.getHeadBlock();
+             block != nullptr; block = block->getNext())
+        {
+            const HeaderRecordPostalCodeItem &item = block->getBlockItem();
+            store.add(item.getLatitude(), item.getLongitude(), block);
+        }
+    }
+    size_t n = store.size();
+
+    mt19937 rng(42);
+    uniform_int_distribution<int> pickRow(0, n - 1);
+    vector<int> originRows(origins);
+    for (int &row : originRows)
+    {
+        row = pickRow(rng);
+    }
+
+    cout << n << " rows, " << origins << " origins, best kernel: "
+         << GeoColumnStore::kernelName(GeoColumnStore::bestKernel()) << endl;
+
+    // Baseline: scalar haversine per record
+    vector<double> expected(n);
+    auto start = chrono::steady_clock::now();
+    for (int row : originRows)
+    {
+        double lat = store.getLatitude(row);
+        double lon = store.getLongitude(row);
+        for (size_t i = 0; i < n; i++)
+        {
+            expected[i] = haversineKm(lat, lon, store.getLatitude(i), store.getLongitude(i));
+        }
+    }
+    auto stop = chrono::steady_clock::now();
+    double baseNs = chrono::duration<double, nano>(stop - start).count() / (origins * n);
+
+    cout << fixed << setprecision(2);
+    cout << left << setw(26) << "haversine (per record)" << right << setw(8) << baseNs << " ns/row" << endl;
+
+    vector<double> distances(n);
+    vector<int> rows;
+    for (int k = GEO_KERNEL_SCALAR; k <= GeoColumnStore::bestKernel(); k++)
+    {
+        store.setKernel((GeoKernel)k);
+        string name = GeoColumnStore::kernelName((GeoKernel)k);
+
+        start = chrono::steady_clock::now();
+        for (int row : originRows)
+        {
+            store.distancesKm(store.getLatitude(row), store.getLongitude(row), distances.data());
+        }
+        stop = chrono::steady_clock::now();
+        double distNs = chrono::duration<double, nano>(stop - start).count() / (origins * n);
+
+        // Compare the last origin against the baseline
+        double maxError = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            maxError = max(maxError, fabs(distances[i] - expected[i]));
+        }
+
+        size_t matches = 0;
+        start = chrono::steady_clock::now();
+        for (int row : originRows)
+        {
+            matches += store.withinRadius(store.getLatitude(row), store.getLongitude(row),
+                                          radiusKm, rows);
+        }
+        stop = chrono::steady_clock::now();
+        double radiusNs = chrono::duration<double, nano>(stop - start).count() / (origins * n);
+
+        cout << left << setw(26) << ("distancesKm " + name) << right << setw(8) << distNs
+             << " ns/row  (max error " << scientific << setprecision(1) << maxError
+             << " km)" << fixed << setprecision(2) << endl;
+        cout << left << setw(26) << ("withinRadius " + name) << right << setw(8) << radiusNs
+             << " ns/row  (" << matches / origins << " rows within "
+             << radiusKm << " km per origin)" << endl;
+    }
+
+    return 0;
+}
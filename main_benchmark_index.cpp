@@ -0,0 +1,106 @@
+/**
+ * @file main_benchmark_index.cpp
+ * @brief Compares lookup latency and memory use of the ZIP index engines.
+ *
+ * Loads the postal data, builds every ZIP index engine from the same keys
+ * and times the same random query stream (half hits, half misses) against
+ * each of them through the common ZipIndex interface.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "readHeaderPostalCodetoBSSBuffer.cpp"
+#include "B+tree.cpp"
+#include "ZipIndex.h"
+#include "EytzingerZipIndex.h"
+#include "DirectAddressZipTable.h"
+
+using namespace std;
+
+/**
+ * @brief Times a query stream against one index engine.
+ * @param index The engine under test.
+ * @param queries ZIP codes to look up.
+ * @return Number of queries that were found (keeps the loop observable).
+ */
+int runQueries(ZipIndex &index, const vector<int> &queries)
+{
+    auto start = chrono::steady_clock::now();
+
+    int found = 0;
+    for (int zip : queries)
+    {
+        found += index.search(zip);
+    }
+
+    auto stop = chrono::steady_clock::now();
+    double ns = chrono::duration<double, nano>(stop - start).count();
+
+    cout << left << setw(14) << index.name()
+         << setw(12) << fixed << setprecision(1) << ns / queries.size()
+         << " ns/lookup  " << setw(10) << index.memoryUsage()
+         << " bytes  (" << found << " found)" << endl;
+
+    return found;
+}
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_index [queryCount] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments; argv[1] optionally sets the number of queries.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    int queryCount = argc > 1 ? stoi(argv[1]) : 1000000;                   ///< Number of timed lookups
+
+    BlockSequenceSetPostalCode myBlockSequenceSetPostalCode;
+    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName);
+
+    BPlusTree<int> tree(10);
+    vector<int> zips;
+
+    BlockPostalCode myBlock = myBlockSequenceSetPostalCode.getHead();
+    while (true)
+    {
+        tree.insert(myBlock.getBlockItem().getZip());
+        zips.push_back(myBlock.getBlockItem().getZip());
+        if (myBlock.getNext() == nullptr)
+        {
+            break;
+        }
+        myBlock = *myBlock.getNext();
+    }
+
+    BPlusTreeZipIndex treeIndex(tree);
+    EytzingerZipIndex eytzingerIndex(zips);
+    DirectAddressZipTable directTable(myBlockSequenceSetPostalCode);
+
+    // Half of the queries are existing ZIPs, half are uniform 5-digit values
+    mt19937 rng(42);
+    uniform_int_distribution<int> pickZip(0, zips.size() - 1);
+    uniform_int_distribution<int> anyZip(0, 99999);
+    vector<int> queries(queryCount);
+    for (int i = 0; i < queryCount; i++)
+    {
+        queries[i] = (i % 2 == 0) ? zips[pickZip(rng)] : anyZip(rng);
+    }
+
+    cout << zips.size() << " keys, " << queryCount << " queries" << endl;
+
+    runQueries(treeIndex, queries);
+    runQueries(eytzingerIndex, queries);
+    runQueries(directTable, queries);
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+/**
+ * @file main_benchmark_lazy.cpp
+ * @brief Compares resident records with records fetched on demand.
+ *
+ * Reports the heap held by a fully loaded sequence set (plus its
+ * direct-address table) and by a LazyPostalStore (record locations plus
+ * decoded-record cache), then times record lookups on two workloads:
+ *  - uniform: every ZIP equally likely.
+ *  - hot:     90% of the lookups go to HOT_SET_SIZE ZIPs, as in loadgen.
+ * Lazy lookups are timed with the default cache and with no cache, so
+ * the second column is the cost of one pread() plus parseLine().
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <malloc.h>
+#include "BlockSequenceSetPostalCode.h"
+#include "DirectAddressZipTable.h"
+#include "LazyPostalStore.h"
+#include "PostalRecordParser.h"
+
+using namespace std;
+
+/// @brief Number of ZIPs receiving the hot share of lookups.
+const size_t HOT_SET_SIZE = 2000;
+
+/**
+ * @brief Gets the heap bytes currently allocated.
+ * @return Bytes in use according to malloc, including mmap()ed chunks.
+ */
+static size_t heapBytes()
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+/**
+ * @brief Gets the time since a start point.
+ * @param start The start point.
+ * @return Elapsed nanoseconds.
+ */
+static double nanosecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Times fetching the records of a ZIP sequence.
+ * @param queries ZIPs to fetch.
+ * @param fetch Fetches one ZIP into a record.
+ * @return Nanoseconds per lookup.
+ */
+template <typename Fetch>
+static double timeLookups(const vector<int> &queries, Fetch fetch)
+{
+    HeaderRecordPostalCodeItem record;
+    size_t found = 0;
+    auto start = chrono::steady_clock::now();
+    for (int zip : queries)
+    {
+        found += fetch(zip, record);
+    }
+    double ns = nanosecondsSince(start) / queries.size();
+    if (found != queries.size())
+    {
+        cerr << "only " << found << " of " << queries.size() << " ZIPs found" << endl;
+    }
+    return ns;
+}
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_lazy [lookups] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments: lookups per workload (default 1000000).
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    size_t lookups = argc > 1 ? stoul(argv[1]) : 1000000;
+
+    size_t before = heapBytes();
+    LazyPostalStore store;
+    string error;
+    if (!store.open(fileName, error))
+    {
+        cerr << error << endl;
+        return 1;
+    }
+    size_t lazyBytes = heapBytes() - before;
+
+    before = heapBytes();
+    BlockSequenceSetPostalCode bss;
+    PostalRecordParser::loadBlockSequenceSet(bss, fileName);
+    DirectAddressZipTable table(bss);
+    size_t residentBytes = heapBytes() - before;
+
+    vector<int> zips = store.getZips();
+    mt19937 rng(42);
+    shuffle(zips.begin(), zips.end(), rng);
+    uniform_int_distribution<size_t> any(0, zips.size() - 1);
+    uniform_int_distribution<size_t> hot(0, min(HOT_SET_SIZE, zips.size()) - 1);
+    uniform_int_distribution<int> percent(0, 99);
+    vector<int> uniformQueries(lookups);
+    vector<int> hotQueries(lookups);
+    for (size_t i = 0; i < lookups; i++)
+    {
+        uniformQueries[i] = zips[any(rng)];
+        hotQueries[i] = zips[percent(rng) < 90 ? hot(rng) : any(rng)];
+    }
+
+    auto resident = [&](int zip, HeaderRecordPostalCodeItem &record)
+    {
+        const BlockPostalCode *block = table.find(zip);
+        if (block == nullptr)
+        {
+            return false;
+        }
+        record = block->getBlockItem();
+        return true;
+    };
+    LazyPostalStore uncached(0);
+    if (!uncached.open(fileName, error))
+    {
+        cerr << error << endl;
+        return 1;
+    }
+
+    cout << fixed << setprecision(1);
+    cout << zips.size() << " records, " << lookups << " lookups per workload" << endl;
+    cout << "heap, resident sequence set + table: " << residentBytes / 1024.0 << " KiB" << endl;
+    cout << "heap, lazy locations + empty cache:  " << lazyBytes / 1024.0 << " KiB ("
+         << (double)residentBytes / lazyBytes << "x less)" << endl;
+    cout << endl;
+    cout << left << setw(10) << "workload" << right << setw(12) << "resident" << setw(14) << "lazy cached"
+         << setw(12) << "hit rate" << setw(14) << "lazy no cache" << "   (ns/lookup)" << endl;
+    for (const auto &workload : {make_pair("uniform", &uniformQueries), make_pair("hot", &hotQueries)})
+    {
+        store.clearCache();
+        unsigned long hits = store.getHits();
+        unsigned long misses = store.getMisses();
+        double residentNs = timeLookups(*workload.second, resident);
+        double cachedNs = timeLookups(*workload.second, [&](int zip, HeaderRecordPostalCodeItem &record)
+                                      { return store.fetch(zip, record); });
+        hits = store.getHits() - hits;
+        misses = store.getMisses() - misses;
+        double uncachedNs = timeLookups(*workload.second, [&](int zip, HeaderRecordPostalCodeItem &record)
+                                        { return uncached.fetch(zip, record); });
+        cout << left << setw(10) << workload.first << right << setw(12) << residentNs << setw(14) << cachedNs
+             << setw(11) << 100.0 * hits / (hits + misses) << "%" << setw(14) << uncachedNs << endl;
+    }
+    cout << endl;
+    cout << "lazy store after the runs: " << store.memoryUsage() / 1024.0 << " KiB" << endl;
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file main_benchmark_packed.cpp
+ * @brief Compares HeaderRecordPostalCodeItem records with PostalRecordPacked.
+ *
+ * Checks first that every packed record unpacks to the original fields
+ * and formats byte-identically, then reports for both layouts:
+ *  - memory: record array plus heap-allocated names.
+ *  - scan:   a bounding-box count over coordinates and state.
+ *  - format: appendData() of every record into one reused buffer.
+ *  - copy:   copying all records (vector copy for items, memcpy for packed
+ *            records into and back out of a raw block buffer).
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include "PostalRecordParser.h"
+#include "PostalRecordPacked.h"
+
+using namespace std;
+
+/**
+ * @brief Gets the time since a start point.
+ * @param start The start point.
+ * @return Elapsed nanoseconds.
+ */
+static double nanosecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_packed [repeats] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments: passes per timed phase (default 50).
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    int repeats = argc > 1 ? stoi(argv[1]) : 50;
+
+    vector<HeaderRecordPostalCodeItem> items = PostalRecordParser::parseFile(fileName);
+    PackedPostalTable table;
+    table.reserve(items.size());
+    for (const HeaderRecordPostalCodeItem &item : items)
+    {
+        table.add(item);
+    }
+    size_t n = items.size();
+
+    // Round trip
+    string expected;
+    string actual;
+    for (size_t i = 0; i < n; i++)
+    {
+        expected.clear();
+        actual.clear();
+        items[i].appendData(expected);
+        table.appendData(i, actual);
+        HeaderRecordPostalCodeItem back = table.unpack(i);
+        if (expected != actual || back.getZip() != items[i].getZip() ||
+            back.getRecordLength() != items[i].getRecordLength() ||
+            back.getPlace() != items[i].getPlace() || back.getState() != items[i].getState() ||
+            back.getCounty() != items[i].getCounty() ||
+            back.getLatitude() != items[i].getLatitude() || back.getLongitude() != items[i].getLongitude())
+        {
+            cerr << "Round trip mismatch at record " << i << ": " << expected << " / " << actual << endl;
+            return 1;
+        }
+    }
+
+    size_t itemBytes = items.capacity() * sizeof(HeaderRecordPostalCodeItem);
+    for (const HeaderRecordPostalCodeItem &item : items)
+    {
+        for (const string *name : {&item.getPlace(), &item.getState(), &item.getCounty()})
+        {
+            itemBytes += name->capacity() > 15 ? name->capacity() + 1 : 0;
+        }
+    }
+
+    cout << fixed << setprecision(2);
+    cout << n << " records round-trip exactly, " << table.getOverflow().size()
+         << " names in the overflow table" << endl;
+    cout << "record size:  " << sizeof(HeaderRecordPostalCodeItem) << " B item, "
+         << sizeof(PostalRecordPacked) << " B packed" << endl;
+    cout << "memory:       " << itemBytes / 1024.0 << " KiB items, "
+         << table.memoryBytes() / 1024.0 << " KiB packed" << endl;
+
+    // Bounding-box count: the Upper Midwest, restricted to Minnesota
+    long itemHits = 0;
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        for (const HeaderRecordPostalCodeItem &item : items)
+        {
+            itemHits += item.getLatitude() >= 43.0 && item.getLatitude() <= 49.5 &&
+                        item.getLongitude() >= -97.5 && item.getLongitude() <= -89.0 &&
+                        item.getState() == "MN";
+        }
+    }
+    double itemScan = nanosecondsSince(start) / repeats / n;
+
+    long packedHits = 0;
+    const vector<PostalRecordPacked> &records = table.getRecords();
+    int32_t south = 43 * PostalRecordPacked::COORDINATE_SCALE;
+    int32_t north = (int32_t)(49.5 * PostalRecordPacked::COORDINATE_SCALE);
+    int32_t west = (int32_t)(-97.5 * PostalRecordPacked::COORDINATE_SCALE);
+    int32_t east = -89 * PostalRecordPacked::COORDINATE_SCALE;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        for (const PostalRecordPacked &record : records)
+        {
+            packedHits += record.getLatitudeE6() >= south && record.getLatitudeE6() <= north &&
+                          record.getLongitudeE6() >= west && record.getLongitudeE6() <= east &&
+                          record.getState() == "MN";
+        }
+    }
+    double packedScan = nanosecondsSince(start) / repeats / n;
+    if (itemHits != packedHits)
+    {
+        cerr << "Scan mismatch: " << itemHits << " / " << packedHits << endl;
+        return 1;
+    }
+
+    // Format
+    string buffer;
+    buffer.reserve(n * 64);
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        buffer.clear();
+        for (const HeaderRecordPostalCodeItem &item : items)
+        {
+            item.appendData(buffer);
+        }
+    }
+    double itemFormat = nanosecondsSince(start) / repeats / n;
+    size_t itemFormatted = buffer.size();
+
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        buffer.clear();
+        for (size_t i = 0; i < n; i++)
+        {
+            table.appendData(i, buffer);
+        }
+    }
+    double packedFormat = nanosecondsSince(start) / repeats / n;
+    if (buffer.size() != itemFormatted)
+    {
+        cerr << "Formatted sizes differ" << endl;
+        return 1;
+    }
+
+    // Copy
+    size_t copied = 0;
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        vector<HeaderRecordPostalCodeItem> copy(items);
+        copied += copy.size();
+    }
+    double itemCopy = nanosecondsSince(start) / repeats / n;
+
+    vector<char> blockBytes(n * sizeof(PostalRecordPacked));
+    vector<PostalRecordPacked> copyBack(n);
+    start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+    {
+        memcpy(blockBytes.data(), records.data(), blockBytes.size());
+        memcpy(copyBack.data(), blockBytes.data(), blockBytes.size());
+        copied += copyBack.size();
+    }
+    double packedCopy = nanosecondsSince(start) / repeats / n;
+    if (memcmp(copyBack.data(), records.data(), blockBytes.size()) != 0)
+    {
+        cerr << "Block copy mismatch" << endl;
+        return 1;
+    }
+
+    cout << "\n"
+         << left << setw(10) << "ns/record" << right << setw(10) << "item" << setw(10) << "packed" << endl;
+    cout << left << setw(10) << "scan" << right << setw(10) << itemScan << setw(10) << packedScan
+         << "   (" << packedHits / repeats << " hits)" << endl;
+    cout << left << setw(10) << "format" << right << setw(10) << itemFormat << setw(10) << packedFormat << endl;
+    cout << left << setw(10) << "copy" << right << setw(10) << itemCopy << setw(10) << packedCopy
+         << "   (packed: to block and back)" << endl;
+    return copied > 0 ? 0 : 1;
+}
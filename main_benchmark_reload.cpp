@@ -0,0 +1,174 @@
+/**
+ * @file main_benchmark_reload.cpp
+ * @brief Measures reader latency while the dataset is reloaded.
+ *
+ * Reader threads look up random ZIPs in a loop and record the latency of
+ * every lookup while another thread reloads the data file a few times.
+ * Two ways of reloading are compared:
+ *  - locked: readers take a shared lock and the reload rebuilds the
+ *            dataset under the exclusive lock, so readers stop until the
+ *            new sequence set and indexes are built;
+ *  - rcu:    the reload builds the new dataset on the side and publishes
+ *            it through a PostalDatasetPublisher; readers never wait.
+ * Reports the lookups done and their latency percentiles for each mode.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <shared_mutex>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include "PostalDataset.h"
+#include "PostalDatasetPublisher.h"
+
+using namespace std;
+
+const string DATA_FILE = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+
+/**
+ * @brief Loads a dataset, exiting on failure.
+ * @return The dataset.
+ */
+static unique_ptr<PostalDataset> loadDataset()
+{
+    unique_ptr<PostalDataset> dataset(new PostalDataset());
+    string error;
+    if (!dataset->load(DATA_FILE, error))
+    {
+        cerr << error << endl;
+        exit(1);
+    }
+    return dataset;
+}
+
+/**
+ * @brief Runs readers against reloads and prints their latency percentiles.
+ * @param mode Name printed for the run.
+ * @param zips ZIPs to look up.
+ * @param readers Reader threads.
+ * @param reloads Number of reloads.
+ * @param lookup Looks up one ZIP; returns whether it was found.
+ * @param reload Reloads the dataset.
+ */
+template <typename Lookup, typename Reload>
+static void run(const string &mode, const vector<int> &zips, int readers, int reloads, Lookup lookup,
+                Reload reload)
+{
+    atomic<bool> done(false);
+    vector<vector<uint32_t>> latencies(readers);
+    vector<size_t> missing(readers, 0);
+    vector<thread> threads;
+    for (int r = 0; r < readers; r++)
+    {
+        threads.emplace_back([&, r]()
+                             {
+            mt19937 rng(r + 1);
+            latencies[r].reserve(1 << 22);
+            while (!done)
+            {
+                int zip = zips[rng() % zips.size()];
+                auto start = chrono::steady_clock::now();
+                bool found = lookup(zip);
+                auto stop = chrono::steady_clock::now();
+                missing[r] += !found;
+                latencies[r].push_back((uint32_t)chrono::duration_cast<chrono::nanoseconds>(stop - start).count());
+            } });
+    }
+
+    double reloadMs = 0;
+    for (int i = 0; i < reloads; i++)
+    {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        auto start = chrono::steady_clock::now();
+        reload();
+        reloadMs += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    }
+    this_thread::sleep_for(chrono::milliseconds(100));
+    done = true;
+    for (thread &t : threads)
+    {
+        t.join();
+    }
+
+    vector<uint32_t> all;
+    size_t lost = 0;
+    for (int r = 0; r < readers; r++)
+    {
+        all.insert(all.end(), latencies[r].begin(), latencies[r].end());
+        lost += missing[r];
+    }
+    sort(all.begin(), all.end());
+    auto percentile = [&](double p)
+    { return all[min(all.size() - 1, (size_t)(p * all.size()))] / 1000.0; };
+    cout << setw(8) << mode << setw(12) << all.size() << setw(10) << percentile(0.5) << setw(10)
+         << percentile(0.99) << setw(10) << percentile(0.999) << setw(12) << all.back() / 1000.0 << setw(12)
+         << reloadMs / reloads << (lost ? "  (ZIPS NOT FOUND)" : "") << endl;
+}
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_reload [readers] [reloads] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments: reader threads (default 2) and reloads (default 5).
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    int readers = argc > 1 ? stoi(argv[1]) : 2;
+    int reloads = argc > 2 ? stoi(argv[2]) : 5;
+
+    vector<int> zips;
+    {
+        unique_ptr<PostalDataset> dataset = loadDataset();
+        for (const BlockPostalCode *block = dataset->getSequenceSet().getHeadBlock(); block != nullptr;
+             block = block->getNext())
+        {
+            zips.push_back(block->getBlockItem().getZip());
+        }
+    }
+
+    cout << readers << " readers, " << reloads << " reloads of " << zips.size() << " records" << endl;
+    cout << fixed << setprecision(2);
+    cout << setw(8) << "mode" << setw(12) << "lookups" << setw(10) << "p50 us" << setw(10) << "p99 us"
+         << setw(10) << "p99.9 us" << setw(12) << "max us" << setw(12) << "reload ms" << endl;
+
+    // Readers stop while the dataset is rebuilt in place
+    {
+        shared_mutex lock;
+        unique_ptr<PostalDataset> dataset = loadDataset();
+        run("locked", zips, readers, reloads, [&](int zip)
+            {
+                shared_lock<shared_mutex> guard(lock);
+                return dataset->getTable().find(zip) != nullptr; },
+            [&]()
+            {
+                unique_lock<shared_mutex> guard(lock);
+                dataset.reset();
+                dataset = loadDataset(); });
+    }
+
+    // The new dataset is built aside and published
+    {
+        PostalDatasetPublisher datasets(loadDataset());
+        run("rcu", zips, readers, reloads, [&](int zip)
+            {
+                PostalDatasetPublisher::ReadGuard dataset(datasets);
+                return dataset->getTable().find(zip) != nullptr; },
+            [&]()
+            { datasets.publish(loadDataset()); });
+        if (datasets.getReclaimed() != (uint64_t)reloads)
+        {
+            cerr << "only " << datasets.getReclaimed() << " of " << reloads << " old versions reclaimed" << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,235 @@
+/**
+ * @file main_benchmark_scheduler.cpp
+ * @brief Measures the WorkStealingPool: scheduling overhead and load balance.
+ *
+ * Reports:
+ *  - The cost per task of submit() + future, of parallelFor() indices with
+ *    a grain of 1, and of starting one std::thread per task for comparison.
+ *  - Load balance on skewed partitions: the records are grouped by their
+ *    2-digit ZIP prefix, whose sizes differ by orders of magnitude (rural
+ *    states next to dense metro areas), and every group runs an all-pairs
+ *    nearest-neighbour pass whose cost grows with the square of its size.
+ *    Static partitioning, which gives each thread an equal count of
+ *    consecutive prefixes, is compared with one pool task per prefix.
+ *    Both compute the same checksum as a serial pass.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include "PostalRecordParser.h"
+#include "WorkStealingPool.h"
+#include "GeoDistance.h"
+
+using namespace std;
+
+/**
+ * @struct PrefixGroup
+ * @brief Records sharing a 2-digit ZIP prefix.
+ */
+struct PrefixGroup
+{
+    int prefix;               ///< First two digits of the ZIPs.
+    vector<double> latitude;  ///< Latitudes of the records.
+    vector<double> longitude; ///< Longitudes of the records.
+};
+
+/**
+ * @brief Sums, over a group, each record's distance to its nearest other record.
+ * @param group The group.
+ * @return The sum in kilometres.
+ */
+static double nearestNeighbourSum(const PrefixGroup &group)
+{
+    double sum = 0;
+    size_t n = group.latitude.size();
+    for (size_t i = 0; i < n; i++)
+    {
+        double best = 1e300;
+        for (size_t j = 0; j < n; j++)
+        {
+            if (i != j)
+            {
+                best = min(best, haversineKm(group.latitude[i], group.longitude[i],
+                                             group.latitude[j], group.longitude[j]));
+            }
+        }
+        sum += n > 1 ? best : 0;
+    }
+    return sum;
+}
+
+/**
+ * @brief Gets the time since a start point.
+ * @param start The start point.
+ * @return Elapsed milliseconds.
+ */
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_scheduler [threads] [tasks] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments: worker count (default: max(4, hardware threads)) and overhead task count.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    int threads = argc > 1 ? stoi(argv[1]) : max(4, (int)thread::hardware_concurrency());
+    int taskCount = argc > 2 ? stoi(argv[2]) : 200000;
+
+    WorkStealingPool pool(threads);
+    cout << fixed << setprecision(1);
+    cout << "Pool of " << pool.size() << " workers on " << thread::hardware_concurrency()
+         << " hardware threads" << endl;
+
+    // Scheduling overhead
+    atomic<long> counter(0);
+    auto start = chrono::steady_clock::now();
+    vector<future<void>> futures;
+    futures.reserve(taskCount);
+    for (int i = 0; i < taskCount; i++)
+    {
+        futures.push_back(pool.submit([&counter]()
+                                      { counter.fetch_add(1, memory_order_relaxed); }));
+    }
+    for (future<void> &result : futures)
+    {
+        pool.waitFor(result);
+    }
+    double submitMs = millisecondsSince(start);
+
+    start = chrono::steady_clock::now();
+    pool.parallelFor(0, taskCount, 1, [&counter](size_t begin, size_t end)
+                     { counter.fetch_add(end - begin, memory_order_relaxed); });
+    double forMs = millisecondsSince(start);
+
+    int threadTasks = min(taskCount, 2000);
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < threadTasks; i++)
+    {
+        thread([&counter]()
+               { counter.fetch_add(1, memory_order_relaxed); })
+            .join();
+    }
+    double threadMs = millisecondsSince(start);
+
+    cout << "submit + future:      " << submitMs * 1e6 / taskCount << " ns/task" << endl;
+    cout << "parallelFor grain 1:  " << forMs * 1e6 / taskCount << " ns/index" << endl;
+    cout << "std::thread per task: " << threadMs * 1e6 / threadTasks << " ns/task" << endl;
+    if (counter != 2L * taskCount + threadTasks)
+    {
+        cerr << "Lost tasks: counted " << counter << endl;
+        return 1;
+    }
+
+    // Skewed partitions: one group per 2-digit ZIP prefix
+    vector<HeaderRecordPostalCodeItem> records = PostalRecordParser::parseFile(fileName, pool);
+    vector<PrefixGroup> groups;
+    for (const HeaderRecordPostalCodeItem &record : records)
+    {
+        int prefix = record.getZip() / 1000;
+        if (groups.empty() || groups.back().prefix != prefix)
+        {
+            groups.push_back({prefix, {}, {}});
+        }
+        groups.back().latitude.push_back(record.getLatitude());
+        groups.back().longitude.push_back(record.getLongitude());
+    }
+    size_t smallest = records.size();
+    size_t largest = 0;
+    for (const PrefixGroup &group : groups)
+    {
+        smallest = min(smallest, group.latitude.size());
+        largest = max(largest, group.latitude.size());
+    }
+    cout << "\n"
+         << groups.size() << " ZIP prefixes, " << smallest << " to " << largest
+         << " records each" << endl;
+
+    vector<double> sums(groups.size());
+    auto checksum = [&sums]()
+    {
+        double total = 0;
+        for (double sum : sums)
+        {
+            total += sum;
+        }
+        return total;
+    };
+
+    start = chrono::steady_clock::now();
+    for (size_t g = 0; g < groups.size(); g++)
+    {
+        sums[g] = nearestNeighbourSum(groups[g]);
+    }
+    double serialMs = millisecondsSince(start);
+    double serialSum = checksum();
+
+    // Static: each thread gets an equal count of consecutive prefixes.
+    vector<double> pairWork(threads, 0);
+    fill(sums.begin(), sums.end(), 0);
+    start = chrono::steady_clock::now();
+    vector<thread> workers;
+    size_t chunk = (groups.size() + threads - 1) / threads;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]()
+                             {
+            for (size_t g = t * chunk; g < min(groups.size(), (t + 1) * chunk); g++)
+            {
+                sums[g] = nearestNeighbourSum(groups[g]);
+                pairWork[t] += (double)groups[g].latitude.size() * groups[g].latitude.size();
+            } });
+    }
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+    double staticMs = millisecondsSince(start);
+    double staticSum = checksum();
+    double meanWork = 0;
+    for (double work : pairWork)
+    {
+        meanWork += work / threads;
+    }
+    double maxWork = *max_element(pairWork.begin(), pairWork.end());
+
+    // Pool: one task per prefix, idle workers steal the rest.
+    fill(sums.begin(), sums.end(), 0);
+    unsigned long stealsBefore = pool.steals();
+    start = chrono::steady_clock::now();
+    pool.parallelFor(0, groups.size(), 1, [&](size_t begin, size_t end)
+                     {
+        for (size_t g = begin; g < end; g++)
+        {
+            sums[g] = nearestNeighbourSum(groups[g]);
+        } });
+    double poolMs = millisecondsSince(start);
+    double poolSum = checksum();
+
+    cout << "serial:               " << serialMs << " ms" << endl;
+    cout << "static partitions:    " << staticMs << " ms (busiest thread has "
+         << setprecision(2) << maxWork / meanWork << "x the mean work)" << endl;
+    cout << setprecision(1) << "work-stealing pool:   " << poolMs << " ms ("
+         << pool.steals() - stealsBefore << " steals)" << endl;
+    if (staticSum != serialSum || poolSum != serialSum)
+    {
+        cerr << "Checksum mismatch" << endl;
+        return 1;
+    }
+    cout << "checksum " << setprecision(3) << serialSum << " km (all three agree)" << endl;
+
+    return 0;
+}
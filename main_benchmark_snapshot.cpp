@@ -0,0 +1,164 @@
+/**
+ * @file main_benchmark_snapshot.cpp
+ * @brief Measures copy-on-write snapshots of the ZIP B+ tree.
+ *
+ * Builds the ZIP tree of the dataset and reports:
+ *  - the cost of taking and releasing a snapshot;
+ *  - the cost of an update (remove plus re-insert of a random ZIP) with no
+ *    snapshot held and with a fresh snapshot before every update, which
+ *    makes every update copy its whole path;
+ *  - the memory held by a snapshot after a number of updates, i.e. the
+ *    nodes no longer shared with the live tree;
+ *  - a national export running concurrently with updates: a reader thread
+ *    walks a snapshot with its iterator over and over while the main
+ *    thread updates the tree, and every walk is compared with the keys
+ *    the snapshot was taken of.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include "B+tree.cpp"
+#include "BlockSequenceSetPostalCode.h"
+#include "PostalRecordParser.h"
+
+using namespace std;
+
+const string DATA_FILE = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+
+/**
+ * @brief Gets the time since a start point.
+ * @param start The start point.
+ * @return Elapsed nanoseconds.
+ */
+static double nanosecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Removes and re-inserts a random ZIP.
+ * @param tree The tree.
+ * @param zips Every ZIP of the tree.
+ * @param rng Random source.
+ */
+static void update(BPlusTree<int> &tree, const vector<int> &zips, mt19937 &rng)
+{
+    int zip = zips[rng() % zips.size()];
+    tree.remove(zip);
+    tree.insert(zip);
+}
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_snapshot [updates] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments: number of updates timed (default 100000).
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    int updates = argc > 1 ? stoi(argv[1]) : 100000;
+
+    vector<int> zips;
+    {
+        BlockSequenceSetPostalCode bss;
+        PostalRecordParser::loadBlockSequenceSet(bss, DATA_FILE);
+        for (const BlockPostalCode *block = bss.getHeadBlock(); block != nullptr; block = block->getNext())
+        {
+            zips.push_back(block->getBlockItem().getZip());
+        }
+    }
+    BPlusTree<int> tree(10);
+    for (int zip : zips)
+    {
+        tree.insert(zip);
+    }
+    tree.releaseFreeList();
+    BPlusTree<int>::MemoryUsage usage = tree.memoryUsage();
+    cout << zips.size() << " ZIPs, " << usage.leafNodes + usage.internalNodes << " nodes, "
+         << usage.totalBytes() / 1024 << " KiB" << endl;
+    cout << fixed << setprecision(1);
+
+    // Snapshot cost
+    const int SNAPSHOTS = 1000000;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < SNAPSHOTS; i++)
+    {
+        BPlusTree<int>::Snapshot snapshot = tree.snapshot();
+    }
+    cout << "snapshot() + release:          " << nanosecondsSince(start) / SNAPSHOTS << " ns" << endl;
+
+    // Update cost without and with a snapshot pinning every version
+    mt19937 rng(42);
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < updates; i++)
+    {
+        update(tree, zips, rng);
+    }
+    cout << "update, no snapshot:           " << nanosecondsSince(start) / updates << " ns" << endl;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < updates; i++)
+    {
+        BPlusTree<int>::Snapshot snapshot = tree.snapshot();
+        update(tree, zips, rng);
+    }
+    cout << "update, snapshot before each:  " << nanosecondsSince(start) / updates << " ns" << endl;
+
+    // Memory a snapshot keeps once the tree moves on
+    for (int count : {1, 10, 100, 1000, 10000})
+    {
+        BPlusTree<int>::Snapshot snapshot = tree.snapshot();
+        for (int i = 0; i < count; i++)
+        {
+            update(tree, zips, rng);
+        }
+        BPlusTree<int>::MemoryUsage held = snapshot.memoryUsage();
+        cout << "snapshot after " << setw(5) << count << " updates holds " << setw(5)
+             << held.leafNodes + held.internalNodes << " nodes, " << setw(6) << held.totalBytes() / 1024.0
+             << " KiB (" << 100.0 * held.totalBytes() / usage.totalBytes() << "% of the tree)" << endl;
+    }
+
+    // Full exports of a snapshot while the tree is updated
+    BPlusTree<int>::Snapshot exported = tree.snapshot();
+    vector<int> expected = tree.rangeQuery(zips.front(), zips.back());
+    atomic<bool> done(false);
+    atomic<long> exports(0);
+    atomic<long> mismatches(0);
+    thread reader([&]()
+                  {
+        while (!done)
+        {
+            size_t i = 0;
+            bool same = true;
+            for (BPlusTree<int>::Iterator it = exported.begin(); it != exported.end(); ++it, i++)
+            {
+                same = same && i < expected.size() && *it == expected[i];
+            }
+            mismatches += !same || i != expected.size();
+            exports++;
+        } });
+    long concurrentUpdates = 0;
+    start = chrono::steady_clock::now();
+    while (exports < 50)
+    {
+        // New ZIPs force splits, removing them forces merges
+        int zip = 100000 + (int)(rng() % 100000);
+        tree.insert(zip);
+        update(tree, zips, rng);
+        tree.remove(zip);
+        concurrentUpdates += 3;
+    }
+    done = true;
+    reader.join();
+    cout << exports << " exports of " << expected.size() << " ZIPs during " << concurrentUpdates
+         << " updates in " << nanosecondsSince(start) / 1e6 << " ms: " << mismatches << " inconsistent" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file main_benchmark_update.cpp
+ * @brief Runs an update-heavy insert/remove workload against the B+ tree.
+ *
+ * Builds the ZIP tree, then repeatedly removes and re-inserts random ZIPs
+ * so nodes are merged and split over and over. Reports the update rate and
+ * the tree's memory usage by node type, including how many nodes are being
+ * recycled through the free-list instead of the heap.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "readHeaderPostalCodetoBSSBuffer.cpp"
+#include "B+tree.cpp"
+
+using namespace std;
+
+/**
+ * @brief Prints the memory usage of a tree by node type.
+ * @param label Heading for the report line.
+ * @param tree The tree to inspect.
+ */
+void printMemoryUsage(const string &label, const BPlusTree<int> &tree)
+{
+    BPlusTree<int>::MemoryUsage usage = tree.memoryUsage();
+    cout << label << endl
+         << "  leaves:    " << setw(8) << usage.leafNodes << " nodes " << setw(10) << usage.leafBytes << " bytes" << endl
+         << "  internal:  " << setw(8) << usage.internalNodes << " nodes " << setw(10) << usage.internalBytes << " bytes" << endl
+         << "  free-list: " << setw(8) << usage.freeNodes << " nodes " << setw(10) << usage.freeBytes << " bytes" << endl
+         << "  total:     " << setw(25) << usage.totalBytes() << " bytes" << endl
+         << "  stats:     " << tree.stats().toJson() << endl;
+}
+
+/**
+ * @brief Program entry point.
+ *
+ * Usage: @code benchmark_update [rounds] @endcode
+ *
+ * @param argc Argument count.
+ * @param argv Arguments; argv[1] optionally sets the number of remove/insert rounds.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    int rounds = argc > 1 ? stoi(argv[1]) : 20;                             ///< Number of churn rounds
+
+    BlockSequenceSetPostalCode myBlockSequenceSetPostalCode;
+    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName);
+
+    BPlusTree<int> tree(10);
+    vector<int> zips;
+    for (const BlockPostalCode *block = myBlockSequenceSetPostalCode.getHeadBlock();
+         block != nullptr; block = block->getNext())
+    {
+        tree.insert(block->getBlockItem().getZip());
+        zips.push_back(block->getBlockItem().getZip());
+    }
+
+    printMemoryUsage("After build:", tree);
+
+    // Each round removes a random half of the ZIPs, then inserts them back
+    mt19937 rng(42);
+    long updates = 0;
+    auto start = chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        shuffle(zips.begin(), zips.end(), rng);
+        size_t half = zips.size() / 2;
+        for (size_t i = 0; i < half; i++)
+        {
+            tree.remove(zips[i]);
+        }
+        for (size_t i = 0; i < half; i++)
+        {
+            tree.insert(zips[i]);
+        }
+        updates += 2 * half;
+    }
+    auto stop = chrono::steady_clock::now();
+
+    double seconds = chrono::duration<double>(stop - start).count();
+    cout << updates << " updates in " << fixed << setprecision(3) << seconds
+         << " s (" << setprecision(0) << updates / seconds << " updates/s)" << endl;
+
+    printMemoryUsage("After churn:", tree);
+
+    tree.releaseFreeList();
+    printMemoryUsage("After releaseFreeList():", tree);
+
+    return 0;
+}
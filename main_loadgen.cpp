@@ -0,0 +1,326 @@
+/**
+ * @file main_loadgen.cpp
+ * @brief Load generator for the postal query server.
+ *
+ * Usage:
+ * @code
+ * loadgen [socketPath] [connections] [pipelineDepth] [seconds] [lookup%] [range%] [hot%]
+ * @endcode
+ * Opens @c connections client threads, each keeping @c pipelineDepth
+ * requests in flight, and sends a random mix of lookups (random ZIPs),
+ * 100-ZIP range scans and 10-nearest queries (random points in the
+ * contiguous US) for the given duration. The remainder of the mix after
+ * lookup% and range% is nearest queries. @c hot% of the lookups (default
+ * 0) go to a hot set: the first HOT_SET_SIZE existing ZIPs each client
+ * has seen, which models skewed metro traffic. Reports queries per
+ * second and the p50 / p99 / max latency of each request type.
+ */
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "PostalProtocol.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+/// @brief Number of ZIPs in each client's hot set.
+const size_t HOT_SET_SIZE = 2000;
+
+/**
+ * @struct ClientResult
+ * @brief Latencies and counters gathered by one client thread.
+ */
+struct ClientResult
+{
+    vector<double> latencies[4]; ///< Microseconds per request, indexed by RequestOp.
+    size_t records = 0;          ///< Records received.
+    size_t errors = 0;           ///< Bad or unexpected responses.
+    bool connected = false;      ///< Whether the connection succeeded.
+};
+
+/**
+ * @brief Connects to the server socket.
+ * @param path Socket path.
+ * @return The connected socket, or -1.
+ */
+int connectServer(const string &path)
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (sockaddr *)&address, sizeof(address)) < 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Writes a whole buffer to a blocking socket.
+ * @param fd The socket.
+ * @param data Bytes to send.
+ * @return false on error.
+ */
+bool sendAll(int fd, const string &data)
+{
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        ssize_t n = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        offset += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs one client: keeps @p depth requests in flight until @p deadline.
+ * @param path Socket path.
+ * @param depth Pipeline depth.
+ * @param deadline When to stop issuing requests.
+ * @param lookupPercent Share of lookup requests.
+ * @param rangePercent Share of range requests.
+ * @param hotPercent Share of lookups sent to the hot set.
+ * @param seed Random seed.
+ * @param result Receives latencies and counters.
+ */
+void runClient(const string &path, int depth, Clock::time_point deadline,
+               int lookupPercent, int rangePercent, int hotPercent, unsigned seed,
+               ClientResult &result)
+{
+    int fd = connectServer(path);
+    if (fd < 0)
+    {
+        return;
+    }
+    result.connected = true;
+
+    mt19937 random(seed);
+    uniform_int_distribution<int> percent(0, 99);
+    uniform_int_distribution<int> zips(500, 99950);
+    uniform_real_distribution<double> latitudes(25, 49);
+    uniform_real_distribution<double> longitudes(-124, -67);
+
+    vector<Clock::time_point> sentAt(depth);
+    vector<uint8_t> opOf(depth);
+    size_t inFlight = 0;
+    string outgoing, incoming;
+    vector<ProtocolRecord> records;
+    vector<int> hotZips;
+
+    auto issue = [&](uint32_t slot)
+    {
+        ProtocolRequest request = {};
+        request.id = slot; // one request in flight per slot
+        int draw = percent(random);
+        if (draw < lookupPercent)
+        {
+            request.op = OP_LOOKUP;
+            request.zip = zips(random);
+            if (!hotZips.empty() && percent(random) < hotPercent)
+            {
+                request.zip = hotZips[random() % hotZips.size()];
+            }
+        }
+        else if (draw < lookupPercent + rangePercent)
+        {
+            request.op = OP_RANGE;
+            request.lower = zips(random);
+            request.upper = request.lower + 99;
+            request.limit = 100;
+        }
+        else
+        {
+            request.op = OP_NEAREST;
+            request.latitude = latitudes(random);
+            request.longitude = longitudes(random);
+            request.limit = 10;
+        }
+        opOf[slot] = request.op;
+        sentAt[slot] = Clock::now();
+        PostalProtocol::encodeRequest(request, outgoing);
+        inFlight++;
+    };
+
+    for (int slot = 0; slot < depth; slot++)
+    {
+        issue(slot);
+    }
+    char chunk[65536];
+    while (inFlight > 0)
+    {
+        if (!outgoing.empty())
+        {
+            if (!sendAll(fd, outgoing))
+            {
+                result.errors++;
+                break;
+            }
+            outgoing.clear();
+        }
+
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+        {
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            result.errors++;
+            break;
+        }
+        incoming.append(chunk, n);
+
+        size_t offset = 0;
+        uint32_t bodyLength;
+        Clock::time_point now = Clock::now();
+        while (PostalProtocol::completeFrame(incoming.data() + offset, incoming.size() - offset, bodyLength))
+        {
+            uint32_t id;
+            uint8_t status;
+            const char *body = incoming.data() + offset + PostalProtocol::LENGTH_BYTES;
+            offset += PostalProtocol::LENGTH_BYTES + bodyLength;
+            if (!PostalProtocol::decodeResponse(body, bodyLength, id, status, records) ||
+                status == STATUS_BAD_REQUEST)
+            {
+                result.errors++;
+                continue;
+            }
+            uint32_t slot = id;
+            if (slot >= (uint32_t)depth)
+            {
+                result.errors++;
+                continue;
+            }
+            result.latencies[opOf[slot]].push_back(
+                chrono::duration<double, micro>(now - sentAt[slot]).count());
+            result.records += records.size();
+            if (opOf[slot] == OP_LOOKUP && !records.empty() && hotZips.size() < HOT_SET_SIZE)
+            {
+                hotZips.push_back(records[0].zip);
+            }
+            inFlight--;
+            if (now < deadline)
+            {
+                issue(slot);
+            }
+        }
+        incoming.erase(0, offset);
+    }
+    close(fd);
+}
+
+/**
+ * @brief Gets a percentile of sorted samples.
+ * @param sorted Samples in ascending order.
+ * @param fraction Percentile as a fraction (0.5 for p50).
+ * @return The sample at that rank, or 0 when empty.
+ */
+double percentile(const vector<double> &sorted, double fraction)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t rank = min(sorted.size() - 1, (size_t)(fraction * sorted.size()));
+    return sorted[rank];
+}
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: socket path, connections, depth, duration and request mix.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string socketPath = argc > 1 ? argv[1] : "/tmp/postal.sock";
+    int connections = argc > 2 ? stoi(argv[2]) : 4;
+    int depth = argc > 3 ? max(1, stoi(argv[3])) : 16;
+    double seconds = argc > 4 ? stod(argv[4]) : 5;
+    int lookupPercent = argc > 5 ? stoi(argv[5]) : 90;
+    int rangePercent = argc > 6 ? stoi(argv[6]) : 5;
+    int hotPercent = argc > 7 ? stoi(argv[7]) : 0;
+
+    vector<ClientResult> results(connections);
+    vector<thread> clients;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + chrono::duration_cast<Clock::duration>(
+                                             chrono::duration<double>(seconds));
+    for (int c = 0; c < connections; c++)
+    {
+        clients.emplace_back(runClient, socketPath, depth, deadline, lookupPercent,
+                             rangePercent, hotPercent, 12345u + c, ref(results[c]));
+    }
+    for (thread &client : clients)
+    {
+        client.join();
+    }
+    double elapsed = chrono::duration<double>(Clock::now() - start).count();
+
+    vector<double> all, byOp[4];
+    size_t records = 0, errors = 0;
+    int connected = 0;
+    for (ClientResult &result : results)
+    {
+        connected += result.connected;
+        records += result.records;
+        errors += result.errors;
+        for (int op = OP_LOOKUP; op <= OP_NEAREST; op++)
+        {
+            byOp[op].insert(byOp[op].end(), result.latencies[op].begin(), result.latencies[op].end());
+        }
+    }
+    if (connected == 0)
+    {
+        cerr << "Cannot connect to " << socketPath << endl;
+        return 1;
+    }
+
+    static const char *names[] = {"", "lookup", "range", "nearest"};
+    cout << left << setw(10) << "Request" << right << setw(12) << "Count" << setw(12) << "p50 us"
+         << setw(12) << "p99 us" << setw(12) << "max us" << endl;
+    cout << fixed << setprecision(1);
+    for (int op = OP_LOOKUP; op <= OP_NEAREST + 1; op++)
+    {
+        vector<double> &samples = op <= OP_NEAREST ? byOp[op] : all;
+        if (op <= OP_NEAREST)
+        {
+            all.insert(all.end(), samples.begin(), samples.end());
+        }
+        sort(samples.begin(), samples.end());
+        cout << left << setw(10) << (op <= OP_NEAREST ? names[op] : "all") << right
+             << setw(12) << samples.size() << setw(12) << percentile(samples, 0.50)
+             << setw(12) << percentile(samples, 0.99)
+             << setw(12) << (samples.empty() ? 0 : samples.back()) << endl;
+    }
+
+    cout << "\n"
+         << all.size() << " requests over " << connected << " connections (depth " << depth
+         << ") in " << setprecision(2) << elapsed << " s: " << setprecision(0)
+         << all.size() / elapsed << " queries/s, " << records << " records, "
+         << errors << " errors" << endl;
+    return errors == 0 ? 0 : 1;
+}
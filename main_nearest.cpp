@@ -0,0 +1,96 @@
+/**
+ * @file main_nearest.cpp
+ * @brief Answers nearest-ZIP and radius queries by latitude/longitude.
+ *
+ * Usage:
+ * @code
+ * nearest <lat> <lon> [k] [radiusKm]
+ * @endcode
+ * Prints the @c k ZIP codes nearest to the point (default 5) and, when a
+ * radius is given, how many ZIP codes lie within it. Query latency is
+ * measured by repeating each query and reported in microseconds.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "readHeaderPostalCodetoBSSBuffer.cpp"
+#include "KdTreePostalCode.h"
+
+using namespace std;
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: latitude, longitude, optional k and radius.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        cout << "Usage: nearest <lat> <lon> [k] [radiusKm]" << endl;
+        return 1;
+    }
+
+    double lat = stod(argv[1]);
+    double lon = stod(argv[2]);
+    int k = argc > 3 ? stoi(argv[3]) : 5;
+    double radiusKm = argc > 4 ? stod(argv[4]) : 0;
+    const int repeats = 10000; ///< Repetitions used to time each query
+
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+
+    BlockSequenceSetPostalCode myBlockSequenceSetPostalCode;
+    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName);
+
+    auto buildStart = chrono::steady_clock::now();
+    KdTreePostalCode spatialIndex(myBlockSequenceSetPostalCode);
+    auto buildStop = chrono::steady_clock::now();
+
+    cout << "Spatial index over " << spatialIndex.size() << " ZIPs built in "
+         << fixed << setprecision(1)
+         << chrono::duration<double, milli>(buildStop - buildStart).count() << " ms" << endl;
+
+    vector<SpatialMatch> matches;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < repeats; i++)
+    {
+        matches = spatialIndex.nearest(lat, lon, k);
+    }
+    auto stop = chrono::steady_clock::now();
+
+    cout << "\n"
+         << k << " nearest ZIPs ("
+         << setprecision(2) << chrono::duration<double, micro>(stop - start).count() / repeats
+         << " us/query):" << endl;
+    for (const SpatialMatch &match : matches)
+    {
+        const HeaderRecordPostalCodeItem &item = match.block->getBlockItem();
+        cout << left << setw(8) << match.zip
+             << setw(25) << item.getPlace()
+             << setw(4) << item.getState()
+             << right << setw(10) << setprecision(2) << match.distanceKm << " km" << endl;
+    }
+
+    if (radiusKm > 0)
+    {
+        start = chrono::steady_clock::now();
+        for (int i = 0; i < repeats; i++)
+        {
+            matches = spatialIndex.withinRadius(lat, lon, radiusKm);
+        }
+        stop = chrono::steady_clock::now();
+
+        cout << "\n"
+             << matches.size() << " ZIPs within " << radiusKm << " km ("
+             << chrono::duration<double, micro>(stop - start).count() / repeats
+             << " us/query)" << endl;
+    }
+
+    return 0;
+}
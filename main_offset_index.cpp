@@ -0,0 +1,150 @@
+/**
+ * @file main_offset_index.cpp
+ * @brief Builds the byte-offset side-car of the data file and fetches records through it.
+ *
+ * Usage:
+ * @code
+ * offset_index build
+ * offset_index get <zip>...
+ * offset_index check
+ * @endcode
+ * @c build indexes the data file in one prefix-hopping pass and writes
+ * the side-car next to it. @c get loads the side-car (building it if it is
+ * missing or stale) and reads each requested record with one pread(),
+ * without loading any other record. @c check compares the index with a
+ * full parse: every record parsed at its indexed offset must equal the
+ * record parsed from the line sweep, and the times of both are reported.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "PostalOffsetIndex.h"
+#include "PostalRecordParser.h"
+
+using namespace std;
+
+/**
+ * @brief Gets the time since a start point.
+ * @param start The start point.
+ * @return Elapsed milliseconds.
+ */
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: command and its operands.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    string command = argc > 1 ? argv[1] : "";
+    PostalOffsetIndex index;
+    string error;
+
+    if (command == "build")
+    {
+        auto start = chrono::steady_clock::now();
+        if (!index.build(fileName, error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        double buildMs = millisecondsSince(start);
+        string sideCar = PostalOffsetIndex::sideCarPath(fileName);
+        if (!index.save(sideCar, error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        cout << index.size() << " records of " << index.getDataBytes() << " bytes indexed in " << buildMs
+             << " ms; wrote " << sideCar << endl;
+        return 0;
+    }
+
+    if (command == "get" && argc > 2)
+    {
+        if (!index.loadOrBuild(fileName, error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            cerr << "Cannot open " << fileName << endl;
+            return 1;
+        }
+        int missing = 0;
+        string line;
+        for (int i = 2; i < argc; i++)
+        {
+            const RecordLocation *location = index.find(atoi(argv[i]));
+            if (location == nullptr)
+            {
+                cout << argv[i] << ": not found" << endl;
+                missing++;
+                continue;
+            }
+            line.resize(location->length);
+            if (pread(fd, &line[0], line.size(), location->offset) != (ssize_t)line.size())
+            {
+                cerr << "Cannot read " << fileName << endl;
+                close(fd);
+                return 1;
+            }
+            cout << line.substr(2) << "  (offset " << location->offset << ")" << endl;
+        }
+        close(fd);
+        return missing == 0 ? 0 : 1;
+    }
+
+    if (command == "check")
+    {
+        auto start = chrono::steady_clock::now();
+        bool loaded = index.load(PostalOffsetIndex::sideCarPath(fileName), fileName, error);
+        if (!loaded && !index.build(fileName, error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        double indexMs = millisecondsSince(start);
+
+        start = chrono::steady_clock::now();
+        vector<HeaderRecordPostalCodeItem> swept = PostalRecordParser::parseFile(fileName);
+        double sweepMs = millisecondsSince(start);
+        start = chrono::steady_clock::now();
+        vector<HeaderRecordPostalCodeItem> located = PostalRecordParser::parseFile(fileName, index);
+        double locatedMs = millisecondsSince(start);
+
+        size_t mismatches = swept.size() == located.size() ? 0 : 1;
+        string expected;
+        string actual;
+        for (size_t i = 0; i < swept.size() && i < located.size(); i++)
+        {
+            expected.clear();
+            actual.clear();
+            swept[i].appendData(expected);
+            located[i].appendData(actual);
+            mismatches += expected != actual || index[i].zip != swept[i].getZip();
+        }
+        cout << index.size() << " records, index " << (loaded ? "loaded from side-car" : "built") << " in "
+             << indexMs << " ms" << endl;
+        cout << "parse with line sweep:   " << sweepMs << " ms" << endl;
+        cout << "parse at indexed offsets: " << locatedMs << " ms" << endl;
+        cout << (mismatches == 0 ? "all records match" : "MISMATCH") << endl;
+        return mismatches == 0 ? 0 : 1;
+    }
+
+    cerr << "Usage: offset_index build | offset_index get <zip>... | offset_index check" << endl;
+    return 1;
+}
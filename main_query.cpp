@@ -0,0 +1,145 @@
+/**
+ * @file main_query.cpp
+ * @brief Runs filter / group-by queries over the postal records.
+ *
+ * Usage:
+ * @code
+ * query [predicate...] [--group field]... [--agg kind[:field]]... [--explain]
+ * @endcode
+ * Predicates look like @c state=TX, @c 'latitude>30' or @c 'zip<=10000'
+ * and are combined with AND. Aggregate kinds are count, sum, min, max and
+ * avg. For example, ZIPs per county in Texas north of latitude 30:
+ * @code
+ * query state=TX 'latitude>30' --group county --agg count
+ * @endcode
+ * Results are printed tab-separated with a header line; @c --explain
+ * prints the plan instead of running the query.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "BlockPostalCode.h"
+#include "BlockSequenceSetPostalCode.h"
+#include "readHeaderPostalCodetoBSSBuffer.cpp"
+#include "DirectAddressZipTable.h"
+#include "PostalQuery.h"
+
+using namespace std;
+
+/**
+ * @brief Parses an aggregate argument such as "count" or "avg:latitude".
+ * @param text The argument.
+ * @param spec Receives the aggregate.
+ * @return false if the argument is not a valid aggregate.
+ */
+bool parseAggregate(const string &text, AggregateSpec &spec)
+{
+    static const string kinds[] = {"count", "sum", "min", "max", "avg"};
+    size_t colon = text.find(':');
+    string kind = text.substr(0, colon);
+    spec.field = FIELD_ZIP;
+    if (colon != string::npos &&
+        (!PostalQuery::parseField(text.substr(colon + 1), spec.field) ||
+         PostalQuery::isTextField(spec.field)))
+    {
+        return false;
+    }
+    for (int k = AGG_COUNT; k <= AGG_AVG; k++)
+    {
+        if (kinds[k] == kind)
+        {
+            spec.kind = (AggregateKind)k;
+            return spec.kind == AGG_COUNT || colon != string::npos;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: predicates and query options.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    PostalQuery query;
+    bool explainOnly = false;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        QueryField field;
+        AggregateSpec spec;
+        Predicate predicate;
+        if (arg == "--explain")
+        {
+            explainOnly = true;
+        }
+        else if (arg == "--group" && i + 1 < argc && PostalQuery::parseField(argv[i + 1], field))
+        {
+            query.groupBy(field);
+            i++;
+        }
+        else if (arg == "--agg" && i + 1 < argc && parseAggregate(argv[i + 1], spec))
+        {
+            query.aggregate(spec.kind, spec.field);
+            i++;
+        }
+        else if (PostalQuery::parsePredicate(arg, predicate))
+        {
+            query.predicates.push_back(predicate);
+        }
+        else
+        {
+            cerr << "Invalid argument: " << arg << "\n"
+                 << "Usage: query [predicate...] [--group field]... [--agg kind[:field]]... [--explain]"
+                 << endl;
+            return 1;
+        }
+    }
+
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+
+    BlockSequenceSetPostalCode myBlockSequenceSetPostalCode;
+    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName);
+
+    DirectAddressZipTable zipTable(myBlockSequenceSetPostalCode);
+    BPlusTree<int> tree(10);
+    for (const BlockPostalCode *block = myBlockSequenceSetPostalCode.getHeadBlock();
+         block != nullptr; block = block->getNext())
+    {
+        tree.insert(block->getBlockItem().getZip());
+    }
+
+    QueryEngine engine(myBlockSequenceSetPostalCode, tree, zipTable);
+    if (explainOnly)
+    {
+        cout << engine.explain(query);
+        return 0;
+    }
+
+    auto start = chrono::steady_clock::now();
+    QueryResult result = engine.execute(query);
+    auto stop = chrono::steady_clock::now();
+
+    for (size_t c = 0; c < result.columns.size(); c++)
+    {
+        cout << (c > 0 ? "\t" : "") << result.columns[c];
+    }
+    cout << "\n";
+    for (const vector<string> &row : result.rows)
+    {
+        for (size_t c = 0; c < row.size(); c++)
+        {
+            cout << (c > 0 ? "\t" : "") << row[c];
+        }
+        cout << "\n";
+    }
+
+    cerr << result.rows.size() << " rows in " << fixed << setprecision(2)
+         << chrono::duration<double, milli>(stop - start).count() << " ms" << endl;
+    return 0;
+}
@@ -4,10 +4,13 @@
  */
 
 #include <string>
+#include <iostream>
+#include <unistd.h>
 #include "BlockPostalCode.h"
 #include "BlockSequenceSetPostalCode.h"
 #include "readHeaderPostalCodetoBSSBuffer.cpp"
-#include <fstream>
+#include "BufferedWriter.h"
+#include "PostalSnapshot.h"
 
 using namespace std;
 
@@ -19,48 +22,50 @@ using namespace std;
  * @code
  * recordLength data prevZip nextZip
  * @endcode
- * where "NULL" is used when a link does not exist.
+ * where "NULL" is used when a link does not exist. Lines are formatted
+ * into one reused string and written through a BufferedWriter, so stdout
+ * sees one write() per megabyte instead of a flush per line.
  *
+ * Usage: @code read_block [snapshot] @endcode
+ * With a snapshot image (see main_snapshot.cpp) the records are taken
+ * from the mapped image instead of parsing the text file.
+ *
+ * @param argc Argument count.
+ * @param argv Arguments: optional snapshot image.
  * @return int Exit status
  */
-int main()
+int main(int argc, char *argv[])
 {
     string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input file containing header + length-indicated records
 
     BlockSequenceSetPostalCode myBlockSequenceSetPostalCode; ///< The full Block Sequence Set structure
 
-    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName); ///< Populate BSS from data file
-
-    BlockPostalCode myBlock = myBlockSequenceSetPostalCode.getHead(); ///< Pointer to first block
-
-    // Write first block
-    string blockRecord = to_string(myBlock.getBlockItem().getRecordLength()) + " " +
-                         myBlock.getBlockItem().getData() + " NULL " +
-                         to_string(myBlock.getNext()->getBlockItem().getZip());
-
-    cout << blockRecord << endl;
-
-    myBlock = *myBlock.getNext(); ///< Move to next block
-
-    // Loop through middle blocks
-    while (myBlock.getNext() != nullptr)
+    if (argc > 1)
     {
-        blockRecord = to_string(myBlock.getBlockItem().getRecordLength()) + " " +
-                      myBlock.getBlockItem().getData() + " " +
-                      to_string(myBlock.getPrev()->getBlockItem().getZip()) + " " +
-                      to_string(myBlock.getNext()->getBlockItem().getZip());
-
-        cout << blockRecord << endl;
-
-        myBlock = *myBlock.getNext(); ///< Advance to next block
+        PostalSnapshot snapshot;
+        string error;
+        if (!snapshot.open(argv[1], error, true))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        snapshot.loadBlockSequenceSet(myBlockSequenceSetPostalCode); ///< Populate BSS from the image
+    }
+    else
+    {
+        inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName); ///< Populate BSS from data file
     }
 
-    // Write last block
-    blockRecord = to_string(myBlock.getBlockItem().getRecordLength()) + " " +
-                  myBlock.getBlockItem().getData() + " " +
-                  to_string(myBlock.getPrev()->getBlockItem().getZip()) + " NULL";
-
-    cout << blockRecord << endl;
+    BufferedWriter out(STDOUT_FILENO);
+    string blockRecord; ///< Reused line buffer
+    for (const BlockPostalCode *block = myBlockSequenceSetPostalCode.getHeadBlock();
+         block != nullptr; block = block->getNext())
+    {
+        blockRecord.clear();
+        block->appendRecord(blockRecord);
+        blockRecord += '\n';
+        out.write(blockRecord);
+    }
 
-    return 0;
-}
\ No newline at end of file
+    return out.flush() ? 0 : 1;
+}
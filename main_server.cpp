@@ -0,0 +1,253 @@
+/**
+ * @file main_server.cpp
+ * @brief Long-running postal query server on a Unix domain socket.
+ *
+ * Usage:
+ * @code
+ * server [socketPath] [workers] [cacheEntries] [statsSeconds] [deltaFile]
+ * @endcode
+ * Loads the dataset and builds the ZIP, range and spatial indexes, then
+ * serves lookup, range and nearest requests (see PostalProtocol.h) until
+ * interrupted. The default socket path is /tmp/postal.sock.
+ *
+ * SIGHUP reloads the data file: a background thread builds a new
+ * PostalDataset while the workers keep answering from the old one, then
+ * publishes it (see PostalDatasetPublisher). Cached results are tagged
+ * with the dataset version, so the new version never sees the old one's
+ * payloads; the cache is then cleared to drop them.
+ *
+ * SIGUSR1 applies a delta file (see PostalDelta.h; default
+ * postal_delta.txt) the same way: the next version is derived from the
+ * current one with the delta applied and then published. Only the changed
+ * ZIPs differ, so the cache keeps its other entries for the new version
+ * and drops those of the ZIPs the delta touched.
+ *
+ * Lookups go through a result cache of @c cacheEntries encoded records
+ * (default 4096, 0 disables it). Its hit-rate counters are printed as JSON
+ * every @c statsSeconds seconds (default 10) and on shutdown.
+ */
+
+#include <string>
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <condition_variable>
+#include <iostream>
+#include <iomanip>
+#include "PostalDataset.h"
+#include "PostalDatasetPublisher.h"
+#include "PostalDelta.h"
+#include "PostalServer.h"
+#include "ZipResultCache.h"
+
+using namespace std;
+
+static PostalServer *activeServer = nullptr; ///< Server stopped by the signal handler
+static atomic<bool> reloadRequested(false);  ///< Set by SIGHUP
+static atomic<bool> deltaRequested(false);   ///< Set by SIGUSR1
+
+/**
+ * @brief Stops the server on SIGINT / SIGTERM.
+ * @param signalNumber The signal received.
+ */
+static void handleStopSignal(int signalNumber)
+{
+    (void)signalNumber;
+    if (activeServer != nullptr)
+    {
+        activeServer->stop();
+    }
+}
+
+/**
+ * @brief Requests a reload of the data file on SIGHUP.
+ * @param signalNumber The signal received.
+ */
+static void handleReloadSignal(int signalNumber)
+{
+    (void)signalNumber;
+    reloadRequested = true;
+}
+
+/**
+ * @brief Requests a delta update on SIGUSR1.
+ * @param signalNumber The signal received.
+ */
+static void handleDeltaSignal(int signalNumber)
+{
+    (void)signalNumber;
+    deltaRequested = true;
+}
+
+/**
+ * @brief Loads a dataset and reports how long it took.
+ * @param fileName The data file.
+ * @return The dataset, or nullptr (after printing the reason) on failure.
+ */
+static unique_ptr<PostalDataset> loadDataset(const string &fileName)
+{
+    auto start = chrono::steady_clock::now();
+    unique_ptr<PostalDataset> dataset(new PostalDataset());
+    string error;
+    if (!dataset->load(fileName, error))
+    {
+        cerr << error << endl;
+        return nullptr;
+    }
+    cout << "Loaded " << dataset->getTable().size() << " ZIPs from " << fileName << " (indexes built in "
+         << fixed << setprecision(1)
+         << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms)" << endl;
+    return dataset;
+}
+
+/**
+ * @brief Publishes the current dataset with a delta applied, keeping the cache warm.
+ *
+ * Runs on the only thread that publishes, so the new dataset becomes the
+ * version after the current one.
+ *
+ * @param datasets The publisher.
+ * @param cache Result cache of the server.
+ * @param deltaPath The delta file.
+ */
+static void applyDelta(PostalDatasetPublisher &datasets, ZipResultCache &cache, const string &deltaPath)
+{
+    auto start = chrono::steady_clock::now();
+    PostalDelta delta;
+    PostalDelta::Summary summary;
+    string error;
+    unique_ptr<PostalDataset> next(new PostalDataset());
+    vector<int> changed;
+    bool built = delta.read(deltaPath, error);
+    if (built)
+    {
+        PostalDatasetPublisher::ReadGuard current(datasets);
+        built = next->derive(*current, delta, summary, error, [&changed](int zip)
+                             { changed.push_back(zip); });
+    }
+    if (!built)
+    {
+        cerr << error << "; delta not applied" << endl;
+        return;
+    }
+
+    // Entries of unchanged ZIPs stay valid; see ZipResultCache::carryOver() for the order
+    uint64_t version = datasets.getVersion();
+    cache.carryOver(version, version + 1);
+    for (int zip : changed)
+    {
+        cache.invalidate(zip);
+    }
+    version = datasets.publish(move(next));
+    cout << "Published version " << version << " with " << summary.added << " added, " << summary.updated
+         << " updated, " << summary.deleted << " deleted from " << deltaPath << " in " << fixed
+         << setprecision(1) << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count()
+         << " ms" << endl;
+}
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: socket path, worker count, cache entries, report interval and delta file.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string socketPath = argc > 1 ? argv[1] : "/tmp/postal.sock";
+    int workers = argc > 2 ? stoi(argv[2]) : 0;
+    size_t cacheEntries = argc > 3 ? stoul(argv[3]) : 4096;
+    int statsSeconds = argc > 4 ? stoi(argv[4]) : 10;
+    string deltaPath = argc > 5 ? argv[5] : "postal_delta.txt";
+
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+
+    unique_ptr<PostalDataset> initial = loadDataset(fileName);
+    if (!initial)
+    {
+        return 1;
+    }
+    PostalDatasetPublisher datasets(move(initial));
+
+    ZipResultCache cache(cacheEntries);
+    PostalServer server(datasets);
+    if (cacheEntries > 0)
+    {
+        server.setCache(&cache);
+    }
+    if (!server.listen(socketPath))
+    {
+        return 1;
+    }
+    activeServer = &server;
+    signal(SIGINT, handleStopSignal);
+    signal(SIGTERM, handleStopSignal);
+    signal(SIGHUP, handleReloadSignal);
+    signal(SIGUSR1, handleDeltaSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    cout << "Serving on " << socketPath << endl;
+
+    // Periodic cache report
+    mutex reportLock;
+    condition_variable reportWake;
+    bool serving = true;
+    thread reporter([&]()
+                    {
+        unique_lock<mutex> guard(reportLock);
+        while (statsSeconds > 0 && cacheEntries > 0 &&
+               !reportWake.wait_for(guard, chrono::seconds(statsSeconds), [&] { return !serving; }))
+        {
+            cout << "cache " << cache.stats().toJson() << endl;
+        } });
+
+    // Reloads requested by SIGHUP and deltas requested by SIGUSR1, built while the old dataset is served
+    thread reloader([&]()
+                    {
+        unique_lock<mutex> guard(reportLock);
+        while (!reportWake.wait_for(guard, chrono::milliseconds(200), [&] { return !serving; }))
+        {
+            if (deltaRequested.exchange(false))
+            {
+                guard.unlock();
+                applyDelta(datasets, cache, deltaPath);
+                guard.lock();
+            }
+            if (!reloadRequested.exchange(false))
+            {
+                continue;
+            }
+            guard.unlock();
+            unique_ptr<PostalDataset> next = loadDataset(fileName);
+            if (next)
+            {
+                auto start = chrono::steady_clock::now();
+                uint64_t version = datasets.publish(move(next));
+                cache.clear(); // frees old-version entries; they already miss
+                cout << "Published version " << version << ", old version reclaimed after "
+                     << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms"
+                     << endl;
+            }
+            guard.lock();
+        } });
+
+    server.run(workers);
+    activeServer = nullptr;
+    {
+        lock_guard<mutex> guard(reportLock);
+        serving = false;
+    }
+    reportWake.notify_all();
+    reporter.join();
+    reloader.join();
+
+    cout << "Stopped after " << server.requestsServed() << " requests" << endl;
+    if (cacheEntries > 0)
+    {
+        cout << "cache " << cache.stats().toJson() << endl;
+    }
+    return 0;
+}
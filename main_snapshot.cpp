@@ -0,0 +1,223 @@
+/**
+ * @file main_snapshot.cpp
+ * @brief Saves the postal dataset as a binary snapshot and answers queries from one.
+ *
+ * Usage:
+ * @code
+ * snapshot save  [image]
+ * snapshot info  [image]
+ * snapshot query <image> <file|->
+ * @endcode
+ * @c save parses the length-indicated text file and writes the image
+ * (default: postal_codes.snapshot). @c info maps an image, verifies its
+ * checksum and prints its contents. @c query reads ZIPs (@c 501) and
+ * inclusive ZIP ranges (@c 501-600), one per line, and writes the same
+ * TSV rows as @c search @c --batch, straight from the mapped image:
+ * nothing is parsed or rebuilt at startup.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+#include "PostalRecordParser.h"
+#include "PostalRecordPacked.h"
+#include "PostalSnapshot.h"
+#include "BufferedWriter.h"
+
+using namespace std;
+
+/**
+ * @brief Gets the time since a start point.
+ * @param start The start point.
+ * @return Elapsed milliseconds.
+ */
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Writes one lookup result as a TSV row.
+ * @param out Destination writer.
+ * @param zip The ZIP that was looked up.
+ * @param record The record, or nullptr if the ZIP is absent.
+ * @param names The image's overflow names.
+ */
+static void writeRow(BufferedWriter &out, int zip, const PostalRecordPacked *record,
+                     const PostalSnapshot::NameTable &names)
+{
+    if (record == nullptr)
+    {
+        out.writeInt(zip);
+        out.write("\t0\t\t\t\t\t\n");
+        return;
+    }
+    string_view place = record->getPlace(names);
+    string_view state = record->getState();
+    string_view county = record->getCounty(names);
+    out.writeInt(record->getZip());
+    out.write("\t1\t");
+    out.write(place.data(), place.size());
+    out.put('\t');
+    out.write(state.data(), state.size());
+    out.put('\t');
+    out.write(county.data(), county.size());
+    out.put('\t');
+    out.writeDouble(record->getLatitude(), 4);
+    out.put('\t');
+    out.writeDouble(record->getLongitude(), 4);
+    out.put('\n');
+}
+
+/**
+ * @brief Answers a query file from a snapshot.
+ * @param snapshot The open snapshot.
+ * @param path Query file, or "-" for stdin.
+ * @return int Exit status
+ */
+static int runQueries(const PostalSnapshot &snapshot, const string &path)
+{
+    ifstream file;
+    if (path != "-")
+    {
+        file.open(path);
+        if (!file)
+        {
+            cerr << "Cannot open query file " << path << endl;
+            return 1;
+        }
+    }
+    istream &input = path == "-" ? cin : file;
+    ios::sync_with_stdio(false);
+
+    BufferedWriter out(STDOUT_FILENO);
+    out.write("zip\tfound\tplace\tstate\tcounty\tlatitude\tlongitude\n");
+    size_t queryCount = 0, invalidCount = 0, rowCount = 0;
+
+    auto start = chrono::steady_clock::now();
+    string line;
+    while (getline(input, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        char *end;
+        long lower = strtol(line.c_str(), &end, 10);
+        long upper = lower;
+        bool isRange = end != line.c_str() && *end == '-';
+        if (isRange)
+        {
+            const char *upperStart = end + 1;
+            upper = strtol(upperStart, &end, 10);
+            if (end == upperStart)
+            {
+                end = (char *)line.c_str();
+            }
+        }
+        if (end == line.c_str() || *end != '\0' || lower < 0 || upper < lower ||
+            upper >= PostalSnapshot::ZIP_DOMAIN)
+        {
+            invalidCount++;
+            continue;
+        }
+
+        queryCount++;
+        if (!isRange)
+        {
+            writeRow(out, (int)lower, snapshot.find((int)lower), snapshot.getNames());
+            rowCount++;
+            continue;
+        }
+        for (size_t i = snapshot.lowerBound((int)lower); i < snapshot.size() && snapshot.getZip(i) <= upper; i++)
+        {
+            writeRow(out, snapshot.getZip(i), &snapshot[i], snapshot.getNames());
+            rowCount++;
+        }
+    }
+    bool written = out.flush();
+
+    double ms = millisecondsSince(start);
+    cerr << queryCount << " queries (" << invalidCount << " invalid lines), " << rowCount << " rows, "
+         << out.getBytesWritten() << " bytes in " << ms << " ms: "
+         << (long)(queryCount / (ms > 0 ? ms / 1000 : 1)) << " queries/s (snapshot)" << endl;
+    return written ? 0 : 1;
+}
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: command and its operands.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+    string command = argc > 1 ? argv[1] : "";
+    string imagePath = argc > 2 ? argv[2] : "postal_codes.snapshot";
+    string error;
+
+    if (command == "save")
+    {
+        auto start = chrono::steady_clock::now();
+        vector<HeaderRecordPostalCodeItem> items = PostalRecordParser::parseFile(fileName);
+        if (items.empty())
+        {
+            cerr << "No records read from " << fileName << endl;
+            return 1;
+        }
+        PackedPostalTable table;
+        table.reserve(items.size());
+        for (const HeaderRecordPostalCodeItem &item : items)
+        {
+            table.add(item);
+        }
+        if (!PostalSnapshot::write(imagePath, table, error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        cout << "Wrote " << table.size() << " records to " << imagePath << " in "
+             << millisecondsSince(start) << " ms" << endl;
+        return 0;
+    }
+
+    if (command == "info" || (command == "query" && argc > 3))
+    {
+        PostalSnapshot snapshot;
+        auto start = chrono::steady_clock::now();
+        if (!snapshot.open(imagePath, error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        double openMs = millisecondsSince(start);
+        if (command == "query")
+        {
+            return runQueries(snapshot, argv[3]);
+        }
+
+        start = chrono::steady_clock::now();
+        bool intact = snapshot.verify();
+        double verifyMs = millisecondsSince(start);
+        cout << imagePath << ": " << snapshot.getImageBytes() << " bytes, " << snapshot.size() << " records"
+             << endl;
+        cout << "opened in " << openMs * 1000 << " us, checksum "
+             << (intact ? "ok" : "MISMATCH") << " (" << verifyMs << " ms)" << endl;
+        if (snapshot.size() > 0)
+        {
+            cout << "ZIPs " << snapshot.getZip(0) << " to " << snapshot.getZip(snapshot.size() - 1) << endl;
+        }
+        return intact ? 0 : 1;
+    }
+
+    cerr << "Usage: snapshot save [image] | snapshot info [image] | snapshot query <image> <file|->" << endl;
+    return 1;
+}
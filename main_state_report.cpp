@@ -0,0 +1,85 @@
+/**
+ * @file main_state_report.cpp
+ * @brief Prints the per-state (or per-county) extremes and counts report.
+ *
+ * Usage:
+ * @code
+ * state_report [state|county] [copies] [threads]
+ * @endcode
+ * For every group prints the record count, the northernmost, southernmost,
+ * easternmost and westernmost ZIP, and the centroid. @c copies replicates
+ * the dataset to measure the engine on millions of rows; the aggregation
+ * time is reported at the end. Parsing and aggregation run on a
+ * WorkStealingPool of @c threads workers (default: one per hardware thread).
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include "PostalRecordParser.h"
+#include "PostalAggregator.h"
+#include "WorkStealingPool.h"
+
+using namespace std;
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: grouping, replication factor and thread count.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string mode = argc > 1 ? argv[1] : "state";
+    int copies = argc > 2 ? stoi(argv[2]) : 1;
+    int threads = argc > 3 ? stoi(argv[3]) : 0;
+    GroupBy groupBy = mode == "county" ? GROUP_BY_STATE_COUNTY : GROUP_BY_STATE;
+
+    string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+
+    WorkStealingPool pool(threads);
+    vector<HeaderRecordPostalCodeItem> parsed = PostalRecordParser::parseFile(fileName, pool);
+
+    vector<HeaderRecordPostalCodeItem> records;
+    records.reserve(parsed.size() * copies);
+    for (int copy = 0; copy < copies; copy++)
+    {
+        records.insert(records.end(), parsed.begin(), parsed.end());
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<GroupAggregate> groups = PostalAggregator::aggregate(records, groupBy, pool);
+    auto stop = chrono::steady_clock::now();
+
+    cout << left << setw(4) << "St";
+    if (groupBy == GROUP_BY_STATE_COUNTY)
+    {
+        cout << setw(24) << "County";
+    }
+    cout << right << setw(9) << "Count" << setw(8) << "North" << setw(8) << "South"
+         << setw(8) << "East" << setw(8) << "West" << setw(11) << "CentLat"
+         << setw(11) << "CentLon" << endl;
+
+    cout << fixed << setprecision(4);
+    for (const GroupAggregate &group : groups)
+    {
+        cout << left << setw(4) << group.state;
+        if (groupBy == GROUP_BY_STATE_COUNTY)
+        {
+            cout << setw(24) << group.county;
+        }
+        cout << right << setw(9) << group.count
+             << setw(8) << group.northmost.zip << setw(8) << group.southmost.zip
+             << setw(8) << group.eastmost.zip << setw(8) << group.westmost.zip
+             << setw(11) << group.centroidLatitude() << setw(11) << group.centroidLongitude() << endl;
+    }
+
+    cout << "\n"
+         << groups.size() << " groups over " << records.size() << " records in "
+         << setprecision(1) << chrono::duration<double, milli>(stop - start).count()
+         << " ms" << endl;
+
+    return 0;
+}
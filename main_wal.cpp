@@ -0,0 +1,382 @@
+/**
+ * @file main_wal.cpp
+ * @brief Applies deltas durably and exercises the write-ahead log.
+ *
+ * Usage:
+ * @code
+ * wal apply <delta file|->
+ * wal checkpoint
+ * wal recover
+ * wal bench [threads] [commits per thread] [commit interval us]
+ * wal crashtest [rounds]
+ * @endcode
+ * @c apply, @c checkpoint and @c recover work on postal_codes.snapshot
+ * (the checkpoint image) and postal_codes.wal (the log), creating both
+ * from the data file on first use; @c recover only opens the store and
+ * reports what was replayed.
+ *
+ * @c bench and @c crashtest use scratch files that are removed at the end.
+ * @c bench runs threads that each commit single-record updates and
+ * reports durable commits per second and how many commits shared an
+ * fsync. @c crashtest starts a writer process that commits updates (and
+ * checkpoints now and then), kills it with SIGKILL at a random moment,
+ * adds a torn record to the log, recovers, and checks that every update
+ * the writer saw acknowledged survived.
+ */
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <sstream>
+#include <iostream>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "DurablePostalStore.h"
+
+using namespace std;
+
+const string IMAGE_FILE = "postal_codes.snapshot";          ///< Checkpoint image
+const string LOG_FILE = "postal_codes.wal";                 ///< Write-ahead log
+const string SCRATCH_IMAGE_FILE = "postal_codes_test.snapshot"; ///< Image used by bench and crashtest
+const string SCRATCH_LOG_FILE = "postal_codes_test.wal";    ///< Log used by bench and crashtest
+const string DATA_FILE = "us_postal_codes_length_indicated_header_record.txt"; ///< Input postal data file
+
+/**
+ * @brief Gets the time since a start point.
+ * @param start The start point.
+ * @return Elapsed milliseconds.
+ */
+static double millisecondsSince(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Opens a store and reports the recovery.
+ * @param store The store.
+ * @param image Checkpoint image.
+ * @param logFile Write-ahead log.
+ * @param quiet true to print nothing on success.
+ * @return false if the store cannot be opened.
+ */
+static bool openStore(DurablePostalStore &store, const string &image, const string &logFile, bool quiet = false)
+{
+    string error;
+    auto start = chrono::steady_clock::now();
+    if (!store.open(image, logFile, DATA_FILE, error))
+    {
+        cerr << error << endl;
+        return false;
+    }
+    if (!quiet)
+    {
+        cout << "opened " << store.getSequenceSet().getCurrentSize() << " records in " << millisecondsSince(start)
+             << " ms, replayed " << store.getReplayedChanges() << " logged changes after LSN "
+             << store.getLog().getCheckpointLsn() << endl;
+    }
+    return true;
+}
+
+/**
+ * @brief Builds a one-line delta that renames a record.
+ * @param record The current record.
+ * @param place The new place name.
+ * @return The delta.
+ */
+static PostalDelta renameDelta(const HeaderRecordPostalCodeItem &record, const string &place)
+{
+    ostringstream line;
+    line.setf(ios::fixed);
+    line.precision(4);
+    line << "U," << record.getZip() << "," << place << "," << record.getState() << "," << record.getCounty()
+         << "," << record.getLatitude() << "," << record.getLongitude() << "\n";
+    istringstream input(line.str());
+    PostalDelta delta;
+    string error;
+    delta.parse(input, error);
+    return delta;
+}
+
+/**
+ * @brief Removes the scratch image and log.
+ */
+static void removeScratchFiles()
+{
+    unlink(SCRATCH_IMAGE_FILE.c_str());
+    unlink(SCRATCH_LOG_FILE.c_str());
+}
+
+/**
+ * @brief Measures durable commit throughput with concurrent committers.
+ * @param threads Committing threads.
+ * @param commits Commits per thread.
+ * @param interval Commit interval of the log.
+ * @return int Exit status
+ */
+static int runBench(int threads, int commits, chrono::microseconds interval)
+{
+    removeScratchFiles();
+    DurablePostalStore store(interval);
+    if (!openStore(store, SCRATCH_IMAGE_FILE, SCRATCH_LOG_FILE, true))
+    {
+        return 1;
+    }
+    vector<HeaderRecordPostalCodeItem> records;
+    for (const BlockPostalCode *block = store.getSequenceSet().getHeadBlock(); block != nullptr;
+         block = block->getNext())
+    {
+        records.push_back(block->getBlockItem());
+    }
+
+    // Prepare every delta up front so only apply() is timed
+    vector<vector<PostalDelta>> deltas(threads);
+    for (int t = 0; t < threads; t++)
+    {
+        for (int i = 0; i < commits; i++)
+        {
+            const HeaderRecordPostalCodeItem &record = records[(size_t)(t * commits + i) % records.size()];
+            deltas[t].push_back(renameDelta(record, record.getPlace() + " " + to_string(i)));
+        }
+    }
+
+    size_t failures = 0;
+    mutex failureLock;
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++)
+    {
+        workers.emplace_back([&, t]()
+                             {
+            for (const PostalDelta &delta : deltas[t])
+            {
+                PostalDelta::Summary summary;
+                string error;
+                if (!store.apply(delta, summary, error))
+                {
+                    lock_guard<mutex> guard(failureLock);
+                    failures++;
+                }
+            } });
+    }
+    for (thread &worker : workers)
+    {
+        worker.join();
+    }
+    double ms = millisecondsSince(start);
+
+    PostalWriteAheadLog::Stats stats = store.getLog().getStats();
+    long total = (long)threads * commits;
+    cout << threads << " threads x " << commits << " commits, interval " << interval.count() << " us: "
+         << (long)(total / (ms / 1000)) << " durable commits/s, " << stats.syncs << " fsyncs ("
+         << (double)total / (stats.syncs ? stats.syncs : 1) << " commits per fsync)" << endl;
+    removeScratchFiles();
+    return failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Commits updates until killed, reporting each acknowledged one on a pipe.
+ * @param out Write end of the pipe.
+ * @param seed Random seed.
+ */
+static void runCrashWriter(int out, unsigned seed)
+{
+    DurablePostalStore store(chrono::microseconds(500));
+    if (!openStore(store, SCRATCH_IMAGE_FILE, SCRATCH_LOG_FILE, true))
+    {
+        _exit(1);
+    }
+    vector<int> zips;
+    for (const BlockPostalCode *block = store.getSequenceSet().getHeadBlock(); block != nullptr;
+         block = block->getNext())
+    {
+        zips.push_back(block->getBlockItem().getZip());
+    }
+    mt19937 rng(seed);
+    for (uint32_t version = 1;; version++)
+    {
+        int zip = zips[rng() % zips.size()];
+        HeaderRecordPostalCodeItem record;
+        store.lookup(zip, record);
+        PostalDelta delta = renameDelta(record, "Crash " + to_string(version));
+        PostalDelta::Summary summary;
+        string error;
+        if (!store.apply(delta, summary, error))
+        {
+            _exit(1);
+        }
+        int32_t acknowledged[2] = {zip, (int32_t)version};
+        if (write(out, acknowledged, sizeof(acknowledged)) != sizeof(acknowledged))
+        {
+            _exit(1);
+        }
+        if (version % 500 == 0 && !store.checkpoint(error))
+        {
+            _exit(1);
+        }
+    }
+}
+
+/**
+ * @brief Gets the version written by runCrashWriter() into a place name.
+ * @param place The place name.
+ * @return The version, or 0 if the record was not renamed.
+ */
+static uint32_t crashVersion(const string &place)
+{
+    return place.compare(0, 6, "Crash ") == 0 ? stoul(place.substr(6)) : 0;
+}
+
+/**
+ * @brief Kills a writer at random moments and checks what recovery restores.
+ * @param rounds Number of kill / recover rounds.
+ * @return int Exit status
+ */
+static int runCrashTest(int rounds)
+{
+    removeScratchFiles();
+    mt19937 rng(7);
+    size_t lost = 0;
+    for (int round = 0; round < rounds; round++)
+    {
+        int channel[2];
+        if (pipe(channel) != 0)
+        {
+            return 1;
+        }
+        pid_t writer = fork();
+        if (writer == 0)
+        {
+            close(channel[0]);
+            runCrashWriter(channel[1], rng());
+        }
+        close(channel[1]);
+        this_thread::sleep_for(chrono::milliseconds(200 + rng() % 400));
+        kill(writer, SIGKILL);
+        waitpid(writer, nullptr, 0);
+
+        // The last acknowledged version of every ZIP must have survived
+        vector<uint32_t> acknowledged(DirectAddressZipTable::ZIP_DOMAIN, 0);
+        int32_t message[2];
+        size_t count = 0;
+        while (read(channel[0], message, sizeof(message)) == sizeof(message))
+        {
+            acknowledged[message[0]] = message[1];
+            count++;
+        }
+        close(channel[0]);
+
+        // A torn record: the header of a write that never finished
+        int fd = open(SCRATCH_LOG_FILE.c_str(), O_WRONLY | O_APPEND);
+        char torn[24] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+        bool tornWritten = fd >= 0 && write(fd, torn, sizeof(torn)) == sizeof(torn);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+
+        DurablePostalStore store;
+        if (!tornWritten || !openStore(store, SCRATCH_IMAGE_FILE, SCRATCH_LOG_FILE, true))
+        {
+            return 1;
+        }
+        size_t missing = 0;
+        for (int zip = 0; zip < DirectAddressZipTable::ZIP_DOMAIN; zip++)
+        {
+            HeaderRecordPostalCodeItem record;
+            if (acknowledged[zip] != 0 &&
+                (!store.lookup(zip, record) || crashVersion(record.getPlace()) < acknowledged[zip]))
+            {
+                missing++;
+            }
+        }
+        lost += missing;
+        cout << "round " << round + 1 << ": " << count << " acknowledged updates, replayed "
+             << store.getReplayedChanges() << " after LSN " << store.getLog().getCheckpointLsn() << ", "
+             << missing << " lost" << endl;
+    }
+    removeScratchFiles();
+    cout << (lost == 0 ? "no acknowledged update was lost" : "ACKNOWLEDGED UPDATES LOST") << endl;
+    return lost == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Program entry point.
+ * @param argc Argument count.
+ * @param argv Arguments: command and its operands.
+ * @return int Exit status
+ */
+int main(int argc, char *argv[])
+{
+    string command = argc > 1 ? argv[1] : "";
+
+    if (command == "apply" && argc > 2)
+    {
+        PostalDelta delta;
+        string error;
+        if (!delta.read(argv[2], error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        DurablePostalStore store;
+        if (!openStore(store, IMAGE_FILE, LOG_FILE))
+        {
+            return 1;
+        }
+        PostalDelta::Summary summary;
+        auto start = chrono::steady_clock::now();
+        if (!store.apply(delta, summary, error))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        cout << summary.added << " added, " << summary.updated << " updated, " << summary.deleted
+             << " deleted; durable in " << millisecondsSince(start) << " ms (last LSN "
+             << store.getLog().getLastLsn() << ")" << endl;
+        return 0;
+    }
+
+    if (command == "checkpoint" || command == "recover")
+    {
+        DurablePostalStore store;
+        if (!openStore(store, IMAGE_FILE, LOG_FILE))
+        {
+            return 1;
+        }
+        if (command == "checkpoint")
+        {
+            string error;
+            auto start = chrono::steady_clock::now();
+            if (!store.checkpoint(error))
+            {
+                cerr << error << endl;
+                return 1;
+            }
+            cout << "checkpoint at LSN " << store.getLog().getCheckpointLsn() << " written in "
+                 << millisecondsSince(start) << " ms" << endl;
+        }
+        return 0;
+    }
+
+    if (command == "bench")
+    {
+        int threads = argc > 2 ? stoi(argv[2]) : 8;
+        int commits = argc > 3 ? stoi(argv[3]) : 500;
+        long interval = argc > 4 ? stol(argv[4]) : 0;
+        return runBench(threads, commits, chrono::microseconds(interval));
+    }
+
+    if (command == "crashtest")
+    {
+        return runCrashTest(argc > 2 ? stoi(argv[2]) : 5);
+    }
+
+    cerr << "Usage: wal apply <delta file|-> | wal checkpoint | wal recover | "
+            "wal bench [threads] [commits] [interval us] | wal crashtest [rounds]"
+         << endl;
+    return 1;
+}
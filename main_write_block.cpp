@@ -9,65 +9,99 @@
  */
 
 #include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <iostream>
 #include "BlockPostalCode.h"
 #include "BlockSequenceSetPostalCode.h"
-#include "readHeaderPostalCodetoBSSBuffer.cpp"
-#include <fstream>
+#include "PostalRecordParser.h"
+#include "WorkStealingPool.h"
+#include "BufferedWriter.h"
+#include "PostalSnapshot.h"
 
 using namespace std;
 
+static const size_t BLOCKS_PER_TASK = 2048; ///< Blocks formatted by one pool task
+static const size_t RECORD_BYTES_HINT = 80; ///< Typical formatted block record, for reserve()
+
 /**
  * @brief Program entry point.
  * Loads postal code data into a Block Sequence Set and writes
  * block data to block_sequence_set_data.txt.
  *
  * Block records include record length, data, previous block ZIP, and next block ZIP.
- * "NULL" is written where a link does not exist.
+ * "NULL" is written where a link does not exist. Parsing and formatting
+ * run on the shared WorkStealingPool: each task formats a run of blocks
+ * into its own chunk with BlockPostalCode::appendRecord(), and the chunks
+ * are written in block order with writev().
+ *
+ * Usage: @code write_block [snapshot] @endcode
+ * With a snapshot image (see main_snapshot.cpp) the records are taken
+ * from the mapped image instead of parsing the text file.
  *
+ * @param argc Argument count.
+ * @param argv Arguments: optional snapshot image.
  * @return int Exit status
  */
-int main()
+int main(int argc, char *argv[])
 {
     string fileName = "us_postal_codes_length_indicated_header_record.txt"; ///< Input file for BSS population
+    string outputName = "block_sequence_set_data.txt";                      ///< Output file for block sequence set
 
+    WorkStealingPool &pool = WorkStealingPool::shared();
     BlockSequenceSetPostalCode myBlockSequenceSetPostalCode; ///< BSS object storing all blocks
 
-    inputDatatoBlockSequenceSet(myBlockSequenceSetPostalCode, fileName); ///< Fill BSS from input file
-
-    ofstream outputFile("block_sequence_set_data.txt"); ///< Output file for block sequence set
-
-    BlockPostalCode myBlock = myBlockSequenceSetPostalCode.getHead(); ///< First block
-
-    // Write first block
-    string blockRecord = to_string(myBlock.getBlockItem().getRecordLength()) + " " +
-                         myBlock.getBlockItem().getData() + " NULL " +
-                         to_string(myBlock.getNext()->getBlockItem().getZip());
-
-    outputFile << blockRecord << endl;
-
-    myBlock = *myBlock.getNext(); ///< Move to next block
-
-    // Loop through middle blocks
-    while (myBlock.getNext() != nullptr)
+    if (argc > 1)
     {
-        blockRecord = to_string(myBlock.getBlockItem().getRecordLength()) + " " +
-                      myBlock.getBlockItem().getData() + " " +
-                      to_string(myBlock.getPrev()->getBlockItem().getZip()) + " " +
-                      to_string(myBlock.getNext()->getBlockItem().getZip());
-
-        outputFile << blockRecord << endl;
-
-        myBlock = *myBlock.getNext(); ///< Advance to next block
+        PostalSnapshot snapshot;
+        string error;
+        if (!snapshot.open(argv[1], error, true))
+        {
+            cerr << error << endl;
+            return 1;
+        }
+        snapshot.loadBlockSequenceSet(myBlockSequenceSetPostalCode); ///< Fill BSS from the image
+    }
+    else
+    {
+        PostalRecordParser::loadBlockSequenceSet(myBlockSequenceSetPostalCode, fileName, pool); ///< Fill BSS from input file
     }
 
-    // Write last block
-    blockRecord = to_string(myBlock.getBlockItem().getRecordLength()) + " " +
-                  myBlock.getBlockItem().getData() + " " +
-                  to_string(myBlock.getPrev()->getBlockItem().getZip()) + " NULL";
-
-    outputFile << blockRecord << endl;
+    vector<const BlockPostalCode *> blocks;
+    for (const BlockPostalCode *block = myBlockSequenceSetPostalCode.getHeadBlock();
+         block != nullptr; block = block->getNext())
+    {
+        blocks.push_back(block);
+    }
 
-    outputFile.close();
+    vector<string> chunks((blocks.size() + BLOCKS_PER_TASK - 1) / BLOCKS_PER_TASK);
+    pool.parallelFor(0, chunks.size(), 1, [&](size_t first, size_t last)
+                     {
+        for (size_t chunk = first; chunk < last; chunk++)
+        {
+            size_t end = min(blocks.size(), (chunk + 1) * BLOCKS_PER_TASK);
+            chunks[chunk].reserve(BLOCKS_PER_TASK * RECORD_BYTES_HINT);
+            for (size_t i = chunk * BLOCKS_PER_TASK; i < end; i++)
+            {
+                blocks[i]->appendRecord(chunks[chunk]);
+                chunks[chunk] += '\n';
+            }
+        } });
+
+    int fd = open(outputName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        cerr << "Cannot create " << outputName << endl;
+        return 1;
+    }
+    bool written;
+    {
+        BufferedWriter outputFile(fd);
+        outputFile.writeBlocks(chunks);
+        written = outputFile.flush();
+    }
+    close(fd);
 
-    return 0;
-}
\ No newline at end of file
+    return written ? 0 : 1;
+}